@@ -0,0 +1,579 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_HASHMAP_H
+#define DM_HASHMAP_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(DM_SIMD_DISABLE)
+    // Use the scalar fallback
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_HASHMAP_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define DM_HASHMAP_NEON
+    #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+/**
+ * Helpers for dmHashMap. The slots of the map are divided into groups of 16, and every slot
+ * has a control byte that is either empty, deleted, or holds 7 bits of the hash of the key
+ * stored in the slot. A lookup compares all control bytes of a group at once and only
+ * compares the keys of the slots with a matching control byte.
+ */
+namespace dmHashMapInternal
+{
+    static const uint32_t GROUP_SIZE    = 16;
+    static const uint8_t  CTRL_EMPTY    = 0x80;
+    static const uint8_t  CTRL_DELETED  = 0xFE;
+
+    // A bit mask with one bit set per matching slot in a group, lowest slot first.
+    // On NEON every slot is four bits wide, and MASK_SHIFT converts a bit index to a slot index.
+    typedef uint64_t Mask;
+
+    static inline uint32_t CountTrailingZeros(uint64_t x)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return (uint32_t)index;
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward(&index, (unsigned long)x))
+            return (uint32_t)index;
+        _BitScanForward(&index, (unsigned long)(x >> 32));
+        return (uint32_t)index + 32;
+#else
+        return (uint32_t)__builtin_ctzll(x);
+#endif
+    }
+
+#if defined(DM_HASHMAP_SSE2)
+    static const uint32_t MASK_SHIFT = 0;
+
+    static inline Mask MatchByte(const uint8_t* ctrl, uint8_t b)
+    {
+        __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)b)));
+    }
+
+    // Empty and deleted slots are the only ones with the high bit set
+    static inline Mask MatchEmptyOrDeleted(const uint8_t* ctrl)
+    {
+        return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+    }
+
+#elif defined(DM_HASHMAP_NEON)
+    static const uint32_t MASK_SHIFT = 2;
+
+    // Narrows a 0x00/0xFF byte per slot compare result to one bit per four bits
+    static inline Mask ToMask(uint8x16_t cmp)
+    {
+        uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+        return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ULL;
+    }
+
+    static inline Mask MatchByte(const uint8_t* ctrl, uint8_t b)
+    {
+        return ToMask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(b)));
+    }
+
+    static inline Mask MatchEmptyOrDeleted(const uint8_t* ctrl)
+    {
+        return ToMask(vcgeq_u8(vld1q_u8(ctrl), vdupq_n_u8(CTRL_EMPTY)));
+    }
+
+#else
+    static const uint32_t MASK_SHIFT = 0;
+
+    // Eight control bytes at a time in a 64 bit word (little endian)
+    static inline uint64_t LoadWord(const uint8_t* ctrl)
+    {
+        uint64_t word;
+        memcpy(&word, ctrl, sizeof(word));
+        return word;
+    }
+
+    // Packs the high bit of each byte into one bit per byte
+    static inline Mask PackHighBits(uint64_t word)
+    {
+        return (((word >> 7) & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56;
+    }
+
+    // Sets the high bit of each byte that equals b
+    static inline uint64_t MatchByteWord(uint64_t word, uint8_t b)
+    {
+        const uint64_t lo7 = 0x7F7F7F7F7F7F7F7FULL;
+        uint64_t x = word ^ (0x0101010101010101ULL * b);
+        return ~(((x & lo7) + lo7) | x | lo7);
+    }
+
+    static inline Mask MatchByte(const uint8_t* ctrl, uint8_t b)
+    {
+        return PackHighBits(MatchByteWord(LoadWord(ctrl), b)) | (PackHighBits(MatchByteWord(LoadWord(ctrl + 8), b)) << 8);
+    }
+
+    static inline Mask MatchEmptyOrDeleted(const uint8_t* ctrl)
+    {
+        return PackHighBits(LoadWord(ctrl)) | (PackHighBits(LoadWord(ctrl + 8)) << 8);
+    }
+#endif
+
+    static inline uint32_t FirstSlot(Mask mask)
+    {
+        return CountTrailingZeros(mask) >> MASK_SHIFT;
+    }
+
+    // Keys are integers, and are often already hashes (dmhash_t), pointers or indices.
+    // A multiplicative hash spreads them over both the group index (high bits) and the
+    // control byte (low 7 bits).
+    template <typename KEY>
+    static inline uint32_t HashKey(KEY key)
+    {
+        if (sizeof(KEY) > sizeof(uint32_t))
+        {
+            uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+            return (uint32_t)(h >> 32);
+        }
+        else
+        {
+            uint32_t h = (uint32_t)key * 0x9E3779B1U;
+            return h ^ (h >> 16);
+        }
+    }
+
+    // At most 7/8 of the slots are used
+    static inline uint32_t MaxLoad(uint32_t slot_count)
+    {
+        return slot_count - slot_count / 8;
+    }
+}
+
+/*# hashmap
+ * Open addressing hash map with memcpy-copy semantics (POD types), for integer keys.
+ * Unlike dmHashTable it grows automatically when it runs out of space, and the keys and values
+ * are stored inline in the slots, which makes lookups cheaper, especially for large maps.
+ * @note Put() and SetCapacity() might move the entries, which invalidates any pointers returned by Get()
+ * @type class
+ * @name dmHashMap
+ */
+template <typename KEY, typename T>
+class dmHashMap
+{
+public:
+    struct Entry
+    {
+        KEY m_Key;
+        T   m_Value;
+    };
+
+    /**
+     * Constructor. Create an empty map with zero capacity
+     * @name dmHashMap
+     */
+    dmHashMap()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    /**
+     * Destructor.
+     * @name ~dmHashMap
+     */
+    ~dmHashMap()
+    {
+        free(m_Ctrl);
+    }
+
+    /**
+     * Removes all the entries from the map. The capacity is kept.
+     * @name Clear
+     */
+    void Clear()
+    {
+        if (m_SlotCount)
+            memset(m_Ctrl, dmHashMapInternal::CTRL_EMPTY, m_SlotCount);
+        m_Count = 0;
+        m_GrowthLeft = dmHashMapInternal::MaxLoad(m_SlotCount);
+    }
+
+    /**
+     * Number of entries stored in the map
+     * @name Size
+     * @return Number of entries.
+     */
+    uint32_t Size() const
+    {
+        return m_Count;
+    }
+
+    /**
+     * Number of entries the map can hold before it grows
+     * @name Capacity
+     * @return [type: uint32_t] the capacity of the map
+     */
+    uint32_t Capacity() const
+    {
+        return dmHashMapInternal::MaxLoad(m_SlotCount);
+    }
+
+    /**
+     * Check if the map is empty
+     * @name Empty
+     * @return true if the map is empty
+     */
+    bool Empty() const
+    {
+        return m_Count == 0;
+    }
+
+    /**
+     * Makes room for at least capacity entries without growing. Never shrinks the map.
+     * @name SetCapacity
+     * @param capacity [type: uint32_t] the number of entries
+     */
+    void SetCapacity(uint32_t capacity)
+    {
+        uint32_t slot_count = dmHashMapInternal::GROUP_SIZE;
+        while (dmHashMapInternal::MaxLoad(slot_count) < capacity)
+        {
+            slot_count *= 2;
+        }
+        if (slot_count > m_SlotCount)
+        {
+            Rehash(slot_count);
+        }
+    }
+
+    /**
+     * Swaps the contents of two maps
+     * @name Swap
+     * @param other [type: dmHashMap<KEY, T>&] the other map
+     */
+    void Swap(dmHashMap<KEY, T>& other)
+    {
+        char buf[sizeof(*this)];
+        memcpy(buf, &other, sizeof(buf));
+        memcpy(&other, this, sizeof(buf));
+        memcpy(this, buf, sizeof(buf));
+    }
+
+    /**
+     * Put key/value pair in the map, replacing the value if the key already exists.
+     * Grows the map if needed.
+     * @name Put
+     * @param key [type: Key] Key
+     * @param value [type: const T&] Value
+     */
+    void Put(KEY key, const T& value)
+    {
+        uint32_t hash = dmHashMapInternal::HashKey(key);
+        uint32_t slot = FindSlot(key, hash);
+        if (slot != INVALID_SLOT)
+        {
+            m_Entries[slot].m_Value = value;
+            return;
+        }
+
+        if (m_SlotCount == 0)
+            Rehash(dmHashMapInternal::GROUP_SIZE);
+
+        slot = FindInsertSlot(hash);
+        if (m_GrowthLeft == 0 && m_Ctrl[slot] == dmHashMapInternal::CTRL_EMPTY)
+        {
+            Grow();
+            slot = FindInsertSlot(hash);
+        }
+        Insert(slot, hash, key, value);
+    }
+
+    /**
+     * Get pointer to value from key
+     * @name Get
+     * @param key [type: Key] Key
+     * @return value [type: T*] Pointer to value. NULL if the key/value pair doesn't exist.
+     */
+    T* Get(KEY key)
+    {
+        uint32_t slot = FindSlot(key, dmHashMapInternal::HashKey(key));
+        return slot != INVALID_SLOT ? &m_Entries[slot].m_Value : 0;
+    }
+
+    /**
+     * Get pointer to value from key. "const" version.
+     * @name Get
+     * @param key [type: Key] Key
+     * @return value [type: const T*] Pointer to value. NULL if the key/value pair doesn't exist.
+     */
+    const T* Get(KEY key) const
+    {
+        uint32_t slot = FindSlot(key, dmHashMapInternal::HashKey(key));
+        return slot != INVALID_SLOT ? &m_Entries[slot].m_Value : 0;
+    }
+
+    /**
+     * Remove key/value pair.
+     * @name Erase
+     * @param key [type: Key] Key to remove
+     * @note Only valid if key exists in map
+     */
+    void Erase(KEY key)
+    {
+        uint32_t slot = FindSlot(key, dmHashMapInternal::HashKey(key));
+        assert(slot != INVALID_SLOT && "Key not found (erase)");
+
+        // A lookup stops at the first group with an empty slot. If the group of the slot has
+        // never been full, no lookup has passed it and the slot can be made empty again.
+        // Otherwise it has to be marked as deleted, which is cleaned up the next time the map is rehashed.
+        const uint8_t* group = m_Ctrl + (slot & ~(dmHashMapInternal::GROUP_SIZE - 1));
+        if (dmHashMapInternal::MatchByte(group, dmHashMapInternal::CTRL_EMPTY))
+        {
+            m_Ctrl[slot] = dmHashMapInternal::CTRL_EMPTY;
+            ++m_GrowthLeft;
+        }
+        else
+        {
+            m_Ctrl[slot] = dmHashMapInternal::CTRL_DELETED;
+        }
+        --m_Count;
+    }
+
+    /**
+     * Iterate over all entries in the map
+     * @name Iterate
+     * @param call_back Call-back called for every entry
+     * @param context Context
+     */
+    template <typename CONTEXT>
+    void Iterate(void (*call_back)(CONTEXT *context, const KEY* key, T* value), CONTEXT* context) const
+    {
+        for (uint32_t i = 0; i < m_SlotCount; ++i)
+        {
+            if (IsFull(m_Ctrl[i]))
+            {
+                Entry* e = &m_Entries[i];
+                call_back(context, &e->m_Key, &e->m_Value);
+            }
+        }
+    }
+
+    /*#
+     * Iterator to the key/value pairs of a map
+     * @struct
+     * @name Iterator
+     * @member GetKey()
+     * @member GetValue()
+     */
+    struct Iterator
+    {
+        // public
+        const KEY&  GetKey()    { return m_Map.m_Entries[m_Slot].m_Key; }
+        const T&    GetValue()  { return m_Map.m_Entries[m_Slot].m_Value; }
+
+        Iterator(dmHashMap<KEY, T>& map)
+            : m_Map(map)
+            , m_Slot(INVALID_SLOT)
+        {
+        }
+
+        bool Next()
+        {
+            for (uint32_t i = m_Slot + 1; i < m_Map.m_SlotCount; ++i)
+            {
+                if (IsFull(m_Map.m_Ctrl[i]))
+                {
+                    m_Slot = i;
+                    return true;
+                }
+            }
+            m_Slot = m_Map.m_SlotCount;
+            return false;
+        }
+
+        // private
+        dmHashMap<KEY, T>&  m_Map;
+        uint32_t            m_Slot;
+    };
+
+    /*#
+     * Get an iterator for the key/value pairs
+     * @name GetIterator
+     * @return iterator [type: dmHashMap<T>::Iterator] the iterator
+     */
+    Iterator GetIterator()
+    {
+        return Iterator(*this);
+    }
+
+    /**
+     * Verify internal structure. "assert" if invalid. For unit testing
+     */
+    void Verify()
+    {
+        uint32_t count = 0;
+        uint32_t empty = 0;
+        for (uint32_t i = 0; i < m_SlotCount; ++i)
+        {
+            if (IsFull(m_Ctrl[i]))
+            {
+                ++count;
+                assert(FindSlot(m_Entries[i].m_Key, dmHashMapInternal::HashKey(m_Entries[i].m_Key)) == i);
+            }
+            else if (m_Ctrl[i] == dmHashMapInternal::CTRL_EMPTY)
+            {
+                ++empty;
+            }
+        }
+        assert(count == m_Count);
+        assert(m_SlotCount == 0 || empty == m_GrowthLeft + (m_SlotCount - dmHashMapInternal::MaxLoad(m_SlotCount)));
+    }
+
+private:
+    static const uint32_t INVALID_SLOT = 0xFFFFFFFF;
+
+    // Forbid assignment operator and copy-constructor
+    dmHashMap(const dmHashMap<KEY, T>&);
+    const dmHashMap<KEY, T>& operator=(const dmHashMap<KEY, T>&);
+
+    static bool IsFull(uint8_t ctrl)
+    {
+        return (ctrl & 0x80) == 0;
+    }
+
+    uint32_t FindSlot(KEY key, uint32_t hash) const
+    {
+        if (m_SlotCount == 0)
+            return INVALID_SLOT;
+
+        uint8_t h2 = (uint8_t)(hash & 0x7F);
+        uint32_t group_mask = m_SlotCount / dmHashMapInternal::GROUP_SIZE - 1;
+        uint32_t group = (hash >> 7) & group_mask;
+        // Triangular probing visits every group when the group count is a power of two
+        for (uint32_t step = 1; ; ++step)
+        {
+            uint32_t base = group * dmHashMapInternal::GROUP_SIZE;
+            const uint8_t* ctrl = m_Ctrl + base;
+            dmHashMapInternal::Mask match = dmHashMapInternal::MatchByte(ctrl, h2);
+            while (match)
+            {
+                uint32_t slot = base + dmHashMapInternal::FirstSlot(match);
+                if (m_Entries[slot].m_Key == key)
+                    return slot;
+                match &= match - 1;
+            }
+            if (dmHashMapInternal::MatchByte(ctrl, dmHashMapInternal::CTRL_EMPTY))
+                return INVALID_SLOT;
+            group = (group + step) & group_mask;
+        }
+    }
+
+    // Returns the first empty or deleted slot in the probe sequence of the hash
+    uint32_t FindInsertSlot(uint32_t hash) const
+    {
+        uint32_t group_mask = m_SlotCount / dmHashMapInternal::GROUP_SIZE - 1;
+        uint32_t group = (hash >> 7) & group_mask;
+        for (uint32_t step = 1; ; ++step)
+        {
+            uint32_t base = group * dmHashMapInternal::GROUP_SIZE;
+            dmHashMapInternal::Mask match = dmHashMapInternal::MatchEmptyOrDeleted(m_Ctrl + base);
+            if (match)
+                return base + dmHashMapInternal::FirstSlot(match);
+            group = (group + step) & group_mask;
+        }
+    }
+
+    void Insert(uint32_t slot, uint32_t hash, KEY key, const T& value)
+    {
+        if (m_Ctrl[slot] == dmHashMapInternal::CTRL_EMPTY)
+            --m_GrowthLeft;
+        m_Ctrl[slot] = (uint8_t)(hash & 0x7F);
+        m_Entries[slot].m_Key = key;
+        m_Entries[slot].m_Value = value;
+        ++m_Count;
+    }
+
+    void Grow()
+    {
+        // If the map is mostly filled with deleted slots, rehash at the same size to clean them up
+        uint32_t slot_count = m_SlotCount;
+        if (m_Count >= dmHashMapInternal::MaxLoad(m_SlotCount) / 2)
+            slot_count *= 2;
+        Rehash(slot_count);
+    }
+
+    void Rehash(uint32_t slot_count)
+    {
+        // The control bytes are followed by the entries. The slot count is a multiple of the
+        // group size, which keeps the entries 16 byte aligned.
+        uint8_t* ctrl = (uint8_t*)malloc(slot_count + sizeof(Entry) * slot_count);
+        memset(ctrl, dmHashMapInternal::CTRL_EMPTY, slot_count);
+
+        uint8_t* old_ctrl = m_Ctrl;
+        Entry* old_entries = m_Entries;
+        uint32_t old_slot_count = m_SlotCount;
+
+        m_Ctrl = ctrl;
+        m_Entries = (Entry*)(ctrl + slot_count);
+        m_SlotCount = slot_count;
+        m_Count = 0;
+        m_GrowthLeft = dmHashMapInternal::MaxLoad(slot_count);
+
+        for (uint32_t i = 0; i < old_slot_count; ++i)
+        {
+            if (IsFull(old_ctrl[i]))
+            {
+                const Entry& e = old_entries[i];
+                uint32_t hash = dmHashMapInternal::HashKey(e.m_Key);
+                Insert(FindInsertSlot(hash), hash, e.m_Key, e.m_Value);
+            }
+        }
+        free(old_ctrl);
+    }
+
+    // Control bytes, followed by m_Entries in the same allocation
+    uint8_t*    m_Ctrl;
+    Entry*      m_Entries;
+    // Number of slots. Zero or a power of two multiple of GROUP_SIZE
+    uint32_t    m_SlotCount;
+    // Number of key/value pairs in the map
+    uint32_t    m_Count;
+    // Number of empty slots that can be used before the map needs to grow
+    uint32_t    m_GrowthLeft;
+};
+
+/*#
+ * Specialized hash map with [type:uint32_t] as keys
+ * @type class
+ * @name dmHashMap32
+ */
+template <typename T>
+class dmHashMap32 : public dmHashMap<uint32_t, T> {};
+
+/*#
+ * Specialized hash map with [type:uint64_t] as keys
+ * @type class
+ * @name dmHashMap64
+ */
+template <typename T>
+class dmHashMap64 : public dmHashMap<uint64_t, T> {};
+
+#endif // DM_HASHMAP_H
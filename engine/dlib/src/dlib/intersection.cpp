@@ -14,6 +14,8 @@
 
 #include <dmsdk/dlib/intersection.h>
 #include <stdint.h>
+#include "intersection.h"
+#include "simd.h"
 
 namespace dmIntersection
 {
@@ -157,4 +159,196 @@ bool TestFrustumOBB(const Frustum& frustum, const dmVMath::Matrix4& world, dmVMa
     return true; // inside the frustum but false positives may also happen. They are ok when used for frustum culling where the object will be hidden later in the rendering pipeline.
 }
 
+void SetupSphereSoA(float* buffer, uint32_t capacity, SphereSoA* soa)
+{
+    soa->m_X        = buffer + capacity * 0;
+    soa->m_Y        = buffer + capacity * 1;
+    soa->m_Z        = buffer + capacity * 2;
+    soa->m_RadiusSq = buffer + capacity * 3;
+}
+
+void SetupOBBSoA(float* buffer, uint32_t capacity, OBBSoA* soa)
+{
+    soa->m_CX = buffer + capacity * 0;
+    soa->m_CY = buffer + capacity * 1;
+    soa->m_CZ = buffer + capacity * 2;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        soa->m_AX[i] = buffer + capacity * (3 + i * 3);
+        soa->m_AY[i] = buffer + capacity * (4 + i * 3);
+        soa->m_AZ[i] = buffer + capacity * (5 + i * 3);
+    }
+}
+
+static inline float Abs(float v)
+{
+    return v < 0.0f ? -v : v;
+}
+
+// The box is outside a plane if the corner furthest along the plane normal is behind it.
+// Same as testing all eight corners as in TestFrustumOBB()
+static inline bool TestFrustumOBB(const Frustum& frustum, const OBBSoA& soa, uint32_t i)
+{
+    int num_planes = frustum.m_NumPlanes;
+    for (int p = 0; p < num_planes; ++p)
+    {
+        const Plane& plane = frustum.m_Planes[p];
+        float d = plane.getX() * soa.m_CX[i] + plane.getY() * soa.m_CY[i] + plane.getZ() * soa.m_CZ[i] + plane.getW();
+        for (uint32_t a = 0; a < 3; ++a)
+        {
+            d += Abs(plane.getX() * soa.m_AX[a][i] + plane.getY() * soa.m_AY[a][i] + plane.getZ() * soa.m_AZ[a][i]);
+        }
+        if (d < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if defined(DM_SIMD)
+static inline void StoreIntersectMask(uint32_t outside_mask, uint8_t* out_intersect)
+{
+    out_intersect[0] = (outside_mask & 1) ? 0 : 1;
+    out_intersect[1] = (outside_mask & 2) ? 0 : 1;
+    out_intersect[2] = (outside_mask & 4) ? 0 : 1;
+    out_intersect[3] = (outside_mask & 8) ? 0 : 1;
+}
+#endif
+
+static void TestFrustumSphereSqRange(const Frustum& frustum, const SphereSoA& soa, uint32_t begin, uint32_t end, uint8_t* out_intersect)
+{
+    uint32_t i = begin;
+#if defined(DM_SIMD)
+    int num_planes = frustum.m_NumPlanes;
+    dmSIMD::Vec4f nx[6], ny[6], nz[6], nw[6];
+    for (int p = 0; p < num_planes; ++p)
+    {
+        nx[p] = dmSIMD::Set1(frustum.m_Planes[p].getX());
+        ny[p] = dmSIMD::Set1(frustum.m_Planes[p].getY());
+        nz[p] = dmSIMD::Set1(frustum.m_Planes[p].getZ());
+        nw[p] = dmSIMD::Set1(frustum.m_Planes[p].getW());
+    }
+    const dmSIMD::Vec4f zero = dmSIMD::Zero();
+    for (; i + 4 <= end; i += 4)
+    {
+        dmSIMD::Vec4f x = dmSIMD::Load(soa.m_X + i);
+        dmSIMD::Vec4f y = dmSIMD::Load(soa.m_Y + i);
+        dmSIMD::Vec4f z = dmSIMD::Load(soa.m_Z + i);
+        dmSIMD::Vec4f radius_sq = dmSIMD::Load(soa.m_RadiusSq + i);
+
+        uint32_t outside = 0;
+        for (int p = 0; p < num_planes; ++p)
+        {
+            dmSIMD::Vec4f d = dmSIMD::MulAdd(nx[p], x, dmSIMD::MulAdd(ny[p], y, dmSIMD::MulAdd(nz[p], z, nw[p])));
+            outside |= dmSIMD::MaskLessThan(d, zero) & dmSIMD::MaskLessThan(radius_sq, dmSIMD::Mul(d, d));
+        }
+        StoreIntersectMask(outside, out_intersect + i);
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        dmVMath::Vector4 pos(soa.m_X[i], soa.m_Y[i], soa.m_Z[i], 1.0f);
+        out_intersect[i] = TestFrustumSphereSq(frustum, pos, soa.m_RadiusSq[i]) ? 1 : 0;
+    }
+}
+
+static void TestFrustumOBBRange(const Frustum& frustum, const OBBSoA& soa, uint32_t begin, uint32_t end, uint8_t* out_intersect)
+{
+    uint32_t i = begin;
+#if defined(DM_SIMD)
+    int num_planes = frustum.m_NumPlanes;
+    dmSIMD::Vec4f nx[6], ny[6], nz[6], nw[6];
+    for (int p = 0; p < num_planes; ++p)
+    {
+        nx[p] = dmSIMD::Set1(frustum.m_Planes[p].getX());
+        ny[p] = dmSIMD::Set1(frustum.m_Planes[p].getY());
+        nz[p] = dmSIMD::Set1(frustum.m_Planes[p].getZ());
+        nw[p] = dmSIMD::Set1(frustum.m_Planes[p].getW());
+    }
+    const dmSIMD::Vec4f zero = dmSIMD::Zero();
+    for (; i + 4 <= end; i += 4)
+    {
+        dmSIMD::Vec4f cx = dmSIMD::Load(soa.m_CX + i);
+        dmSIMD::Vec4f cy = dmSIMD::Load(soa.m_CY + i);
+        dmSIMD::Vec4f cz = dmSIMD::Load(soa.m_CZ + i);
+        dmSIMD::Vec4f ax[3], ay[3], az[3];
+        for (uint32_t a = 0; a < 3; ++a)
+        {
+            ax[a] = dmSIMD::Load(soa.m_AX[a] + i);
+            ay[a] = dmSIMD::Load(soa.m_AY[a] + i);
+            az[a] = dmSIMD::Load(soa.m_AZ[a] + i);
+        }
+
+        uint32_t outside = 0;
+        for (int p = 0; p < num_planes; ++p)
+        {
+            // Distance from the plane to the corner furthest along the plane normal
+            dmSIMD::Vec4f d = dmSIMD::MulAdd(nx[p], cx, dmSIMD::MulAdd(ny[p], cy, dmSIMD::MulAdd(nz[p], cz, nw[p])));
+            for (uint32_t a = 0; a < 3; ++a)
+            {
+                d = dmSIMD::Add(d, dmSIMD::Abs(dmSIMD::MulAdd(nx[p], ax[a], dmSIMD::MulAdd(ny[p], ay[a], dmSIMD::Mul(nz[p], az[a])))));
+            }
+            outside |= dmSIMD::MaskLessThan(d, zero);
+        }
+        StoreIntersectMask(outside, out_intersect + i);
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        out_intersect[i] = TestFrustumOBB(frustum, soa, i) ? 1 : 0;
+    }
+}
+
+struct FrustumBatchJob
+{
+    const Frustum*  m_Frustum;
+    const void*     m_Volumes; // SphereSoA or OBBSoA
+    uint8_t*        m_Out;
+};
+
+static void TestFrustumSphereSqJob(void* _job, uint32_t begin, uint32_t end)
+{
+    FrustumBatchJob* job = (FrustumBatchJob*)_job;
+    TestFrustumSphereSqRange(*job->m_Frustum, *(const SphereSoA*)job->m_Volumes, begin, end, job->m_Out);
+}
+
+static void TestFrustumOBBJob(void* _job, uint32_t begin, uint32_t end)
+{
+    FrustumBatchJob* job = (FrustumBatchJob*)_job;
+    TestFrustumOBBRange(*job->m_Frustum, *(const OBBSoA*)job->m_Volumes, begin, end, job->m_Out);
+}
+
+void TestFrustumSphereSqBatch(const Frustum& frustum, const SphereSoA& spheres, uint32_t count, uint8_t* out_intersect)
+{
+    TestFrustumSphereSqRange(frustum, spheres, 0, count, out_intersect);
+}
+
+void TestFrustumSphereSqBatch(dmJobSystem::HJobSystem job_system, const Frustum& frustum, const SphereSoA& spheres, uint32_t count, uint8_t* out_intersect)
+{
+    if (!job_system || count <= FRUSTUM_BATCH_JOB_CHUNK_SIZE)
+    {
+        TestFrustumSphereSqRange(frustum, spheres, 0, count, out_intersect);
+        return;
+    }
+    FrustumBatchJob job = {&frustum, &spheres, out_intersect};
+    dmJobSystem::ParallelFor(job_system, TestFrustumSphereSqJob, &job, count, FRUSTUM_BATCH_JOB_CHUNK_SIZE);
+}
+
+void TestFrustumOBBBatch(const Frustum& frustum, const OBBSoA& boxes, uint32_t count, uint8_t* out_intersect)
+{
+    TestFrustumOBBRange(frustum, boxes, 0, count, out_intersect);
+}
+
+void TestFrustumOBBBatch(dmJobSystem::HJobSystem job_system, const Frustum& frustum, const OBBSoA& boxes, uint32_t count, uint8_t* out_intersect)
+{
+    if (!job_system || count <= FRUSTUM_BATCH_JOB_CHUNK_SIZE)
+    {
+        TestFrustumOBBRange(frustum, boxes, 0, count, out_intersect);
+        return;
+    }
+    FrustumBatchJob job = {&frustum, &boxes, out_intersect};
+    dmJobSystem::ParallelFor(job_system, TestFrustumOBBJob, &job, count, FRUSTUM_BATCH_JOB_CHUNK_SIZE);
+}
+
 } // dmIntersection
@@ -0,0 +1,158 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+// 
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+// 
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#ifndef DM_INTERSECTION_H
+#define DM_INTERSECTION_H
+
+#include <stdint.h>
+#include <dmsdk/dlib/intersection.h>
+#include <dmsdk/dlib/vmath.h>
+#include <dlib/job_system.h>
+
+namespace dmIntersection
+{
+    /**
+     * Structure-of-arrays (SoA) view of a batch of bounding spheres.
+     * Each component is stored in a separate contiguous stream of floats,
+     * which allows the batch functions below to test four spheres per iteration.
+     */
+    struct SphereSoA
+    {
+        float* m_X;
+        float* m_Y;
+        float* m_Z;
+        float* m_RadiusSq;
+    };
+
+    /**
+     * Number of float streams in a SphereSoA
+     */
+    const uint32_t SPHERE_SOA_STREAM_COUNT = 4;
+
+    /**
+     * Structure-of-arrays (SoA) view of a batch of oriented bounding boxes (OBB).
+     * Each box is stored as its world space center and its three world space half axes.
+     */
+    struct OBBSoA
+    {
+        float* m_CX;
+        float* m_CY;
+        float* m_CZ;
+        float* m_AX[3]; // The x component of each half axis
+        float* m_AY[3];
+        float* m_AZ[3];
+    };
+
+    /**
+     * Number of float streams in an OBBSoA
+     */
+    const uint32_t OBB_SOA_STREAM_COUNT = 12;
+
+    /**
+     * Number of bounding volumes tested per job when a batch is split across the job threads
+     */
+    const uint32_t FRUSTUM_BATCH_JOB_CHUNK_SIZE = 1024;
+
+    /**
+     * Setup a SphereSoA from a single buffer of SPHERE_SOA_STREAM_COUNT * capacity floats
+     * @param buffer Buffer holding all streams
+     * @param capacity Max number of spheres in each stream
+     * @param soa [out] The SoA view
+     */
+    void SetupSphereSoA(float* buffer, uint32_t capacity, SphereSoA* soa);
+
+    /**
+     * Setup an OBBSoA from a single buffer of OBB_SOA_STREAM_COUNT * capacity floats
+     * @param buffer Buffer holding all streams
+     * @param capacity Max number of boxes in each stream
+     * @param soa [out] The SoA view
+     */
+    void SetupOBBSoA(float* buffer, uint32_t capacity, OBBSoA* soa);
+
+    /**
+     * Store a sphere at an index in a SphereSoA
+     * @param soa The SoA view
+     * @param index Index to store the sphere at
+     * @param pos The center position of the sphere
+     * @param radius_sq The squared radius of the sphere
+     */
+    inline void SetSphereSoA(const SphereSoA& soa, uint32_t index, const dmVMath::Point3& pos, float radius_sq)
+    {
+        soa.m_X[index] = pos.getX();
+        soa.m_Y[index] = pos.getY();
+        soa.m_Z[index] = pos.getZ();
+        soa.m_RadiusSq[index] = radius_sq;
+    }
+
+    /**
+     * Store a box at an index in an OBBSoA
+     * @param soa The SoA view
+     * @param index Index to store the box at
+     * @param world The world transform of the box
+     * @param aabb_min The minimum corner of the box. In local space.
+     * @param aabb_max The maximum corner of the box. In local space.
+     */
+    inline void SetOBBSoA(const OBBSoA& soa, uint32_t index, const dmVMath::Matrix4& world, const dmVMath::Vector3& aabb_min, const dmVMath::Vector3& aabb_max)
+    {
+        dmVMath::Vector4 center = world * dmVMath::Point3((aabb_min + aabb_max) * 0.5f);
+        dmVMath::Vector3 half_size = (aabb_max - aabb_min) * 0.5f;
+        soa.m_CX[index] = center.getX();
+        soa.m_CY[index] = center.getY();
+        soa.m_CZ[index] = center.getZ();
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            dmVMath::Vector4 axis = world.getCol(i) * half_size.getElem(i);
+            soa.m_AX[i][index] = axis.getX();
+            soa.m_AY[i][index] = axis.getY();
+            soa.m_AZ[i][index] = axis.getZ();
+        }
+    }
+
+    /**
+     * Tests a batch of spheres against a frustum. Same result as TestFrustumSphereSq() on each sphere.
+     * Uses SIMD (SSE2/NEON) when available.
+     * @param frustum The frustum
+     * @param spheres The spheres
+     * @param count Number of spheres
+     * @param out_intersect [out] 1 if the sphere intersects the frustum, otherwise 0. count entries
+     */
+    void TestFrustumSphereSqBatch(const Frustum& frustum, const SphereSoA& spheres, uint32_t count, uint8_t* out_intersect);
+
+    /**
+     * Same as above, but split across the job workers in chunks of FRUSTUM_BATCH_JOB_CHUNK_SIZE spheres.
+     * Blocks until all spheres are tested.
+     * @param job_system Job system, or 0x0 to only use the calling thread
+     */
+    void TestFrustumSphereSqBatch(dmJobSystem::HJobSystem job_system, const Frustum& frustum, const SphereSoA& spheres, uint32_t count, uint8_t* out_intersect);
+
+    /**
+     * Tests a batch of oriented bounding boxes against a frustum. Same result as TestFrustumOBB() on each box.
+     * Uses SIMD (SSE2/NEON) when available.
+     * @param frustum The frustum
+     * @param boxes The boxes
+     * @param count Number of boxes
+     * @param out_intersect [out] 1 if the box may intersect the frustum, 0 if it is outside. count entries
+     */
+    void TestFrustumOBBBatch(const Frustum& frustum, const OBBSoA& boxes, uint32_t count, uint8_t* out_intersect);
+
+    /**
+     * Same as above, but split across the job workers in chunks of FRUSTUM_BATCH_JOB_CHUNK_SIZE boxes.
+     * Blocks until all boxes are tested.
+     * @param job_system Job system, or 0x0 to only use the calling thread
+     */
+    void TestFrustumOBBBatch(dmJobSystem::HJobSystem job_system, const Frustum& frustum, const OBBSoA& boxes, uint32_t count, uint8_t* out_intersect);
+}
+
+#endif // DM_INTERSECTION_H
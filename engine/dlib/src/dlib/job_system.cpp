@@ -0,0 +1,456 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <dmsdk/dlib/atomic.h>
+#include <dmsdk/dlib/profile.h>
+#include <dmsdk/dlib/spinlock.h>
+#include <dlib/thread.h>
+#include <dlib/math.h>
+#include <dlib/dstrings.h>
+
+#if defined(DM_HAS_THREADS)
+    #include <dmsdk/dlib/condition_variable.h>
+    #include <dmsdk/dlib/mutex.h>
+#endif
+
+#include "job_system.h"
+
+namespace dmJobSystem
+{
+
+struct Job
+{
+    FJob        m_Function;
+    void*       m_Context;
+    void*       m_Data;
+    Counter*    m_Counter;
+    Job*        m_Next;     // Used when waiting for a dependency
+};
+
+// A double ended queue. The owner pushes and pops at the bottom, other threads steal from the top.
+struct JobQueue
+{
+    dmSpinlock::Spinlock    m_Lock;
+    Job*                    m_Jobs;
+    uint32_t                m_Mask;
+    uint32_t                m_Top;
+    uint32_t                m_Bottom;
+    uint8_t                 m_Padding[64]; // Keep the locks of different queues on separate cache lines
+};
+
+struct Worker
+{
+    JobSystem*          m_System;
+    uint32_t            m_Index;
+#if defined(DM_HAS_THREADS)
+    dmThread::Thread    m_Thread;
+#endif
+};
+
+struct JobSystem
+{
+    // One queue per worker, followed by the queue shared by all other threads
+    JobQueue*           m_Queues;
+    Worker*             m_Workers;
+    uint32_t            m_WorkerCount;
+    uint32_t            m_QueueCount;
+    // Holds the queue index + 1 for worker threads, 0 for other threads
+    dmThread::TlsKey    m_QueueIndexKey;
+    int32_atomic_t      m_PendingCount;
+
+#if defined(DM_HAS_THREADS)
+    dmMutex::HMutex                         m_Mutex;
+    dmConditionVariable::HConditionVariable m_WakeupCond;
+    int32_atomic_t                          m_SleepingCount;
+    int32_atomic_t                          m_Run;
+#endif
+};
+
+static const uint32_t DEFAULT_WORKER_COUNT = 3;
+static const uint32_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+static bool PushBottom(JobQueue* queue, const Job& job)
+{
+    DM_SPINLOCK_SCOPED_LOCK(queue->m_Lock);
+    if (queue->m_Bottom - queue->m_Top > queue->m_Mask)
+        return false;
+    queue->m_Jobs[queue->m_Bottom & queue->m_Mask] = job;
+    queue->m_Bottom++;
+    return true;
+}
+
+static bool PopBottom(JobQueue* queue, Job* job)
+{
+    DM_SPINLOCK_SCOPED_LOCK(queue->m_Lock);
+    if (queue->m_Bottom == queue->m_Top)
+        return false;
+    queue->m_Bottom--;
+    *job = queue->m_Jobs[queue->m_Bottom & queue->m_Mask];
+    return true;
+}
+
+static bool PopTop(JobQueue* queue, Job* job)
+{
+    DM_SPINLOCK_SCOPED_LOCK(queue->m_Lock);
+    if (queue->m_Bottom == queue->m_Top)
+        return false;
+    *job = queue->m_Jobs[queue->m_Top & queue->m_Mask];
+    queue->m_Top++;
+    return true;
+}
+
+static uint32_t GetQueueIndex(JobSystem* system)
+{
+    uintptr_t value = (uintptr_t)dmThread::GetTlsValue(system->m_QueueIndexKey);
+    return value ? (uint32_t)(value - 1) : system->m_WorkerCount;
+}
+
+// Takes a job from the given queue, or steals one from any of the other queues
+static bool TryGetJob(JobSystem* system, uint32_t queue_index, Job* job)
+{
+    if (dmAtomicGet32(&system->m_PendingCount) == 0)
+        return false;
+
+    bool found = PopBottom(&system->m_Queues[queue_index], job);
+    for (uint32_t i = 1; !found && i < system->m_QueueCount; ++i)
+    {
+        found = PopTop(&system->m_Queues[(queue_index + i) % system->m_QueueCount], job);
+    }
+    if (found)
+        dmAtomicDecrement32(&system->m_PendingCount);
+    return found;
+}
+
+static void Execute(JobSystem* system, const Job& job);
+
+static void Push(JobSystem* system, const Job& job)
+{
+    if (system->m_WorkerCount == 0 || !PushBottom(&system->m_Queues[GetQueueIndex(system)], job))
+    {
+        Execute(system, job);
+        return;
+    }
+
+    dmAtomicIncrement32(&system->m_PendingCount);
+#if defined(DM_HAS_THREADS)
+    // The pending count is incremented before checking for sleepers, and the workers do the opposite,
+    // so either this thread sees the worker going to sleep, or the worker sees the new job
+    if (dmAtomicGet32(&system->m_SleepingCount) > 0)
+    {
+        DM_MUTEX_SCOPED_LOCK(system->m_Mutex);
+        dmConditionVariable::Signal(system->m_WakeupCond);
+    }
+#endif
+}
+
+// The counters are owned by the user, and have no destroy function, so they use a plain atomic as lock
+static void LockCounter(Counter* counter)
+{
+    while (dmAtomicCompareStore32(&counter->m_Lock, 1, 0) != 0)
+    {
+    }
+}
+
+static void UnlockCounter(Counter* counter)
+{
+    // Not dmAtomicStore32(), which is only an acquire barrier on some platforms
+    dmAtomicCompareStore32(&counter->m_Lock, 0, 1);
+}
+
+static void DecrementCounter(JobSystem* system, Counter* counter)
+{
+    // The lock makes sure that no job is added to the waiting list after it has been taken
+    Job* waiting = 0;
+    LockCounter(counter);
+    bool done = dmAtomicDecrement32(&counter->m_Value) == 1;
+    if (done)
+    {
+        waiting = counter->m_Waiting;
+        counter->m_Waiting = 0;
+    }
+    UnlockCounter(counter);
+
+    while (waiting)
+    {
+        Job* next = waiting->m_Next;
+        Push(system, *waiting);
+        delete waiting;
+        waiting = next;
+    }
+
+#if defined(DM_HAS_THREADS)
+    // Wake up the threads sleeping in WaitForCounter(), one of which may be waiting for this counter.
+    // Same ordering as in Push(), but with the counter value instead of the pending count.
+    if (done && dmAtomicGet32(&system->m_SleepingCount) > 0)
+    {
+        DM_MUTEX_SCOPED_LOCK(system->m_Mutex);
+        dmConditionVariable::Broadcast(system->m_WakeupCond);
+    }
+#endif
+}
+
+static void Execute(JobSystem* system, const Job& job)
+{
+    job.m_Function(job.m_Context, job.m_Data);
+    if (job.m_Counter)
+        DecrementCounter(system, job.m_Counter);
+}
+
+#if defined(DM_HAS_THREADS)
+static void WorkerThread(void* _worker)
+{
+    Worker* worker = (Worker*)_worker;
+    JobSystem* system = worker->m_System;
+    dmThread::SetTlsValue(system->m_QueueIndexKey, (void*)(uintptr_t)(worker->m_Index + 1));
+
+    while (dmAtomicGet32(&system->m_Run) != 0)
+    {
+        Job job;
+        if (TryGetJob(system, worker->m_Index, &job))
+        {
+            DM_PROFILE("Job");
+            Execute(system, job);
+            continue;
+        }
+
+        DM_MUTEX_SCOPED_LOCK(system->m_Mutex);
+        dmAtomicIncrement32(&system->m_SleepingCount);
+        while (dmAtomicGet32(&system->m_PendingCount) == 0 && dmAtomicGet32(&system->m_Run) != 0)
+        {
+            dmConditionVariable::Wait(system->m_WakeupCond, system->m_Mutex);
+        }
+        dmAtomicDecrement32(&system->m_SleepingCount);
+    }
+}
+#endif
+
+void SetDefaultParams(Params* params)
+{
+    params->m_Name = "job_worker";
+    params->m_WorkerCount = DEFAULT_WORKER_COUNT;
+    params->m_QueueCapacity = DEFAULT_QUEUE_CAPACITY;
+}
+
+HJobSystem New(const Params& params)
+{
+    JobSystem* system = new JobSystem;
+#if defined(DM_HAS_THREADS)
+    system->m_WorkerCount = params.m_WorkerCount;
+#else
+    system->m_WorkerCount = 0;
+#endif
+    system->m_QueueCount = system->m_WorkerCount + 1;
+    system->m_QueueIndexKey = dmThread::AllocTls();
+    system->m_PendingCount = 0;
+
+    uint32_t capacity = 1;
+    while (capacity < params.m_QueueCapacity)
+        capacity <<= 1;
+
+    system->m_Queues = new JobQueue[system->m_QueueCount];
+    for (uint32_t i = 0; i < system->m_QueueCount; ++i)
+    {
+        JobQueue* queue = &system->m_Queues[i];
+        dmSpinlock::Create(&queue->m_Lock);
+        queue->m_Jobs = new Job[capacity];
+        queue->m_Mask = capacity - 1;
+        queue->m_Top = 0;
+        queue->m_Bottom = 0;
+    }
+
+    system->m_Workers = new Worker[system->m_WorkerCount];
+#if defined(DM_HAS_THREADS)
+    system->m_Mutex = dmMutex::New();
+    system->m_WakeupCond = dmConditionVariable::New();
+    system->m_SleepingCount = 0;
+    system->m_Run = 1;
+
+    for (uint32_t i = 0; i < system->m_WorkerCount; ++i)
+    {
+        Worker* worker = &system->m_Workers[i];
+        worker->m_System = system;
+        worker->m_Index = i;
+
+        char name_buf[128];
+        dmSnPrintf(name_buf, sizeof(name_buf), "%s_%d", params.m_Name, i);
+        worker->m_Thread = dmThread::New(WorkerThread, 0x80000, (void*)worker, name_buf);
+    }
+#endif
+    return system;
+}
+
+void Delete(HJobSystem system)
+{
+    if (!system)
+        return;
+
+    // Finish the queued jobs, since someone may be depending on them
+    Job job;
+    while (TryGetJob(system, system->m_WorkerCount, &job))
+    {
+        Execute(system, job);
+    }
+
+#if defined(DM_HAS_THREADS)
+    dmAtomicStore32(&system->m_Run, 0);
+    {
+        DM_MUTEX_SCOPED_LOCK(system->m_Mutex);
+        dmConditionVariable::Broadcast(system->m_WakeupCond);
+    }
+
+    for (uint32_t i = 0; i < system->m_WorkerCount; ++i)
+    {
+        dmThread::Join(system->m_Workers[i].m_Thread);
+    }
+
+    dmConditionVariable::Delete(system->m_WakeupCond);
+    dmMutex::Delete(system->m_Mutex);
+#endif
+
+    for (uint32_t i = 0; i < system->m_QueueCount; ++i)
+    {
+        dmSpinlock::Destroy(&system->m_Queues[i].m_Lock);
+        delete[] system->m_Queues[i].m_Jobs;
+    }
+    delete[] system->m_Queues;
+    delete[] system->m_Workers;
+    dmThread::FreeTls(system->m_QueueIndexKey);
+    delete system;
+}
+
+uint32_t GetWorkerCount(HJobSystem system)
+{
+    return system->m_WorkerCount;
+}
+
+void InitCounter(Counter* counter)
+{
+    counter->m_Value = 0;
+    counter->m_Lock = 0;
+    counter->m_Waiting = 0;
+}
+
+void Run(HJobSystem system, FJob function, void* context, void* data, Counter* counter, Counter* dependency)
+{
+    Job job;
+    job.m_Function = function;
+    job.m_Context = context;
+    job.m_Data = data;
+    job.m_Counter = counter;
+    job.m_Next = 0;
+
+    if (counter)
+        dmAtomicIncrement32(&counter->m_Value);
+
+    if (dependency)
+    {
+        LockCounter(dependency);
+        bool wait = dmAtomicGet32(&dependency->m_Value) != 0;
+        if (wait)
+        {
+            Job* waiting = new Job(job);
+            waiting->m_Next = dependency->m_Waiting;
+            dependency->m_Waiting = waiting;
+        }
+        UnlockCounter(dependency);
+        if (wait)
+            return;
+    }
+
+    Push(system, job);
+}
+
+void WaitForCounter(HJobSystem system, Counter* counter)
+{
+    DM_PROFILE("WaitForCounter");
+    uint32_t queue_index = GetQueueIndex(system);
+    while (dmAtomicGet32(&counter->m_Value) != 0)
+    {
+        Job job;
+        if (TryGetJob(system, queue_index, &job))
+        {
+            Execute(system, job);
+            continue;
+        }
+
+#if defined(DM_HAS_THREADS)
+        // Nothing to help out with, so sleep until a job is pushed or a counter reaches zero
+        DM_MUTEX_SCOPED_LOCK(system->m_Mutex);
+        dmAtomicIncrement32(&system->m_SleepingCount);
+        while (dmAtomicGet32(&system->m_PendingCount) == 0 && dmAtomicGet32(&counter->m_Value) != 0)
+        {
+            dmConditionVariable::Wait(system->m_WakeupCond, system->m_Mutex);
+        }
+        dmAtomicDecrement32(&system->m_SleepingCount);
+#endif
+    }
+
+    // The last job may still be releasing the lock after having decremented the counter,
+    // and the counter is often destroyed as soon as this function returns
+    LockCounter(counter);
+    UnlockCounter(counter);
+}
+
+struct ParallelForContext
+{
+    FParallelFor    m_Process;
+    void*           m_Context;
+    uint32_t        m_Count;
+    uint32_t        m_GrainSize;
+};
+
+static void ParallelForJob(void* context, void* data)
+{
+    DM_PROFILE("ParallelFor");
+    ParallelForContext* pf = (ParallelForContext*)context;
+    uint32_t begin = (uint32_t)(uintptr_t)data * pf->m_GrainSize;
+    uint32_t end = dmMath::Min(begin + pf->m_GrainSize, pf->m_Count);
+    pf->m_Process(pf->m_Context, begin, end);
+}
+
+void ParallelFor(HJobSystem system, FParallelFor process, void* context, uint32_t count, uint32_t grain_size)
+{
+    if (count == 0)
+        return;
+
+    grain_size = dmMath::Max(1U, grain_size);
+    uint32_t chunk_count = (count + grain_size - 1) / grain_size;
+    if (chunk_count == 1 || system->m_WorkerCount == 0)
+    {
+        process(context, 0, count);
+        return;
+    }
+
+    ParallelForContext pf;
+    pf.m_Process = process;
+    pf.m_Context = context;
+    pf.m_Count = count;
+    pf.m_GrainSize = grain_size;
+
+    Counter counter;
+    InitCounter(&counter);
+    for (uint32_t i = 1; i < chunk_count; ++i)
+    {
+        Run(system, ParallelForJob, &pf, (void*)(uintptr_t)i, &counter, 0);
+    }
+
+    // The first chunk is processed directly, and the calling thread helps out with the rest while waiting
+    ParallelForJob(&pf, (void*)(uintptr_t)0);
+    WaitForCounter(system, &counter);
+}
+
+} // namespace dmJobSystem
@@ -0,0 +1,120 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_JOB_SYSTEM_H
+#define DM_JOB_SYSTEM_H
+
+#include <stdint.h>
+#include <dmsdk/dlib/atomic.h>
+
+/**
+ * Work stealing job scheduler.
+ *
+ * Each worker thread owns a job queue. A worker takes jobs from its own queue
+ * in LIFO order, and steals the oldest jobs from the other queues when its own queue is empty.
+ * Jobs pushed from other threads (e.g. the main thread) go to a shared queue.
+ *
+ * Completion is tracked with counters. A counter holds the number of unfinished jobs
+ * associated with it, and a job may depend on a counter, in which case it isn't started
+ * until the counter has reached zero. WaitForCounter() processes jobs on the calling thread
+ * while waiting, which also makes it possible to wait from within a job.
+ *
+ * Unlike dmJobThread, there are no callbacks: the results are available as soon as WaitForCounter() returns.
+ */
+namespace dmJobSystem
+{
+    typedef struct JobSystem* HJobSystem;
+    typedef void (*FJob)(void* context, void* data);
+    typedef void (*FParallelFor)(void* context, uint32_t begin, uint32_t end);
+
+    struct Job;
+
+    /**
+     * Counts the unfinished jobs associated with it.
+     * Must be initialized with InitCounter() and stay alive until it has reached zero
+     * and all jobs depending on it have been started.
+     */
+    struct Counter
+    {
+        int32_atomic_t          m_Value;
+        int32_atomic_t          m_Lock;
+        Job*                    m_Waiting; // Jobs waiting for the counter to reach zero
+    };
+
+    struct Params
+    {
+        const char* m_Name;
+        uint32_t    m_WorkerCount;
+        uint32_t    m_QueueCapacity;    // Max number of queued jobs per queue. Rounded up to a power of two
+    };
+
+    void SetDefaultParams(Params* params);
+
+    /**
+     * Create a job system. If the platform has no thread support, no worker threads are created
+     * and all jobs are run directly when they are scheduled.
+     * @param params Parameters
+     * @return Job system handle
+     */
+    HJobSystem New(const Params& params);
+
+    /**
+     * Delete a job system. Any jobs still queued are run on the calling thread before the workers are stopped.
+     * @param system Job system handle
+     */
+    void Delete(HJobSystem system);
+
+    /**
+     * @param system Job system handle
+     * @return The number of worker threads
+     */
+    uint32_t GetWorkerCount(HJobSystem system);
+
+    /**
+     * Initialize a counter to zero
+     * @param counter Counter
+     */
+    void InitCounter(Counter* counter);
+
+    /**
+     * Schedule a job. If the queue is full, the job is run directly on the calling thread.
+     * @param system Job system handle
+     * @param job Job function
+     * @param context User context passed to the job function
+     * @param data User data passed to the job function
+     * @param counter Incremented now and decremented when the job has finished. May be 0x0.
+     * @param dependency If not 0x0, the job isn't started until this counter is zero
+     */
+    void Run(HJobSystem system, FJob job, void* context, void* data, Counter* counter, Counter* dependency);
+
+    /**
+     * Wait for a counter to reach zero. The calling thread processes queued jobs while waiting, and sleeps when there are none.
+     * @param system Job system handle
+     * @param counter Counter to wait for
+     */
+    void WaitForCounter(HJobSystem system, Counter* counter);
+
+    /**
+     * Call a function for each chunk of at most grain_size items in the range [0, count), in parallel.
+     * Blocks until all chunks are processed, and may be called from within a job.
+     * @param system Job system handle
+     * @param process Function called for each chunk. Must be thread safe.
+     * @param context User context passed to the function
+     * @param count Number of items
+     * @param grain_size Max number of items per chunk
+     */
+    void ParallelFor(HJobSystem system, FParallelFor process, void* context, uint32_t count, uint32_t grain_size);
+}
+
+#endif // DM_JOB_SYSTEM_H
@@ -96,6 +96,10 @@ static void JobThread(void* _ctx)
             DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
             while(ctx->m_Work.Empty())
             {
+                // Check before waiting as well, since Destroy() may have signaled before we got the lock
+                if(dmAtomicGet32(&ctx->m_Run) == 0)
+                    return;
+
                 dmConditionVariable::Wait(ctx->m_WakeupCond, ctx->m_Mutex);
 
                 if(dmAtomicGet32(&ctx->m_Run) == 0)
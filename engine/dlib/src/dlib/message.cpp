@@ -13,17 +13,17 @@
 // specific language governing permissions and limitations under the License.
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include "message.h"
 #include "atomic.h"
 #include "hash.h"
-#include "hashtable.h"
-#include "array.h"
 #include "condition_variable.h"
 #include "dstrings.h"
 #include <dlib/mutex.h>
 #include <dlib/static_assert.h>
 #include <dlib/spinlock.h>
+#include <dlib/thread.h>
 #include <dlib/profile/profile.h>
 
 DM_PROPERTY_GROUP(rmtp_Message, "dmMessage");
@@ -34,123 +34,160 @@ namespace dmMessage
     // Alignment of allocations
     const uint32_t DM_MESSAGE_ALIGNMENT = 16U;
 
+    struct MemoryPage;
+
+    // Stored in front of each message, to find the page it was allocated from
+    struct MessageHeader
+    {
+        MemoryPage*     m_Page;
+        uint8_t         m_Padding[DM_MESSAGE_ALIGNMENT - sizeof(MemoryPage*)];
+    };
+
+    // Pages are owned by the posting threads, one page per thread at a time, so allocating a message needs no lock.
+    // A page is recycled when its thread has moved on to a new page and all messages in it have been dispatched.
     struct MemoryPage
     {
-        uint8_t     m_Memory[DM_MESSAGE_PAGE_SIZE];
-        uint32_t    m_Current;
-        MemoryPage* m_NextPage;
+        uint8_t DM_ALIGNED(16) m_Memory[DM_MESSAGE_PAGE_SIZE + sizeof(MessageHeader)];
+        uint32_t        m_Current;
+        // Number of undispatched messages in the page, plus one while the page is owned by a thread
+        int32_atomic_t  m_RefCount;
+        MemoryPage*     m_NextFree;
+        MemoryPage*     m_NextAllocated;
     };
 
-    struct MemoryAllocator
+    struct MessageSocket
     {
-        MemoryAllocator()
-        {
-            m_CurrentPage = 0;
-            m_FreePages = 0;
-            m_FullPages = 0;
-        }
-        MemoryPage* m_CurrentPage;
-        MemoryPage* m_FreePages;
-        MemoryPage* m_FullPages;
+        // Number of references, where the socket itself holds one until it's deleted. Zero if the slot is unused
+        int32_atomic_t  m_RefCount;
+        // Set while the slot is in use, including while the last reference is being disposed
+        uint32_t        m_Used;
+        dmhash_t        m_NameHash;
+        // Messages in reverse order of posting
+        Message* volatile m_Head;
+        const char*     m_Name;
+        dmMutex::HMutex m_Mutex;
+        dmConditionVariable::HConditionVariable m_Condition;
     };
 
+    const uint32_t MAX_SOCKETS = 256;
+    // Size of the open addressing index of the sockets, a power of two larger than MAX_SOCKETS to keep the probe sequences short
+    const uint32_t SOCKET_INDEX_SIZE = 1024;
+    const int32_t SOCKET_INDEX_EMPTY = 0;
+    const int32_t SOCKET_INDEX_DELETED = -1;
+
+    // The sockets never move, and the index is only modified while holding g_MessageSpinlock,
+    // which lets Post() and Dispatch() find the sockets without taking any lock
+    struct MessageContext
+    {
+        MessageSocket   m_Sockets[MAX_SOCKETS];
+        // Socket slot + 1, or SOCKET_INDEX_EMPTY/SOCKET_INDEX_DELETED
+        int32_atomic_t  m_Index[SOCKET_INDEX_SIZE];
+        uint32_t        m_SocketCount;
+
+        // Protected by g_MessageSpinlock
+        MemoryPage*     m_FreePages;
+        MemoryPage*     m_AllPages;
+        dmThread::TlsKey m_PageKey;
+    };
+
+    static MessageContext g_MessageContext;
+    dmSpinlock::Spinlock g_MessageSpinlock;
+
     struct GlobalInit
     {
         GlobalInit() {
             // Make sure the struct sizes are in sync! Think of potential save files!
             DM_STATIC_ASSERT(sizeof(dmMessage::URL) == 32, Invalid_Struct_Size);
+            DM_STATIC_ASSERT(sizeof(MessageHeader) == DM_MESSAGE_ALIGNMENT, Invalid_Struct_Size);
         }
 
     } g_MessageInit;
 
-    static Result GetSocketNoLock(dmhash_t name_hash, HSocket* out_socket);
+    template <typename T>
+    static inline T* AtomicCompareStorePtr(T* volatile* ptr, T* value, T* comparand)
+    {
+#if defined(_MSC_VER)
+        return (T*) InterlockedCompareExchangePointer((void* volatile*) ptr, (void*) value, (void*) comparand);
+#else
+        return __sync_val_compare_and_swap(ptr, comparand, value);
+#endif
+    }
 
-    static void AllocateNewPage(MemoryAllocator* allocator)
+    static void ReleasePage(MemoryPage* page)
     {
-        if (allocator->m_CurrentPage)
+        if (dmAtomicDecrement32(&page->m_RefCount) == 1)
         {
-            // Link current page to full pages
-            allocator->m_CurrentPage->m_NextPage = allocator->m_FullPages;
-            allocator->m_FullPages = allocator->m_CurrentPage;
+            DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
+            page->m_NextFree = g_MessageContext.m_FreePages;
+            g_MessageContext.m_FreePages = page;
         }
+    }
 
-        MemoryPage* new_page = 0;
-
-        if (allocator->m_FreePages)
-        {
-            // Free page to use
-            new_page = allocator->m_FreePages;
-            allocator->m_FreePages = new_page->m_NextPage;
-        }
-        else
+    static MemoryPage* NewPage()
+    {
+        MemoryPage* page = 0;
         {
-            // Allocate new page
-            new_page = new MemoryPage;
+            DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
+            page = g_MessageContext.m_FreePages;
+            if (page)
+            {
+                g_MessageContext.m_FreePages = page->m_NextFree;
+            }
+            else
+            {
+                page = new MemoryPage;
+                page->m_NextAllocated = g_MessageContext.m_AllPages;
+                g_MessageContext.m_AllPages = page;
+            }
         }
-
-        new_page->m_Current = 0;
-        new_page->m_NextPage = 0;
-
-        allocator->m_CurrentPage = new_page;
+        page->m_Current = 0;
+        page->m_RefCount = 1;
+        page->m_NextFree = 0;
+        return page;
     }
 
-    static void* AllocateMessage(MemoryAllocator* allocator, uint32_t size)
+    static Message* AllocateMessage(uint32_t size)
     {
         // At least ALIGNMENT bytes alignment of size in order to ensure that the next allocation is aligned
+        size += sizeof(MessageHeader);
         size += DM_MESSAGE_ALIGNMENT-1;
         size &= ~(DM_MESSAGE_ALIGNMENT-1);
-        assert(size <= DM_MESSAGE_PAGE_SIZE);
+        assert(size <= DM_MESSAGE_PAGE_SIZE + sizeof(MessageHeader));
 
-        if (allocator->m_CurrentPage == 0 || (DM_MESSAGE_PAGE_SIZE-allocator->m_CurrentPage->m_Current) < size)
+        MemoryPage* page = (MemoryPage*) dmThread::GetTlsValue(g_MessageContext.m_PageKey);
+        if (page == 0 || (sizeof(page->m_Memory) - page->m_Current) < size)
         {
-            // No current page or allocation didn't fit.
-            AllocateNewPage(allocator);
+            // No current page or allocation didn't fit
+            if (page)
+            {
+                ReleasePage(page);
+            }
+            page = NewPage();
+            dmThread::SetTlsValue(g_MessageContext.m_PageKey, page);
         }
 
-        MemoryPage* page = allocator->m_CurrentPage;
-        void* ret = (void*) ((uintptr_t) &page->m_Memory[0] + page->m_Current);
+        MessageHeader* header = (MessageHeader*) &page->m_Memory[page->m_Current];
+        header->m_Page = page;
         page->m_Current += size;
-        return ret;
+        dmAtomicIncrement32(&page->m_RefCount);
+        return (Message*) (header + 1);
     }
 
-    struct MessageSocket
-    {
-        uint32_t        m_RefCount; // Is protected by "g_MessageSpinlock"
-        dmhash_t        m_NameHash;
-        Message*        m_Header;
-        Message*        m_Tail;
-        const char*     m_Name;
-        dmMutex::HMutex m_Mutex;
-        dmConditionVariable::HConditionVariable m_Condition;
-        MemoryAllocator m_Allocator;
-    };
-
-    const uint32_t MAX_SOCKETS = 256;
-
-    struct MessageContext
+    static void FreeMessage(Message* message)
     {
-        dmHashTable64<MessageSocket> m_Sockets;
-    };
-
-    MessageContext* g_MessageContext = 0;
-    dmSpinlock::Spinlock g_MessageSpinlock;
-
-    static MessageContext* Create(uint32_t max_sockets)
-    {
-        MessageContext* ctx = new MessageContext;
-        ctx->m_Sockets.SetCapacity(max_sockets, max_sockets);
-
-        return ctx;
+        MessageHeader* header = ((MessageHeader*) message) - 1;
+        ReleasePage(header->m_Page);
     }
 
     // Until the Create/Destroy functions are exposed:
-    // The context is created on demand, and we also need to destroy it automatically
+    // The context is created statically, and we also need to destroy it automatically
     struct ContextDestroyer
     {
         ContextDestroyer()
         {
             dmAtomicStore32(&m_Deleted, 0);
             dmSpinlock::Create(&g_MessageSpinlock);
+            g_MessageContext.m_PageKey = dmThread::AllocTls();
         }
 
         ~ContextDestroyer()
@@ -158,17 +195,63 @@ namespace dmMessage
             dmAtomicStore32(&m_Deleted, 1);
             {
                 DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-                if (g_MessageContext)
+                MemoryPage* page = g_MessageContext.m_AllPages;
+                while (page)
                 {
-                    delete g_MessageContext;
-                    g_MessageContext = 0;
+                    MemoryPage* next = page->m_NextAllocated;
+                    delete page;
+                    page = next;
                 }
+                g_MessageContext.m_AllPages = 0;
+                g_MessageContext.m_FreePages = 0;
             }
+            dmThread::FreeTls(g_MessageContext.m_PageKey);
             dmSpinlock::Destroy(&g_MessageSpinlock);
         }
         int32_atomic_t m_Deleted;
     } g_ContextDestroyer;
 
+    // Returns the index position of the socket, or the first free position if not found. Must hold g_MessageSpinlock.
+    static uint32_t FindIndexPositionNoLock(dmhash_t name_hash, bool* found)
+    {
+        uint32_t free_position = SOCKET_INDEX_SIZE;
+        uint32_t position = (uint32_t) name_hash & (SOCKET_INDEX_SIZE - 1);
+        for (uint32_t i = 0; i < SOCKET_INDEX_SIZE; ++i, position = (position + 1) & (SOCKET_INDEX_SIZE - 1))
+        {
+            int32_t value = g_MessageContext.m_Index[position];
+            if (value == SOCKET_INDEX_EMPTY)
+            {
+                break;
+            }
+            if (value == SOCKET_INDEX_DELETED)
+            {
+                if (free_position == SOCKET_INDEX_SIZE)
+                    free_position = position;
+                continue;
+            }
+            if (g_MessageContext.m_Sockets[value - 1].m_NameHash == name_hash)
+            {
+                *found = true;
+                return position;
+            }
+        }
+        *found = false;
+        return free_position != SOCKET_INDEX_SIZE ? free_position : position;
+    }
+
+    static Result GetSocketNoLock(dmhash_t name_hash, HSocket* out_socket)
+    {
+        *out_socket = name_hash; // to silence an existing test
+
+        bool found;
+        FindIndexPositionNoLock(name_hash, &found);
+        if (!found)
+        {
+            return RESULT_NAME_OK_SOCKET_NOT_FOUND;
+        }
+        return RESULT_OK;
+    }
+
     Result NewSocket(const char* name, HSocket* socket)
     {
         if (dmAtomicGet32(&g_ContextDestroyer.m_Deleted))
@@ -185,91 +268,108 @@ namespace dmMessage
 
         DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
 
-        if (g_MessageContext == 0)
+        if (g_MessageContext.m_SocketCount == MAX_SOCKETS)
         {
-            g_MessageContext = Create(MAX_SOCKETS);
+            return RESULT_SOCKET_OUT_OF_RESOURCES;
         }
 
-        if (g_MessageContext->m_Sockets.Full())
+        bool found;
+        uint32_t position = FindIndexPositionNoLock(name_hash, &found);
+        if (found)
         {
-            return RESULT_SOCKET_OUT_OF_RESOURCES;
+            return RESULT_SOCKET_EXISTS;
         }
 
-        HSocket tmp;
-        if (GetSocketNoLock(name_hash, &tmp) == RESULT_OK)
+        uint32_t slot = 0;
+        while (g_MessageContext.m_Sockets[slot].m_Used)
         {
-            return RESULT_SOCKET_EXISTS;
+            ++slot;
         }
 
-        MessageSocket s;
-        s.m_RefCount = 1;
-        s.m_Header = 0;
-        s.m_Tail = 0;
-        s.m_NameHash = name_hash;
-        s.m_Name = strdup(name);
-        s.m_Mutex = dmMutex::New();
-        s.m_Condition = dmConditionVariable::New();
+        MessageSocket* s = &g_MessageContext.m_Sockets[slot];
+        s->m_Used = 1;
+        s->m_Head = 0;
+        s->m_NameHash = name_hash;
+        s->m_Name = strdup(name);
+        s->m_Mutex = dmMutex::New();
+        s->m_Condition = dmConditionVariable::New();
+        // Publish the socket to the lock free readers
+        dmAtomicStore32(&s->m_RefCount, 1);
+        dmAtomicStore32(&g_MessageContext.m_Index[position], (int32_t) slot + 1);
+        g_MessageContext.m_SocketCount++;
 
-        g_MessageContext->m_Sockets.Put(name_hash, s);
         *socket = name_hash;
 
         return RESULT_OK;
     }
 
+    // The messages are pushed to the head of the list, so it's reversed to get them in the order they were posted
+    static Message* ReverseMessages(Message* message_object)
+    {
+        Message* reversed = 0;
+        while (message_object)
+        {
+            Message* next = message_object->m_Next;
+            message_object->m_Next = reversed;
+            reversed = message_object;
+            message_object = next;
+        }
+        return reversed;
+    }
+
     static void DisposeSocket(MessageSocket* s)
     {
-        Message *message_object = s->m_Header;
+        Message* message_object = ReverseMessages(s->m_Head);
         while (message_object)
         {
+            Message* next = message_object->m_Next;
             if (message_object->m_DestroyCallback)
             {
                 message_object->m_DestroyCallback(message_object);
             }
-            message_object = message_object->m_Next;
+            FreeMessage(message_object);
+            message_object = next;
         }
+        s->m_Head = 0;
 
         free((void*) s->m_Name);
-
-        MemoryPage* p = s->m_Allocator.m_FreePages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            delete p;
-            p = next;
-        }
-        p = s->m_Allocator.m_FullPages;
-        while (p)
-        {
-            MemoryPage* next = p->m_NextPage;
-            delete p;
-            p = next;
-        }
-        if (s->m_Allocator.m_CurrentPage)
-        {
-            delete s->m_Allocator.m_CurrentPage;
-        }
+        s->m_Name = 0;
 
         dmConditionVariable::Delete(s->m_Condition);
 
         dmMutex::Delete(s->m_Mutex);
 
-        memset(s, 0, sizeof(*s));
+        DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
+        s->m_Used = 0;
+        g_MessageContext.m_SocketCount--;
     }
 
     static void ReleaseSocket(MessageSocket* s)
     {
+        if (dmAtomicDecrement32(&s->m_RefCount) == 1)
         {
-            DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-            --s->m_RefCount;
+            DisposeSocket(s);
+        }
+    }
 
-            if (s->m_RefCount > 0)
+    // Increments the reference count, unless the socket is being disposed
+    static bool TryAcquireSocket(MessageSocket* s)
+    {
+        int32_t ref_count = dmAtomicGet32(&s->m_RefCount);
+        while (ref_count > 0)
+        {
+            int32_t prev = dmAtomicCompareStore32(&s->m_RefCount, ref_count + 1, ref_count);
+            if (prev == ref_count)
             {
-                return;
+                return true;
             }
+            ref_count = prev;
         }
-        DisposeSocket(s);
+        return false;
     }
 
+    // Lock free lookup of a socket. The name hash is verified after the reference is taken,
+    // since the slot may have been reused by another socket after it was read from the index.
     static MessageSocket* AcquireSocket(HSocket socket)
     {
         if (dmAtomicGet32(&g_ContextDestroyer.m_Deleted))
@@ -277,20 +377,31 @@ namespace dmMessage
             return 0; // The system has already been shut down
         }
 
-        DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-
-        MessageSocket* s = g_MessageContext->m_Sockets.Get(socket);
-
-        if (s == 0x0)
+        uint32_t position = (uint32_t) socket & (SOCKET_INDEX_SIZE - 1);
+        for (uint32_t i = 0; i < SOCKET_INDEX_SIZE; ++i, position = (position + 1) & (SOCKET_INDEX_SIZE - 1))
         {
-            return 0x0;
-        }
-
-        assert(s->m_RefCount >= 1);
-
-        ++s->m_RefCount;
+            int32_t value = dmAtomicGet32(&g_MessageContext.m_Index[position]);
+            if (value == SOCKET_INDEX_EMPTY)
+            {
+                return 0;
+            }
+            if (value == SOCKET_INDEX_DELETED)
+            {
+                continue;
+            }
 
-        return s;
+            MessageSocket* s = &g_MessageContext.m_Sockets[value - 1];
+            if (s->m_NameHash != socket || !TryAcquireSocket(s))
+            {
+                continue;
+            }
+            if (s->m_NameHash == socket)
+            {
+                return s;
+            }
+            ReleaseSocket(s);
+        }
+        return 0;
     }
 
     Result DeleteSocket(HSocket socket)
@@ -298,34 +409,27 @@ namespace dmMessage
         MessageSocket* s = 0x0;
         {
             DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-            s = g_MessageContext->m_Sockets.Get(socket);
-            if (s == 0x0)
+            bool found;
+            uint32_t position = FindIndexPositionNoLock(socket, &found);
+            if (!found)
             {
                 return RESULT_SOCKET_NOT_FOUND;
             }
 
-            g_MessageContext->m_Sockets.Erase(s->m_NameHash);
-            --s->m_RefCount;
+            s = &g_MessageContext.m_Sockets[g_MessageContext.m_Index[position] - 1];
+            dmAtomicStore32(&g_MessageContext.m_Index[position], SOCKET_INDEX_DELETED);
 
-            if(s->m_RefCount > 0)
+            // Positions at the end of a probe sequence can be marked as empty, which keeps the sequences short
+            while (g_MessageContext.m_Index[(position + 1) & (SOCKET_INDEX_SIZE - 1)] == SOCKET_INDEX_EMPTY &&
+                   g_MessageContext.m_Index[position] == SOCKET_INDEX_DELETED)
             {
-                // Defer deletion
-                return RESULT_OK;
+                dmAtomicStore32(&g_MessageContext.m_Index[position], SOCKET_INDEX_EMPTY);
+                position = (position - 1) & (SOCKET_INDEX_SIZE - 1);
             }
         }
-        DisposeSocket(s);
-        return RESULT_OK;
-    }
-
-    static Result GetSocketNoLock(dmhash_t name_hash, HSocket* out_socket)
-    {
-        *out_socket = name_hash; // to silence an existing test
 
-        MessageSocket* message_socket = g_MessageContext->m_Sockets.Get(name_hash);
-        if (!message_socket)
-        {
-            return RESULT_NAME_OK_SOCKET_NOT_FOUND;
-        }
+        // Defer deletion if the socket is in use by another thread
+        ReleaseSocket(s);
         return RESULT_OK;
     }
 
@@ -349,10 +453,11 @@ namespace dmMessage
     {
         DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
 
-        MessageSocket* message_socket = g_MessageContext->m_Sockets.Get(socket);
-        if (message_socket != 0x0)
+        bool found;
+        uint32_t position = FindIndexPositionNoLock(socket, &found);
+        if (found)
         {
-            return message_socket->m_Name;
+            return g_MessageContext.m_Sockets[g_MessageContext.m_Index[position] - 1].m_Name;
         }
         else
         {
@@ -365,8 +470,9 @@ namespace dmMessage
         if (socket != 0)
         {
             DM_SPINLOCK_SCOPED_LOCK(g_MessageSpinlock);
-            MessageSocket* message_socket = g_MessageContext->m_Sockets.Get(socket);
-            return message_socket != 0;
+            bool found;
+            FindIndexPositionNoLock(socket, &found);
+            return found;
         }
         return false;
     }
@@ -379,11 +485,7 @@ namespace dmMessage
         MessageSocket* s = AcquireSocket(socket);
         if (s != 0)
         {
-            bool has_messages;
-            {
-                DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
-                has_messages = s->m_Header != 0;
-            }
+            bool has_messages = AtomicCompareStorePtr<Message>(&s->m_Head, 0, 0) != 0;
             ReleaseSocket(s);
             return has_messages;
         }
@@ -447,11 +549,8 @@ namespace dmMessage
             return RESULT_SOCKET_NOT_FOUND;
         }
 
-        dmMutex::Lock(s->m_Mutex);
-
-        MemoryAllocator* allocator = &s->m_Allocator;
         uint32_t data_size = sizeof(Message) + message_data_size;
-        Message *new_message = (Message *) AllocateMessage(allocator, data_size);
+        Message *new_message = AllocateMessage(data_size);
         if (sender != 0x0)
         {
             new_message->m_Sender = *sender;
@@ -466,28 +565,26 @@ namespace dmMessage
         new_message->m_UserData2 = user_data2;
         new_message->m_Descriptor = descriptor;
         new_message->m_DataSize = message_data_size;
-        new_message->m_Next = 0;
         new_message->m_DestroyCallback = destroy_callback;
         memcpy(&new_message->m_Data[0], message_data, message_data_size);
 
-        bool is_first_message = !s->m_Header;
-
-        if (!s->m_Header)
+        // Multiple producers, single consumer: push to the head of the list
+        Message* head = s->m_Head;
+        for (;;)
         {
-            s->m_Header = new_message;
-            s->m_Tail = new_message;
-        }
-        else
-        {
-            s->m_Tail->m_Next = new_message;
-            s->m_Tail = new_message;
+            new_message->m_Next = head;
+            Message* prev = AtomicCompareStorePtr<Message>(&s->m_Head, new_message, head);
+            if (prev == head)
+                break;
+            head = prev;
         }
 
-        if (is_first_message)
+        if (head == 0)
         {
+            // Wake up any DispatchBlocking() waiting for the first message
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
             dmConditionVariable::Signal(s->m_Condition);
         }
-        dmMutex::Unlock(s->m_Mutex);
 
         ReleaseSocket(s);
 
@@ -527,7 +624,7 @@ namespace dmMessage
         return buffer;
     }
 
-    uint32_t InternalDispatch(HSocket socket, DispatchCallback dispatch_callback, void* user_ptr, bool blocking)
+    uint32_t InternalDispatch(HSocket socket, DispatchCallback dispatch_callback, DispatchFlushCallback flush_callback, void* user_ptr, bool blocking)
     {
         MessageSocket* s = AcquireSocket(socket);
         if (s == 0)
@@ -535,21 +632,30 @@ namespace dmMessage
             return 0;
         }
 
-        dmMutex::Lock(s->m_Mutex);
-
-        MemoryAllocator* allocator = &s->m_Allocator;
-
-        if (!s->m_Header)
+        if (blocking)
         {
-            if (blocking) {
+            DM_MUTEX_SCOPED_LOCK(s->m_Mutex);
+            while (AtomicCompareStorePtr<Message>(&s->m_Head, 0, 0) == 0)
+            {
                 dmConditionVariable::Wait(s->m_Condition, s->m_Mutex);
-            } else {
-                dmMutex::Unlock(s->m_Mutex);
-                ReleaseSocket(s);
-                return 0;
             }
         }
 
+        // Take all messages posted so far. Messages posted during dispatch are handled in the next dispatch
+        Message* head = s->m_Head;
+        for (;;)
+        {
+            Message* prev = AtomicCompareStorePtr<Message>(&s->m_Head, 0, head);
+            if (prev == head)
+                break;
+            head = prev;
+        }
+
+        if (!head)
+        {
+            ReleaseSocket(s);
+            return 0;
+        }
 
         char buffer[128];
         const char* profiler_string = GetProfilerString(s->m_Name, buffer, sizeof(buffer));
@@ -557,37 +663,42 @@ namespace dmMessage
 
         uint32_t dispatch_count = 0;
 
-        Message *message_object = s->m_Header;
-        s->m_Header = 0;
-        s->m_Tail = 0;
-
-        // Unlink full pages
-        MemoryPage* full_pages = allocator->m_FullPages;
-        allocator->m_FullPages = 0;
-
-        dmMutex::Unlock(s->m_Mutex);
-
-        while (message_object)
+        Message *message_object = ReverseMessages(head);
+        if (flush_callback)
         {
-            dispatch_callback(message_object, user_ptr);
-            if (message_object->m_DestroyCallback) {
-                message_object->m_DestroyCallback(message_object);
+            Message* first = message_object;
+            while (message_object)
+            {
+                dispatch_callback(message_object, user_ptr);
+                message_object = message_object->m_Next;
+                dispatch_count++;
+            }
+            flush_callback(user_ptr);
+            message_object = first;
+            while (message_object)
+            {
+                Message* next = message_object->m_Next;
+                if (message_object->m_DestroyCallback) {
+                    message_object->m_DestroyCallback(message_object);
+                }
+                FreeMessage(message_object);
+                message_object = next;
             }
-            message_object = message_object->m_Next;
-            dispatch_count++;
         }
-
-        // Reclaim all full pages active when dispatch started
-        dmMutex::Lock(s->m_Mutex);
-        MemoryPage* p = full_pages;
-        while (p)
+        else
         {
-            MemoryPage* next = p->m_NextPage;
-            p->m_NextPage = allocator->m_FreePages;
-            allocator->m_FreePages = p;
-            p = next;
+            while (message_object)
+            {
+                Message* next = message_object->m_Next;
+                dispatch_callback(message_object, user_ptr);
+                if (message_object->m_DestroyCallback) {
+                    message_object->m_DestroyCallback(message_object);
+                }
+                FreeMessage(message_object);
+                message_object = next;
+                dispatch_count++;
+            }
         }
-        dmMutex::Unlock(s->m_Mutex);
 
         ReleaseSocket(s);
 
@@ -596,12 +707,17 @@ namespace dmMessage
 
     uint32_t Dispatch(HSocket socket, DispatchCallback dispatch_callback, void* user_ptr)
     {
-        return InternalDispatch(socket, dispatch_callback, user_ptr, false);
+        return InternalDispatch(socket, dispatch_callback, 0, user_ptr, false);
     }
 
     uint32_t DispatchBlocking(HSocket socket, DispatchCallback dispatch_callback, void* user_ptr)
     {
-        return InternalDispatch(socket, dispatch_callback, user_ptr, true);
+        return InternalDispatch(socket, dispatch_callback, 0, user_ptr, true);
+    }
+
+    uint32_t DispatchDeferred(HSocket socket, DispatchCallback dispatch_callback, DispatchFlushCallback flush_callback, void* user_ptr)
+    {
+        return InternalDispatch(socket, dispatch_callback, flush_callback, user_ptr, false);
     }
 
     static void ConsumeCallback(dmMessage::Message*, void*)
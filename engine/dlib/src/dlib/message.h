@@ -33,6 +33,11 @@ namespace dmMessage
      */
     typedef void(*DispatchCallback)(dmMessage::Message *message, void* user_ptr);
 
+    /**
+     * @see #DispatchDeferred
+     */
+    typedef void(*DispatchFlushCallback)(void* user_ptr);
+
 
     /**
      * Create a new socket
@@ -91,6 +96,18 @@ namespace dmMessage
      */
     uint32_t DispatchBlocking(HSocket socket, DispatchCallback dispatch_callback, void* user_ptr);
 
+    /**
+     * Dispatch messages, but don't destroy them until flush_callback has been called after the last message.
+     * This lets dispatch_callback hold on to messages and handle them in groups from flush_callback.
+     * See Dispatch() for additional information
+     * @param socket socket
+     * @param dispatch_callback dispatch callback, called for each message
+     * @param flush_callback called once after the last message, if any messages were dispatched
+     * @param user_ptr user data
+     * @return Number of dispatched messages
+     */
+    uint32_t DispatchDeferred(HSocket socket, DispatchCallback dispatch_callback, DispatchFlushCallback flush_callback, void* user_ptr);
+
     /**
      * Consume all pending messages
      * @param socket Socket handle
@@ -0,0 +1,188 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+// 
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+// 
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_SIMD_H
+#define DM_SIMD_H
+
+#include <stdint.h>
+#include <math.h>
+
+/**
+ * Minimal 4-wide float SIMD abstraction used by the batch kernels in the engine.
+ * Maps to SSE2 or NEON when available, with a scalar fallback.
+ * The functions are meant to be used on streams of data (structure-of-arrays),
+ * processing four elements per iteration.
+ */
+
+#if defined(DM_SIMD_DISABLE)
+    // Use the scalar fallback
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DM_SIMD_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define DM_SIMD_NEON
+    #include <arm_neon.h>
+#endif
+
+#if defined(DM_SIMD_SSE2) || defined(DM_SIMD_NEON)
+    #define DM_SIMD
+#endif
+
+namespace dmSIMD
+{
+#if defined(DM_SIMD_SSE2)
+    typedef __m128 Vec4f;
+
+    static inline Vec4f Load(const float* p)                    { return _mm_loadu_ps(p); }
+    static inline void  Store(float* p, Vec4f v)                { _mm_storeu_ps(p, v); }
+    static inline Vec4f Set1(float v)                           { return _mm_set1_ps(v); }
+    static inline Vec4f Zero()                                  { return _mm_setzero_ps(); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)                   { return _mm_add_ps(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)                   { return _mm_sub_ps(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)                   { return _mm_mul_ps(a, b); }
+    static inline Vec4f MulAdd(Vec4f a, Vec4f b, Vec4f c)       { return _mm_add_ps(_mm_mul_ps(a, b), c); } // a * b + c
+    static inline Vec4f Min(Vec4f a, Vec4f b)                   { return _mm_min_ps(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)                   { return _mm_max_ps(a, b); }
+    static inline Vec4f Abs(Vec4f a)                            { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+    static inline Vec4f Sqrt(Vec4f a)                           { return _mm_sqrt_ps(a); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)                   { return _mm_div_ps(a, b); }
+
+    // Per lane x >= 0 ? a : b, same as dmMath::Select
+    static inline Vec4f Select(Vec4f x, Vec4f a, Vec4f b)
+    {
+        __m128 mask = _mm_cmpge_ps(x, _mm_setzero_ps());
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // Returns a bit mask with one bit per lane, set if a < b
+    static inline uint32_t MaskLessThan(Vec4f a, Vec4f b)      { return (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+
+    // Stores the lanes as four int16 values, truncated towards zero. The values must be in the int16 range
+    static inline void StoreInt16(int16_t* p, Vec4f a)
+    {
+        _mm_storel_epi64((__m128i*)p, _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_setzero_si128()));
+    }
+
+    // Transposes a 4x4 matrix given as four rows
+    static inline void Transpose(Vec4f& r0, Vec4f& r1, Vec4f& r2, Vec4f& r3)
+    {
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    }
+
+#elif defined(DM_SIMD_NEON)
+    typedef float32x4_t Vec4f;
+
+    static inline Vec4f Load(const float* p)                    { return vld1q_f32(p); }
+    static inline void  Store(float* p, Vec4f v)                { vst1q_f32(p, v); }
+    static inline Vec4f Set1(float v)                           { return vdupq_n_f32(v); }
+    static inline Vec4f Zero()                                  { return vdupq_n_f32(0.0f); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)                   { return vaddq_f32(a, b); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)                   { return vsubq_f32(a, b); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)                   { return vmulq_f32(a, b); }
+    static inline Vec4f MulAdd(Vec4f a, Vec4f b, Vec4f c)       { return vmlaq_f32(c, a, b); } // a * b + c
+    static inline Vec4f Min(Vec4f a, Vec4f b)                   { return vminq_f32(a, b); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)                   { return vmaxq_f32(a, b); }
+    static inline Vec4f Abs(Vec4f a)                            { return vabsq_f32(a); }
+#if defined(__aarch64__)
+    static inline Vec4f Sqrt(Vec4f a)                           { return vsqrtq_f32(a); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)                   { return vdivq_f32(a, b); }
+#else
+    static inline Vec4f Sqrt(Vec4f a)
+    {
+        float v[4];
+        vst1q_f32(v, a);
+        for (int i = 0; i < 4; ++i)
+            v[i] = sqrtf(v[i]);
+        return vld1q_f32(v);
+    }
+    static inline Vec4f Div(Vec4f a, Vec4f b)
+    {
+        float va[4], vb[4];
+        vst1q_f32(va, a);
+        vst1q_f32(vb, b);
+        for (int i = 0; i < 4; ++i)
+            va[i] /= vb[i];
+        return vld1q_f32(va);
+    }
+#endif
+
+    // Per lane x >= 0 ? a : b, same as dmMath::Select
+    static inline Vec4f Select(Vec4f x, Vec4f a, Vec4f b)       { return vbslq_f32(vcgeq_f32(x, vdupq_n_f32(0.0f)), a, b); }
+
+    static inline uint32_t MaskLessThan(Vec4f a, Vec4f b)
+    {
+        uint32x4_t cmp = vcltq_f32(a, b);
+        return (vgetq_lane_u32(cmp, 0) & 1) | (vgetq_lane_u32(cmp, 1) & 2) | (vgetq_lane_u32(cmp, 2) & 4) | (vgetq_lane_u32(cmp, 3) & 8);
+    }
+
+    static inline void StoreInt16(int16_t* p, Vec4f a)         { vst1_s16(p, vqmovn_s32(vcvtq_s32_f32(a))); }
+
+    static inline void Transpose(Vec4f& r0, Vec4f& r1, Vec4f& r2, Vec4f& r3)
+    {
+        float32x4x2_t t01 = vtrnq_f32(r0, r1);
+        float32x4x2_t t23 = vtrnq_f32(r2, r3);
+        r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+        r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+        r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+        r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+    }
+
+#else
+    struct Vec4f
+    {
+        float v[4];
+    };
+
+    static inline Vec4f Make(float x, float y, float z, float w)   { Vec4f r = {{x, y, z, w}}; return r; }
+    static inline Vec4f Load(const float* p)                        { return Make(p[0], p[1], p[2], p[3]); }
+    static inline void  Store(float* p, Vec4f a)                    { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+    static inline Vec4f Set1(float x)                               { return Make(x, x, x, x); }
+    static inline Vec4f Zero()                                      { return Set1(0.0f); }
+    static inline Vec4f Add(Vec4f a, Vec4f b)                       { return Make(a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3]); }
+    static inline Vec4f Sub(Vec4f a, Vec4f b)                       { return Make(a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3]); }
+    static inline Vec4f Mul(Vec4f a, Vec4f b)                       { return Make(a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3]); }
+    static inline Vec4f MulAdd(Vec4f a, Vec4f b, Vec4f c)           { return Add(Mul(a, b), c); }
+    static inline Vec4f Div(Vec4f a, Vec4f b)                       { return Make(a.v[0]/b.v[0], a.v[1]/b.v[1], a.v[2]/b.v[2], a.v[3]/b.v[3]); }
+    static inline float MinF(float a, float b)                      { return a < b ? a : b; }
+    static inline float MaxF(float a, float b)                      { return a > b ? a : b; }
+    static inline float AbsF(float a)                               { return a < 0.0f ? -a : a; }
+    static inline Vec4f Min(Vec4f a, Vec4f b)                       { return Make(MinF(a.v[0],b.v[0]), MinF(a.v[1],b.v[1]), MinF(a.v[2],b.v[2]), MinF(a.v[3],b.v[3])); }
+    static inline Vec4f Max(Vec4f a, Vec4f b)                       { return Make(MaxF(a.v[0],b.v[0]), MaxF(a.v[1],b.v[1]), MaxF(a.v[2],b.v[2]), MaxF(a.v[3],b.v[3])); }
+    static inline Vec4f Abs(Vec4f a)                                { return Make(AbsF(a.v[0]), AbsF(a.v[1]), AbsF(a.v[2]), AbsF(a.v[3])); }
+    static inline Vec4f Sqrt(Vec4f a)                               { return Make(sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3])); }
+    static inline float SelectF(float x, float a, float b)          { return x >= 0.0f ? a : b; }
+    static inline Vec4f Select(Vec4f x, Vec4f a, Vec4f b)           { return Make(SelectF(x.v[0],a.v[0],b.v[0]), SelectF(x.v[1],a.v[1],b.v[1]), SelectF(x.v[2],a.v[2],b.v[2]), SelectF(x.v[3],a.v[3],b.v[3])); }
+
+    static inline uint32_t MaskLessThan(Vec4f a, Vec4f b)
+    {
+        return (a.v[0] < b.v[0] ? 1 : 0) | (a.v[1] < b.v[1] ? 2 : 0) | (a.v[2] < b.v[2] ? 4 : 0) | (a.v[3] < b.v[3] ? 8 : 0);
+    }
+
+    static inline void StoreInt16(int16_t* p, Vec4f a)
+    {
+        p[0] = (int16_t)a.v[0]; p[1] = (int16_t)a.v[1]; p[2] = (int16_t)a.v[2]; p[3] = (int16_t)a.v[3];
+    }
+
+    static inline void Transpose(Vec4f& r0, Vec4f& r1, Vec4f& r2, Vec4f& r3)
+    {
+        Vec4f t0 = Make(r0.v[0], r1.v[0], r2.v[0], r3.v[0]);
+        Vec4f t1 = Make(r0.v[1], r1.v[1], r2.v[1], r3.v[1]);
+        Vec4f t2 = Make(r0.v[2], r1.v[2], r2.v[2], r3.v[2]);
+        Vec4f t3 = Make(r0.v[3], r1.v[3], r2.v[3], r3.v[3]);
+        r0 = t0; r1 = t1; r2 = t2; r3 = t3;
+    }
+#endif
+}
+
+#endif // DM_SIMD_H
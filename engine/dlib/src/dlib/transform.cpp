@@ -0,0 +1,183 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+// 
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+// 
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "transform.h"
+#include "simd.h"
+#include "static_assert.h"
+
+namespace dmTransform
+{
+    using namespace dmVMath;
+
+    // The batch functions read and write matrices as 16 consecutive floats (four columns)
+    DM_STATIC_ASSERT(sizeof(Matrix4) == sizeof(float) * 16, Invalid_Struct_Size);
+
+    void SetupTransformSoA(float* buffer, uint32_t capacity, TransformSoA* soa)
+    {
+        soa->m_TX = buffer + capacity * 0;
+        soa->m_TY = buffer + capacity * 1;
+        soa->m_TZ = buffer + capacity * 2;
+        soa->m_RX = buffer + capacity * 3;
+        soa->m_RY = buffer + capacity * 4;
+        soa->m_RZ = buffer + capacity * 5;
+        soa->m_RW = buffer + capacity * 6;
+        soa->m_SX = buffer + capacity * 7;
+        soa->m_SY = buffer + capacity * 8;
+        soa->m_SZ = buffer + capacity * 9;
+    }
+
+    static inline Transform GetTransformSoA(const TransformSoA& soa, uint32_t i)
+    {
+        return Transform(Vector3(soa.m_TX[i], soa.m_TY[i], soa.m_TZ[i]),
+                         Quat(soa.m_RX[i], soa.m_RY[i], soa.m_RZ[i], soa.m_RW[i]),
+                         Vector3(soa.m_SX[i], soa.m_SY[i], soa.m_SZ[i]));
+    }
+
+    void ToMatrix4Batch(const TransformSoA& soa, uint32_t count, Matrix4* out)
+    {
+        uint32_t i = 0;
+#if defined(DM_SIMD)
+        const dmSIMD::Vec4f one = dmSIMD::Set1(1.0f);
+        const dmSIMD::Vec4f zero = dmSIMD::Zero();
+        for (; i + 4 <= count; i += 4)
+        {
+            // Same calculation as Matrix3(const Quat&), four transforms at a time
+            dmSIMD::Vec4f qx = dmSIMD::Load(soa.m_RX + i);
+            dmSIMD::Vec4f qy = dmSIMD::Load(soa.m_RY + i);
+            dmSIMD::Vec4f qz = dmSIMD::Load(soa.m_RZ + i);
+            dmSIMD::Vec4f qw = dmSIMD::Load(soa.m_RW + i);
+            dmSIMD::Vec4f qx2 = dmSIMD::Add(qx, qx);
+            dmSIMD::Vec4f qy2 = dmSIMD::Add(qy, qy);
+            dmSIMD::Vec4f qz2 = dmSIMD::Add(qz, qz);
+            dmSIMD::Vec4f qxqx2 = dmSIMD::Mul(qx, qx2);
+            dmSIMD::Vec4f qxqy2 = dmSIMD::Mul(qx, qy2);
+            dmSIMD::Vec4f qxqz2 = dmSIMD::Mul(qx, qz2);
+            dmSIMD::Vec4f qxqw2 = dmSIMD::Mul(qw, qx2);
+            dmSIMD::Vec4f qyqy2 = dmSIMD::Mul(qy, qy2);
+            dmSIMD::Vec4f qyqz2 = dmSIMD::Mul(qy, qz2);
+            dmSIMD::Vec4f qyqw2 = dmSIMD::Mul(qw, qy2);
+            dmSIMD::Vec4f qzqz2 = dmSIMD::Mul(qz, qz2);
+            dmSIMD::Vec4f qzqw2 = dmSIMD::Mul(qw, qz2);
+
+            dmSIMD::Vec4f sx = dmSIMD::Load(soa.m_SX + i);
+            dmSIMD::Vec4f sy = dmSIMD::Load(soa.m_SY + i);
+            dmSIMD::Vec4f sz = dmSIMD::Load(soa.m_SZ + i);
+
+            // One register per matrix element, one lane per transform
+            dmSIMD::Vec4f c0x = dmSIMD::Mul(dmSIMD::Sub(dmSIMD::Sub(one, qyqy2), qzqz2), sx);
+            dmSIMD::Vec4f c0y = dmSIMD::Mul(dmSIMD::Add(qxqy2, qzqw2), sx);
+            dmSIMD::Vec4f c0z = dmSIMD::Mul(dmSIMD::Sub(qxqz2, qyqw2), sx);
+            dmSIMD::Vec4f c0w = zero;
+            dmSIMD::Vec4f c1x = dmSIMD::Mul(dmSIMD::Sub(qxqy2, qzqw2), sy);
+            dmSIMD::Vec4f c1y = dmSIMD::Mul(dmSIMD::Sub(dmSIMD::Sub(one, qxqx2), qzqz2), sy);
+            dmSIMD::Vec4f c1z = dmSIMD::Mul(dmSIMD::Add(qyqz2, qxqw2), sy);
+            dmSIMD::Vec4f c1w = zero;
+            dmSIMD::Vec4f c2x = dmSIMD::Mul(dmSIMD::Add(qxqz2, qyqw2), sz);
+            dmSIMD::Vec4f c2y = dmSIMD::Mul(dmSIMD::Sub(qyqz2, qxqw2), sz);
+            dmSIMD::Vec4f c2z = dmSIMD::Mul(dmSIMD::Sub(dmSIMD::Sub(one, qxqx2), qyqy2), sz);
+            dmSIMD::Vec4f c2w = zero;
+            dmSIMD::Vec4f c3x = dmSIMD::Load(soa.m_TX + i);
+            dmSIMD::Vec4f c3y = dmSIMD::Load(soa.m_TY + i);
+            dmSIMD::Vec4f c3z = dmSIMD::Load(soa.m_TZ + i);
+            dmSIMD::Vec4f c3w = one;
+
+            // Transpose so that each register holds one column of one matrix
+            dmSIMD::Transpose(c0x, c0y, c0z, c0w);
+            dmSIMD::Transpose(c1x, c1y, c1z, c1w);
+            dmSIMD::Transpose(c2x, c2y, c2z, c2w);
+            dmSIMD::Transpose(c3x, c3y, c3z, c3w);
+
+            float* m0 = (float*)&out[i + 0];
+            float* m1 = (float*)&out[i + 1];
+            float* m2 = (float*)&out[i + 2];
+            float* m3 = (float*)&out[i + 3];
+            dmSIMD::Store(m0 + 0, c0x); dmSIMD::Store(m0 + 4, c1x); dmSIMD::Store(m0 + 8, c2x); dmSIMD::Store(m0 + 12, c3x);
+            dmSIMD::Store(m1 + 0, c0y); dmSIMD::Store(m1 + 4, c1y); dmSIMD::Store(m1 + 8, c2y); dmSIMD::Store(m1 + 12, c3y);
+            dmSIMD::Store(m2 + 0, c0z); dmSIMD::Store(m2 + 4, c1z); dmSIMD::Store(m2 + 8, c2z); dmSIMD::Store(m2 + 12, c3z);
+            dmSIMD::Store(m3 + 0, c0w); dmSIMD::Store(m3 + 4, c1w); dmSIMD::Store(m3 + 8, c2w); dmSIMD::Store(m3 + 12, c3w);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            out[i] = ToMatrix4(GetTransformSoA(soa, i));
+        }
+    }
+
+#if defined(DM_SIMD)
+    // out = lhs * rhs, where out may be the same matrix as rhs
+    static inline void MulSIMD(const float* lhs, const float* rhs, float* out, bool no_scale_z)
+    {
+        dmSIMD::Vec4f l0 = dmSIMD::Load(lhs + 0);
+        dmSIMD::Vec4f l1 = dmSIMD::Load(lhs + 4);
+        dmSIMD::Vec4f l2 = dmSIMD::Load(lhs + 8);
+        dmSIMD::Vec4f l3 = dmSIMD::Load(lhs + 12);
+
+        // Read all of rhs before writing, since out may alias it
+        float r[16];
+        for (uint32_t j = 0; j < 16; ++j)
+            r[j] = rhs[j];
+
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            const float* rc = r + c * 4;
+            dmSIMD::Vec4f col = dmSIMD::Mul(l0, dmSIMD::Set1(rc[0]));
+            col = dmSIMD::MulAdd(l1, dmSIMD::Set1(rc[1]), col);
+            col = dmSIMD::MulAdd(l2, dmSIMD::Set1(rc[2]), col);
+            col = dmSIMD::MulAdd(l3, dmSIMD::Set1(rc[3]), col);
+            dmSIMD::Store(out + c * 4, col);
+        }
+
+        if (no_scale_z)
+        {
+            // Same as NormalizeZScale(), the translation is not affected by the z-scale of lhs
+            float z_mag_sqr = lhs[8] * lhs[8] + lhs[9] * lhs[9] + lhs[10] * lhs[10] + lhs[11] * lhs[11];
+            if (z_mag_sqr > 0.0f)
+            {
+                l2 = dmSIMD::Mul(l2, dmSIMD::Set1(1.0f / sqrtf(z_mag_sqr)));
+            }
+        }
+
+        const float* r3 = r + 12;
+        dmSIMD::Vec4f col3 = dmSIMD::Mul(l0, dmSIMD::Set1(r3[0]));
+        col3 = dmSIMD::MulAdd(l1, dmSIMD::Set1(r3[1]), col3);
+        col3 = dmSIMD::MulAdd(l2, dmSIMD::Set1(r3[2]), col3);
+        col3 = dmSIMD::MulAdd(l3, dmSIMD::Set1(r3[3]), col3);
+        dmSIMD::Store(out + 12, col3);
+    }
+#endif
+
+    void MulBatch(const Matrix4* parents, const uint16_t* parent_indices, const Matrix4* local, uint32_t count, Matrix4* out)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+#if defined(DM_SIMD)
+            MulSIMD((const float*)&parents[parent_indices[i]], (const float*)&local[i], (float*)&out[i], false);
+#else
+            out[i] = parents[parent_indices[i]] * local[i];
+#endif
+        }
+    }
+
+    void MulNoScaleZBatch(const Matrix4* parents, const uint16_t* parent_indices, const Matrix4* local, uint32_t count, Matrix4* out)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+#if defined(DM_SIMD)
+            MulSIMD((const float*)&parents[parent_indices[i]], (const float*)&local[i], (float*)&out[i], true);
+#else
+            out[i] = MulNoScaleZ(parents[parent_indices[i]], local[i]);
+#endif
+        }
+    }
+}
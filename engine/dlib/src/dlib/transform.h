@@ -16,6 +16,7 @@
 #define DM_TRANSFORM_H
 
 #include <assert.h>
+#include <stdint.h>
 #include <dmsdk/dlib/transform.h>
 #include <dmsdk/dlib/vmath.h>
 
@@ -179,6 +180,90 @@ namespace dmTransform
         res = appendScale(res, dmVMath::Vector3(t.GetScale()));
         return res;
     }
+
+    /**
+     * Structure-of-arrays (SoA) view of a batch of transforms.
+     * Each component is stored in a separate contiguous stream of floats,
+     * which allows the batch functions below to process four transforms per iteration.
+     */
+    struct TransformSoA
+    {
+        float* m_TX;
+        float* m_TY;
+        float* m_TZ;
+        float* m_RX;
+        float* m_RY;
+        float* m_RZ;
+        float* m_RW;
+        float* m_SX;
+        float* m_SY;
+        float* m_SZ;
+    };
+
+    /**
+     * Number of float streams in a TransformSoA
+     */
+    const uint32_t TRANSFORM_SOA_STREAM_COUNT = 10;
+
+    /**
+     * Setup a TransformSoA from a single buffer of TRANSFORM_SOA_STREAM_COUNT * capacity floats
+     * @param buffer Buffer holding all streams
+     * @param capacity Max number of transforms in each stream
+     * @param soa [out] The SoA view
+     */
+    void SetupTransformSoA(float* buffer, uint32_t capacity, TransformSoA* soa);
+
+    /**
+     * Store a transform at an index in a TransformSoA
+     * @param soa The SoA view
+     * @param index Index to store the transform at
+     * @param t Transform to store
+     */
+    inline void SetTransformSoA(const TransformSoA& soa, uint32_t index, const Transform& t)
+    {
+        const float* translation = t.GetPositionPtr();
+        const float* rotation = t.GetRotationPtr();
+        const float* scale = t.GetScalePtr();
+        soa.m_TX[index] = translation[0];
+        soa.m_TY[index] = translation[1];
+        soa.m_TZ[index] = translation[2];
+        soa.m_RX[index] = rotation[0];
+        soa.m_RY[index] = rotation[1];
+        soa.m_RZ[index] = rotation[2];
+        soa.m_RW[index] = rotation[3];
+        soa.m_SX[index] = scale[0];
+        soa.m_SY[index] = scale[1];
+        soa.m_SZ[index] = scale[2];
+    }
+
+    /**
+     * Convert a batch of transforms into 4-dim matrices. Same result as ToMatrix4() on each transform.
+     * Uses SIMD (SSE2/NEON) when available.
+     * @param transforms Transforms to convert
+     * @param count Number of transforms
+     * @param out [out] Resulting matrices, count entries
+     */
+    void ToMatrix4Batch(const TransformSoA& transforms, uint32_t count, dmVMath::Matrix4* out);
+
+    /**
+     * Multiply a batch of matrices with their parent matrices: out[i] = parents[parent_indices[i]] * local[i]
+     * @param parents Array of parent matrices
+     * @param parent_indices Index into parents for each matrix
+     * @param local Matrices to transform
+     * @param count Number of matrices
+     * @param out [out] Resulting matrices. May be the same array as local
+     */
+    void MulBatch(const dmVMath::Matrix4* parents, const uint16_t* parent_indices, const dmVMath::Matrix4* local, uint32_t count, dmVMath::Matrix4* out);
+
+    /**
+     * Same as MulBatch, but with the semantics of MulNoScaleZ()
+     * @param parents Array of parent matrices
+     * @param parent_indices Index into parents for each matrix
+     * @param local Matrices to transform
+     * @param count Number of matrices
+     * @param out [out] Resulting matrices. May be the same array as local
+     */
+    void MulNoScaleZBatch(const dmVMath::Matrix4* parents, const uint16_t* parent_indices, const dmVMath::Matrix4* local, uint32_t count, dmVMath::Matrix4* out);
 }
 
 #endif // DM_TRANSFORM_H
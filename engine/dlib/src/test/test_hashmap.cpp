@@ -0,0 +1,423 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <vector>
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+#include "dlib/hashmap.h"
+#include "dlib/hashtable.h"
+#include "dlib/time.h"
+
+static uint64_t NextRandom(uint64_t* state)
+{
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+TEST(dmHashMap, EmptyConstructor)
+{
+    dmHashMap32<int> hm;
+
+    EXPECT_EQ(0U, hm.Size());
+    EXPECT_EQ(0U, hm.Capacity());
+    EXPECT_TRUE(hm.Empty());
+    EXPECT_EQ((int*)0, hm.Get(1));
+    hm.Verify();
+}
+
+TEST(dmHashMap, SimplePut)
+{
+    dmHashMap<uint32_t, uint32_t> hm;
+    hm.Put(12, 23);
+
+    uint32_t* val = hm.Get(12);
+    ASSERT_NE((uintptr_t) 0, (uintptr_t) val);
+    EXPECT_EQ((uint32_t) 23, *val);
+    EXPECT_EQ(1U, hm.Size());
+    EXPECT_LE(1U, hm.Capacity());
+
+    hm.Put(12, 24);
+    EXPECT_EQ((uint32_t) 24, *hm.Get(12));
+    EXPECT_EQ(1U, hm.Size());
+    hm.Verify();
+}
+
+TEST(dmHashMap, SimpleErase)
+{
+    dmHashMap64<uint32_t> hm;
+    hm.Put(1, 10);
+    hm.Put(2, 20);
+    hm.Verify();
+
+    hm.Erase(1);
+    hm.Verify();
+    EXPECT_EQ((uint32_t*)0, hm.Get(1));
+    ASSERT_NE((uint32_t*)0, hm.Get(2));
+    EXPECT_EQ(20U, *hm.Get(2));
+
+    hm.Erase(2);
+    hm.Verify();
+    EXPECT_EQ((uint32_t*)0, hm.Get(2));
+    EXPECT_TRUE(hm.Empty());
+}
+
+TEST(dmHashMap, SetCapacity)
+{
+    dmHashMap64<int> hm;
+    hm.SetCapacity(1000);
+    EXPECT_LE(1000U, hm.Capacity());
+
+    uint32_t capacity = hm.Capacity();
+    for (int i = 0; i < 1000; ++i)
+    {
+        hm.Put((uint64_t)i, i);
+    }
+    EXPECT_EQ(capacity, hm.Capacity());
+    EXPECT_EQ(1000U, hm.Size());
+
+    // Never shrinks
+    hm.SetCapacity(10);
+    EXPECT_EQ(capacity, hm.Capacity());
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(i, *hm.Get((uint64_t)i));
+    }
+    hm.Verify();
+}
+
+TEST(dmHashMap, Grow)
+{
+    // Sequential keys, no capacity set up front
+    dmHashMap32<uint32_t> hm;
+    const uint32_t count = 100000;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        hm.Put(i, i * 2);
+    }
+    EXPECT_EQ(count, hm.Size());
+    EXPECT_LE(count, hm.Capacity());
+    hm.Verify();
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t* val = hm.Get(i);
+        ASSERT_NE((uint32_t*)0, val);
+        ASSERT_EQ(i * 2, *val);
+    }
+    EXPECT_EQ((uint32_t*)0, hm.Get(count));
+}
+
+TEST(dmHashMap, Clear)
+{
+    dmHashMap64<int> hm;
+    for (int i = 0; i < 100; ++i)
+    {
+        hm.Put((uint64_t)i, i);
+    }
+    uint32_t capacity = hm.Capacity();
+    hm.Clear();
+    hm.Verify();
+    EXPECT_EQ(0U, hm.Size());
+    EXPECT_EQ(capacity, hm.Capacity());
+    EXPECT_EQ((int*)0, hm.Get(1));
+
+    hm.Put(1, 2);
+    EXPECT_EQ(2, *hm.Get(1));
+}
+
+TEST(dmHashMap, Swap)
+{
+    dmHashMap64<int> a;
+    dmHashMap64<int> b;
+    a.Put(1, 10);
+    b.Put(2, 20);
+    b.Put(3, 30);
+
+    a.Swap(b);
+    EXPECT_EQ(2U, a.Size());
+    EXPECT_EQ(1U, b.Size());
+    EXPECT_EQ(20, *a.Get(2));
+    EXPECT_EQ(10, *b.Get(1));
+    EXPECT_EQ((int*)0, a.Get(1));
+}
+
+TEST(dmHashMap, PointerKeys)
+{
+    // Aligned pointers have their low bits cleared
+    std::vector<uint64_t> storage(1000);
+    dmHashMap<uintptr_t, uint32_t> hm;
+    for (uint32_t i = 0; i < storage.size(); ++i)
+    {
+        hm.Put((uintptr_t)&storage[i], i);
+    }
+    hm.Verify();
+    for (uint32_t i = 0; i < storage.size(); ++i)
+    {
+        ASSERT_EQ(i, *hm.Get((uintptr_t)&storage[i]));
+    }
+}
+
+static void IterateCallback(uint64_t* sum, const uint32_t* key, uint32_t* value)
+{
+    *sum += *key + *value;
+}
+
+TEST(dmHashMap, Iterate)
+{
+    dmHashMap32<uint32_t> hm;
+    uint64_t expected = 0;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        hm.Put(i, i * 3);
+        expected += i + i * 3;
+    }
+
+    uint64_t sum = 0;
+    hm.Iterate(IterateCallback, &sum);
+    EXPECT_EQ(expected, sum);
+
+    sum = 0;
+    uint32_t count = 0;
+    dmHashMap32<uint32_t>::Iterator iter = hm.GetIterator();
+    while (iter.Next())
+    {
+        sum += iter.GetKey() + iter.GetValue();
+        ++count;
+    }
+    EXPECT_EQ(expected, sum);
+    EXPECT_EQ(1000U, count);
+
+    dmHashMap32<uint32_t> empty;
+    dmHashMap32<uint32_t>::Iterator empty_iter = empty.GetIterator();
+    EXPECT_FALSE(empty_iter.Next());
+}
+
+TEST(dmHashMap, EraseReuse)
+{
+    // Repeatedly filling and emptying the map should reuse the deleted slots instead of growing forever
+    dmHashMap64<uint32_t> hm;
+    hm.SetCapacity(1000);
+    uint32_t capacity = hm.Capacity();
+
+    uint64_t state = 0x1234567;
+    std::vector<uint64_t> keys;
+    for (uint32_t round = 0; round < 100; ++round)
+    {
+        for (uint32_t i = 0; i < 1000; ++i)
+        {
+            uint64_t key = NextRandom(&state);
+            keys.push_back(key);
+            hm.Put(key, i);
+        }
+        for (uint32_t i = 0; i < keys.size(); ++i)
+        {
+            hm.Erase(keys[i]);
+        }
+        keys.clear();
+    }
+    hm.Verify();
+    EXPECT_EQ(0U, hm.Size());
+    EXPECT_EQ(capacity, hm.Capacity());
+}
+
+TEST(dmHashMap, Exhaustive)
+{
+    // Random operations compared to std::map
+    std::map<uint64_t, uint32_t> reference;
+    dmHashMap64<uint32_t> hm;
+
+    uint64_t state = 0x9876543;
+    for (uint32_t i = 0; i < 200000; ++i)
+    {
+        uint64_t r = NextRandom(&state);
+        // Use a small key range to get a lot of collisions between puts and erases
+        uint64_t key = (r >> 8) % 5000;
+        uint32_t op = (uint32_t)(r & 0xFF);
+        if (op < 128)
+        {
+            hm.Put(key, i);
+            reference[key] = i;
+        }
+        else if (op < 192)
+        {
+            bool exists = reference.find(key) != reference.end();
+            ASSERT_EQ(exists, hm.Get(key) != 0);
+            if (exists)
+            {
+                hm.Erase(key);
+                reference.erase(key);
+            }
+        }
+        else
+        {
+            uint32_t* val = hm.Get(key);
+            std::map<uint64_t, uint32_t>::iterator it = reference.find(key);
+            if (it == reference.end())
+            {
+                ASSERT_EQ((uint32_t*)0, val);
+            }
+            else
+            {
+                ASSERT_NE((uint32_t*)0, val);
+                ASSERT_EQ(it->second, *val);
+            }
+        }
+        ASSERT_EQ((uint32_t)reference.size(), hm.Size());
+    }
+    hm.Verify();
+}
+
+// Benchmark of dmHashMap64 compared to dmHashTable64, with random dmhash_t-like keys
+
+struct BenchmarkResult
+{
+    double m_Insert;
+    double m_Lookup;
+    double m_LookupMiss;
+    double m_Erase;
+};
+
+static double ElapsedNsPerOp(uint64_t start, uint32_t count)
+{
+    return (double)(dmTime::GetTime() - start) * 1000.0 / count;
+}
+
+template <typename MAP>
+static void BenchmarkLookups(MAP& map, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& missing, BenchmarkResult* result)
+{
+    uint32_t count = (uint32_t)keys.size();
+    uint32_t sum = 0;
+    uint32_t found_missing = 0;
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        sum += *map.Get(keys[i]);
+    }
+    result->m_Lookup = ElapsedNsPerOp(start, count);
+
+    start = dmTime::GetTime();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        found_missing += map.Get(missing[i]) != 0;
+    }
+    result->m_LookupMiss = ElapsedNsPerOp(start, count);
+
+    // Using the results keeps the compiler from removing the lookups. The values are the indices 0..count-1
+    ASSERT_EQ((uint32_t)((uint64_t)count * (count - 1) / 2), sum);
+    ASSERT_EQ(0U, found_missing);
+}
+
+TEST(dmHashMapBenchmark, CompareWithHashTable)
+{
+    for (uint32_t count = 1000; count <= 100000; count *= 10)
+    {
+        uint64_t state = 0xdef01d + count;
+        std::vector<uint64_t> keys(count);
+        std::vector<uint64_t> missing(count);
+        std::vector<uint64_t> lookup_order(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            keys[i] = NextRandom(&state);
+            missing[i] = NextRandom(&state);
+        }
+        // Look up in a different order than inserted, to not favor the chained table
+        lookup_order = keys;
+        for (uint32_t i = count - 1; i > 0; --i)
+        {
+            uint32_t j = (uint32_t)(NextRandom(&state) % (i + 1));
+            uint64_t tmp = lookup_order[i];
+            lookup_order[i] = lookup_order[j];
+            lookup_order[j] = tmp;
+        }
+
+        BenchmarkResult table_result;
+        {
+            dmHashTable64<uint32_t>* table = new dmHashTable64<uint32_t>();
+            uint64_t start = dmTime::GetTime();
+            table->SetCapacity(count * 3 / 4, count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                table->Put(keys[i], i);
+            }
+            table_result.m_Insert = ElapsedNsPerOp(start, count);
+
+            BenchmarkLookups(*table, lookup_order, missing, &table_result);
+
+            start = dmTime::GetTime();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                table->Erase(lookup_order[i]);
+            }
+            table_result.m_Erase = ElapsedNsPerOp(start, count);
+            delete table;
+        }
+
+        BenchmarkResult map_result;
+        {
+            dmHashMap64<uint32_t>* map = new dmHashMap64<uint32_t>();
+            uint64_t start = dmTime::GetTime();
+            map->SetCapacity(count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                map->Put(keys[i], i);
+            }
+            map_result.m_Insert = ElapsedNsPerOp(start, count);
+
+            BenchmarkLookups(*map, lookup_order, missing, &map_result);
+
+            start = dmTime::GetTime();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                map->Erase(lookup_order[i]);
+            }
+            map_result.m_Erase = ElapsedNsPerOp(start, count);
+            ASSERT_TRUE(map->Empty());
+            delete map;
+        }
+
+        // Growing from an empty map
+        double map_grow_insert;
+        {
+            dmHashMap64<uint32_t> map;
+            uint64_t start = dmTime::GetTime();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                map.Put(keys[i], i);
+            }
+            map_grow_insert = ElapsedNsPerOp(start, count);
+        }
+
+        printf("%7u entries (ns/op)  dmHashTable64: insert %6.1f lookup %6.1f miss %6.1f erase %6.1f   dmHashMap64: insert %6.1f (growing %6.1f) lookup %6.1f miss %6.1f erase %6.1f\n",
+                count,
+                table_result.m_Insert, table_result.m_Lookup, table_result.m_LookupMiss, table_result.m_Erase,
+                map_result.m_Insert, map_grow_insert, map_result.m_Lookup, map_result.m_LookupMiss, map_result.m_Erase);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
@@ -14,7 +14,12 @@
 
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
+#include <stdio.h>
 #include "dlib/vmath.h"
+#include <dlib/array.h>
+#include <dlib/intersection.h>
+#include <dlib/job_system.h>
+#include <dlib/time.h>
 #include <dmsdk/dlib/intersection.h>
 
 const float PI = 3.141592653;
@@ -314,7 +319,181 @@ TEST(dmVMath, TestFrustumOBBCorners)
 }
 
 
+static float RandomFloat(uint32_t* seed, float min, float max)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    return min + (max - min) * (float)(*seed >> 8) / (float)(1 << 24);
+}
+
+static void CreateTestFrustum(dmIntersection::Frustum& frustum)
+{
+    dmVMath::Matrix4 view = Matrix4::lookAt(dmVMath::Point3(0, 0, 0), dmVMath::Point3(0, 0, -1), dmVMath::Vector3(0, 1, 0));
+    dmVMath::Matrix4 proj = dmVMath::Matrix4::perspective(PER_FRUSTUM_FOV, PER_FRUSTUM_RATIO, PER_FRUSTUM_NEAR, PER_FRUSTUM_FAR);
+    dmIntersection::CreateFrustumFromMatrix(proj * view, true, 6, frustum);
+}
+
+// Fills the spheres with random positions around the frustum, with some of them on the frustum planes
+static void CreateTestSpheres(uint32_t count, dmArray<float>& buffer, dmIntersection::SphereSoA& spheres)
+{
+    buffer.SetCapacity(count * dmIntersection::SPHERE_SOA_STREAM_COUNT);
+    buffer.SetSize(count * dmIntersection::SPHERE_SOA_STREAM_COUNT);
+    dmIntersection::SetupSphereSoA(buffer.Begin(), count, &spheres);
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmVMath::Point3 pos(RandomFloat(&seed, -150.0f, 150.0f), RandomFloat(&seed, -150.0f, 150.0f), RandomFloat(&seed, -150.0f, 50.0f));
+        float radius = RandomFloat(&seed, 0.0f, 20.0f);
+        dmIntersection::SetSphereSoA(spheres, i, pos, radius * radius);
+    }
+}
+
+static dmVMath::Matrix4 CreateTestOBB(uint32_t* seed, dmVMath::Vector3& aabb_min, dmVMath::Vector3& aabb_max)
+{
+    aabb_min = dmVMath::Vector3(RandomFloat(seed, -10.0f, 0.0f), RandomFloat(seed, -10.0f, 0.0f), RandomFloat(seed, -10.0f, 0.0f));
+    aabb_max = dmVMath::Vector3(RandomFloat(seed, 0.0f, 10.0f), RandomFloat(seed, 0.0f, 10.0f), RandomFloat(seed, 0.0f, 10.0f));
+    dmVMath::Vector3 pos(RandomFloat(seed, -150.0f, 150.0f), RandomFloat(seed, -150.0f, 150.0f), RandomFloat(seed, -150.0f, 50.0f));
+    return dmVMath::Matrix4::translation(pos) * dmVMath::Matrix4::rotationZYX(dmVMath::Vector3(RandomFloat(seed, 0.0f, PI), RandomFloat(seed, 0.0f, PI), RandomFloat(seed, 0.0f, PI))) * dmVMath::Matrix4::scale(dmVMath::Vector3(RandomFloat(seed, 0.5f, 2.0f)));
+}
+
+TEST(dmVMath, TestFrustumSphereSqBatch)
+{
+    dmIntersection::Frustum frustum;
+    CreateTestFrustum(frustum);
+
+    // Not a multiple of four, to test the remainder
+    const uint32_t count = 1003;
+    dmArray<float> buffer;
+    dmIntersection::SphereSoA spheres;
+    CreateTestSpheres(count, buffer, spheres);
+
+    dmArray<uint8_t> intersect;
+    intersect.SetCapacity(count);
+    intersect.SetSize(count);
+    dmIntersection::TestFrustumSphereSqBatch(frustum, spheres, count, intersect.Begin());
+
+    uint32_t num_intersect = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmVMath::Point3 pos(spheres.m_X[i], spheres.m_Y[i], spheres.m_Z[i]);
+        ASSERT_EQ(dmIntersection::TestFrustumSphereSq(frustum, pos, spheres.m_RadiusSq[i]) ? 1 : 0, intersect[i]);
+        num_intersect += intersect[i];
+    }
+    ASSERT_LT(0U, num_intersect);
+    ASSERT_GT(count, num_intersect);
+}
 
+TEST(dmVMath, TestFrustumOBBBatch)
+{
+    dmIntersection::Frustum frustum;
+    CreateTestFrustum(frustum);
+
+    const uint32_t count = 1003;
+    dmArray<float> buffer;
+    buffer.SetCapacity(count * dmIntersection::OBB_SOA_STREAM_COUNT);
+    buffer.SetSize(count * dmIntersection::OBB_SOA_STREAM_COUNT);
+    dmIntersection::OBBSoA boxes;
+    dmIntersection::SetupOBBSoA(buffer.Begin(), count, &boxes);
+
+    dmArray<uint8_t> expected;
+    expected.SetCapacity(count);
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmVMath::Vector3 aabb_min, aabb_max;
+        dmVMath::Matrix4 world = CreateTestOBB(&seed, aabb_min, aabb_max);
+        dmIntersection::SetOBBSoA(boxes, i, world, aabb_min, aabb_max);
+        expected.Push(dmIntersection::TestFrustumOBB(frustum, world, aabb_min, aabb_max) ? 1 : 0);
+    }
+
+    dmArray<uint8_t> intersect;
+    intersect.SetCapacity(count);
+    intersect.SetSize(count);
+    dmIntersection::TestFrustumOBBBatch(frustum, boxes, count, intersect.Begin());
+
+    uint32_t num_intersect = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(expected[i], intersect[i]);
+        num_intersect += intersect[i];
+    }
+    ASSERT_LT(0U, num_intersect);
+    ASSERT_GT(count, num_intersect);
+}
+
+TEST(dmVMath, TestFrustumBatchJobSystem)
+{
+    dmIntersection::Frustum frustum;
+    CreateTestFrustum(frustum);
+
+    const uint32_t count = dmIntersection::FRUSTUM_BATCH_JOB_CHUNK_SIZE * 8 + 3;
+    dmArray<float> buffer;
+    dmIntersection::SphereSoA spheres;
+    CreateTestSpheres(count, buffer, spheres);
+
+    dmArray<uint8_t> expected;
+    dmArray<uint8_t> intersect;
+    expected.SetCapacity(count);
+    expected.SetSize(count);
+    intersect.SetCapacity(count);
+    intersect.SetSize(count);
+    dmIntersection::TestFrustumSphereSqBatch(frustum, spheres, count, expected.Begin());
+
+    dmJobSystem::Params job_system_params;
+    dmJobSystem::SetDefaultParams(&job_system_params);
+    job_system_params.m_Name = "test_intersection";
+    job_system_params.m_WorkerCount = 4;
+    dmJobSystem::HJobSystem job_system = dmJobSystem::New(job_system_params);
+    dmIntersection::TestFrustumSphereSqBatch(job_system, frustum, spheres, count, intersect.Begin());
+    dmJobSystem::Delete(job_system);
+
+    ASSERT_ARRAY_EQ_LEN(expected.Begin(), intersect.Begin(), count);
+}
+
+// Benchmark of the frustum culling of spheres, one at a time and in batches
+
+TEST(dmVMath, BenchmarkFrustumSphereSq)
+{
+    dmIntersection::Frustum frustum;
+    CreateTestFrustum(frustum);
+
+    const uint32_t count = 200000;
+    dmArray<float> buffer;
+    dmIntersection::SphereSoA spheres;
+    CreateTestSpheres(count, buffer, spheres);
+
+    dmArray<uint8_t> intersect;
+    intersect.SetCapacity(count);
+    intersect.SetSize(count);
+
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmVMath::Point3 pos(spheres.m_X[i], spheres.m_Y[i], spheres.m_Z[i]);
+        intersect[i] = dmIntersection::TestFrustumSphereSq(frustum, pos, spheres.m_RadiusSq[i]) ? 1 : 0;
+    }
+    uint64_t single_time = dmTime::GetTime() - start;
+
+    start = dmTime::GetTime();
+    dmIntersection::TestFrustumSphereSqBatch(frustum, spheres, count, intersect.Begin());
+    uint64_t batch_time = dmTime::GetTime() - start;
+
+    dmJobSystem::Params job_system_params;
+    dmJobSystem::SetDefaultParams(&job_system_params);
+    job_system_params.m_Name = "bench_intersection";
+    job_system_params.m_WorkerCount = 4;
+    dmJobSystem::HJobSystem job_system = dmJobSystem::New(job_system_params);
+
+    start = dmTime::GetTime();
+    dmIntersection::TestFrustumSphereSqBatch(job_system, frustum, spheres, count, intersect.Begin());
+    uint64_t job_system_time = dmTime::GetTime() - start;
+    dmJobSystem::Delete(job_system);
+
+    // Entries culled per millisecond
+    #define CULLED_PER_MS(_TIME) ((_TIME) ? (count * 1000.0 / (_TIME)) : 0.0)
+    printf("%u spheres: TestFrustumSphereSq %.0f/ms  TestFrustumSphereSqBatch %.0f/ms  TestFrustumSphereSqBatch (4 job workers) %.0f/ms\n",
+            count, CULLED_PER_MS(single_time), CULLED_PER_MS(batch_time), CULLED_PER_MS(job_system_time));
+    #undef CULLED_PER_MS
+}
 
 int main(int argc, char **argv)
 {
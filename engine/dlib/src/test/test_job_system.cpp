@@ -0,0 +1,385 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include "dlib/job_system.h"
+#include "dlib/job_thread.h"
+#include "dlib/array.h"
+#include "dlib/atomic.h"
+#include "dlib/thread.h"
+#include "dlib/time.h"
+
+#define JC_TEST_IMPLEMENTATION
+#include <jc_test/jc_test.h>
+
+class JobSystemTest : public jc_test_params_class<uint32_t>
+{
+protected:
+    virtual void SetUp()
+    {
+        dmJobSystem::Params params;
+        dmJobSystem::SetDefaultParams(&params);
+        params.m_Name = "test_job_worker";
+        params.m_WorkerCount = GetParam();
+        params.m_QueueCapacity = 64;
+        m_System = dmJobSystem::New(params);
+    }
+
+    virtual void TearDown()
+    {
+        dmJobSystem::Delete(m_System);
+    }
+
+    dmJobSystem::HJobSystem m_System;
+};
+
+static void IncrementJob(void* context, void* data)
+{
+    dmAtomicIncrement32((int32_atomic_t*)context);
+}
+
+TEST_P(JobSystemTest, RunAndWait)
+{
+    int32_atomic_t value = 0;
+    dmJobSystem::Counter counter;
+    dmJobSystem::InitCounter(&counter);
+
+    // More jobs than fit in the queue, so that some of them are run directly
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        dmJobSystem::Run(m_System, IncrementJob, (void*)&value, 0, &counter, 0);
+    }
+    dmJobSystem::WaitForCounter(m_System, &counter);
+
+    ASSERT_EQ(1000, dmAtomicGet32(&value));
+    ASSERT_EQ(0, dmAtomicGet32(&counter.m_Value));
+}
+
+struct ChainContext
+{
+    int32_atomic_t  m_Step;
+    uint32_t        m_Order[16];
+};
+
+static void ChainJob(void* context, void* data)
+{
+    ChainContext* ctx = (ChainContext*)context;
+    ctx->m_Order[(uintptr_t)data] = (uint32_t)dmAtomicIncrement32(&ctx->m_Step);
+}
+
+TEST_P(JobSystemTest, Dependencies)
+{
+    for (uint32_t iteration = 0; iteration < 100; ++iteration)
+    {
+        ChainContext ctx;
+        ctx.m_Step = 0;
+
+        // Each job depends on the counter of the previous job
+        dmJobSystem::Counter counters[16];
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(counters); ++i)
+        {
+            dmJobSystem::InitCounter(&counters[i]);
+            dmJobSystem::Run(m_System, ChainJob, &ctx, (void*)(uintptr_t)i, &counters[i], i > 0 ? &counters[i - 1] : 0);
+        }
+        dmJobSystem::WaitForCounter(m_System, &counters[DM_ARRAY_SIZE(counters) - 1]);
+
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(counters); ++i)
+        {
+            ASSERT_EQ(i, ctx.m_Order[i]);
+        }
+    }
+}
+
+static void WaitForFlagJob(void* context, void* data)
+{
+    while (dmAtomicGet32((int32_atomic_t*)context) == 0)
+    {
+    }
+}
+
+static void StoreValueJob(void* context, void* data)
+{
+    dmAtomicStore32((int32_atomic_t*)data, dmAtomicGet32((int32_atomic_t*)context));
+}
+
+TEST_P(JobSystemTest, FanInDependency)
+{
+    int32_atomic_t value = 0;
+    int32_atomic_t seen = -1;
+    // Without workers, the jobs are run directly and must not block
+    int32_atomic_t flag = dmJobSystem::GetWorkerCount(m_System) == 0 ? 1 : 0;
+
+    dmJobSystem::Counter gate;
+    dmJobSystem::Counter first;
+    dmJobSystem::Counter second;
+    dmJobSystem::InitCounter(&gate);
+    dmJobSystem::InitCounter(&first);
+    dmJobSystem::InitCounter(&second);
+
+    // Keep the first batch from starting until all the jobs are scheduled
+    dmJobSystem::Run(m_System, WaitForFlagJob, (void*)&flag, 0, &gate, 0);
+    for (uint32_t i = 0; i < 50; ++i)
+    {
+        dmJobSystem::Run(m_System, IncrementJob, (void*)&value, 0, &first, &gate);
+    }
+    // Depends on all the jobs of the first batch
+    dmJobSystem::Run(m_System, StoreValueJob, (void*)&value, (void*)&seen, &second, &first);
+
+    dmAtomicStore32(&flag, 1);
+    dmJobSystem::WaitForCounter(m_System, &second);
+    ASSERT_EQ(50, dmAtomicGet32(&value));
+    ASSERT_EQ(50, dmAtomicGet32(&seen));
+}
+
+static void ParallelForProcess(void* context, uint32_t begin, uint32_t end)
+{
+    uint32_t* data = (uint32_t*)context;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        data[i] += i;
+    }
+}
+
+TEST_P(JobSystemTest, ParallelFor)
+{
+    const uint32_t count = 10007;
+    dmArray<uint32_t> data;
+    data.SetCapacity(count);
+    data.SetSize(count);
+
+    const uint32_t grain_sizes[] = {0, 1, 16, 1000, count, count * 2};
+    for (uint32_t g = 0; g < DM_ARRAY_SIZE(grain_sizes); ++g)
+    {
+        memset(data.Begin(), 0, sizeof(uint32_t) * count);
+        for (uint32_t j = 0; j < 10; ++j)
+        {
+            dmJobSystem::ParallelFor(m_System, ParallelForProcess, data.Begin(), count, grain_sizes[g]);
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ASSERT_EQ(i * 10, data[i]);
+        }
+    }
+}
+
+struct NestedContext
+{
+    dmJobSystem::HJobSystem m_System;
+    uint32_t*               m_Data;
+    uint32_t                m_InnerCount;
+};
+
+static void NestedOuterProcess(void* context, uint32_t begin, uint32_t end)
+{
+    NestedContext* ctx = (NestedContext*)context;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        // Waiting from within a job, which must not deadlock even if all workers do it
+        dmJobSystem::ParallelFor(ctx->m_System, ParallelForProcess, ctx->m_Data + i * ctx->m_InnerCount, ctx->m_InnerCount, 7);
+    }
+}
+
+TEST_P(JobSystemTest, NestedParallelFor)
+{
+    const uint32_t outer_count = 64;
+    const uint32_t inner_count = 100;
+    dmArray<uint32_t> data;
+    data.SetCapacity(outer_count * inner_count);
+    data.SetSize(outer_count * inner_count);
+    memset(data.Begin(), 0, sizeof(uint32_t) * data.Size());
+
+    NestedContext ctx;
+    ctx.m_System = m_System;
+    ctx.m_Data = data.Begin();
+    ctx.m_InnerCount = inner_count;
+    dmJobSystem::ParallelFor(m_System, NestedOuterProcess, &ctx, outer_count, 1);
+
+    for (uint32_t i = 0; i < data.Size(); ++i)
+    {
+        ASSERT_EQ(i % inner_count, data[i]);
+    }
+}
+
+struct ProducerContext
+{
+    dmJobSystem::HJobSystem m_System;
+    int32_atomic_t          m_Value;
+};
+
+static void ProducerThread(void* _ctx)
+{
+    ProducerContext* ctx = (ProducerContext*)_ctx;
+    for (uint32_t batch = 0; batch < 100; ++batch)
+    {
+        dmJobSystem::Counter counter;
+        dmJobSystem::InitCounter(&counter);
+        for (uint32_t i = 0; i < 100; ++i)
+        {
+            dmJobSystem::Run(ctx->m_System, IncrementJob, (void*)&ctx->m_Value, 0, &counter, 0);
+        }
+        dmJobSystem::WaitForCounter(ctx->m_System, &counter);
+    }
+}
+
+// Several threads scheduling and waiting for jobs at the same time
+TEST_P(JobSystemTest, StressMultipleProducers)
+{
+    if (!dmThread::PlatformHasThreadSupport())
+        return;
+
+    ProducerContext ctx;
+    ctx.m_System = m_System;
+    ctx.m_Value = 0;
+
+    dmThread::Thread threads[4];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(threads); ++i)
+    {
+        threads[i] = dmThread::New(ProducerThread, 0x80000, (void*)&ctx, "test_producer");
+    }
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(threads); ++i)
+    {
+        dmThread::Join(threads[i]);
+    }
+
+    ASSERT_EQ(DM_ARRAY_SIZE(threads) * 100 * 100, (uint32_t)dmAtomicGet32(&ctx.m_Value));
+}
+
+// Jobs still queued when the system is deleted are run
+TEST_P(JobSystemTest, DeleteWithQueuedJobs)
+{
+    int32_atomic_t value = 0;
+    dmJobSystem::Counter counter;
+    dmJobSystem::InitCounter(&counter);
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        dmJobSystem::Run(m_System, IncrementJob, (void*)&value, 0, &counter, 0);
+    }
+
+    dmJobSystem::Delete(m_System);
+    m_System = 0;
+    ASSERT_EQ(10, dmAtomicGet32(&value));
+    ASSERT_EQ(0, dmAtomicGet32(&counter.m_Value));
+}
+
+const uint32_t worker_counts[] = {0, 1, 3, 8};
+INSTANTIATE_TEST_CASE_P(JobSystem, JobSystemTest, jc_test_values_in(worker_counts));
+
+// Benchmark of many small jobs, compared to the dmJobThread queue
+
+static const uint32_t BENCHMARK_JOB_COUNT = 20000;
+static const uint32_t BENCHMARK_WORK_SIZE = 256;
+
+static void BenchmarkWork(float* data)
+{
+    for (uint32_t i = 0; i < BENCHMARK_WORK_SIZE; ++i)
+    {
+        data[i] = data[i] * 0.5f + 1.0f;
+    }
+}
+
+static int BenchmarkJobThreadProcess(void* context, void* data)
+{
+    BenchmarkWork((float*)data);
+    return 1;
+}
+
+static void BenchmarkJobThreadCallback(void* context, void* data, int result)
+{
+    (*(uint32_t*)context)++;
+}
+
+static void BenchmarkJobSystemJob(void* context, void* data)
+{
+    BenchmarkWork((float*)data);
+}
+
+static void BenchmarkParallelFor(void* context, uint32_t begin, uint32_t end)
+{
+    float* data = (float*)context;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        BenchmarkWork(data + i * BENCHMARK_WORK_SIZE);
+    }
+}
+
+TEST(JobSystemBenchmark, CompareWithJobThread)
+{
+    if (!dmThread::PlatformHasThreadSupport())
+        return;
+
+    const uint32_t worker_count = 4;
+    dmArray<float> data;
+    data.SetCapacity(BENCHMARK_JOB_COUNT * BENCHMARK_WORK_SIZE);
+    data.SetSize(BENCHMARK_JOB_COUNT * BENCHMARK_WORK_SIZE);
+    memset(data.Begin(), 0, sizeof(float) * data.Size());
+
+    // dmJobThread: results are delivered by Update() on the calling thread
+    dmJobThread::JobThreadCreationParams job_thread_params;
+    for (uint32_t i = 0; i < worker_count; ++i)
+        job_thread_params.m_ThreadNames[i] = "bench_job_thread";
+    job_thread_params.m_ThreadCount = worker_count;
+    dmJobThread::HContext job_thread = dmJobThread::Create(job_thread_params);
+
+    uint64_t start = dmTime::GetTime();
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < BENCHMARK_JOB_COUNT; ++i)
+    {
+        dmJobThread::PushJob(job_thread, BenchmarkJobThreadProcess, BenchmarkJobThreadCallback, &done, data.Begin() + i * BENCHMARK_WORK_SIZE);
+    }
+    while (done != BENCHMARK_JOB_COUNT)
+    {
+        dmJobThread::Update(job_thread);
+    }
+    uint64_t job_thread_time = dmTime::GetTime() - start;
+    dmJobThread::Destroy(job_thread);
+
+    dmJobSystem::Params params;
+    dmJobSystem::SetDefaultParams(&params);
+    params.m_WorkerCount = worker_count;
+    params.m_QueueCapacity = BENCHMARK_JOB_COUNT;
+    dmJobSystem::HJobSystem system = dmJobSystem::New(params);
+
+    start = dmTime::GetTime();
+    dmJobSystem::Counter counter;
+    dmJobSystem::InitCounter(&counter);
+    for (uint32_t i = 0; i < BENCHMARK_JOB_COUNT; ++i)
+    {
+        dmJobSystem::Run(system, BenchmarkJobSystemJob, 0, data.Begin() + i * BENCHMARK_WORK_SIZE, &counter, 0);
+    }
+    dmJobSystem::WaitForCounter(system, &counter);
+    uint64_t job_system_time = dmTime::GetTime() - start;
+
+    start = dmTime::GetTime();
+    dmJobSystem::ParallelFor(system, BenchmarkParallelFor, data.Begin(), BENCHMARK_JOB_COUNT, 64);
+    uint64_t parallel_for_time = dmTime::GetTime() - start;
+
+    start = dmTime::GetTime();
+    BenchmarkParallelFor(data.Begin(), 0, BENCHMARK_JOB_COUNT);
+    uint64_t single_thread_time = dmTime::GetTime() - start;
+
+    dmJobSystem::Delete(system);
+
+    printf("%u jobs, %u workers: dmJobThread %.3f ms  dmJobSystem %.3f ms  ParallelFor %.3f ms  single thread %.3f ms\n",
+            BENCHMARK_JOB_COUNT, worker_count,
+            job_thread_time / 1000.0f, job_system_time / 1000.0f,
+            parallel_for_time / 1000.0f, single_thread_time / 1000.0f);
+}
+
+int main(int argc, char **argv)
+{
+    jc_test_init(&argc, argv);
+    return jc_test_run_all();
+}
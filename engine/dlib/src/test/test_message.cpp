@@ -14,12 +14,14 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <vector>
 #define JC_TEST_IMPLEMENTATION
 #include <jc_test/jc_test.h>
 #include "../../src/dlib/hash.h"
 #include "../../src/dlib/message.h"
 #include "../../src/dlib/dstrings.h"
+#include "../../src/dlib/array.h"
 #include "../../src/dlib/thread.h"
 #include "../../src/dlib/time.h"
 #include "../../src/dlib/profile/profile.h"
@@ -365,6 +367,88 @@ TEST(dmMessage, ThreadTest2)
     ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
 }
 
+struct ThroughputContext
+{
+    dmMessage::URL  m_Receiver;
+    uint32_t        m_ThreadIndex;
+    uint32_t        m_MessageCount;
+};
+
+static void ThroughputPostThread(void* arg)
+{
+    ThroughputContext* ctx = (ThroughputContext*) arg;
+    for (uint32_t i = 0; i < ctx->m_MessageCount; ++i)
+    {
+        uint32_t data[2] = {ctx->m_ThreadIndex, i};
+        dmMessage::Result result = dmMessage::Post(0x0, &ctx->m_Receiver, m_HashMessage1, 0, 0x0, data, sizeof(data), 0);
+        T_ASSERT_EQ(dmMessage::RESULT_OK, result);
+    }
+}
+
+struct ThroughputDispatchContext
+{
+    uint32_t m_NextIndex[8];
+    bool     m_InOrder;
+};
+
+static void HandleThroughputMessage(dmMessage::Message *message_object, void *user_ptr)
+{
+    ThroughputDispatchContext* ctx = (ThroughputDispatchContext*) user_ptr;
+    const uint32_t* data = (const uint32_t*) message_object->m_Data;
+    // Messages from the same thread must be dispatched in the order they were posted
+    ctx->m_InOrder &= ctx->m_NextIndex[data[0]] == data[1];
+    ctx->m_NextIndex[data[0]] = data[1] + 1;
+}
+
+// Posting from 1, 4 and 8 threads while dispatching on the main thread
+TEST(dmMessage, ThroughputThreads)
+{
+    const uint32_t total_message_count = 1024 * 64;
+    const uint32_t thread_counts[] = {1, 4, 8};
+
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+
+    for (uint32_t t = 0; t < DM_ARRAY_SIZE(thread_counts); ++t)
+    {
+        uint32_t thread_count = thread_counts[t];
+        ThroughputContext contexts[8];
+        dmThread::Thread threads[8];
+        ThroughputDispatchContext dispatch_ctx;
+        memset(&dispatch_ctx, 0, sizeof(dispatch_ctx));
+        dispatch_ctx.m_InOrder = true;
+
+        uint64_t start = dmTime::GetTime();
+        for (uint32_t i = 0; i < thread_count; ++i)
+        {
+            contexts[i].m_Receiver = receiver;
+            contexts[i].m_ThreadIndex = i;
+            contexts[i].m_MessageCount = total_message_count / thread_count;
+            threads[i] = dmThread::New(&ThroughputPostThread, 0xf0000, (void*) &contexts[i], "post");
+        }
+
+        uint32_t count = 0;
+        while (count < total_message_count)
+        {
+            count += dmMessage::Dispatch(receiver.m_Socket, HandleThroughputMessage, &dispatch_ctx);
+        }
+        uint64_t end = dmTime::GetTime();
+
+        for (uint32_t i = 0; i < thread_count; ++i)
+        {
+            dmThread::Join(threads[i]);
+        }
+
+        ASSERT_EQ(total_message_count, count);
+        ASSERT_TRUE(dispatch_ctx.m_InOrder);
+        printf("%u posting threads: %u messages in %.3f ms (%.1f messages/ms)\n", thread_count, total_message_count,
+                (end - start) / 1000.0f, total_message_count / ((end - start) / 1000.0f));
+    }
+
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
+
 void HandleIntegrityMessage(dmMessage::Message *message_object, void *user_ptr)
 {
     dmhash_t hash = dmHashBuffer64(message_object->m_Data, message_object->m_DataSize);
@@ -472,6 +556,68 @@ TEST(dmMessage, MessagePostDispatch)
     ASSERT_EQ(8111, g_PostDistpatchCalled);
 }
 
+struct DeferredContext
+{
+    dmArray<dmMessage::Message*> m_Messages;
+    uint32_t m_DestroyedAtFlush;
+    uint32_t m_Sum;
+};
+
+static uint32_t g_DeferredDestroyCount = 0;
+
+static void DeferredMessageDestroyCallback(dmMessage::Message* message)
+{
+    g_DeferredDestroyCount++;
+}
+
+static void DeferredDispatchCallback(dmMessage::Message* message, void* user_ptr)
+{
+    DeferredContext* ctx = (DeferredContext*)user_ptr;
+    if (ctx->m_Messages.Full())
+        ctx->m_Messages.OffsetCapacity(16);
+    ctx->m_Messages.Push(message);
+}
+
+static void DeferredFlushCallback(void* user_ptr)
+{
+    DeferredContext* ctx = (DeferredContext*)user_ptr;
+    ctx->m_DestroyedAtFlush = g_DeferredDestroyCount;
+    for (uint32_t i = 0; i < ctx->m_Messages.Size(); ++i)
+    {
+        // The messages are still valid
+        ctx->m_Sum += *(uint32_t*)ctx->m_Messages[i]->m_Data;
+    }
+    ctx->m_Messages.SetSize(0);
+}
+
+TEST(dmMessage, DispatchDeferred)
+{
+    dmMessage::URL receiver;
+    dmMessage::ResetURL(&receiver);
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::NewSocket("my_socket", &receiver.m_Socket));
+
+    DeferredContext ctx;
+    ctx.m_DestroyedAtFlush = ~0u;
+    ctx.m_Sum = 0;
+    g_DeferredDestroyCount = 0;
+
+    // No flush when there are no messages
+    ASSERT_EQ(0u, dmMessage::DispatchDeferred(receiver.m_Socket, DeferredDispatchCallback, DeferredFlushCallback, &ctx));
+    ASSERT_EQ(~0u, ctx.m_DestroyedAtFlush);
+
+    const uint32_t count = 100;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(0x0, &receiver, m_HashMessage1, 0, 0, 0x0, &i, sizeof(i), DeferredMessageDestroyCallback));
+    }
+    ASSERT_EQ(count, dmMessage::DispatchDeferred(receiver.m_Socket, DeferredDispatchCallback, DeferredFlushCallback, &ctx));
+    ASSERT_EQ(0u, ctx.m_DestroyedAtFlush);
+    ASSERT_EQ(count * (count - 1) / 2, ctx.m_Sum);
+    ASSERT_EQ(count, g_DeferredDestroyCount);
+    ASSERT_FALSE(dmMessage::HasMessages(receiver.m_Socket));
+
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::DeleteSocket(receiver.m_Socket));
+}
 
 int main(int argc, char **argv)
 {
@@ -211,6 +211,77 @@ TEST(dmTransform, Inverse)
     ASSERT_TRANSFORM_NEAR(i, Mul(Inv(t0), t0));
 }
 
+TEST(dmTransform, ToMatrix4Batch)
+{
+    // Not a multiple of four, to also test the scalar tail
+    const uint32_t count = 11;
+    float buffer[TRANSFORM_SOA_STREAM_COUNT * count];
+    TransformSoA soa;
+    SetupTransformSoA(buffer, count, &soa);
+
+    Transform transforms[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float f = (float)i;
+        transforms[i] = Transform(Vector3(f, -2.0f * f, 0.5f * f),
+                                  normalize(Quat(0.1f * f, 1.0f, -0.2f * f, 0.3f + f)),
+                                  Vector3(1.0f + f, 2.0f, 0.5f + 0.1f * f));
+        SetTransformSoA(soa, i, transforms[i]);
+    }
+
+    Matrix4 out[count];
+    ToMatrix4Batch(soa, count, out);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Matrix4 expected = ToMatrix4(transforms[i]);
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            ASSERT_V4_NEAR(expected.getCol(c), out[i].getCol(c));
+        }
+    }
+}
+
+TEST(dmTransform, MulBatch)
+{
+    const uint32_t count = 5;
+    Matrix4 parents[2];
+    parents[0] = ToMatrix4(Transform(Vector3(1.0f, 2.0f, 3.0f), Quat::rotationZ((float) M_PI_2), Vector3(2.0f, 3.0f, 4.0f)));
+    parents[1] = ToMatrix4(Transform(Vector3(-1.0f, 0.0f, 5.0f), Quat::rotationX((float) M_PI_4), Vector3(1.0f, 1.0f, 0.5f)));
+    uint16_t parent_indices[count] = {0, 1, 1, 0, 1};
+
+    Matrix4 local[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float f = (float)i;
+        local[i] = ToMatrix4(Transform(Vector3(f, 1.0f, -f), Quat::rotationY(0.1f * f), Vector3(1.0f, 1.0f + f, 2.0f)));
+    }
+
+    Matrix4 out[count];
+    MulBatch(parents, parent_indices, local, count, out);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Matrix4 expected = parents[parent_indices[i]] * local[i];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            ASSERT_V4_NEAR(expected.getCol(c), out[i].getCol(c));
+        }
+    }
+
+    // In place
+    MulNoScaleZBatch(parents, parent_indices, local, count, out);
+    MulNoScaleZBatch(parents, parent_indices, local, count, local);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Matrix4 local_i = ToMatrix4(Transform(Vector3((float)i, 1.0f, -(float)i), Quat::rotationY(0.1f * i), Vector3(1.0f, 1.0f + i, 2.0f)));
+        Matrix4 expected = MulNoScaleZ(parents[parent_indices[i]], local_i);
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            ASSERT_V4_NEAR(expected.getCol(c), out[i].getCol(c));
+            ASSERT_V4_NEAR(expected.getCol(c), local[i].getCol(c));
+        }
+    }
+}
+
 #undef EPSILON
 #undef ASSERT_V3_NEAR
 #undef ASSERT_V4_NEAR
@@ -226,6 +226,7 @@ namespace dmEngine
     , m_MainCollection(0)
     , m_LastReloadMTime(0)
     , m_MouseSensitivity(1.0f)
+    , m_JobSystem(0x0)
     , m_GraphicsContext(0)
     , m_RenderContext(0)
     , m_SharedScriptContext(0x0)
@@ -264,6 +265,8 @@ namespace dmEngine
         m_ModelContext.m_RenderContext = 0x0;
         m_ModelContext.m_MaxModelCount = 0;
         m_AccumFrameTime = 0;
+        m_FrameWorkTime = 0;
+        m_SwapInterval = 1;
         m_PreviousFrameTime = dmTime::GetTime();
     }
 
@@ -272,6 +275,28 @@ namespace dmEngine
         return new Engine(engine_service);
     }
 
+    static void SaveLoadTraces(HEngine engine)
+    {
+        const char* path = dmConfigFile::GetString(engine->m_Config, dmResource::RECORD_LOAD_TRACE_KEY, 0);
+        if (!path || !path[0])
+            return;
+
+        dmArray<uint8_t> data;
+        dmResource::GetLoadTraces(engine->m_Factory, &data);
+
+        FILE* file = fopen(path, "wb");
+        if (!file || fwrite(data.Begin(), 1, data.Size(), file) != data.Size())
+        {
+            dmLogError("Failed to write load traces to '%s'", path);
+        }
+        else
+        {
+            dmLogInfo("Wrote load traces to '%s'", path);
+        }
+        if (file)
+            fclose(file);
+    }
+
     void Delete(HEngine engine)
     {
         if (engine->m_MainCollection)
@@ -317,6 +342,8 @@ namespace dmEngine
 
         dmRender::DeleteRenderContext(engine->m_RenderContext, engine->m_RenderScriptContext);
 
+        dmJobSystem::Delete(engine->m_JobSystem);
+
         if (engine->m_HidContext)
         {
             dmHID::Final(engine->m_HidContext);
@@ -346,6 +373,7 @@ namespace dmEngine
 
         if (engine->m_Factory)
         {
+            SaveLoadTraces(engine);
             dmResource::DeleteFactory(engine->m_Factory);
         }
 
@@ -511,6 +539,7 @@ namespace dmEngine
     static void SetSwapInterval(HEngine engine, int swap_interval)
     {
         swap_interval = dmMath::Max(0, swap_interval);
+        engine->m_SwapInterval = (uint32_t)swap_interval;
         dmGraphics::SetSwapInterval(engine->m_GraphicsContext, swap_interval);
     }
 
@@ -873,6 +902,12 @@ namespace dmEngine
         job_thread_create_param.m_ThreadCount    = 1;
         engine->m_JobThreadContext               = dmJobThread::Create(job_thread_create_param);
 
+        // Used by the engine systems that split their work into parallel chunks
+        dmJobSystem::Params job_system_params;
+        dmJobSystem::SetDefaultParams(&job_system_params);
+        job_system_params.m_Name = "DefoldJobWorker";
+        engine->m_JobSystem = dmJobSystem::New(job_system_params);
+
         dmGraphics::ContextParams graphics_context_params;
         graphics_context_params.m_DefaultTextureMinFilter = ConvertMinTextureFilter(dmConfigFile::GetString(engine->m_Config, "graphics.default_texture_min_filter", "linear"));
         graphics_context_params.m_DefaultTextureMagFilter = ConvertMagTextureFilter(dmConfigFile::GetString(engine->m_Config, "graphics.default_texture_mag_filter", "linear"));
@@ -924,6 +959,10 @@ namespace dmEngine
         dmResource::NewFactoryParams params;
         params.m_MaxResources = max_resources;
         params.m_Flags = 0;
+        params.m_LoadQueueWorkerCount = dmConfigFile::GetInt(engine->m_Config, dmResource::LOAD_QUEUE_WORKER_COUNT_KEY, params.m_LoadQueueWorkerCount);
+        params.m_LoadQueueSlots = dmConfigFile::GetInt(engine->m_Config, dmResource::LOAD_QUEUE_SLOTS_KEY, params.m_LoadQueueSlots);
+        params.m_LoadQueueMaxPendingData = dmConfigFile::GetInt(engine->m_Config, dmResource::LOAD_QUEUE_MAX_PENDING_DATA_KEY, params.m_LoadQueueMaxPendingData);
+        params.m_PrefetchMaxData = dmConfigFile::GetInt(engine->m_Config, dmResource::PREFETCH_MAX_DATA_KEY, params.m_PrefetchMaxData);
 
         if (dLib::IsDebugMode())
         {
@@ -957,6 +996,28 @@ namespace dmEngine
             return false;
         }
 
+        const char* record_load_trace = dmConfigFile::GetString(engine->m_Config, dmResource::RECORD_LOAD_TRACE_KEY, 0);
+        const char* load_trace = dmConfigFile::GetString(engine->m_Config, dmResource::LOAD_TRACE_KEY, 0);
+        if (record_load_trace && record_load_trace[0])
+        {
+            dmResource::SetRecordLoadTraces(engine->m_Factory, true);
+        }
+        else if (load_trace && load_trace[0])
+        {
+            void* data = 0;
+            uint32_t data_size = 0;
+            dmResource::Result r = dmResource::GetRaw(engine->m_Factory, load_trace, &data, &data_size);
+            if (r == dmResource::RESULT_OK)
+            {
+                r = dmResource::SetLoadTraces(engine->m_Factory, data, data_size);
+                free(data);
+            }
+            if (r != dmResource::RESULT_OK)
+            {
+                dmLogWarning("Failed to read load traces from '%s': %d", load_trace, r);
+            }
+        }
+
         dmScript::ClearLuaRefCount(); // Reset the debug counter to 0
 
         dmArray<dmScript::HContext>& module_script_contexts = engine->m_ModuleContext.m_ScriptContexts;
@@ -977,6 +1038,17 @@ namespace dmEngine
             dmScript::Initialize(engine->m_RenderScriptContext);
             engine->m_GuiScriptContext = dmScript::NewContext(engine->m_Config, engine->m_Factory, true);
             dmScript::Initialize(engine->m_GuiScriptContext);
+
+            // The contexts share the gc budget of the frame
+            uint32_t gc_budget = (uint32_t)dmMath::Max(0, dmConfigFile::GetInt(engine->m_Config, dmScript::SCRIPT_GC_BUDGET_KEY, 0));
+            if (gc_budget != 0)
+            {
+                gc_budget = dmMath::Max(1u, gc_budget / 3);
+            }
+            dmScript::SetGCBudget(engine->m_GOScriptContext, gc_budget);
+            dmScript::SetGCBudget(engine->m_RenderScriptContext, gc_budget);
+            dmScript::SetGCBudget(engine->m_GuiScriptContext, gc_budget);
+
             module_script_contexts.SetCapacity(3);
             module_script_contexts.Push(engine->m_GOScriptContext);
             module_script_contexts.Push(engine->m_RenderScriptContext);
@@ -1004,6 +1076,7 @@ namespace dmEngine
             return false;
         }
         dmGameObject::SetInputStackDefaultCapacity(engine->m_Register, dmConfigFile::GetInt(engine->m_Config, dmGameObject::COLLECTION_MAX_INPUT_STACK_ENTRIES_KEY, dmGameObject::DEFAULT_MAX_INPUT_STACK_CAPACITY));
+        dmGameObject::SetTransformJobSystem(engine->m_Register, engine->m_JobSystem, dmConfigFile::GetInt(engine->m_Config, dmGameObject::COLLECTION_TRANSFORM_JOB_MIN_LEVEL_SIZE_KEY, dmGameObject::DEFAULT_TRANSFORM_JOB_MIN_LEVEL_SIZE));
 
         dmRender::RenderContextParams render_params;
         render_params.m_MaxRenderTypes = 16;
@@ -1022,6 +1095,7 @@ namespace dmEngine
         render_params.m_MaxDebugVertexCount = 0;
 #endif
         engine->m_RenderContext = dmRender::NewRenderContext(engine->m_GraphicsContext, render_params);
+        dmRender::SetRenderListJobSystem(engine->m_RenderContext, engine->m_JobSystem, dmConfigFile::GetInt(engine->m_Config, dmRender::RENDER_LIST_JOB_MIN_ENTRY_COUNT_KEY, dmRender::DEFAULT_RENDER_LIST_JOB_MIN_ENTRY_COUNT));
 
         dmGameObject::Initialize(engine->m_Register, engine->m_GOScriptContext);
 
@@ -1030,6 +1104,8 @@ namespace dmEngine
         engine->m_ParticleFXContext.m_MaxParticleFXCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_INSTANCE_COUNT_KEY, 64);
         engine->m_ParticleFXContext.m_MaxEmitterCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_EMITTER_COUNT_KEY, 64);
         engine->m_ParticleFXContext.m_MaxParticleCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::MAX_PARTICLE_COUNT_KEY, 1024);
+        engine->m_ParticleFXContext.m_JobSystem = engine->m_JobSystem;
+        engine->m_ParticleFXContext.m_JobMinParticleCount = dmConfigFile::GetInt(engine->m_Config, dmParticle::JOB_MIN_PARTICLE_COUNT_KEY, dmParticle::DEFAULT_JOB_MIN_PARTICLE_COUNT);
         engine->m_ParticleFXContext.m_Debug = false;
 
         dmInput::NewContextParams input_params;
@@ -1494,6 +1570,34 @@ bail:
         return memcount;
     }
 
+    // The frame time we aim for, from the update frequency and the vsync. 0 if unknown.
+    static uint32_t GetTargetFrameTime(HEngine engine)
+    {
+        uint32_t frame_time = 0;
+        if (engine->m_UpdateFrequency != 0)
+        {
+            frame_time = 1000000 / engine->m_UpdateFrequency;
+        }
+        uint32_t refresh_rate = dmGraphics::GetWindowRefreshRate(engine->m_GraphicsContext);
+        if (engine->m_SwapInterval != 0 && refresh_rate != 0)
+        {
+            frame_time = dmMath::Max(frame_time, 1000000 * engine->m_SwapInterval / refresh_rate);
+        }
+        return frame_time;
+    }
+
+    // Without a shared script context, the game object, render and gui contexts each collect
+    // garbage, so they split the time left of the frame between them (see the gc budget in Init).
+    static void SetGCFrameTime(HEngine engine, dmScript::HContext context, uint32_t frame_time, uint32_t context_count)
+    {
+        uint32_t work_time = engine->m_FrameWorkTime;
+        if (frame_time > work_time)
+        {
+            frame_time = work_time + (frame_time - work_time) / context_count;
+        }
+        dmScript::SetGCFrameTime(context, work_time, frame_time);
+    }
+
     static void StepFrame(HEngine engine, float dt)
     {
         dmProfiler::SetUpdateFrequency((uint32_t)(1.0f / dt));
@@ -1528,6 +1632,9 @@ bail:
             }
         }
 
+        uint64_t frame_start = dmTime::GetTime();
+        uint32_t gc_frame_time = GetTargetFrameTime(engine);
+
         dmProfile::HProfile profile = dmProfile::BeginFrame();
         {
             DM_PROFILE("Frame");
@@ -1569,6 +1676,7 @@ bail:
                     {
                         script_lib_context.m_LuaState = dmScript::GetLuaState(engine->m_SharedScriptContext);
                         dmGameSystem::UpdateScriptLibs(script_lib_context);
+                        SetGCFrameTime(engine, engine->m_SharedScriptContext, gc_frame_time, 1);
                         dmScript::Update(engine->m_SharedScriptContext);
                     }
                      else
@@ -1577,16 +1685,19 @@ bail:
                         {
                             script_lib_context.m_LuaState = dmScript::GetLuaState(engine->m_GOScriptContext);
                             dmGameSystem::UpdateScriptLibs(script_lib_context);
+                            SetGCFrameTime(engine, engine->m_GOScriptContext, gc_frame_time, 3);
                             dmScript::Update(engine->m_GOScriptContext);
                         }
                         if (engine->m_RenderScriptContext)
                         {
+                            SetGCFrameTime(engine, engine->m_RenderScriptContext, gc_frame_time, 3);
                             dmScript::Update(engine->m_RenderScriptContext);
                         }
                         if (engine->m_GuiScriptContext)
                         {
                             script_lib_context.m_LuaState = dmScript::GetLuaState(engine->m_GuiScriptContext);
                             dmGameSystem::UpdateScriptLibs(script_lib_context);
+                            SetGCFrameTime(engine, engine->m_GuiScriptContext, gc_frame_time, 3);
                             dmScript::Update(engine->m_GuiScriptContext);
                         }
                     }
@@ -1730,6 +1841,7 @@ bail:
                 dmExtension::PostRender(&ext_params);
             }
 
+            engine->m_FrameWorkTime = (uint32_t)(dmTime::GetTime() - frame_start);
             dmGraphics::Flip(engine->m_GraphicsContext);
 
             RecordData* record_data = &engine->m_RecordData;
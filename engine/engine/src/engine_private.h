@@ -121,6 +121,7 @@ namespace dmEngine
         float                                       m_MouseSensitivity;
 
         dmJobThread::HContext                       m_JobThreadContext;
+        dmJobSystem::HJobSystem                     m_JobSystem;
         dmGraphics::HContext                        m_GraphicsContext;
         dmRender::HRenderContext                    m_RenderContext;
         dmGameSystem::PhysicsContext                m_PhysicsContext;
@@ -159,7 +160,9 @@ namespace dmEngine
         bool                                        m_RunWhileIconified;
         uint64_t                                    m_PreviousFrameTime;        // Used to calculate dt
         float                                       m_AccumFrameTime;           // Used to trigger frame updates when using m_UpdateFrequency != 0
+        uint32_t                                    m_FrameWorkTime;            // Time (us) the previous frame spent before Flip(). Used to schedule the lua gc
         uint32_t                                    m_UpdateFrequency;
+        uint32_t                                    m_SwapInterval;
         uint32_t                                    m_FixedUpdateFrequency;
         uint32_t                                    m_Width;
         uint32_t                                    m_Height;
@@ -330,6 +330,28 @@ namespace dmGameObject
      */
     typedef UpdateResult (*ComponentOnMessage)(const ComponentOnMessageParams& params);
 
+    /*#
+     * Parameters to ComponentOnMessageBatch callback.
+     */
+    struct ComponentOnMessageBatchParams
+    {
+        /// World
+        void* m_World;
+        /// User context
+        void* m_Context;
+        /// Messages, in the order they were posted. All messages have the same message id.
+        const ComponentOnMessageParams* m_Messages;
+        /// Number of messages
+        uint32_t m_MessageCount;
+    };
+
+    /*#
+     * Component on-message-batch function. Called with consecutive messages that are sent to components of this type and have the same message id
+     * @param params Input parameters
+     * @return UPDATE_RESULT_OK on success
+     */
+    typedef UpdateResult (*ComponentOnMessageBatch)(const ComponentOnMessageBatchParams& params);
+
     /*#
      * Parameters to ComponentOnInput callback.
      */
@@ -566,6 +588,16 @@ namespace dmGameObject
      */
     void ComponentTypeSetOnMessageFn(ComponentType* type, ComponentOnMessage fn);
 
+    /*# set the component on-message-batch callback
+     * Set the component on-message-batch callback. If set, it is called instead of the on-message callback
+     * for messages sent to a specific component of this type. Consecutive messages with the same message id are
+     * passed in a single call. Messages broadcast to all components of a game object still use the on-message callback.
+     * @name ComponentTypeSetOnMessageBatchFn
+     * @param type [type: ComponentType*] the type
+     * @param fn [type: ComponentOnMessageBatch] callback
+     */
+    void ComponentTypeSetOnMessageBatchFn(ComponentType* type, ComponentOnMessageBatch fn);
+
     /*# set the component on-input callback
      * Set the component on-input callback. Called once per frame, before the Update function.
      * @name ComponentTypeSetOnInputFn
@@ -150,6 +150,107 @@ namespace dmGameObject
         return result;
     }
 
+    // Calls update_all once with the script state of all the instances
+    static ScriptResult RunUpdateAll(lua_State* L, HScript script, HScriptInstance* instances, uint32_t count, const RunScriptParams& params)
+    {
+        DM_PROFILE("RunScript");
+
+        ScriptResult result = SCRIPT_RESULT_OK;
+
+        int top = lua_gettop(L);
+        (void) top;
+
+        if (script->m_UpdateAllTableReference == LUA_NOREF)
+        {
+            lua_createtable(L, count, 0);
+            script->m_UpdateAllTableReference = dmScript::Ref(L, LUA_REGISTRYINDEX);
+        }
+
+        // There is no single instance being updated, but the first one lets
+        // functions like go.get_position(id) resolve ids within the collection
+        lua_rawgeti(L, LUA_REGISTRYINDEX, instances[0]->m_InstanceReference);
+        dmScript::SetInstance(L);
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, script->m_FunctionReferences[SCRIPT_FUNCTION_UPDATE_ALL]);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, script->m_UpdateAllTableReference);
+
+        int table_index = lua_gettop(L);
+        uint32_t prev_count = (uint32_t)lua_objlen(L, table_index);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, instances[i]->m_InstanceReference);
+            lua_rawseti(L, table_index, i + 1);
+        }
+        // Remove the instances left from a previous update
+        for (uint32_t i = count; i < prev_count; ++i)
+        {
+            lua_pushnil(L);
+            lua_rawseti(L, table_index, i + 1);
+        }
+
+        lua_pushnumber(L, params.m_UpdateContext->m_DT);
+
+        {
+            char buffer[128];
+            const char* profiler_string = dmScript::GetProfilerString(L, 0, script->m_LuaModule->m_Source.m_Filename, SCRIPT_FUNCTION_NAMES[SCRIPT_FUNCTION_UPDATE_ALL], 0, buffer, sizeof(buffer));
+            DM_PROFILE_DYN(profiler_string, 0);
+
+            if (dmScript::PCall(L, 2, 0) != 0)
+            {
+                result = SCRIPT_RESULT_FAILED;
+            }
+        }
+
+        lua_pushnil(L);
+        dmScript::SetInstance(L);
+
+        assert(top == lua_gettop(L));
+        return result;
+    }
+
+    // Adds one to the count of the update_all group of the script
+    static void CountUpdateAllInstance(dmArray<UpdateAllGroup>& groups, HScript script)
+    {
+        if (script->m_UpdateAllGroup >= groups.Size() || groups[script->m_UpdateAllGroup].m_Script != script)
+        {
+            if (groups.Full())
+            {
+                groups.OffsetCapacity(dmMath::Max(16U, groups.Capacity()));
+            }
+            UpdateAllGroup group = { script, 0, 0 };
+            script->m_UpdateAllGroup = groups.Size();
+            groups.Push(group);
+        }
+        groups[script->m_UpdateAllGroup].m_Count++;
+    }
+
+    // Groups the instances by script, keeping their update order, with a counting sort
+    static void GroupUpdateAllInstances(CompScriptWorld* script_world)
+    {
+        dmArray<HScriptInstance>& instances = script_world->m_UpdateAllInstances;
+        dmArray<HScriptInstance>& grouped = script_world->m_UpdateAllGrouped;
+        dmArray<UpdateAllGroup>& groups = script_world->m_UpdateAllGroups;
+
+        uint32_t start = 0;
+        for (uint32_t i = 0; i < groups.Size(); ++i)
+        {
+            groups[i].m_Start = start;
+            start += groups[i].m_Count;
+            groups[i].m_Count = 0;
+        }
+
+        if (grouped.Capacity() < instances.Size())
+        {
+            grouped.SetCapacity(instances.Capacity());
+        }
+        grouped.SetSize(instances.Size());
+        for (uint32_t i = 0; i < instances.Size(); ++i)
+        {
+            UpdateAllGroup& group = groups[instances[i]->m_Script->m_UpdateAllGroup];
+            grouped[group.m_Start + group.m_Count++] = instances[i];
+        }
+    }
+
     CreateResult CompScriptDestroy(const ComponentDestroyParams& params)
     {
         CompScriptWorld* script_world = (CompScriptWorld*)params.m_World;
@@ -162,6 +263,15 @@ namespace dmGameObject
                 break;
             }
         }
+
+        // The update_all table may still reference the instance, so let the next update create a new one
+        HScript script = script_instance->m_Script;
+        if (script->m_UpdateAllTableReference != LUA_NOREF)
+        {
+            dmScript::Unref(script->m_LuaState, LUA_REGISTRYINDEX, script->m_UpdateAllTableReference);
+            script->m_UpdateAllTableReference = LUA_NOREF;
+        }
+
         DeleteScriptInstance(script_instance);
         return CREATE_RESULT_OK;
     }
@@ -213,7 +323,9 @@ namespace dmGameObject
         if (script_instance->m_Initialized)
         {
             HScript script = script_instance->m_Script;
-            script_instance->m_Update = script->m_FunctionReferences[SCRIPT_FUNCTION_UPDATE] != LUA_NOREF || script->m_FunctionReferences[SCRIPT_FUNCTION_FIXED_UPDATE] != LUA_NOREF;
+            script_instance->m_Update = script->m_FunctionReferences[SCRIPT_FUNCTION_UPDATE] != LUA_NOREF
+                                     || script->m_FunctionReferences[SCRIPT_FUNCTION_FIXED_UPDATE] != LUA_NOREF
+                                     || script->m_FunctionReferences[SCRIPT_FUNCTION_UPDATE_ALL] != LUA_NOREF;
             return CREATE_RESULT_OK;
         }
         return CREATE_RESULT_UNKNOWN_ERROR;
@@ -229,11 +341,25 @@ namespace dmGameObject
         RunScriptParams run_params;
         run_params.m_UpdateContext = params.m_UpdateContext;
         CompScriptWorld* script_world = (CompScriptWorld*)params.m_World;
+        dmArray<HScriptInstance>& update_all_instances = script_world->m_UpdateAllInstances;
+        dmArray<UpdateAllGroup>& update_all_groups = script_world->m_UpdateAllGroups;
+        update_all_instances.SetSize(0);
+        update_all_groups.SetSize(0);
         uint32_t size = script_world->m_Instances.Size();
         for (uint32_t i = 0; i < size; ++i)
         {
             HScriptInstance script_instance = script_world->m_Instances[i];
             if (script_instance->m_Update) {
+                if (function == SCRIPT_FUNCTION_UPDATE && script_instance->m_Script->m_FunctionReferences[SCRIPT_FUNCTION_UPDATE_ALL] != LUA_NOREF)
+                {
+                    if (update_all_instances.Full())
+                    {
+                        update_all_instances.OffsetCapacity(dmMath::Max(64U, update_all_instances.Capacity()));
+                    }
+                    update_all_instances.Push(script_instance);
+                    CountUpdateAllInstance(update_all_groups, script_instance->m_Script);
+                    continue;
+                }
                 ScriptResult ret = RunScript(L, script_instance->m_Script, function, script_instance, run_params);
                 if (ret == SCRIPT_RESULT_FAILED)
                 {
@@ -242,6 +368,18 @@ namespace dmGameObject
             }
         }
 
+        // The scripts with update_all are updated after the others, with a single call for each script
+        GroupUpdateAllInstances(script_world);
+        for (uint32_t i = 0; i < update_all_groups.Size(); ++i)
+        {
+            const UpdateAllGroup& group = update_all_groups[i];
+            ScriptResult ret = RunUpdateAll(L, group.m_Script, &script_world->m_UpdateAllGrouped[group.m_Start], group.m_Count, run_params);
+            if (ret == SCRIPT_RESULT_FAILED)
+            {
+                result = UPDATE_RESULT_UNKNOWN_ERROR;
+            }
+        }
+
         // TODO: Find out if the scripts actually sent any transform events
         update_result.m_TransformsUpdated = true;
 
@@ -116,6 +116,7 @@ void ComponentTypeSetUpdateFn(ComponentType* type, ComponentsUpdate fn)
 void ComponentTypeSetFixedUpdateFn(ComponentType* type, ComponentsFixedUpdate fn)           { type->m_FixedUpdateFunction = fn; }
 void ComponentTypeSetPostUpdateFn(ComponentType* type, ComponentsPostUpdate fn)             { type->m_PostUpdateFunction = fn; }
 void ComponentTypeSetOnMessageFn(ComponentType* type, ComponentOnMessage fn)                { type->m_OnMessageFunction = fn; }
+void ComponentTypeSetOnMessageBatchFn(ComponentType* type, ComponentOnMessageBatch fn)      { type->m_OnMessageBatchFunction = fn; }
 void ComponentTypeSetOnInputFn(ComponentType* type, ComponentOnInput fn)                    { type->m_OnInputFunction = fn; }
 void ComponentTypeSetOnReloadFn(ComponentType* type, ComponentOnReload fn)                  { type->m_OnReloadFunction = fn; }
 void ComponentTypeSetSetPropertiesFn(ComponentType* type, ComponentSetProperties fn)        { type->m_SetPropertiesFunction = fn; }
@@ -46,6 +46,7 @@ namespace dmGameObject
         ComponentsRender        m_RenderFunction;
         ComponentsPostUpdate    m_PostUpdateFunction;
         ComponentOnMessage      m_OnMessageFunction;
+        ComponentOnMessageBatch m_OnMessageBatchFunction;
         ComponentOnInput        m_OnInputFunction;
         ComponentOnReload       m_OnReloadFunction;
         ComponentSetProperties  m_SetPropertiesFunction;
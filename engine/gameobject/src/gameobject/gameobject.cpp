@@ -26,6 +26,8 @@
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/mutex.h>
+#include <dlib/atomic.h>
+#include <dlib/job_system.h>
 #include <dmsdk/dlib/vmath.h>
 #include <ddf/ddf.h>
 #include "gameobject.h"
@@ -40,14 +42,21 @@ DM_PROPERTY_GROUP(rmtp_GameObject, "Gameobjects");
 
 DM_PROPERTY_U32(rmtp_GOInstances, 0, FrameReset, "# alive go instances / frame", &rmtp_GameObject);
 DM_PROPERTY_U32(rmtp_GODeleted, 0, FrameReset, "# deleted instances / frame", &rmtp_GameObject);
+DM_PROPERTY_U32(rmtp_GOTransformsUpdated, 0, FrameReset, "# recalculated world transforms / frame", &rmtp_GameObject);
+DM_PROPERTY_U32(rmtp_GOMessagesBatched, 0, FrameReset, "# messages handled by OnMessageBatch / frame", &rmtp_GameObject);
+DM_PROPERTY_U32(rmtp_GOMessageBatches, 0, FrameReset, "# OnMessageBatch calls / frame", &rmtp_GameObject);
+DM_PROPERTY_U32(rmtp_GOMessagesSingle, 0, FrameReset, "# messages handled by OnMessage / frame", &rmtp_GameObject);
 
 namespace dmGameObject
 {
     const char* COLLECTION_MAX_INSTANCES_KEY = "collection.max_instances";
     const char* COLLECTION_MAX_INPUT_STACK_ENTRIES_KEY = "collection.max_input_stack_entries";
+    const char* COLLECTION_TRANSFORM_JOB_MIN_LEVEL_SIZE_KEY = "collection.transform_job_min_level_size";
     const dmhash_t UNNAMED_IDENTIFIER = dmHashBuffer64("__unnamed__", strlen("__unnamed__"));
     const char* ID_SEPARATOR = "/";
     const uint32_t MAX_DISPATCH_ITERATION_COUNT = 10;
+    // Min number of instances per job when updating the transforms of a level in parallel
+    const uint32_t TRANSFORM_JOB_MIN_CHUNK_SIZE = 256;
 
     static Prototype EMPTY_PROTOTYPE;
 
@@ -173,6 +182,8 @@ namespace dmGameObject
         m_ComponentTypeCount = 0;
         m_DefaultCollectionCapacity = DEFAULT_MAX_COLLECTION_CAPACITY;
         m_DefaultInputStackCapacity = DEFAULT_MAX_INPUT_STACK_CAPACITY;
+        m_TransformJobSystem = 0;
+        m_TransformJobMinLevelSize = DEFAULT_TRANSFORM_JOB_MIN_LEVEL_SIZE;
         m_Mutex = dmMutex::New();
     }
 
@@ -206,11 +217,16 @@ namespace dmGameObject
         m_InstanceIndices.SetCapacity(max_instances);
         m_WorldTransforms.SetCapacity(max_instances);
         m_WorldTransforms.SetSize(max_instances);
-        m_IDToInstance.SetCapacity(dmMath::Max(1U, max_instances/3), max_instances);
+        m_PrevLocalTransforms.SetCapacity(max_instances);
+        m_PrevLocalTransforms.SetSize(max_instances);
+        m_TransformDirtyFlags.SetCapacity(max_instances);
+        m_TransformDirtyFlags.SetSize(max_instances);
+        m_IDToInstance.SetCapacity(max_instances);
         m_InputFocusStack.SetCapacity(max_input_stack_entries);
         m_NameHash = 0;
         m_ComponentSocket = 0;
         m_FrameSocket = 0;
+        m_MessageBatchType = 0;
 
         // Instances that cannot use an ID from the InstanceIdPool will
         // generate indexes greater than the size of the pool.
@@ -233,6 +249,8 @@ namespace dmGameObject
 
         memset(&m_Instances[0], 0, sizeof(Instance*) * max_instances);
         memset(&m_WorldTransforms[0], 0xcc, sizeof(dmTransform::Transform) * max_instances);
+        memset(&m_PrevLocalTransforms[0], 0xcc, sizeof(dmTransform::Transform) * max_instances);
+        memset(&m_TransformDirtyFlags[0], TRANSFORM_FLAG_DIRTY, sizeof(uint8_t) * max_instances);
         memset(&m_LevelIndices[0], 0, sizeof(m_LevelIndices));
     }
 
@@ -257,6 +275,13 @@ namespace dmGameObject
         regist->m_DefaultInputStackCapacity = capacity;
     }
 
+    void SetTransformJobSystem(HRegister regist, dmJobSystem::HJobSystem job_system, uint32_t min_level_size)
+    {
+        assert(regist != 0x0);
+        regist->m_TransformJobSystem = job_system;
+        regist->m_TransformJobMinLevelSize = min_level_size;
+    }
+
     static uint32_t GetInputStackDefaultCapacity(HRegister regist)
     {
         assert(regist != 0x0);
@@ -705,6 +730,10 @@ namespace dmGameObject
         level.SetSize(level_index + 1);
         level[level_index] = instance->m_Index;
         instance->m_LevelIndex = level_index;
+
+        // The instance is either new or has a new parent, so the world transform must be recalculated
+        collection->m_TransformDirtyFlags[instance->m_Index] = TRANSFORM_FLAG_DIRTY;
+        collection->m_DirtyTransforms = 1;
     }
 
     static HInstance AllocInstance(Prototype* proto, const char* prototype_name) {
@@ -2158,6 +2187,53 @@ namespace dmGameObject
         bool m_Success;
     };
 
+    // Calls OnMessageBatch for the gathered messages. Must be called before any other message is handled, to keep the message order.
+    static void FlushMessageBatch(DispatchMessagesContext* context)
+    {
+        Collection* collection = context->m_Collection;
+        uint32_t message_count = collection->m_MessageBatch.Size();
+        if (message_count == 0)
+            return;
+
+        DM_PROFILE("OnMessageBatchFunction");
+        ComponentType* component_type = collection->m_MessageBatchType;
+        ComponentOnMessageBatchParams params;
+        params.m_World = collection->m_MessageBatch[0].m_World;
+        params.m_Context = component_type->m_Context;
+        params.m_Messages = collection->m_MessageBatch.Begin();
+        params.m_MessageCount = message_count;
+        UpdateResult res = component_type->m_OnMessageBatchFunction(params);
+        if (res != UPDATE_RESULT_OK)
+            context->m_Success = false;
+
+        collection->m_MessageBatch.SetSize(0);
+        collection->m_MessageBatchType = 0;
+
+        DM_PROPERTY_ADD_U32(rmtp_GOMessagesBatched, message_count);
+        DM_PROPERTY_ADD_U32(rmtp_GOMessageBatches, 1);
+    }
+
+    static void AddToMessageBatch(DispatchMessagesContext* context, ComponentType* component_type, const ComponentOnMessageParams& params)
+    {
+        Collection* collection = context->m_Collection;
+        dmArray<ComponentOnMessageParams>& batch = collection->m_MessageBatch;
+        if (collection->m_MessageBatchType != component_type || (!batch.Empty() && batch[0].m_Message->m_Id != params.m_Message->m_Id))
+        {
+            FlushMessageBatch(context);
+            collection->m_MessageBatchType = component_type;
+        }
+        if (batch.Full())
+        {
+            batch.OffsetCapacity(dmMath::Max(16U, batch.Capacity()));
+        }
+        batch.Push(params);
+    }
+
+    static void FlushMessageBatchCallback(void* user_ptr)
+    {
+        FlushMessageBatch((DispatchMessagesContext*) user_ptr);
+    }
+
     void DispatchMessagesFunction(dmMessage::Message* message, void* user_ptr)
     {
         DispatchMessagesContext* context = (DispatchMessagesContext*) user_ptr;
@@ -2200,16 +2276,19 @@ namespace dmGameObject
             dmDDF::Descriptor* descriptor = (dmDDF::Descriptor*)message->m_Descriptor;
             if (descriptor == dmGameObjectDDF::AcquireInputFocus::m_DDFDescriptor)
             {
+                FlushMessageBatch(context);
                 dmGameObject::AcquireInputFocus(collection, instance);
                 return;
             }
             else if (descriptor == dmGameObjectDDF::ReleaseInputFocus::m_DDFDescriptor)
             {
+                FlushMessageBatch(context);
                 dmGameObject::ReleaseInputFocus(collection, instance);
                 return;
             }
             else if (descriptor == dmGameObjectDDF::SetParent::m_DDFDescriptor)
             {
+                FlushMessageBatch(context);
                 dmGameObjectDDF::SetParent* sp = (dmGameObjectDDF::SetParent*)message->m_Data;
                 dmGameObject::HInstance parent = 0;
                 if (sp->m_ParentId != 0)
@@ -2286,7 +2365,7 @@ namespace dmGameObject
             ComponentType* component_type = component->m_Type;
             assert(component_type);
 
-            if (component_type->m_OnMessageFunction)
+            if (component_type->m_OnMessageFunction || component_type->m_OnMessageBatchFunction)
             {
                 // TODO: Not optimal way to find index of component instance data
                 uint32_t next_component_instance_data = 0;
@@ -2305,17 +2384,24 @@ namespace dmGameObject
                 {
                     component_instance_data = &instance->m_ComponentInstanceUserData[next_component_instance_data];
                 }
+                ComponentOnMessageParams params;
+                params.m_Instance = instance;
+                params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
+                params.m_Context = component_type->m_Context;
+                params.m_UserData = component_instance_data;
+                params.m_Message = message;
+                if (component_type->m_OnMessageBatchFunction)
+                {
+                    AddToMessageBatch(context, component_type, params);
+                }
+                else
                 {
+                    FlushMessageBatch(context);
                     DM_PROFILE("OnMessageFunction");
-                    ComponentOnMessageParams params;
-                    params.m_Instance = instance;
-                    params.m_World = collection->m_ComponentWorlds[component->m_TypeIndex];
-                    params.m_Context = component_type->m_Context;
-                    params.m_UserData = component_instance_data;
-                    params.m_Message = message;
                     UpdateResult res = component_type->m_OnMessageFunction(params);
                     if (res != UPDATE_RESULT_OK)
                         context->m_Success = false;
+                    DM_PROPERTY_ADD_U32(rmtp_GOMessagesSingle, 1);
                 }
             }
             else
@@ -2326,6 +2412,7 @@ namespace dmGameObject
         }
         else // broadcast
         {
+            FlushMessageBatch(context);
             uint32_t next_component_instance_data = 0;
             for (uint32_t i = 0; i < prototype->m_ComponentCount; ++i)
             {
@@ -2351,6 +2438,7 @@ namespace dmGameObject
                         UpdateResult res = component_type->m_OnMessageFunction(params);
                         if (res != UPDATE_RESULT_OK)
                             context->m_Success = false;
+                        DM_PROPERTY_ADD_U32(rmtp_GOMessagesSingle, 1);
                     }
                 }
                 else
@@ -2387,7 +2475,8 @@ namespace dmGameObject
                 {
                     UpdateTransforms(collection);
                 }
-                uint32_t message_count = dmMessage::Dispatch(sockets[i], &DispatchMessagesFunction, (void*) &ctx);
+                // The batched messages are handled in FlushMessageBatch, before the messages are destroyed
+                uint32_t message_count = dmMessage::DispatchDeferred(sockets[i], &DispatchMessagesFunction, &FlushMessageBatchCallback, (void*) &ctx);
                 if (message_count)
                 {
                     collection->m_DirtyTransforms = true;
@@ -2427,67 +2516,177 @@ namespace dmGameObject
         }
     }
 
-    void UpdateTransforms(Collection* collection)
+    static inline bool HasLocalTransformChanged(const dmTransform::Transform& prev, const dmTransform::Transform& transform)
     {
-        DM_PROFILE("UpdateTransforms");
+        const uint32_t* prev_rotation = (const uint32_t*)prev.GetRotationPtr();
+        const uint32_t* rotation = (const uint32_t*)transform.GetRotationPtr();
+        return !(Vec3Equals((uint32_t*)prev.GetPositionPtr(), (uint32_t*)transform.GetPositionPtr()) &&
+                 Vec3Equals((uint32_t*)prev.GetScalePtr(), (uint32_t*)transform.GetScalePtr()) &&
+                 prev_rotation[0] == rotation[0] && prev_rotation[1] == rotation[1] &&
+                 prev_rotation[2] == rotation[2] && prev_rotation[3] == rotation[3]);
+    }
 
-        // Calculate world transforms
-        // First root-level instances
-        dmArray<uint16_t>& root_level = collection->m_LevelIndices[0];
-        uint32_t root_count = root_level.Size();
-        for (uint32_t i = 0; i < root_count; ++i)
+    // Returns true if the world transform of the instance needs to be recalculated.
+    // The local transform is stored so that the next call can detect if it has changed.
+    static inline bool CheckTransformDirty(Collection* collection, Instance* instance, uint16_t index, bool parent_updated)
+    {
+        CheckEuler(instance);
+        dmTransform::Transform& prev = collection->m_PrevLocalTransforms[index];
+        bool dirty = parent_updated
+                  || (collection->m_TransformDirtyFlags[index] & TRANSFORM_FLAG_DIRTY)
+                  || HasLocalTransformChanged(prev, instance->m_Transform);
+        collection->m_TransformDirtyFlags[index] = dirty ? TRANSFORM_FLAG_UPDATED : 0;
+        if (dirty)
         {
-            uint16_t index = root_level[i];
-            Instance* instance = collection->m_Instances[index];
-            CheckEuler(instance);
-            collection->m_WorldTransforms[index] = dmTransform::ToMatrix4(instance->m_Transform);
-            uint16_t parent_index = instance->m_Parent;
-            assert(parent_index == INVALID_INSTANCE_INDEX);
+            prev = instance->m_Transform;
         }
+        return dirty;
+    }
 
+    static void EnsureTransformBatchCapacity(Collection* collection, uint32_t capacity)
+    {
+        if (collection->m_TransformBatchIndices.Capacity() >= capacity)
+            return;
+        collection->m_TransformBatchSoA.SetCapacity(capacity * dmTransform::TRANSFORM_SOA_STREAM_COUNT);
+        collection->m_TransformBatchSoA.SetSize(capacity * dmTransform::TRANSFORM_SOA_STREAM_COUNT);
+        collection->m_TransformBatchIndices.SetCapacity(capacity);
+        collection->m_TransformBatchIndices.SetSize(capacity);
+        collection->m_TransformBatchParents.SetCapacity(capacity);
+        collection->m_TransformBatchParents.SetSize(capacity);
+        collection->m_TransformBatchMatrices.SetCapacity(capacity);
+        collection->m_TransformBatchMatrices.SetSize(capacity);
+    }
+
+    // Calculates the world transforms of the changed instances in the range [begin, end) of a level,
+    // given that the previous level is up to date. The range [begin, end) of the scratch buffers is used,
+    // which makes it safe to process separate ranges of the same level in parallel.
+    // Returns the number of recalculated world transforms
+    static uint32_t UpdateLevelTransformsRange(Collection* collection, uint32_t level_i, uint32_t begin, uint32_t end)
+    {
+        dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
+        uint16_t* indices = collection->m_TransformBatchIndices.Begin() + begin;
+        uint16_t* parents = collection->m_TransformBatchParents.Begin() + begin;
+        uint8_t* dirty_flags = collection->m_TransformDirtyFlags.Begin();
+        dmTransform::TransformSoA soa;
+        dmTransform::SetupTransformSoA(collection->m_TransformBatchSoA.Begin(), collection->m_TransformBatchIndices.Capacity(), &soa);
+        soa.m_TX += begin; soa.m_TY += begin; soa.m_TZ += begin;
+        soa.m_RX += begin; soa.m_RY += begin; soa.m_RZ += begin; soa.m_RW += begin;
+        soa.m_SX += begin; soa.m_SY += begin; soa.m_SZ += begin;
+
+        // Gather the changed instances
+        uint32_t count = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            uint16_t index = level[i];
+            Instance* instance = collection->m_Instances[index];
 
-        if (collection->m_ScaleAlongZ) {
-            for (uint32_t level_i = 1; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+            uint16_t parent_index = instance->m_Parent;
+            bool parent_updated = false;
+            if (level_i == 0)
             {
-                dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
-                uint32_t instance_count = level.Size();
-                for (uint32_t i = 0; i < instance_count; ++i)
-                {
-                    uint16_t index = level[i];
-                    Instance* instance = collection->m_Instances[index];
-                    CheckEuler(instance);
-                    Matrix4* trans = &collection->m_WorldTransforms[index];
+                assert(parent_index == INVALID_INSTANCE_INDEX);
+            }
+            else
+            {
+                assert(parent_index != INVALID_INSTANCE_INDEX);
+                parent_updated = dirty_flags[parent_index] & TRANSFORM_FLAG_UPDATED;
+            }
 
-                    uint16_t parent_index = instance->m_Parent;
-                    assert(parent_index != INVALID_INSTANCE_INDEX);
+            if (!CheckTransformDirty(collection, instance, index, parent_updated))
+                continue;
 
-                    Matrix4* parent_trans = &collection->m_WorldTransforms[parent_index];
-                    Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
-                    *trans = *parent_trans * own;
-                }
+            indices[count] = index;
+            parents[count] = parent_index;
+            dmTransform::SetTransformSoA(soa, count, instance->m_Transform);
+            ++count;
+        }
+
+        if (count == 0)
+            return 0;
+
+        Matrix4* matrices = collection->m_TransformBatchMatrices.Begin() + begin;
+        Matrix4* world_transforms = collection->m_WorldTransforms.Begin();
+        dmTransform::ToMatrix4Batch(soa, count, matrices);
+        if (level_i > 0)
+        {
+            if (collection->m_ScaleAlongZ)
+            {
+                dmTransform::MulBatch(world_transforms, parents, matrices, count, matrices);
             }
-        } else {
-            for (uint32_t level_i = 1; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+            else
             {
-                dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
-                uint32_t instance_count = level.Size();
-                for (uint32_t i = 0; i < instance_count; ++i)
-                {
-                    uint16_t index = level[i];
-                    Instance* instance = collection->m_Instances[index];
-                    CheckEuler(instance);
-                    Matrix4* trans = &collection->m_WorldTransforms[index];
+                dmTransform::MulNoScaleZBatch(world_transforms, parents, matrices, count, matrices);
+            }
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            world_transforms[indices[i]] = matrices[i];
+        }
+        return count;
+    }
 
-                    uint16_t parent_index = instance->m_Parent;
-                    assert(parent_index != INVALID_INSTANCE_INDEX);
+    struct UpdateLevelTransformsJob
+    {
+        Collection*     m_Collection;
+        uint32_t        m_Level;
+        int32_atomic_t  m_UpdatedCount;
+    };
 
-                    Matrix4* parent_trans = &collection->m_WorldTransforms[parent_index];
-                    Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
-                    *trans = dmTransform::MulNoScaleZ(*parent_trans, own);
-                }
-            }
+    static void UpdateLevelTransformsParallel(void* context, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("UpdateLevelTransformsJob");
+        UpdateLevelTransformsJob* job = (UpdateLevelTransformsJob*)context;
+        uint32_t count = UpdateLevelTransformsRange(job->m_Collection, job->m_Level, begin, end);
+        if (count > 0)
+            dmAtomicAdd32(&job->m_UpdatedCount, (int32_t)count);
+    }
+
+    // Calculates the world transforms of the changed instances in a level, given that the previous level is up to date.
+    // Large levels are split into chunks that are processed on the job workers of the register.
+    // Returns the number of recalculated world transforms
+    static uint32_t UpdateLevelTransforms(Collection* collection, uint32_t level_i)
+    {
+        uint32_t instance_count = collection->m_LevelIndices[level_i].Size();
+        EnsureTransformBatchCapacity(collection, instance_count);
+
+        Register* regist = collection->m_Register;
+        dmJobSystem::HJobSystem job_system = regist->m_TransformJobSystem;
+        uint32_t worker_count = job_system ? dmJobSystem::GetWorkerCount(job_system) : 0;
+        if (worker_count == 0 || regist->m_TransformJobMinLevelSize == 0 || instance_count < regist->m_TransformJobMinLevelSize)
+        {
+            return UpdateLevelTransformsRange(collection, level_i, 0, instance_count);
+        }
+
+        UpdateLevelTransformsJob job;
+        job.m_Collection = collection;
+        job.m_Level = level_i;
+        job.m_UpdatedCount = 0;
+
+        // One chunk per thread (including the calling thread), but not too small chunks
+        uint32_t chunk_size = dmMath::Max(TRANSFORM_JOB_MIN_CHUNK_SIZE, (instance_count + worker_count) / (worker_count + 1));
+        // ParallelFor returns when the whole level is done, which is what the next level depends on
+        dmJobSystem::ParallelFor(job_system, UpdateLevelTransformsParallel, &job, instance_count, chunk_size);
+        return (uint32_t)dmAtomicGet32(&job.m_UpdatedCount);
+    }
+
+    void UpdateTransforms(Collection* collection)
+    {
+        DM_PROFILE("UpdateTransforms");
+
+        // Calculate world transforms, one level at a time starting with the root-level instances.
+        // Only instances that have changed, or whose parent was recalculated during this
+        // pass (i.e. the dirty subtrees), are recalculated.
+        uint32_t updated_count = 0;
+        for (uint32_t level_i = 0; level_i < MAX_HIERARCHICAL_DEPTH; ++level_i)
+        {
+            // Every instance in a level has its parent in the previous level, so there are no deeper instances
+            if (collection->m_LevelIndices[level_i].Empty())
+                break;
+            updated_count += UpdateLevelTransforms(collection, level_i);
         }
 
+        DM_PROPERTY_ADD_U32(rmtp_GOTransformsUpdated, updated_count);
         collection->m_DirtyTransforms = false;
     }
 
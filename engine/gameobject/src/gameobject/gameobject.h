@@ -21,6 +21,7 @@
 
 #include <dlib/easing.h>
 #include <dlib/hashtable.h>
+#include <dlib/job_system.h>
 #include <dlib/message.h>
 #include <dlib/transform.h>
 
@@ -40,12 +41,18 @@ namespace dmGameObject
     /// Default max instances in input stack
     const uint32_t DEFAULT_MAX_INPUT_STACK_CAPACITY = 16;
 
+    /// Default min number of instances in a hierarchy level for its transforms to be updated on the job threads (0 disables)
+    const uint32_t DEFAULT_TRANSFORM_JOB_MIN_LEVEL_SIZE = 0;
+
     /// Config key to use for tweaking maximum number of instances in a collection
     extern const char* COLLECTION_MAX_INSTANCES_KEY;
 
     /// Config key to use for tweaking the maximum capacity of the input stack
     extern const char* COLLECTION_MAX_INPUT_STACK_ENTRIES_KEY;
 
+    /// Config key to use for tweaking the min number of instances in a hierarchy level for its transforms to be updated on the job threads
+    extern const char* COLLECTION_TRANSFORM_JOB_MIN_LEVEL_SIZE_KEY;
+
     extern const dmhash_t UNNAMED_IDENTIFIER;
 
 
@@ -96,6 +103,16 @@ namespace dmGameObject
      */
     void SetInputStackDefaultCapacity(HRegister regist, uint32_t capacity);
 
+    /**
+     * Set the job system used to update the world transforms of collections in this register.
+     * Hierarchy levels with at least min_level_size instances are split into chunks that are processed
+     * in parallel, smaller levels are processed on the calling thread.
+     * @param regist Register
+     * @param job_system Job system, or 0x0 to only use the calling thread
+     * @param min_level_size Min number of instances in a level for it to be processed in parallel. 0 disables parallel processing.
+     */
+    void SetTransformJobSystem(HRegister regist, dmJobSystem::HJobSystem job_system, uint32_t min_level_size);
+
     /**
      * Creates a new gameobject collection
      * @param name Collection name, which must be unique and follow the same naming as for sockets
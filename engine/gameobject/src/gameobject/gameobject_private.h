@@ -16,6 +16,7 @@
 #define GAMEOBJECT_COMMON_H
 
 #include <dlib/hash.h>
+#include <dlib/hashmap.h>
 #include <dlib/hashtable.h>
 #include <dlib/index_pool.h>
 #include <dlib/math.h>
@@ -204,6 +205,9 @@ namespace dmGameObject
         // Default capacity of collections
         uint32_t                    m_DefaultCollectionCapacity;
         uint32_t                    m_DefaultInputStackCapacity;
+        // Job system used to update large hierarchy levels in parallel
+        dmJobSystem::HJobSystem     m_TransformJobSystem;
+        uint32_t                    m_TransformJobMinLevelSize;
 
         Register();
         ~Register();
@@ -213,6 +217,13 @@ namespace dmGameObject
     // depth is interpreted as up to <depth> levels of child nodes including root-nodes
     // Must be greater than zero
     const uint32_t MAX_HIERARCHICAL_DEPTH = 128;
+
+    // Flags stored per instance in Collection::m_TransformDirtyFlags
+    // The world transform must be recalculated regardless of the local transform (e.g. the instance changed parent)
+    const uint8_t TRANSFORM_FLAG_DIRTY   = 1;
+    // The world transform was recalculated during the last UpdateTransforms. Used to propagate changes to children
+    const uint8_t TRANSFORM_FLAG_UPDATED = 2;
+
     struct Collection
     {
         Collection(dmResource::HFactory factory, HRegister regist, uint32_t max_instances, uint32_t max_input_stack_entries);
@@ -253,8 +264,24 @@ namespace dmGameObject
         // Array of world transforms. Calculated using m_LevelIndices above
         dmArray<Matrix4>         m_WorldTransforms;
 
+        // Local transforms used when the world transforms were last calculated.
+        // Used to detect which instances have moved since the last UpdateTransforms
+        dmArray<dmTransform::Transform> m_PrevLocalTransforms;
+
+        // TRANSFORM_FLAG_* for each instance. Only instances that are dirty, have moved or have
+        // an updated parent get their world transform recalculated
+        dmArray<uint8_t>         m_TransformDirtyFlags;
+
+        // Scratch buffers used by UpdateTransforms. The changed instances of a level are gathered
+        // as structure-of-arrays and converted to world transforms in batches.
+        // Grows on demand to the largest level size.
+        dmArray<float>           m_TransformBatchSoA;
+        dmArray<uint16_t>        m_TransformBatchIndices;
+        dmArray<uint16_t>        m_TransformBatchParents;
+        dmArray<Matrix4>         m_TransformBatchMatrices;
+
         // Identifier to Instance mapping
-        dmHashTable64<Instance*> m_IDToInstance;
+        dmHashMap64<Instance*> m_IDToInstance;
 
         // Stack keeping track of which instance has the input focus
         dmArray<Instance*>       m_InputFocusStack;
@@ -270,6 +297,11 @@ namespace dmGameObject
         // Socket for sending to instances, dispatched once each update
         dmMessage::HSocket       m_FrameSocket;
 
+        // Consecutive messages to components of a type with an OnMessageBatch function,
+        // all with the same message id. Flushed when the component type or message id changes.
+        dmArray<ComponentOnMessageParams> m_MessageBatch;
+        ComponentType*           m_MessageBatchType;
+
         dmMutex::HMutex          m_Mutex;
 
         // Counter for generating instance ids, protected by m_Mutex
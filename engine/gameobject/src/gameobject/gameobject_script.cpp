@@ -163,7 +163,8 @@ namespace dmGameObject
         "fixed_update",
         "on_message",
         "on_input",
-        "on_reload"
+        "on_reload",
+        "update_all"
     };
 
     static const char* TYPE_NAMES[PROPERTY_TYPE_COUNT] = {
@@ -181,6 +182,9 @@ namespace dmGameObject
 
     CompScriptWorld::CompScriptWorld(uint32_t max_instance_count)
     : m_Instances()
+    , m_UpdateAllInstances()
+    , m_UpdateAllGrouped()
+    , m_UpdateAllGroups()
     , m_ScriptWorld(0x0)
     {
         m_Instances.SetCapacity(max_instance_count);
@@ -404,7 +408,7 @@ namespace dmGameObject
     {
         ScriptInstance* i = ScriptInstance_Check(L);
         Instance* instance = i->m_Instance;
-        if (lua_gettop(L) == instance_arg && !lua_isnil(L, instance_arg)) {
+        if (!lua_isnoneornil(L, instance_arg)) {
             dmMessage::URL receiver;
             dmScript::ResolveURL(L, instance_arg, &receiver, 0x0);
             if (receiver.m_Socket != dmGameObject::GetMessageSocket(i->m_Instance->m_Collection->m_HCollection))
@@ -1049,7 +1053,8 @@ namespace dmGameObject
      * @name go.get_position
      * @replaces request_transform transform_response
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the position for, by default the instance of the calling script
-     * @return position [type:vector3] instance position
+     * @param [out] [type:vector3] optional vector3 to store the result in, instead of creating a new one
+     * @return position [type:vector3] instance position, `out` if supplied
      * @examples
      *
      * Get the position of the game object instance the script is attached to:
@@ -1063,11 +1068,23 @@ namespace dmGameObject
      * ```lua
      * local pos = go.get_position("my_gameobject")
      * ```
+     *
+     * Get the position every frame without creating a new vector:
+     *
+     * ```lua
+     * function init(self)
+     *     self.position = vmath.vector3()
+     * end
+     *
+     * function update(self, dt)
+     *     go.get_position(nil, self.position)
+     * end
+     * ```
      */
     int Script_GetPosition(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmVMath::Vector3(dmGameObject::GetPosition(instance)));
+        dmScript::PushVector3Into(L, 2, dmVMath::Vector3(dmGameObject::GetPosition(instance)));
         return 1;
     }
 
@@ -1076,7 +1093,8 @@ namespace dmGameObject
      *
      * @name go.get_rotation
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the rotation for, by default the instance of the calling script
-     * @return rotation [type:quaternion] instance rotation
+     * @param [out] [type:quaternion] optional quaternion to store the result in, instead of creating a new one
+     * @return rotation [type:quaternion] instance rotation, `out` if supplied
      * @examples
      *
      * Get the rotation of the game object instance the script is attached to:
@@ -1094,7 +1112,7 @@ namespace dmGameObject
     int Script_GetRotation(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushQuat(L, dmGameObject::GetRotation(instance));
+        dmScript::PushQuatInto(L, 2, dmGameObject::GetRotation(instance));
         return 1;
     }
 
@@ -1103,7 +1121,8 @@ namespace dmGameObject
      *
      * @name go.get_scale
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the scale for, by default the instance of the calling script
-     * @return scale [type:vector3] instance scale factor
+     * @param [out] [type:vector3] optional vector3 to store the result in, instead of creating a new one
+     * @return scale [type:vector3] instance scale factor, `out` if supplied
      * @examples
      *
      * Get the scale of the game object instance the script is attached to:
@@ -1121,7 +1140,7 @@ namespace dmGameObject
     static int Script_GetScale(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmGameObject::GetScale(instance));
+        dmScript::PushVector3Into(L, 2, dmGameObject::GetScale(instance));
         return 1;
     }
 
@@ -1430,7 +1449,8 @@ namespace dmGameObject
      *
      * @name go.get_world_position
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the world position for, by default the instance of the calling script
-     * @return position [type:vector3] instance world position
+     * @param [out] [type:vector3] optional vector3 to store the result in, instead of creating a new one
+     * @return position [type:vector3] instance world position, `out` if supplied
      * @examples
      *
      * Get the world position of the game object instance the script is attached to:
@@ -1448,7 +1468,7 @@ namespace dmGameObject
     int Script_GetWorldPosition(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmVMath::Vector3(dmGameObject::GetWorldPosition(instance)));
+        dmScript::PushVector3Into(L, 2, dmVMath::Vector3(dmGameObject::GetWorldPosition(instance)));
         return 1;
     }
 
@@ -1458,7 +1478,8 @@ namespace dmGameObject
      *
      * @name go.get_world_rotation
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the world rotation for, by default the instance of the calling script
-     * @return rotation [type:quaternion] instance world rotation
+     * @param [out] [type:quaternion] optional quaternion to store the result in, instead of creating a new one
+     * @return rotation [type:quaternion] instance world rotation, `out` if supplied
      * @examples
      *
      * Get the world rotation of the game object instance the script is attached to:
@@ -1476,7 +1497,7 @@ namespace dmGameObject
     int Script_GetWorldRotation(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushQuat(L, dmGameObject::GetWorldRotation(instance));
+        dmScript::PushQuatInto(L, 2, dmGameObject::GetWorldRotation(instance));
         return 1;
     }
 
@@ -1488,7 +1509,8 @@ namespace dmGameObject
      *
      * @name go.get_world_scale
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the world scale for, by default the instance of the calling script
-     * @return scale [type:vector3] instance world 3D scale factor
+     * @param [out] [type:vector3] optional vector3 to store the result in, instead of creating a new one
+     * @return scale [type:vector3] instance world 3D scale factor, `out` if supplied
      * @examples
      *
      * Get the world 3D scale of the game object instance the script is attached to:
@@ -1506,7 +1528,7 @@ namespace dmGameObject
     int Script_GetWorldScale(lua_State* L)
     {
         Instance* instance = ResolveInstance(L, 1);
-        dmScript::PushVector3(L, dmGameObject::GetWorldScale(instance));
+        dmScript::PushVector3Into(L, 2, dmGameObject::GetWorldScale(instance));
         return 1;
     }
 
@@ -1543,7 +1565,8 @@ namespace dmGameObject
      *
      * @name go.get_world_transform
      * @param [id] [type:string|hash|url] optional id of the game object instance to get the world transform for, by default the instance of the calling script
-     * @return transform [type:matrix4] instance world transform
+     * @param [out] [type:matrix4] optional matrix4 to store the result in, instead of creating a new one
+     * @return transform [type:matrix4] instance world transform, `out` if supplied
      * @examples
      *
      * Get the world transform of the game object instance the script is attached to:
@@ -1561,7 +1584,7 @@ namespace dmGameObject
     int Script_GetWorldTransform(lua_State* L)
     {
         Instance* instance = ResolveInstance(L,1);
-        dmScript::PushMatrix4(L, dmGameObject::GetWorldMatrix(instance));
+        dmScript::PushMatrix4Into(L, 2, dmGameObject::GetWorldMatrix(instance));
         return 1;
     }
 
@@ -2454,6 +2477,11 @@ namespace dmGameObject
                         lua_pop(L, 1);
                     }
                 }
+                if (script->m_FunctionReferences[SCRIPT_FUNCTION_UPDATE] != LUA_NOREF && script->m_FunctionReferences[SCRIPT_FUNCTION_UPDATE_ALL] != LUA_NOREF)
+                {
+                    dmLogWarning("'%s' defines both '%s' and '%s', only '%s' will be called.", source->m_Filename,
+                        SCRIPT_FUNCTION_NAMES[SCRIPT_FUNCTION_UPDATE], SCRIPT_FUNCTION_NAMES[SCRIPT_FUNCTION_UPDATE_ALL], SCRIPT_FUNCTION_NAMES[SCRIPT_FUNCTION_UPDATE_ALL]);
+                }
                 result = true;
             }
             lua_pushnil(L);
@@ -2480,6 +2508,8 @@ bail:
             script->m_FunctionReferences[i] = LUA_NOREF;
         }
         script->m_InstanceReference = LUA_NOREF;
+        script->m_UpdateAllTableReference = LUA_NOREF;
+        script->m_UpdateAllGroup = 0;
     }
 
     HScript NewScript(lua_State* L, dmLuaDDF::LuaModule* lua_module)
@@ -2522,6 +2552,9 @@ bail:
                 dmScript::Unref(L, LUA_REGISTRYINDEX, script->m_FunctionReferences[i]);
             }
         }
+        if (script->m_UpdateAllTableReference != LUA_NOREF) {
+            dmScript::Unref(L, LUA_REGISTRYINDEX, script->m_UpdateAllTableReference);
+        }
 
         dmScript::Unref(L, LUA_REGISTRYINDEX, script->m_InstanceReference);
         script->~Script();
@@ -2865,6 +2898,44 @@ bail:
      * ```
      */
 
+    /*# called every frame to update all instances of a script component
+     *
+     * This is an optional callback-function, which replaces [ref:update] for scripts that have many instances.
+     * Instead of being called once per instance, it is called once per frame for all the instances of
+     * the script in a collection, which removes most of the per instance cost of calling into Lua.
+     * If a script defines both `update` and `update_all`, only `update_all` is called.
+     *
+     * In each collection, `update_all` is called after `update` has been called for all the script
+     * components without `update_all`. The scripts are called in the order their first instance would
+     * have been updated, and the instances keep their update order within the table.
+     *
+     * Functions that act on the current instance, such as `go.get_position()` without an id, act on the
+     * first instance in the list. Store the id of each instance in `init` and pass it explicitly instead.
+     *
+     * The `instances` table is reused between frames and must not be stored.
+     *
+     * @name update_all
+     * @param instances [type:table] the script state of each instance, see `self` in [ref:update]
+     * @param dt [type:number] the time-step of the frame update
+     * @examples
+     *
+     * This example demonstrates how to move many game object instances from the same script:
+     *
+     * ```lua
+     * function init(self)
+     *     self.id = go.get_id()
+     *     self.velocity = vmath.vector3(1, 0, 0)
+     * end
+     *
+     * function update_all(instances, dt)
+     *     for i = 1, #instances do
+     *         local self = instances[i]
+     *         go.set_position(go.get_position(self.id) + dt * self.velocity, self.id)
+     *     end
+     * end
+     * ```
+     */
+
     /*# called at fixed intervals to update the script component
      *
      * This is a callback-function, which is called by the engine at fixed intervals to update the state of a script
@@ -51,6 +51,7 @@ namespace dmGameObject
         SCRIPT_FUNCTION_ONMESSAGE,
         SCRIPT_FUNCTION_ONINPUT,
         SCRIPT_FUNCTION_ONRELOAD,
+        SCRIPT_FUNCTION_UPDATE_ALL,
         MAX_SCRIPT_FUNCTION_COUNT
     };
 
@@ -63,6 +64,10 @@ namespace dmGameObject
         PropertySet             m_PropertySet;
         dmLuaDDF::LuaModule*    m_LuaModule;
         int                     m_InstanceReference;
+        // Table of instances passed to update_all, reused between frames
+        int                     m_UpdateAllTableReference;
+        // Index in CompScriptWorld::m_UpdateAllGroups, only valid if that group refers back to this script
+        uint32_t                m_UpdateAllGroup;
         // Resources referenced through property values in the script
         dmArray<void*>          m_PropertyResources;
     };
@@ -84,11 +89,23 @@ namespace dmGameObject
         uint8_t    m_Padding      : 6;
     };
 
+    // The instances of a script in CompScriptWorld::m_UpdateAllGrouped
+    struct UpdateAllGroup
+    {
+        Script*  m_Script;
+        uint32_t m_Start;
+        uint32_t m_Count;
+    };
+
     struct CompScriptWorld
     {
         CompScriptWorld(uint32_t max_instance_count);
 
         dmArray<ScriptInstance*> m_Instances;
+        // Scratch lists of the instances updated through update_all, in update order and grouped by script
+        dmArray<ScriptInstance*> m_UpdateAllInstances;
+        dmArray<ScriptInstance*> m_UpdateAllGrouped;
+        dmArray<UpdateAllGroup>  m_UpdateAllGroups;
         dmScript::HScriptWorld m_ScriptWorld;
     };
 
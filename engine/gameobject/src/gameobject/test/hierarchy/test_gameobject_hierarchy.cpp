@@ -581,6 +581,65 @@ TEST_F(HierarchyTest, TestMultiReparent)
     dmGameObject::Delete(m_Collection, child2, false);
 }
 
+TEST_F(HierarchyTest, TestHierarchyDirtySubtree)
+{
+    dmGameObject::Collection* collection = m_Collection->m_Collection;
+
+    dmGameObject::HInstance parent = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::HInstance child = dmGameObject::New(m_Collection, "/go.goc");
+    dmGameObject::HInstance other = dmGameObject::New(m_Collection, "/go.goc");
+
+    dmGameObject::SetPosition(parent, Point3(1.0f, 0.0f, 0.0f));
+    dmGameObject::SetPosition(child, Point3(0.0f, 2.0f, 0.0f));
+    dmGameObject::SetPosition(other, Point3(0.0f, 0.0f, 3.0f));
+    dmGameObject::SetParent(child, parent);
+
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_EQ(dmGameObject::TRANSFORM_FLAG_UPDATED, collection->m_TransformDirtyFlags[parent->m_Index]);
+    ASSERT_EQ(dmGameObject::TRANSFORM_FLAG_UPDATED, collection->m_TransformDirtyFlags[child->m_Index]);
+    ASSERT_EQ(dmGameObject::TRANSFORM_FLAG_UPDATED, collection->m_TransformDirtyFlags[other->m_Index]);
+    ASSERT_NEAR(1.0f, dmGameObject::GetWorldPosition(child).getX(), EPSILON);
+    ASSERT_NEAR(2.0f, dmGameObject::GetWorldPosition(child).getY(), EPSILON);
+
+    // Nothing has moved
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_EQ(0, collection->m_TransformDirtyFlags[parent->m_Index]);
+    ASSERT_EQ(0, collection->m_TransformDirtyFlags[child->m_Index]);
+    ASSERT_EQ(0, collection->m_TransformDirtyFlags[other->m_Index]);
+
+    // Moving the parent should update the whole subtree, but not the other instance
+    dmGameObject::SetPosition(parent, Point3(5.0f, 0.0f, 0.0f));
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_EQ(dmGameObject::TRANSFORM_FLAG_UPDATED, collection->m_TransformDirtyFlags[parent->m_Index]);
+    ASSERT_EQ(dmGameObject::TRANSFORM_FLAG_UPDATED, collection->m_TransformDirtyFlags[child->m_Index]);
+    ASSERT_EQ(0, collection->m_TransformDirtyFlags[other->m_Index]);
+    ASSERT_NEAR(5.0f, dmGameObject::GetWorldPosition(child).getX(), EPSILON);
+    ASSERT_NEAR(2.0f, dmGameObject::GetWorldPosition(child).getY(), EPSILON);
+    ASSERT_NEAR(3.0f, dmGameObject::GetWorldPosition(other).getZ(), EPSILON);
+
+    // Moving the child only should not update the parent
+    dmGameObject::SetPosition(child, Point3(0.0f, 4.0f, 0.0f));
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_EQ(0, collection->m_TransformDirtyFlags[parent->m_Index]);
+    ASSERT_EQ(dmGameObject::TRANSFORM_FLAG_UPDATED, collection->m_TransformDirtyFlags[child->m_Index]);
+    ASSERT_EQ(0, collection->m_TransformDirtyFlags[other->m_Index]);
+    ASSERT_NEAR(5.0f, dmGameObject::GetWorldPosition(child).getX(), EPSILON);
+    ASSERT_NEAR(4.0f, dmGameObject::GetWorldPosition(child).getY(), EPSILON);
+
+    // Reparenting without moving should still update the child
+    dmGameObject::SetParent(child, other);
+    dmGameObject::UpdateTransforms(m_Collection);
+    ASSERT_EQ(0, collection->m_TransformDirtyFlags[parent->m_Index]);
+    ASSERT_EQ(dmGameObject::TRANSFORM_FLAG_UPDATED, collection->m_TransformDirtyFlags[child->m_Index]);
+    ASSERT_NEAR(0.0f, dmGameObject::GetWorldPosition(child).getX(), EPSILON);
+    ASSERT_NEAR(4.0f, dmGameObject::GetWorldPosition(child).getY(), EPSILON);
+    ASSERT_NEAR(3.0f, dmGameObject::GetWorldPosition(child).getZ(), EPSILON);
+
+    dmGameObject::Delete(m_Collection, child, false);
+    dmGameObject::Delete(m_Collection, parent, false);
+    dmGameObject::Delete(m_Collection, other, false);
+}
+
 TEST_F(HierarchyTest, TestHierarchyScale)
 {
     dmGameObject::HInstance parent = dmGameObject::New(m_Collection, "/go.goc");
@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <map>
 
+#include <dlib/array.h>
 #include <dlib/hash.h>
 #include <dlib/message.h>
 
@@ -107,6 +108,7 @@ protected:
     static dmGameObject::CreateResult CompMessageTargetCreate(const dmGameObject::ComponentCreateParams& params);
     static dmGameObject::CreateResult CompMessageTargetDestroy(const dmGameObject::ComponentDestroyParams& params);
     static dmGameObject::UpdateResult CompMessageTargetOnMessage(const dmGameObject::ComponentOnMessageParams& params);
+    static dmGameObject::UpdateResult CompMessageTargetOnMessageBatch(const dmGameObject::ComponentOnMessageBatchParams& params);
 
 public:
     dmGameObject::UpdateContext m_UpdateContext;
@@ -119,6 +121,7 @@ public:
     std::map<uint32_t, uint32_t> m_MessageMap;
 
     uint32_t m_MessageTargetCounter;
+    dmArray<uint32_t> m_MessageBatchSizes;
     dmGameObject::ModuleContext m_ModuleContext;
     dmHashTable64<void*> m_Contexts;
 };
@@ -199,6 +202,30 @@ dmGameObject::UpdateResult MessageTest::CompMessageTargetOnMessage(const dmGameO
     return dmGameObject::UPDATE_RESULT_OK;
 }
 
+dmGameObject::UpdateResult MessageTest::CompMessageTargetOnMessageBatch(const dmGameObject::ComponentOnMessageBatchParams& params)
+{
+    MessageTest* self = (MessageTest*) params.m_Context;
+    assert(params.m_Context == params.m_World);
+    assert(params.m_MessageCount > 0);
+
+    dmhash_t message_id = params.m_Messages[0].m_Message->m_Id;
+    for (uint32_t i = 0; i < params.m_MessageCount; ++i)
+    {
+        const dmGameObject::ComponentOnMessageParams& message_params = params.m_Messages[i];
+        assert(message_params.m_Message->m_Id == message_id);
+        assert(message_params.m_World == params.m_World);
+        if (message_id == dmHashString64("inc"))
+            self->m_MessageTargetCounter++;
+        else if (message_id == dmHashString64("dec"))
+            self->m_MessageTargetCounter--;
+    }
+
+    if (self->m_MessageBatchSizes.Full())
+        self->m_MessageBatchSizes.OffsetCapacity(8);
+    self->m_MessageBatchSizes.Push(params.m_MessageCount);
+    return dmGameObject::UPDATE_RESULT_OK;
+}
+
 void DispatchCallback(dmMessage::Message *message, void* user_ptr)
 {
     MessageTest* test = (MessageTest*)user_ptr;
@@ -283,6 +310,53 @@ TEST_F(MessageTest, TestComponentMessage)
     dmGameObject::Delete(m_Collection, go, false);
 }
 
+TEST_F(MessageTest, TestComponentMessageBatch)
+{
+    dmResource::ResourceType resource_type;
+    ASSERT_EQ(dmResource::RESULT_OK, dmResource::GetTypeFromExtension(m_Factory, "mt", &resource_type));
+    dmGameObject::ComponentType* type = dmGameObject::FindComponentType(m_Register, resource_type, 0x0);
+    ASSERT_NE((void*) 0, (void*) type);
+    dmGameObject::ComponentTypeSetOnMessageBatchFn(type, CompMessageTargetOnMessageBatch);
+
+    dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/component_message.goc");
+    ASSERT_NE((void*) 0, (void*) go);
+    ASSERT_EQ(dmGameObject::RESULT_OK, dmGameObject::SetIdentifier(m_Collection, go, "test_instance"));
+
+    dmMessage::URL sender;
+    sender.m_Socket = dmGameObject::GetMessageSocket(m_Collection);
+    sender.m_Path = dmGameObject::GetIdentifier(go);
+    sender.m_Fragment = dmHashString64("script");
+    dmMessage::URL receiver = sender;
+    receiver.m_Fragment = dmHashString64("mt");
+
+    // Consecutive messages with the same id are handled in one batch
+    const char* messages[] = {"inc", "inc", "inc", "dec", "dec", "inc"};
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(messages); ++i)
+    {
+        ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(&sender, &receiver, dmHashString64(messages[i]), 0, 0, 0x0, 0, 0));
+    }
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    ASSERT_EQ(2U, m_MessageTargetCounter);
+    ASSERT_EQ(3U, m_MessageBatchSizes.Size());
+    ASSERT_EQ(3U, m_MessageBatchSizes[0]);
+    ASSERT_EQ(2U, m_MessageBatchSizes[1]);
+    ASSERT_EQ(1U, m_MessageBatchSizes[2]);
+
+    // A message to a component type without a batch function ends the batch
+    m_MessageBatchSizes.SetSize(0);
+    dmMessage::URL script_receiver = sender;
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(&sender, &receiver, dmHashString64("inc"), 0, 0, 0x0, 0, 0));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(&receiver, &script_receiver, dmHashString64("test_message"), 0, 0, 0x0, 0, 0));
+    ASSERT_EQ(dmMessage::RESULT_OK, dmMessage::Post(&sender, &receiver, dmHashString64("inc"), 0, 0, 0x0, 0, 0));
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    ASSERT_EQ(4U, m_MessageTargetCounter);
+    ASSERT_EQ(2U, m_MessageBatchSizes.Size());
+    ASSERT_EQ(1U, m_MessageBatchSizes[0]);
+    ASSERT_EQ(1U, m_MessageBatchSizes[1]);
+
+    dmGameObject::Delete(m_Collection, go, false);
+}
+
 TEST_F(MessageTest, TestComponentMessageFail)
 {
     dmGameObject::HInstance go = dmGameObject::New(m_Collection, "/component_message.goc");
@@ -572,3 +572,83 @@ TEST_F(ScriptTest, TestExists)
 
     ASSERT_TRUE(dmGameObject::Init(m_Collection));
 }
+
+static int GetGlobalInt(lua_State* L, const char* name)
+{
+    lua_getglobal(L, name);
+    int value = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+    return value;
+}
+
+TEST_F(ScriptTest, TestUpdateAll)
+{
+    lua_State* L = dmScript::GetLuaState(m_ScriptContext);
+
+    const uint32_t count = 16;
+    dmGameObject::HInstance instances[count];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        instances[i] = dmGameObject::New(m_Collection, "/update_all.goc");
+        ASSERT_NE((void*) 0, (void*) instances[i]);
+    }
+    ASSERT_TRUE(dmGameObject::Init(m_Collection));
+
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    ASSERT_EQ(1, GetGlobalInt(L, "update_all_calls"));
+    ASSERT_EQ((int)count, GetGlobalInt(L, "update_all_count"));
+
+    // The instances table must not keep the deleted instances
+    for (uint32_t i = 0; i < count / 2; ++i)
+    {
+        dmGameObject::Delete(m_Collection, instances[i], false);
+    }
+    ASSERT_TRUE(dmGameObject::PostUpdate(m_Collection));
+
+    ASSERT_TRUE(dmGameObject::Update(m_Collection, &m_UpdateContext));
+    ASSERT_EQ(2, GetGlobalInt(L, "update_all_calls"));
+    ASSERT_EQ((int)(count / 2), GetGlobalInt(L, "update_all_count"));
+
+    ASSERT_TRUE(dmGameObject::Final(m_Collection));
+}
+
+static uint64_t BenchmarkUpdate(ScriptTest* test, const char* prototype, uint32_t count, uint32_t frames)
+{
+    dmGameObject::HCollection collection = dmGameObject::NewCollection("benchmark", test->m_Factory, test->m_Register, count, 0x0);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (dmGameObject::New(collection, prototype) == 0)
+        {
+            dmGameObject::DeleteCollection(collection);
+            return 0;
+        }
+    }
+    dmGameObject::Init(collection);
+
+    uint64_t start = dmTime::GetTime();
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        dmGameObject::Update(collection, &test->m_UpdateContext);
+    }
+    uint64_t time = dmTime::GetTime() - start;
+
+    dmGameObject::Final(collection);
+    dmGameObject::DeleteCollection(collection);
+    dmGameObject::PostUpdate(test->m_Register);
+    return time / frames;
+}
+
+TEST_F(ScriptTest, BenchmarkUpdateAll)
+{
+    const uint32_t counts[] = { 1000, 5000, 20000 };
+    const uint32_t frames = 20;
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(counts); ++i)
+    {
+        uint64_t each_time = BenchmarkUpdate(this, "/update_each.goc", counts[i], frames);
+        uint64_t all_time = BenchmarkUpdate(this, "/update_all.goc", counts[i], frames);
+        ASSERT_NE(0u, each_time);
+        ASSERT_NE(0u, all_time);
+        printf("%6u instances: update %8.3f ms/frame, update_all %8.3f ms/frame (%.1fx)\n",
+            counts[i], each_time / 1000.0f, all_time / 1000.0f, each_time / (float)all_time);
+    }
+}
@@ -0,0 +1,232 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+// 
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+// 
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include <jc_test/jc_test.h>
+
+#include <stdio.h>
+#include <dlib/hash.h>
+#include <dlib/job_system.h>
+#include <dlib/time.h>
+#include <dlib/transform.h>
+#include <resource/resource.h>
+#include "../gameobject.h"
+#include "../gameobject_private.h"
+
+#define EPSILON 0.0001f
+
+using namespace dmVMath;
+
+class TransformTest : public jc_test_base_class
+{
+protected:
+    virtual void SetUp()
+    {
+        dmResource::NewFactoryParams params;
+        params.m_MaxResources = 16;
+        params.m_Flags = RESOURCE_FACTORY_FLAGS_EMPTY;
+        m_Factory = dmResource::NewFactory(&params, "build/src/gameobject/test/transform");
+        m_ScriptContext = dmScript::NewContext(0, 0, true);
+        dmScript::Initialize(m_ScriptContext);
+        m_Register = dmGameObject::NewRegister();
+        dmGameObject::Initialize(m_Register, m_ScriptContext);
+        m_Collection = 0;
+    }
+
+    virtual void TearDown()
+    {
+        if (m_Collection)
+            dmGameObject::DeleteCollection(m_Collection);
+        dmGameObject::PostUpdate(m_Register);
+        dmScript::Finalize(m_ScriptContext);
+        dmScript::DeleteContext(m_ScriptContext);
+        dmResource::DeleteFactory(m_Factory);
+        dmGameObject::DeleteRegister(m_Register);
+    }
+
+    // Creates instance_count instances, evenly distributed over 'depth' levels
+    void CreateHierarchy(uint32_t instance_count, uint32_t depth)
+    {
+        m_Collection = dmGameObject::NewCollection("collection", m_Factory, m_Register, instance_count, 0x0);
+        ASSERT_NE((dmGameObject::HCollection)0, m_Collection);
+
+        m_Instances.SetSize(0);
+        m_Instances.SetCapacity(instance_count);
+        uint32_t per_level = instance_count / depth;
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            dmGameObject::HInstance instance = dmGameObject::New(m_Collection, 0);
+            ASSERT_NE((dmGameObject::HInstance)0, instance);
+            float f = (float)i;
+            dmGameObject::SetPosition(instance, Point3(f * 0.1f, 1.0f, -f * 0.01f));
+            dmGameObject::SetRotation(instance, Quat::rotationZ(f * 0.001f));
+            dmGameObject::SetScale(instance, Vector3(1.0f, 1.0f + f * 0.0001f, 1.0f));
+            if (i >= per_level && depth > 1)
+            {
+                dmGameObject::SetParent(instance, m_Instances[i - per_level]);
+            }
+            m_Instances.Push(instance);
+        }
+    }
+
+    // The original implementation of UpdateTransforms, which recalculates every world transform
+    void UpdateTransformsReference(Matrix4* out)
+    {
+        dmGameObject::Collection* collection = m_Collection->m_Collection;
+        for (uint32_t level_i = 0; level_i < dmGameObject::MAX_HIERARCHICAL_DEPTH; ++level_i)
+        {
+            dmArray<uint16_t>& level = collection->m_LevelIndices[level_i];
+            uint32_t instance_count = level.Size();
+            for (uint32_t i = 0; i < instance_count; ++i)
+            {
+                uint16_t index = level[i];
+                dmGameObject::Instance* instance = collection->m_Instances[index];
+                Matrix4 own = dmTransform::ToMatrix4(instance->m_Transform);
+                if (level_i == 0)
+                    out[index] = own;
+                else if (collection->m_ScaleAlongZ)
+                    out[index] = out[instance->m_Parent] * own;
+                else
+                    out[index] = dmTransform::MulNoScaleZ(out[instance->m_Parent], own);
+            }
+        }
+    }
+
+    void MoveRoots(float offset)
+    {
+        dmGameObject::Collection* collection = m_Collection->m_Collection;
+        dmArray<uint16_t>& level = collection->m_LevelIndices[0];
+        for (uint32_t i = 0; i < level.Size(); ++i)
+        {
+            dmGameObject::HInstance instance = collection->m_Instances[level[i]];
+            dmGameObject::SetPosition(instance, dmGameObject::GetPosition(instance) + Vector3(offset, 0.0f, 0.0f));
+        }
+    }
+
+    void VerifyAgainstReference(uint32_t instance_count, uint32_t iterations)
+    {
+        dmGameObject::Collection* collection = m_Collection->m_Collection;
+        dmArray<Matrix4> expected;
+        expected.SetCapacity(instance_count);
+        expected.SetSize(instance_count);
+
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+        {
+            MoveRoots(1.0f);
+            dmGameObject::UpdateTransforms(m_Collection);
+            UpdateTransformsReference(expected.Begin());
+
+            for (uint32_t i = 0; i < instance_count; ++i)
+            {
+                uint16_t index = m_Instances[i]->m_Index;
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    Vector4 e = expected[index].getCol(c);
+                    Vector4 a = collection->m_WorldTransforms[index].getCol(c);
+                    ASSERT_NEAR(e.getX(), a.getX(), EPSILON);
+                    ASSERT_NEAR(e.getY(), a.getY(), EPSILON);
+                    ASSERT_NEAR(e.getZ(), a.getZ(), EPSILON);
+                    ASSERT_NEAR(e.getW(), a.getW(), EPSILON);
+                }
+            }
+        }
+    }
+
+public:
+    dmScript::HContext m_ScriptContext;
+    dmGameObject::HRegister m_Register;
+    dmGameObject::HCollection m_Collection;
+    dmResource::HFactory m_Factory;
+    dmArray<dmGameObject::HInstance> m_Instances;
+};
+
+TEST_F(TransformTest, BatchMatchesReference)
+{
+    const uint32_t instance_count = 1001;
+    CreateHierarchy(instance_count, 7);
+    VerifyAgainstReference(instance_count, 2);
+}
+
+TEST_F(TransformTest, ParallelMatchesReference)
+{
+    dmJobSystem::Params job_system_params;
+    dmJobSystem::SetDefaultParams(&job_system_params);
+    job_system_params.m_Name = "test_jobs";
+    job_system_params.m_WorkerCount = 3;
+    dmJobSystem::HJobSystem job_system = dmJobSystem::New(job_system_params);
+    dmGameObject::SetTransformJobSystem(m_Register, job_system, 100);
+
+    // Some levels are split into chunks, and some are small enough to be updated on this thread
+    const uint32_t instance_count = 4001;
+    CreateHierarchy(instance_count, 11);
+    VerifyAgainstReference(instance_count, 3);
+
+    dmGameObject::DeleteCollection(m_Collection);
+    dmGameObject::PostUpdate(m_Register);
+    m_Collection = 0;
+    dmGameObject::SetTransformJobSystem(m_Register, 0, 0);
+    dmJobSystem::Delete(job_system);
+}
+
+// Compares the original per-instance UpdateTransforms with the batched version,
+// both when the whole hierarchy has moved and when nothing has moved
+TEST_F(TransformTest, Performance)
+{
+    const uint32_t instance_counts[] = {1000, 10000, 30000};
+    const uint32_t depths[] = {1, 2, 4, 8};
+    const uint32_t iterations = 20;
+
+    for (uint32_t c = 0; c < DM_ARRAY_SIZE(instance_counts); ++c)
+    {
+        for (uint32_t d = 0; d < DM_ARRAY_SIZE(depths); ++d)
+        {
+            uint32_t instance_count = instance_counts[c];
+            uint32_t depth = depths[d];
+            CreateHierarchy(instance_count, depth);
+
+            dmArray<Matrix4> reference;
+            reference.SetCapacity(instance_count);
+            reference.SetSize(instance_count);
+
+            uint64_t reference_time = 0;
+            uint64_t moved_time = 0;
+            uint64_t static_time = 0;
+            for (uint32_t i = 0; i < iterations; ++i)
+            {
+                MoveRoots(0.5f);
+
+                uint64_t start = dmTime::GetTime();
+                UpdateTransformsReference(reference.Begin());
+                reference_time += dmTime::GetTime() - start;
+
+                start = dmTime::GetTime();
+                dmGameObject::UpdateTransforms(m_Collection);
+                moved_time += dmTime::GetTime() - start;
+
+                start = dmTime::GetTime();
+                dmGameObject::UpdateTransforms(m_Collection);
+                static_time += dmTime::GetTime() - start;
+            }
+
+            printf("[%5u instances, depth %u] reference: %.3f ms  batched (all moved): %.3f ms  batched (none moved): %.3f ms\n",
+                    instance_count, depth,
+                    reference_time / (1000.0f * iterations),
+                    moved_time / (1000.0f * iterations),
+                    static_time / (1000.0f * iterations));
+
+            dmGameObject::DeleteCollection(m_Collection);
+            dmGameObject::PostUpdate(m_Register);
+            m_Collection = 0;
+        }
+    }
+}
@@ -25,6 +25,7 @@
 #include <dlib/dstrings.h>
 #include <dlib/object_pool.h>
 #include <dlib/math.h>
+#include <dlib/intersection.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/intersection.h>
 #include <graphics/graphics.h>
@@ -119,6 +120,10 @@ namespace dmGameSystem
         uint32_t*                        m_VertexBufferDispatchCounts;
         // Temporary scratch array for instances, only used during the creation phase of components
         dmArray<dmGameObject::HInstance> m_ScratchInstances;
+        // Scratch buffers for the frustum culling (dmIntersection::OBBSoA)
+        dmArray<float>                   m_CullingBoxes;
+        dmArray<uint8_t>                 m_CullingResults;
+        dmRender::HRenderContext         m_RenderContext;
         dmRig::HRigContext               m_RigContext;
         uint32_t                         m_MaxElementsVertices;
         uint32_t                         m_MaxBatchIndex;
@@ -166,6 +171,7 @@ namespace dmGameSystem
         dmGraphics::AddVertexStream(stream_declaration, "texcoord1", 2, dmGraphics::TYPE_FLOAT, false);
 
         world->m_MaxBatchIndex = 0;
+        world->m_RenderContext = render_context;
         world->m_VertexDeclaration = dmGraphics::NewVertexDeclaration(graphics_context, stream_declaration);
         world->m_MaxElementsVertices = dmGraphics::GetMaxElementsVertices(graphics_context);
         world->m_VertexBuffers = new dmRender::HBufferedRenderBuffer[VERTEX_BUFFER_MAX_BATCHES];
@@ -1149,15 +1155,31 @@ namespace dmGameSystem
     {
         DM_PROFILE("Model");
 
-        const dmIntersection::Frustum frustum = *params.m_Frustum;
+        ModelWorld* world = (ModelWorld*)params.m_UserData;
         uint32_t num_entries = params.m_NumEntries;
+        if (world->m_CullingResults.Capacity() < num_entries)
+        {
+            world->m_CullingBoxes.SetCapacity(num_entries * dmIntersection::OBB_SOA_STREAM_COUNT);
+            world->m_CullingResults.SetCapacity(num_entries);
+        }
+        world->m_CullingBoxes.SetSize(num_entries * dmIntersection::OBB_SOA_STREAM_COUNT);
+        world->m_CullingResults.SetSize(num_entries);
+
+        dmIntersection::OBBSoA boxes;
+        dmIntersection::SetupOBBSoA(world->m_CullingBoxes.Begin(), num_entries, &boxes);
         for (uint32_t i = 0; i < num_entries; ++i)
         {
-            dmRender::RenderListEntry* entry = &params.m_Entries[i];
-            MeshRenderItem* render_item = (MeshRenderItem*)entry->m_UserData;
+            const MeshRenderItem* render_item = (MeshRenderItem*)params.m_Entries[i].m_UserData;
+            dmIntersection::SetOBBSoA(boxes, i, render_item->m_World, render_item->m_AabbMin, render_item->m_AabbMax);
+        }
 
-            bool intersect = dmIntersection::TestFrustumOBB(frustum, render_item->m_World, render_item->m_AabbMin, render_item->m_AabbMax);
-            entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+        uint8_t* intersect = world->m_CullingResults.Begin();
+        dmJobSystem::HJobSystem job_system = dmRender::GetRenderListJobSystem(world->m_RenderContext, num_entries);
+        dmIntersection::TestFrustumOBBBatch(job_system, *params.m_Frustum, boxes, num_entries, intersect);
+
+        for (uint32_t i = 0; i < num_entries; ++i)
+        {
+            params.m_Entries[i].m_Visibility = intersect[i] ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
         }
     }
 
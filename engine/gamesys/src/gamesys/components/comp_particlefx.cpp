@@ -79,6 +79,7 @@ namespace dmGameSystem
         dmParticle::HParticleContext            m_ParticleContext;
         dmRender::HBufferedRenderBuffer         m_VertexBuffer;
         dmArray<uint8_t>                        m_VertexBufferData;
+        dmArray<dmParticle::GenerateVertexDataParams> m_GenerateVertexDataParams;
         uint32_t                                m_VerticesWritten;
         uint32_t                                m_EmitterCount;
         uint32_t                                m_DispatchCount;
@@ -95,6 +96,7 @@ namespace dmGameSystem
         world->m_Context = ctx;
         uint32_t particle_fx_count = dmMath::Min(params.m_MaxComponentInstances, ctx->m_MaxParticleFXCount);
         world->m_ParticleContext = dmParticle::CreateContext(ctx->m_MaxParticleFXCount, ctx->m_MaxParticleCount);
+        dmParticle::SetJobSystem(world->m_ParticleContext, ctx->m_JobSystem, ctx->m_JobMinParticleCount);
         world->m_Components.SetCapacity(particle_fx_count);
         world->m_Prototypes.SetCapacity(particle_fx_count);
         world->m_Prototypes.SetSize(particle_fx_count);
@@ -329,16 +331,33 @@ namespace dmGameSystem
 
         FillParticleMaterialAttributeInfos(material_res->m_Material, &attribute_infos);
 
-        for (uint32_t *i = begin; i != end; ++i)
+        uint32_t emitter_count = end - begin;
+        dmArray<dmParticle::GenerateVertexDataParams>& generate_params = pfx_world->m_GenerateVertexDataParams;
+        if (generate_params.Capacity() < emitter_count)
         {
-            const dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*) buf[*i].m_UserData;
+            generate_params.SetCapacity(emitter_count);
+        }
+        generate_params.SetSize(emitter_count);
+
+        for (uint32_t i = 0; i < emitter_count; ++i)
+        {
+            const dmParticle::EmitterRenderData* emitter_render_data = (dmParticle::EmitterRenderData*) buf[begin[i]].m_UserData;
 
             FillEmitterAttributeInfos(emitter_render_data->m_Attributes, emitter_render_data->m_AttributeCount, &attribute_infos);
 
-            dmParticle::GenerateVertexDataResult res = dmParticle::GenerateVertexData(particle_context,
-                pfx_world->m_DT, emitter_render_data->m_Instance, emitter_render_data->m_EmitterIndex,
-                attribute_infos, Vector4(1,1,1,1), (void*) vertex_buffer.Begin(), vb_max_size, &vb_size);
+            dmParticle::GenerateVertexDataParams& p = generate_params[i];
+            p.m_AttributeInfos = attribute_infos;
+            p.m_Color          = Vector4(1,1,1,1);
+            p.m_Instance       = emitter_render_data->m_Instance;
+            p.m_EmitterIndex   = emitter_render_data->m_EmitterIndex;
+        }
+
+        dmParticle::GenerateVertexDataBatch(particle_context, pfx_world->m_DT, generate_params.Begin(), emitter_count,
+            (void*) vertex_buffer.Begin(), vb_max_size, &vb_size);
 
+        for (uint32_t i = 0; i < emitter_count; ++i)
+        {
+            dmParticle::GenerateVertexDataResult res = generate_params[i].m_Result;
             if (res != dmParticle::GENERATE_VERTEX_DATA_OK)
             {
                 if (res == dmParticle::GENERATE_VERTEX_DATA_MAX_PARTICLES_EXCEEDED)
@@ -348,7 +367,7 @@ namespace dmGameSystem
                 }
                 else if (res == dmParticle::GENERATE_VERTEX_DATA_INVALID_INSTANCE)
                 {
-                    dmLogWarning("Cannot generate vertex data for emitter (%d), particle instance handle is invalid.", (*i));
+                    dmLogWarning("Cannot generate vertex data for emitter (%d), particle instance handle is invalid.", begin[i]);
                 }
             }
         }
@@ -26,6 +26,7 @@
 #include <dlib/dstrings.h>
 #include <dlib/object_pool.h>
 #include <dlib/math.h>
+#include <dlib/intersection.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/intersection.h>
 #include <graphics/graphics.h>
@@ -113,6 +114,9 @@ namespace dmGameSystem
         DynamicAttributePool                m_DynamicVertexAttributePool;
         dmArray<dmRender::RenderObject*>    m_RenderObjects;
         dmArray<float>                      m_BoundingVolumes;
+        dmArray<float>                      m_CullingSpheres;   // Scratch buffer for the frustum culling (dmIntersection::SphereSoA)
+        dmArray<uint8_t>                    m_CullingResults;
+        dmRender::HRenderContext            m_RenderContext;
         uint32_t                            m_RenderObjectsInUse;
         dmRender::HBufferedRenderBuffer     m_VertexBuffer;
         uint8_t*                            m_VertexBufferData;
@@ -219,6 +223,7 @@ namespace dmGameSystem
         sprite_world->m_BoundingVolumes.SetCapacity(comp_count);
         sprite_world->m_BoundingVolumes.SetSize(comp_count);
         memset(sprite_world->m_Components.GetRawObjects().Begin(), 0, sizeof(SpriteComponent) * comp_count);
+        sprite_world->m_RenderContext = sprite_context->m_RenderContext;
         sprite_world->m_RenderObjectsInUse = 0;
         sprite_world->m_VertexBuffer     = 0;
         sprite_world->m_VertexBufferData = 0;
@@ -1805,16 +1810,30 @@ namespace dmGameSystem
         SpriteWorld* sprite_world = (SpriteWorld*)params.m_UserData;
         const float* radiuses = sprite_world->m_BoundingVolumes.Begin();
 
-        const dmIntersection::Frustum frustum = *params.m_Frustum;
         uint32_t num_entries = params.m_NumEntries;
+        if (sprite_world->m_CullingResults.Capacity() < num_entries)
+        {
+            sprite_world->m_CullingSpheres.SetCapacity(num_entries * dmIntersection::SPHERE_SOA_STREAM_COUNT);
+            sprite_world->m_CullingResults.SetCapacity(num_entries);
+        }
+        sprite_world->m_CullingSpheres.SetSize(num_entries * dmIntersection::SPHERE_SOA_STREAM_COUNT);
+        sprite_world->m_CullingResults.SetSize(num_entries);
+
+        dmIntersection::SphereSoA spheres;
+        dmIntersection::SetupSphereSoA(sprite_world->m_CullingSpheres.Begin(), num_entries, &spheres);
         for (uint32_t i = 0; i < num_entries; ++i)
         {
-            dmRender::RenderListEntry* entry = &params.m_Entries[i];
+            const dmRender::RenderListEntry* entry = &params.m_Entries[i];
+            dmIntersection::SetSphereSoA(spheres, i, entry->m_WorldPosition, radiuses[entry->m_UserData]);
+        }
 
-            float radius_sq = radiuses[entry->m_UserData];
+        uint8_t* intersect = sprite_world->m_CullingResults.Begin();
+        dmJobSystem::HJobSystem job_system = dmRender::GetRenderListJobSystem(sprite_world->m_RenderContext, num_entries);
+        dmIntersection::TestFrustumSphereSqBatch(job_system, *params.m_Frustum, spheres, num_entries, intersect);
 
-            bool intersect = dmIntersection::TestFrustumSphereSq(frustum, entry->m_WorldPosition, radius_sq);
-            entry->m_Visibility = intersect ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
+        for (uint32_t i = 0; i < num_entries; ++i)
+        {
+            params.m_Entries[i].m_Visibility = intersect[i] ? dmRender::VISIBILITY_FULL : dmRender::VISIBILITY_NONE;
         }
     }
 
@@ -2064,6 +2083,31 @@ namespace dmGameSystem
         return dmGameObject::UPDATE_RESULT_OK;
     }
 
+    dmGameObject::UpdateResult CompSpriteOnMessageBatch(const dmGameObject::ComponentOnMessageBatchParams& params)
+    {
+        // All messages in the batch have the same id, which is checked once for the enable/disable case
+        SpriteWorld* sprite_world = (SpriteWorld*)params.m_World;
+        dmhash_t message_id = params.m_Messages[0].m_Message->m_Id;
+        if (message_id == dmGameObjectDDF::Enable::m_DDFDescriptor->m_NameHash || message_id == dmGameObjectDDF::Disable::m_DDFDescriptor->m_NameHash)
+        {
+            uint16_t enabled = message_id == dmGameObjectDDF::Enable::m_DDFDescriptor->m_NameHash ? 1 : 0;
+            for (uint32_t i = 0; i < params.m_MessageCount; ++i)
+            {
+                sprite_world->m_Components.Get(*params.m_Messages[i].m_UserData).m_Enabled = enabled;
+            }
+            return dmGameObject::UPDATE_RESULT_OK;
+        }
+
+        dmGameObject::UpdateResult result = dmGameObject::UPDATE_RESULT_OK;
+        for (uint32_t i = 0; i < params.m_MessageCount; ++i)
+        {
+            dmGameObject::UpdateResult r = CompSpriteOnMessage(params.m_Messages[i]);
+            if (r != dmGameObject::UPDATE_RESULT_OK)
+                result = r;
+        }
+        return result;
+    }
+
     void CompSpriteOnReload(const dmGameObject::ComponentOnReloadParams& params)
     {
         SpriteWorld* sprite_world = (SpriteWorld*)params.m_World;
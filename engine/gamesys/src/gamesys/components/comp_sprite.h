@@ -35,6 +35,8 @@ namespace dmGameSystem
 
     dmGameObject::UpdateResult CompSpriteOnMessage(const dmGameObject::ComponentOnMessageParams& params);
 
+    dmGameObject::UpdateResult CompSpriteOnMessageBatch(const dmGameObject::ComponentOnMessageBatchParams& params);
+
     void CompSpriteOnReload(const dmGameObject::ComponentOnReloadParams& params);
 
     dmGameObject::PropertyResult CompSpriteGetProperty(const dmGameObject::ComponentGetPropertyParams& params, dmGameObject::PropertyDesc& out_value);
@@ -135,6 +135,29 @@ namespace dmGameSystem
 
 #undef REGISTER_RESOURCE_TYPE
 
+        // These types only read their data, so they can be created straight from a memory mapped archive
+        const char* zero_copy_types[] = {"texturec", "bufferc", "wavc", "oggc"};
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(zero_copy_types); ++i)
+        {
+            e = dmResource::SetTypeZeroCopy(factory, zero_copy_types[i], true);
+            if (e != dmResource::RESULT_OK)
+                return e;
+        }
+
+        // Pure ddf types can be created on the load threads
+        const char* thread_safe_types[] = {"meshsetc", "skeletonc"};
+        for (uint32_t i = 0; i < DM_ARRAY_SIZE(thread_safe_types); ++i)
+        {
+            e = dmResource::SetTypeThreadSafeCreate(factory, thread_safe_types[i], true);
+            if (e != dmResource::RESULT_OK)
+                return e;
+        }
+
+        // Registered with dmResource::RegisterTypes(), unless excluded by the app manifest
+        e = dmResource::SetTypeThreadSafeCreate(factory, "animationsetc", true);
+        if (e == dmResource::RESULT_UNKNOWN_RESOURCE_TYPE)
+            e = dmResource::RESULT_OK;
+
         return e;
     }
 
@@ -291,6 +314,7 @@ namespace dmGameSystem
                 CompSpriteOnReload, CompSpriteGetProperty, CompSpriteSetProperty,
                 0, CompSpriteIterProperties,
                 1);
+        dmGameObject::ComponentTypeSetOnMessageBatchFn(dmGameObject::FindComponentType(regist, type, 0), CompSpriteOnMessageBatch);
 
         REGISTER_COMPONENT_TYPE(TILE_MAP_EXT, 1200, tilemap_context,
                 CompTileGridNewWorld, CompTileGridDeleteWorld,
@@ -19,6 +19,7 @@
 #include <string.h>
 #include <script/script.h>
 
+#include <dlib/job_system.h>
 #include <dlib/job_thread.h>
 #include <resource/resource.h>
 
@@ -99,9 +100,11 @@ namespace dmGameSystem
         }
         dmResource::HFactory m_Factory;
         dmRender::HRenderContext m_RenderContext;
+        dmJobSystem::HJobSystem m_JobSystem;
         uint32_t m_MaxParticleFXCount;
         uint32_t m_MaxParticleCount;
         uint32_t m_MaxEmitterCount;
+        uint32_t m_JobMinParticleCount;
         bool m_Debug;
     };
 
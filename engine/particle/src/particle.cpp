@@ -22,6 +22,7 @@
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/profile.h>
+#include <dlib/simd.h>
 #include <dlib/time.h>
 #include <dmsdk/dlib/vmath.h>
 
@@ -50,6 +51,8 @@ namespace dmParticle
     const char* MAX_EMITTER_COUNT_KEY  = "particle_fx.max_emitter_count";
     /// Config key to use for tweaking the total maximum number of particles in a context.
     const char* MAX_PARTICLE_COUNT_KEY = "particle_fx.max_particle_count";
+    /// Config key to use for tweaking the min number of particles in a context for the emitters to be processed on the job threads.
+    const char* JOB_MIN_PARTICLE_COUNT_KEY = "particle_fx.job_min_particle_count";
 
     /// Used for degree to radian conversion
     const float DEG_RAD = (float) (M_PI / 180.0);
@@ -112,6 +115,34 @@ namespace dmParticle
         context->m_MaxParticleCount = max_particle_count;
     }
 
+    void SetJobSystem(HParticleContext context, dmJobSystem::HJobSystem job_system, uint32_t min_particle_count)
+    {
+        context->m_JobSystem = job_system;
+        context->m_JobMinParticleCount = min_particle_count;
+    }
+
+    // Returns the job system to use when processing particle_count particles, or 0x0 to use the calling thread
+    static dmJobSystem::HJobSystem GetJobSystem(HParticleContext context, uint32_t particle_count)
+    {
+        dmJobSystem::HJobSystem job_system = context->m_JobSystem;
+        if (!job_system || dmJobSystem::GetWorkerCount(job_system) == 0 || context->m_JobMinParticleCount == 0 || particle_count < context->m_JobMinParticleCount)
+            return 0x0;
+        return job_system;
+    }
+
+    static void RunEmitterJob(dmJobSystem::HJobSystem job_system, dmJobSystem::FParallelFor process, void* job, uint32_t emitter_count)
+    {
+        if (job_system)
+        {
+            // One emitter per chunk since the particle counts of the emitters differ a lot
+            dmJobSystem::ParallelFor(job_system, process, job, emitter_count, 1);
+        }
+        else
+        {
+            process(job, 0, emitter_count);
+        }
+    }
+
     static Instance* GetInstance(HParticleContext context, HInstance instance)
     {
         if (instance == INVALID_INSTANCE)
@@ -188,6 +219,70 @@ namespace dmParticle
         }
     }
 
+    void ParticleBuffer::SetCapacity(uint32_t capacity)
+    {
+        if (capacity == m_Capacity)
+            return;
+
+        float* data = 0x0;
+        uint32_t stride = (capacity + 3) & ~3u;
+        uint32_t size = dmMath::Min(m_Size, capacity);
+        if (capacity > 0)
+        {
+            // Allocated as bytes since the scratch space is also used for the 64 bit sort keys
+            uint32_t data_size = (PARTICLE_STREAM_COUNT + 3) * stride * sizeof(float);
+            data = (float*)new uint8_t[data_size];
+            memset(data, 0, data_size);
+            for (uint32_t s = 0; s < PARTICLE_STREAM_COUNT && size > 0; ++s)
+            {
+                memcpy(data + s * stride, Stream(s), size * sizeof(float));
+            }
+        }
+        delete [] (uint8_t*)m_Data;
+        m_Data = data;
+        m_Stride = stride;
+        m_Capacity = capacity;
+        m_Size = size;
+    }
+
+    void ParticleBuffer::SetSize(uint32_t size)
+    {
+        assert(size <= m_Capacity);
+        m_Size = size;
+    }
+
+    uint32_t ParticleBuffer::Push()
+    {
+        assert(m_Size < m_Capacity);
+        uint32_t index = m_Size++;
+        for (uint32_t s = 0; s < PARTICLE_STREAM_COUNT; ++s)
+        {
+            Stream(s)[index] = 0.0f;
+        }
+        return index;
+    }
+
+    void ParticleBuffer::EraseSwap(uint32_t i)
+    {
+        assert(i < m_Size);
+        uint32_t last = --m_Size;
+        if (i != last)
+        {
+            for (uint32_t s = 0; s < PARTICLE_STREAM_COUNT; ++s)
+            {
+                float* stream = Stream(s);
+                stream[i] = stream[last];
+            }
+        }
+    }
+
+    void ParticleBuffer::Swap(ParticleBuffer& other)
+    {
+        ParticleBuffer tmp = *this;
+        *this = other;
+        other = tmp;
+    }
+
     static void InitEmitter(Emitter* emitter, dmParticleDDF::Emitter* emitter_ddf, uint32_t original_seed)
     {
         emitter->m_Id = dmHashString64(emitter_ddf->m_Id);
@@ -490,7 +585,8 @@ namespace dmParticle
     static void ResetEmitter(Emitter* emitter)
     {
         // Save particles array and id
-        dmArray<Particle> tmp;
+        ParticleBuffer tmp;
+        memset(&tmp, 0, sizeof(tmp));
         tmp.Swap(emitter->m_Particles);
         dmhash_t id = emitter->m_Id;
         uint32_t original_seed = emitter->m_OriginalSeed;
@@ -600,6 +696,14 @@ namespace dmParticle
     static void EvaluateEmitterProperties(Emitter* emitter, Property* emitter_properties, float duration, float properties[EMITTER_KEY_COUNT]);
     static void EvaluateParticleProperties(Emitter* emitter, Property* particle_properties, dmParticleDDF::Emitter* emitter_ddf, float dt);
     static GenerateVertexDataResult UpdateRenderData(HParticleContext context, Instance* instance, Emitter* emitter, dmParticleDDF::Emitter* ddf, const ParticleVertexAttributeInfos& attribute_infos, const Vector4& color, uint32_t vertex_index, uint8_t* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* bytes_written, float dt);
+
+    // Number of particles of the emitter that fit in the vertex buffer when starting at vertex_index
+    static inline uint32_t GetRenderParticleCount(Emitter* emitter, uint32_t vertex_index, uint32_t max_vertex_count)
+    {
+        uint32_t particle_count = emitter->m_Particles.Size();
+        return vertex_index < max_vertex_count ? dmMath::Min(particle_count, (max_vertex_count - vertex_index) / 6) : 0;
+    }
+
     static void GenerateKeys(Emitter* emitter, float max_particle_life_time);
     static void SortParticles(Emitter* emitter);
     static void Simulate(Instance* instance, Emitter* emitter, EmitterPrototype* prototype, dmParticleDDF::Emitter* ddf, float dt);
@@ -686,12 +790,141 @@ namespace dmParticle
         return res;
     }
 
+    struct GenerateVertexDataJob
+    {
+        HParticleContext            m_Context;
+        GenerateVertexDataParams*   m_Params;
+        EmitterVertexRange*         m_Ranges;
+        uint8_t*                    m_VertexBuffer;
+        uint32_t                    m_VertexBufferSize;
+        float                       m_DT;
+    };
+
+    static void GenerateVertexDataParallel(void* context, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("GenerateVertexDataJob");
+        GenerateVertexDataJob* job = (GenerateVertexDataJob*)context;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const EmitterVertexRange& range = job->m_Ranges[i];
+            if (range.m_Emitter == 0x0)
+                continue;
+            GenerateVertexDataParams& params = job->m_Params[i];
+            uint32_t bytes_written = 0;
+            params.m_Result = UpdateRenderData(job->m_Context, range.m_Instance, range.m_Emitter, range.m_DDF, params.m_AttributeInfos, params.m_Color, range.m_VertexIndex, job->m_VertexBuffer, job->m_VertexBufferSize, &bytes_written, job->m_DT);
+        }
+    }
+
+    void GenerateVertexDataBatch(HParticleContext context, float dt, GenerateVertexDataParams* params, uint32_t params_count, void* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* out_vertex_buffer_size)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        dmArray<EmitterVertexRange>& ranges = context->m_EmitterVertexRanges;
+        if (ranges.Capacity() < params_count)
+            ranges.SetCapacity(params_count);
+        ranges.SetSize(params_count);
+
+        // Lay out the emitters in the vertex buffer the same way consecutive calls to GenerateVertexData would,
+        // so each emitter can write its vertices without synchronization
+        bool write = vertex_buffer != 0x0 && vertex_buffer_size > 0;
+        uint32_t vb_size = *out_vertex_buffer_size;
+        uint32_t particle_count = 0;
+        for (uint32_t i = 0; i < params_count; ++i)
+        {
+            GenerateVertexDataParams& p = params[i];
+            assert(p.m_AttributeInfos.m_StructSize == sizeof(ParticleVertexAttributeInfos));
+            assert(p.m_AttributeInfos.m_VertexStride != 0);
+
+            EmitterVertexRange& range = ranges[i];
+            range.m_Emitter = 0x0;
+            p.m_Result = GENERATE_VERTEX_DATA_OK;
+            if (p.m_Instance == INVALID_INSTANCE)
+            {
+                p.m_Result = GENERATE_VERTEX_DATA_INVALID_INSTANCE;
+                continue;
+            }
+
+            Instance* inst = GetInstance(context, p.m_Instance);
+            if (IsSleeping(inst))
+                continue;
+
+            uint32_t render_count = 0;
+            if (write)
+            {
+                uint32_t vertex_size = p.m_AttributeInfos.m_VertexStride;
+                uint32_t vertex_index = vb_size / vertex_size;
+                if (vb_size % vertex_size != 0)
+                {
+                    vertex_index++;
+                }
+
+                range.m_Instance = inst;
+                range.m_Emitter = &inst->m_Emitters[p.m_EmitterIndex];
+                range.m_DDF = &inst->m_Prototype->m_DDF->m_Emitters[p.m_EmitterIndex];
+                range.m_VertexIndex = vertex_index;
+
+                render_count = GetRenderParticleCount(range.m_Emitter, vertex_index, vertex_buffer_size / vertex_size);
+                vb_size += render_count * 6 * vertex_size;
+                particle_count += render_count;
+            }
+
+            context->m_Stats.m_Particles = render_count; // Debug data for editor playback
+        }
+
+        GenerateVertexDataJob job;
+        job.m_Context = context;
+        job.m_Params = params;
+        job.m_Ranges = ranges.Begin();
+        job.m_VertexBuffer = (uint8_t*)vertex_buffer;
+        job.m_VertexBufferSize = vertex_buffer_size;
+        job.m_DT = dt;
+        RunEmitterJob(GetJobSystem(context, particle_count), GenerateVertexDataParallel, &job, params_count);
+
+        *out_vertex_buffer_size = vb_size;
+    }
+
+    struct UpdateEmittersJob
+    {
+        EmitterUpdate*  m_Emitters;
+        float           m_DT;
+    };
+
+    static void UpdateParticlesParallel(void* context, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("UpdateParticlesJob");
+        UpdateEmittersJob* job = (UpdateEmittersJob*)context;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            EmitterUpdate& e = job->m_Emitters[i];
+            if (e.m_Simulate)
+                UpdateParticles(e.m_Instance, e.m_Emitter, e.m_DDF, job->m_DT);
+        }
+    }
+
+    static void SimulateParallel(void* context, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("SimulateJob");
+        UpdateEmittersJob* job = (UpdateEmittersJob*)context;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            EmitterUpdate& e = job->m_Emitters[i];
+            if (e.m_Simulate)
+            {
+                GenerateKeys(e.m_Emitter, e.m_Prototype->m_MaxParticleLifeTime);
+                SortParticles(e.m_Emitter);
+                Simulate(e.m_Instance, e.m_Emitter, e.m_Prototype, e.m_DDF, job->m_DT);
+            }
+        }
+    }
+
     void Update(HParticleContext context, float dt, FetchAnimationCallback fetch_animation_callback)
     {
         DM_PROFILE(__FUNCTION__);
 
+        dmArray<EmitterUpdate>& updates = context->m_EmitterUpdates;
+        updates.SetSize(0);
+
         uint32_t size = context->m_Instances.Size();
-        uint32_t TotalAliveParticles = 0;
         for (uint32_t i = 0; i < size; i++)
         {
             Instance* instance = context->m_Instances[i];
@@ -716,23 +949,58 @@ namespace dmParticle
             instance->m_PlayTime += dt;
             Prototype* prototype = instance->m_Prototype;
             uint32_t emitter_count = instance->m_Emitters.Size();
+            if (updates.Remaining() < emitter_count)
+                updates.OffsetCapacity(dmMath::Max(emitter_count, 16u));
             for (uint32_t emitter_i = 0; emitter_i < emitter_count; ++emitter_i)
             {
-                Emitter* emitter = &instance->m_Emitters[emitter_i];
-                EmitterPrototype* emitter_prototype = &prototype->m_Emitters[emitter_i];
-                dmParticleDDF::Emitter* emitter_ddf = &prototype->m_DDF->m_Emitters[emitter_i];
+                EmitterUpdate e;
+                e.m_Instance = instance;
+                e.m_Emitter = &instance->m_Emitters[emitter_i];
+                e.m_Prototype = &prototype->m_Emitters[emitter_i];
+                e.m_DDF = &prototype->m_DDF->m_Emitters[emitter_i];
+                e.m_InstanceHandle = instance_handle;
+                e.m_EmitterIndex = emitter_i;
+                // Don't update emitter if time is standing still
+                e.m_Simulate = !IsSleeping(e.m_Emitter) && dt > 0.0f;
+                updates.Push(e);
+
+                UpdateEmitterVelocity(instance, e.m_Emitter, e.m_DDF, dt);
+            }
+        }
 
-                UpdateEmitterVelocity(instance, emitter, emitter_ddf, dt);
-                UpdateEmitter(prototype, instance, emitter_prototype, emitter, emitter_ddf, dt);
-                TotalAliveParticles += (uint32_t)emitter->m_Particles.Size();
-                FetchAnimation(emitter, emitter_prototype, fetch_animation_callback);
-                UpdateEmitterRenderData(instance_handle, emitter_i, instance, emitter, emitter_ddf);
+        // The emitters are updated in passes. Stepping and simulating the particles only touches the emitter itself,
+        // and is done on the job threads when there are enough particles. Spawning stays on the calling thread
+        // since it changes the emitter state, which invokes the state changed callbacks.
+        UpdateEmittersJob job;
+        job.m_Emitters = updates.Begin();
+        job.m_DT = dt;
+        uint32_t update_count = updates.Size();
+        dmJobSystem::HJobSystem job_system = GetJobSystem(context, context->m_ParticleCount);
 
-                if (emitter->m_ReHash)
-                    ReHashEmitter(emitter);
-            }
+        RunEmitterJob(job_system, UpdateParticlesParallel, &job, update_count);
+
+        for (uint32_t i = 0; i < update_count; ++i)
+        {
+            EmitterUpdate& e = updates[i];
+            if (e.m_Simulate)
+                UpdateEmitterState(e.m_Instance, e.m_Emitter, e.m_Prototype, e.m_DDF, dt);
         }
 
+        RunEmitterJob(job_system, SimulateParallel, &job, update_count);
+
+        uint32_t TotalAliveParticles = 0;
+        for (uint32_t i = 0; i < update_count; ++i)
+        {
+            EmitterUpdate& e = updates[i];
+            TotalAliveParticles += (uint32_t)e.m_Emitter->m_Particles.Size();
+            FetchAnimation(e.m_Emitter, e.m_Prototype, fetch_animation_callback);
+            UpdateEmitterRenderData(e.m_InstanceHandle, e.m_EmitterIndex, e.m_Instance, e.m_Emitter, e.m_DDF);
+
+            if (e.m_Emitter->m_ReHash)
+                ReHashEmitter(e.m_Emitter);
+        }
+        context->m_ParticleCount = TotalAliveParticles;
+
         DM_PROPERTY_SET_U32(rmtp_ParticlesAlive, TotalAliveParticles);
     }
 
@@ -763,17 +1031,34 @@ namespace dmParticle
     {
         DM_PROFILE(__FUNCTION__);
 
-        // Step particle life, prune dead particles
-        uint32_t particle_count = emitter->m_Particles.Size();
+        // Step particle life
+        ParticleBuffer& particles = emitter->m_Particles;
+        uint32_t particle_count = particles.Size();
+        float* time_left = particles.Stream(PARTICLE_STREAM_TIME_LEFT);
+        const dmSIMD::Vec4f dt4 = dmSIMD::Set1(dt);
+        const dmSIMD::Vec4f zero = dmSIMD::Zero();
+        uint32_t dead_mask = 0;
+        for (uint32_t i = 0; i < particle_count; i += 4)
+        {
+            dmSIMD::Vec4f t = dmSIMD::Sub(dmSIMD::Load(time_left + i), dt4);
+            dmSIMD::Store(time_left + i, t);
+            uint32_t mask = dmSIMD::MaskLessThan(t, zero);
+            // Ignore the padding lanes of the last group
+            if (particle_count - i < 4)
+                mask &= (1u << (particle_count - i)) - 1;
+            dead_mask |= mask;
+        }
+        if (dead_mask == 0)
+            return;
+
+        // Prune dead particles
         uint32_t j = 0;
         while (j < particle_count)
         {
-            Particle* p = &emitter->m_Particles[j];
-            p->SetTimeLeft(p->GetTimeLeft() - dt);
-            if (p->GetTimeLeft() < 0.0f)
+            if (time_left[j] < 0.0f)
             {
                 // TODO Handle death-action
-                emitter->m_Particles.EraseSwap(j);
+                particles.EraseSwap(j);
                 --particle_count;
             } else {
                 ++j;
@@ -781,7 +1066,7 @@ namespace dmParticle
         }
     }
 
-    static void SpawnParticle(dmArray<Particle>& particles, uint32_t* seed, dmParticleDDF::Emitter* ddf, const dmTransform::TransformS1& emitter_transform, Vector3 emitter_velocity, float emitter_properties[EMITTER_KEY_COUNT], float dt);
+    static void SpawnParticle(ParticleBuffer& particles, uint32_t* seed, dmParticleDDF::Emitter* ddf, const dmTransform::TransformS1& emitter_transform, Vector3 emitter_velocity, float emitter_properties[EMITTER_KEY_COUNT], float dt);
 
     static void UpdateEmitterState(Instance* instance, Emitter* emitter, EmitterPrototype* emitter_prototype, dmParticleDDF::Emitter* emitter_ddf, float dt)
     {
@@ -860,24 +1145,21 @@ namespace dmParticle
         return particle_count * vertices_per_particle;
     }
 
-    static void SpawnParticle(dmArray<Particle>& particles, uint32_t* seed, dmParticleDDF::Emitter* ddf, const dmTransform::TransformS1& emitter_transform, Vector3 emitter_velocity, float emitter_properties[EMITTER_KEY_COUNT], float dt)
+    static void SpawnParticle(ParticleBuffer& particles, uint32_t* seed, dmParticleDDF::Emitter* ddf, const dmTransform::TransformS1& emitter_transform, Vector3 emitter_velocity, float emitter_properties[EMITTER_KEY_COUNT], float dt)
     {
         DM_PROFILE(__FUNCTION__);
 
-        uint32_t particle_count = particles.Size();
-        particles.SetSize(particle_count + 1);
-        Particle *particle = &particles[particle_count];
-        memset(particle, 0, sizeof(Particle));
+        Particle particle = particles[particles.Push()];
 
         // TODO Handle birth-action
 
-        particle->SetMaxLifeTime(emitter_properties[EMITTER_KEY_PARTICLE_LIFE_TIME]);
-        particle->SetooMaxLifeTime(1.0f / particle->GetMaxLifeTime());
+        particle.SetMaxLifeTime(emitter_properties[EMITTER_KEY_PARTICLE_LIFE_TIME]);
+        particle.SetooMaxLifeTime(1.0f / particle.GetMaxLifeTime());
         // Include dt since already existing particles have already been advanced
-        particle->SetTimeLeft(particle->GetMaxLifeTime() - dt);
-        particle->SetSpreadFactor(dmMath::Rand11(seed));
-        particle->SetSourceSize(emitter_properties[EMITTER_KEY_PARTICLE_SIZE] * emitter_transform.GetScale());
-        particle->SetSourceColor(Vector4(
+        particle.SetTimeLeft(particle.GetMaxLifeTime() - dt);
+        particle.SetSpreadFactor(dmMath::Rand11(seed));
+        particle.SetSourceSize(emitter_properties[EMITTER_KEY_PARTICLE_SIZE] * emitter_transform.GetScale());
+        particle.SetSourceColor(Vector4(
                 emitter_properties[EMITTER_KEY_PARTICLE_RED],
                 emitter_properties[EMITTER_KEY_PARTICLE_GREEN],
                 emitter_properties[EMITTER_KEY_PARTICLE_BLUE],
@@ -1017,19 +1299,19 @@ namespace dmParticle
         }
 
         transform = dmTransform::Mul(emitter_transform, transform);
-        particle->SetPosition(Point3(transform.GetTranslation()));
+        particle.SetPosition(Point3(transform.GetTranslation()));
         if (ddf->m_ParticleOrientation == PARTICLE_ORIENTATION_MOVEMENT_DIRECTION) {
-            particle->SetSourceRotation(dmVMath::QuatFromAngle(2, DEG_RAD * emitter_properties[EMITTER_KEY_PARTICLE_ROTATION]));
+            particle.SetSourceRotation(dmVMath::QuatFromAngle(2, DEG_RAD * emitter_properties[EMITTER_KEY_PARTICLE_ROTATION]));
         } else {
-            particle->SetSourceRotation(transform.GetRotation() * dmVMath::QuatFromAngle(2, DEG_RAD * emitter_properties[EMITTER_KEY_PARTICLE_ROTATION]));
+            particle.SetSourceRotation(transform.GetRotation() * dmVMath::QuatFromAngle(2, DEG_RAD * emitter_properties[EMITTER_KEY_PARTICLE_ROTATION]));
         }
-        particle->SetRotation(particle->GetSourceRotation());
-        particle->SetVelocity(dmTransform::Apply(emitter_transform, velocity) + emitter_velocity);
-        particle->m_SourceStretchFactorX = emitter_properties[EMITTER_KEY_PARTICLE_STRETCH_FACTOR_X];
-        particle->m_StretchFactorX = particle->m_SourceStretchFactorX;
-        particle->m_SourceStretchFactorY = emitter_properties[EMITTER_KEY_PARTICLE_STRETCH_FACTOR_Y];
-        particle->m_StretchFactorY = particle->m_SourceStretchFactorY;
-        particle->m_SourceAngularVelocity = emitter_properties[EMITTER_KEY_PARTICLE_ANGULAR_VELOCITY];
+        particle.SetRotation(particle.GetSourceRotation());
+        particle.SetVelocity(dmTransform::Apply(emitter_transform, velocity) + emitter_velocity);
+        particle.SetSourceStretchFactorX(emitter_properties[EMITTER_KEY_PARTICLE_STRETCH_FACTOR_X]);
+        particle.SetStretchFactorX(particle.GetSourceStretchFactorX());
+        particle.SetSourceStretchFactorY(emitter_properties[EMITTER_KEY_PARTICLE_STRETCH_FACTOR_Y]);
+        particle.SetStretchFactorY(particle.GetSourceStretchFactorY());
+        particle.SetSourceAngularVelocity(emitter_properties[EMITTER_KEY_PARTICLE_ANGULAR_VELOCITY]);
     }
 
     static inline bool HasLocalPositionAttribute(const ParticleVertexAttributeInfos& attribute_infos)
@@ -1097,6 +1379,36 @@ namespace dmParticle
         1.0f, 1.0f,
     };
 
+    /// Number of particles per batch when generating vertex data, must be a multiple of four
+    static const uint32_t RENDER_BATCH_SIZE = 64;
+
+    // Same as Quat * Quat for four quaternions
+    static inline void QuatMul4(dmSIMD::Vec4f ax, dmSIMD::Vec4f ay, dmSIMD::Vec4f az, dmSIMD::Vec4f aw,
+                                dmSIMD::Vec4f bx, dmSIMD::Vec4f by, dmSIMD::Vec4f bz, dmSIMD::Vec4f bw,
+                                dmSIMD::Vec4f& rx, dmSIMD::Vec4f& ry, dmSIMD::Vec4f& rz, dmSIMD::Vec4f& rw)
+    {
+        using namespace dmSIMD;
+        rx = Sub(Add(Add(Mul(aw, bx), Mul(ax, bw)), Mul(ay, bz)), Mul(az, by));
+        ry = Sub(Add(Add(Mul(aw, by), Mul(ay, bw)), Mul(az, bx)), Mul(ax, bz));
+        rz = Sub(Add(Add(Mul(aw, bz), Mul(az, bw)), Mul(ax, by)), Mul(ay, bx));
+        rw = Sub(Sub(Sub(Mul(aw, bw), Mul(ax, bx)), Mul(ay, by)), Mul(az, bz));
+    }
+
+    // Same as rotate(Quat, Vector3) for four vectors
+    static inline void Rotate4(dmSIMD::Vec4f qx, dmSIMD::Vec4f qy, dmSIMD::Vec4f qz, dmSIMD::Vec4f qw,
+                               dmSIMD::Vec4f vx, dmSIMD::Vec4f vy, dmSIMD::Vec4f vz,
+                               dmSIMD::Vec4f& rx, dmSIMD::Vec4f& ry, dmSIMD::Vec4f& rz)
+    {
+        using namespace dmSIMD;
+        Vec4f tmp_x = Sub(Add(Mul(qw, vx), Mul(qy, vz)), Mul(qz, vy));
+        Vec4f tmp_y = Sub(Add(Mul(qw, vy), Mul(qz, vx)), Mul(qx, vz));
+        Vec4f tmp_z = Sub(Add(Mul(qw, vz), Mul(qx, vy)), Mul(qy, vx));
+        Vec4f tmp_w = Add(Add(Mul(qx, vx), Mul(qy, vy)), Mul(qz, vz));
+        rx = Add(Sub(Add(Mul(tmp_w, qx), Mul(tmp_x, qw)), Mul(tmp_y, qz)), Mul(tmp_z, qy));
+        ry = Add(Sub(Add(Mul(tmp_w, qy), Mul(tmp_y, qw)), Mul(tmp_z, qx)), Mul(tmp_x, qz));
+        rz = Add(Sub(Add(Mul(tmp_w, qz), Mul(tmp_z, qw)), Mul(tmp_x, qy)), Mul(tmp_y, qx));
+    }
+
     static GenerateVertexDataResult UpdateRenderData(HParticleContext context, Instance* instance, Emitter* emitter, dmParticleDDF::Emitter* ddf, const ParticleVertexAttributeInfos& attribute_infos, const Vector4& color, uint32_t vertex_index, uint8_t* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* bytes_written, float dt)
     {
         DM_PROFILE(__FUNCTION__);
@@ -1152,7 +1464,6 @@ namespace dmParticle
 
         // calculate emission space
         dmTransform::TransformS1 emission_transform;
-        dmTransform::Transform particle_transform;
         emission_transform.SetIdentity();
         if (ddf->m_Space == EMISSION_SPACE_EMITTER)
         {
@@ -1204,117 +1515,205 @@ namespace dmParticle
                 ddf->m_Pivot.getZ()));
         }
 
-        for (j = 0; j < particle_count && vertex_index + 6 <= max_vertex_count; j++)
+        uint32_t flip_flag = 0;
+        if (hFlip)
+        {
+            flip_flag = 1;
+        }
+        if (vFlip)
+        {
+            flip_flag |= 2;
+        }
+        const int* tex_lookup = &tex_coord_order[flip_flag * 6];
+
+        ParticleBuffer& particles = emitter->m_Particles;
+        uint32_t render_count = GetRenderParticleCount(emitter, vertex_index, max_vertex_count);
+
+        // The particle transforms and quad extents are calculated in batches, four particles at a time,
+        // before the vertices are written according to the vertex attributes.
+        float batch_width[RENDER_BATCH_SIZE];
+        float batch_height[RENDER_BATCH_SIZE];
+        float batch_size[3][RENDER_BATCH_SIZE];
+        uint32_t batch_tile[RENDER_BATCH_SIZE];
+        float batch_translation[3][RENDER_BATCH_SIZE];
+        float batch_x[3][RENDER_BATCH_SIZE];
+        float batch_y[3][RENDER_BATCH_SIZE];
+
+        const Quat emission_rotation = emission_transform.GetRotation();
+        const Vector3 emission_translation = emission_transform.GetTranslation();
+        const dmSIMD::Vec4f emission_scale = dmSIMD::Set1(emission_transform.GetScale());
+        const dmSIMD::Vec4f eqx = dmSIMD::Set1(emission_rotation.getX());
+        const dmSIMD::Vec4f eqy = dmSIMD::Set1(emission_rotation.getY());
+        const dmSIMD::Vec4f eqz = dmSIMD::Set1(emission_rotation.getZ());
+        const dmSIMD::Vec4f eqw = dmSIMD::Set1(emission_rotation.getW());
+        const dmSIMD::Vec4f etx = dmSIMD::Set1(emission_translation.getX());
+        const dmSIMD::Vec4f ety = dmSIMD::Set1(emission_translation.getY());
+        const dmSIMD::Vec4f etz = dmSIMD::Set1(emission_translation.getZ());
+        const dmSIMD::Vec4f pivot_x = dmSIMD::Set1(pivot_transform.GetTranslation().getX());
+        const dmSIMD::Vec4f pivot_y = dmSIMD::Set1(pivot_transform.GetTranslation().getY());
+        const dmSIMD::Vec4f pivot_z = dmSIMD::Set1(pivot_transform.GetTranslation().getZ());
+        const dmSIMD::Vec4f zero = dmSIMD::Zero();
+
+        for (j = 0; j < render_count; j += RENDER_BATCH_SIZE)
         {
-            Particle* particle = &emitter->m_Particles[j];
-            // Evaluate anim frame
-            uint32_t tile = 0;
-            Vector3 size;
-            if (anim_playing)
+            uint32_t batch_count = dmMath::Min(render_count - j, RENDER_BATCH_SIZE);
+            uint32_t batch_lanes = (batch_count + 3) & ~3u;
+
+            for (uint32_t b = 0; b < batch_lanes; ++b)
             {
-                float anim_cursor = particle->GetMaxLifeTime() - particle->GetTimeLeft() - half_dt;
-                float anim_t = 0.0f;
-                if (anim_once) // stretch over particle life
+                if (b >= batch_count)
                 {
-                    anim_t = anim_cursor * particle->GetooMaxLifeTime();
+                    // Padding lanes
+                    batch_width[b] = batch_height[b] = 0.0f;
+                    batch_size[0][b] = batch_size[1][b] = batch_size[2][b] = 0.0f;
+                    continue;
                 }
-                else // use anim FPS
+                Particle particle = particles[j + b];
+                // Evaluate anim frame
+                uint32_t tile = 0;
+                Vector3 size;
+                if (anim_playing)
                 {
-                    anim_t = anim_cursor * inv_anim_length;
-                }
-                tile = (uint32_t)(tile_count * anim_t);
-                tile = tile % tile_count;
-                if (tile >= interval) {
-                    tile = (interval-1) * 2 - tile;
-                }
-                if (anim_bwd)
-                    tile = tile_count - tile - 1;
+                    float anim_cursor = particle.GetMaxLifeTime() - particle.GetTimeLeft() - half_dt;
+                    float anim_t = 0.0f;
+                    if (anim_once) // stretch over particle life
+                    {
+                        anim_t = anim_cursor * particle.GetooMaxLifeTime();
+                    }
+                    else // use anim FPS
+                    {
+                        anim_t = anim_cursor * inv_anim_length;
+                    }
+                    tile = (uint32_t)(tile_count * anim_t);
+                    tile = tile % tile_count;
+                    if (tile >= interval) {
+                        tile = (interval-1) * 2 - tile;
+                    }
+                    if (anim_bwd)
+                        tile = tile_count - tile - 1;
 
-                size = particle->GetScale();
-                if(anim_auto_size)
-                {
-                    const float* td = &tex_dims[(start_tile + tile) << 1];
-                    width_factor = td[0] * 0.5;
-                    height_factor = td[1] * 0.5;
+                    size = particle.GetScale();
+                    if(anim_auto_size)
+                    {
+                        const float* td = &tex_dims[(start_tile + tile) << 1];
+                        width_factor = td[0] * 0.5;
+                        height_factor = td[1] * 0.5;
+                    }
+                    else
+                    {
+                        size *= particle.GetSourceSize();
+                    }
                 }
                 else
                 {
-                    size *= particle->GetSourceSize();
+                    size = particle.GetScale() * particle.GetSourceSize();
                 }
+                batch_tile[b] = tile + start_tile;
+                batch_width[b] = width_factor;
+                batch_height[b] = height_factor;
+                batch_size[0][b] = size.getX();
+                batch_size[1][b] = size.getY();
+                batch_size[2][b] = size.getZ();
             }
-            else
+
+            for (uint32_t b = 0; b < batch_lanes; b += 4)
             {
-                size = particle->GetScale() * particle->GetSourceSize();
+                uint32_t i = j + b;
+                // Particle transform in world space, same as applying the emission transform to the particle transform
+                dmSIMD::Vec4f qx = dmSIMD::Load(particles.Stream(PARTICLE_STREAM_ROTATION_X) + i);
+                dmSIMD::Vec4f qy = dmSIMD::Load(particles.Stream(PARTICLE_STREAM_ROTATION_Y) + i);
+                dmSIMD::Vec4f qz = dmSIMD::Load(particles.Stream(PARTICLE_STREAM_ROTATION_Z) + i);
+                dmSIMD::Vec4f qw = dmSIMD::Load(particles.Stream(PARTICLE_STREAM_ROTATION_W) + i);
+                dmSIMD::Vec4f rx, ry, rz, rw;
+                QuatMul4(eqx, eqy, eqz, eqw, qx, qy, qz, qw, rx, ry, rz, rw);
+
+                dmSIMD::Vec4f sx = dmSIMD::Mul(dmSIMD::Load(batch_size[0] + b), emission_scale);
+                dmSIMD::Vec4f sy = dmSIMD::Mul(dmSIMD::Load(batch_size[1] + b), emission_scale);
+                dmSIMD::Vec4f sz = dmSIMD::Mul(dmSIMD::Load(batch_size[2] + b), emission_scale);
+
+                dmSIMD::Vec4f tx, ty, tz;
+                Rotate4(eqx, eqy, eqz, eqw,
+                        dmSIMD::Mul(dmSIMD::Load(particles.Stream(PARTICLE_STREAM_POSITION_X) + i), emission_scale),
+                        dmSIMD::Mul(dmSIMD::Load(particles.Stream(PARTICLE_STREAM_POSITION_Y) + i), emission_scale),
+                        dmSIMD::Mul(dmSIMD::Load(particles.Stream(PARTICLE_STREAM_POSITION_Z) + i), emission_scale),
+                        tx, ty, tz);
+                tx = dmSIMD::Add(tx, etx);
+                ty = dmSIMD::Add(ty, ety);
+                tz = dmSIMD::Add(tz, etz);
+
+                if (use_pivot)
+                {
+                    dmSIMD::Vec4f px, py, pz;
+                    Rotate4(rx, ry, rz, rw, dmSIMD::Mul(pivot_x, sx), dmSIMD::Mul(pivot_y, sy), dmSIMD::Mul(pivot_z, sz), px, py, pz);
+                    tx = dmSIMD::Add(px, tx);
+                    ty = dmSIMD::Add(py, ty);
+                    tz = dmSIMD::Add(pz, tz);
+                }
+                dmSIMD::Store(batch_translation[0] + b, tx);
+                dmSIMD::Store(batch_translation[1] + b, ty);
+                dmSIMD::Store(batch_translation[2] + b, tz);
+
+                // Quad extents along the local x and y axes
+                dmSIMD::Vec4f x, y, z;
+                Rotate4(rx, ry, rz, rw, dmSIMD::Mul(dmSIMD::Load(batch_width + b), sx), zero, zero, x, y, z);
+                dmSIMD::Store(batch_x[0] + b, x);
+                dmSIMD::Store(batch_x[1] + b, y);
+                dmSIMD::Store(batch_x[2] + b, z);
+                Rotate4(rx, ry, rz, rw, zero, dmSIMD::Mul(dmSIMD::Load(batch_height + b), sy), zero, x, y, z);
+                dmSIMD::Store(batch_y[0] + b, x);
+                dmSIMD::Store(batch_y[1] + b, y);
+                dmSIMD::Store(batch_y[2] + b, z);
             }
-            tile += start_tile;
-            float* tex_coord = &tex_coords[tile << 3];
 
-            particle_transform.SetTranslation(Vector3(particle->GetPosition()));
-            particle_transform.SetRotation(particle->GetRotation());
-            particle_transform.SetScale(size);
-            particle_transform.SetRotation(emission_transform.GetRotation() * particle_transform.GetRotation());
-            particle_transform.SetTranslation(Vector3(Apply(emission_transform, Point3(particle_transform.GetTranslation()))));
-            particle_transform.SetScale(emission_transform.GetScale() * particle_transform.GetScale());
-
-            if (use_pivot)
+            for (uint32_t b = 0; b < batch_count; ++b)
             {
-                particle_transform = dmTransform::Mul(particle_transform, pivot_transform);
-            }
+                Particle particle = particles[j + b];
+                uint32_t tile = batch_tile[b];
+                float* tex_coord = &tex_coords[tile << 3];
 
-            Vector3 x_local = Vector3(width_factor, 0.0f, 0.0f);
-            Vector3 y_local = Vector3(0.0f, height_factor, 0.0f);
+                Vector3 translation(batch_translation[0][b], batch_translation[1][b], batch_translation[2][b]);
+                Vector3 x(batch_x[0][b], batch_x[1][b], batch_x[2][b]);
+                Vector3 y(batch_y[0][b], batch_y[1][b], batch_y[2][b]);
 
-            Vector3 x = dmTransform::Apply(particle_transform, x_local);
-            Vector3 y = dmTransform::Apply(particle_transform, y_local);
+                Vector3 p0 = -x - y + translation;
+                Vector3 p1 = -x + y + translation;
+                Vector3 p2 = x - y + translation;
+                Vector3 p3 = x + y + translation;
 
-            Vector3 p0 = -x - y + particle_transform.GetTranslation();
-            Vector3 p1 = -x + y + particle_transform.GetTranslation();
-            Vector3 p2 = x - y + particle_transform.GetTranslation();
-            Vector3 p3 = x + y + particle_transform.GetTranslation();
+                Vector3 p0_local;
+                Vector3 p1_local;
+                Vector3 p2_local;
+                Vector3 p3_local;
 
-            Vector3 p0_local;
-            Vector3 p1_local;
-            Vector3 p2_local;
-            Vector3 p3_local;
+                if (use_local_position)
+                {
+                    p0_local = -x - y;
+                    p1_local = -x + y;
+                    p2_local = x - y;
+                    p3_local = x + y;
+                }
 
-            if (use_local_position)
-            {
-                p0_local = -x - y;
-                p1_local = -x + y;
-                p2_local = x - y;
-                p3_local = x + y;
-            }
+                Vector4 c = particle.GetColor();
+                c = Vector4(mulPerElem(c.getXYZ(), color.getXYZ()), c.getW() * color.getW());
 
-            uint32_t flip_flag = 0;
-            if (hFlip)
-            {
-                flip_flag = 1;
-            }
-            if (vFlip)
-            {
-                flip_flag |= 2;
-            }
-            const int* tex_lookup = &tex_coord_order[flip_flag * 6];
-
-            Vector4 c = particle->GetColor();
-            c = Vector4(mulPerElem(c.getXYZ(), color.getXYZ()), c.getW() * color.getW());
+                float page_index = 0.0f;
+                if (frame_indices != 0x0)
+                {
+                    uint32_t page_indices_index = frame_indices[tile];
+                    page_index                  = (float) page_indices[page_indices_index];
+                }
 
-            float page_index = 0.0f;
-            if (frame_indices != 0x0)
-            {
-                uint32_t page_indices_index = frame_indices[tile];
-                page_index                  = (float) page_indices[page_indices_index];
+                uint8_t* write_ptr = vertex_buffer + vertex_index * attribute_infos.m_VertexStride;
+                write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p0, p0_local, c, tex_coord + tex_lookup[0] * 2, page_index);
+                write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p1, p1_local, c, tex_coord + tex_lookup[1] * 2, page_index);
+                write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p3, p3_local, c, tex_coord + tex_lookup[2] * 2, page_index);
+                write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p3, p3_local, c, tex_coord + tex_lookup[3] * 2, page_index);
+                write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p2, p2_local, c, tex_coord + tex_lookup[4] * 2, page_index);
+                write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p0, p0_local, c, tex_coord + tex_lookup[5] * 2, page_index);
+                vertex_index += 6;
             }
-
-            uint8_t* write_ptr = vertex_buffer + vertex_index * attribute_infos.m_VertexStride;
-            write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p0, p0_local, c, tex_coord + tex_lookup[0] * 2, page_index);
-            write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p1, p1_local, c, tex_coord + tex_lookup[1] * 2, page_index);
-            write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p3, p3_local, c, tex_coord + tex_lookup[2] * 2, page_index);
-            write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p3, p3_local, c, tex_coord + tex_lookup[3] * 2, page_index);
-            write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p2, p2_local, c, tex_coord + tex_lookup[4] * 2, page_index);
-            write_ptr          = WriteParticleVertex(attribute_infos, write_ptr, p0, p0_local, c, tex_coord + tex_lookup[5] * 2, page_index);
-            vertex_index += 6;
         }
+        j = render_count;
 
         GenerateVertexDataResult res = GENERATE_VERTEX_DATA_OK;
 
@@ -1332,35 +1731,22 @@ namespace dmParticle
         return res;
     }
 
-    struct SortPred
-    {
-        inline bool operator () (const Particle& p1, const Particle& p2)
-        {
-            return p1.GetSortKey().m_Key < p2.GetSortKey().m_Key;
-        }
-
-    };
-
     void GenerateKeys(Emitter* emitter, float max_particle_life_time)
     {
-        dmArray<Particle>& particles = emitter->m_Particles;
+        ParticleBuffer& particles = emitter->m_Particles;
         uint32_t n = particles.Size();
 
         float range = 1.0f / max_particle_life_time;
 
-        Particle* first = particles.Begin();
+        // Key is the quantified relative life time, with the index in the low bits to ensure a stable sort
+        const float* time_left = particles.Stream(PARTICLE_STREAM_TIME_LEFT);
+        uint64_t* keys = particles.SortKeys();
         for (uint32_t i = 0; i < n; ++i)
         {
-            Particle* p = &particles[i];
-            uint32_t index = p - first;
-
-            float life_time = (1.0f - p->GetTimeLeft() * range) * 65535;
+            float life_time = (1.0f - time_left[i] * range) * 65535;
             life_time = dmMath::Clamp(life_time, 0.0f, 65535.0f);
             uint16_t lt = (uint16_t) life_time;
-            SortKey key;
-            key.m_LifeTime = lt;
-            key.m_Index = index;
-            p->SetSortKey(key);
+            keys[i] = ((uint64_t)lt << 32) | i;
         }
     }
 
@@ -1368,7 +1754,25 @@ namespace dmParticle
     {
         DM_PROFILE(__FUNCTION__);
 
-        std::sort(emitter->m_Particles.Begin(), emitter->m_Particles.End(), SortPred());
+        ParticleBuffer& particles = emitter->m_Particles;
+        uint32_t n = particles.Size();
+        uint64_t* keys = particles.SortKeys();
+        if (std::is_sorted(keys, keys + n))
+            return;
+
+        std::sort(keys, keys + n);
+
+        // Gather each stream into the sorted order
+        float* tmp = particles.ScratchStream();
+        for (uint32_t s = 0; s < PARTICLE_STREAM_COUNT; ++s)
+        {
+            float* stream = particles.Stream(s);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                tmp[i] = stream[(uint32_t)keys[i]];
+            }
+            memcpy(stream, tmp, n * sizeof(float));
+        }
     }
 
 #define SAMPLE_PROP(segment, x, target)\
@@ -1387,78 +1791,161 @@ namespace dmParticle
         }
     }
 
+    /*
+     * The kernels below process four particles per iteration and have the same order of
+     * operations as the corresponding vector math, so that the results are identical to
+     * evaluating one particle at a time. The streams are padded to a multiple of four.
+     */
+
+    // Relative life time of four particles, x in SAMPLE_PROP
+    static inline dmSIMD::Vec4f LifeTime4(const ParticleBuffer& particles, uint32_t i)
+    {
+        dmSIMD::Vec4f max_life_time = dmSIMD::Load(particles.Stream(PARTICLE_STREAM_MAX_LIFE_TIME) + i);
+        dmSIMD::Vec4f time_left = dmSIMD::Load(particles.Stream(PARTICLE_STREAM_TIME_LEFT) + i);
+        dmSIMD::Vec4f oo_max_life_time = dmSIMD::Load(particles.Stream(PARTICLE_STREAM_OO_MAX_LIFE_TIME) + i);
+        dmSIMD::Vec4f x = dmSIMD::Sub(dmSIMD::Set1(1.0f), dmSIMD::Mul(time_left, oo_max_life_time));
+        return dmSIMD::Select(dmSIMD::Sub(dmSIMD::Zero(), max_life_time), dmSIMD::Zero(), x);
+    }
+
+    static inline void SegmentIndices4(dmSIMD::Vec4f x, uint32_t segment_index[4])
+    {
+        float lanes[4];
+        dmSIMD::Store(lanes, x);
+        for (uint32_t l = 0; l < 4; ++l)
+        {
+            segment_index[l] = dmMath::Min((uint32_t)(lanes[l] * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
+        }
+    }
+
+    // Same as SAMPLE_PROP for four particles, each in its own segment
+    static inline dmSIMD::Vec4f SampleProperty4(const Property& property, const uint32_t segment_index[4], dmSIMD::Vec4f x)
+    {
+        float segment_x[4];
+        float segment_y[4];
+        float segment_k[4];
+        for (uint32_t l = 0; l < 4; ++l)
+        {
+            const LinearSegment& segment = property.m_Segments[segment_index[l]];
+            segment_x[l] = segment.m_X;
+            segment_y[l] = segment.m_Y;
+            segment_k[l] = segment.m_K;
+        }
+        return dmSIMD::Add(dmSIMD::Mul(dmSIMD::Sub(x, dmSIMD::Load(segment_x)), dmSIMD::Load(segment_k)), dmSIMD::Load(segment_y));
+    }
+
+    static inline dmSIMD::Vec4f LengthSqr4(dmSIMD::Vec4f x, dmSIMD::Vec4f y, dmSIMD::Vec4f z)
+    {
+        return dmSIMD::Add(dmSIMD::Add(dmSIMD::Mul(x, x), dmSIMD::Mul(y, y)), dmSIMD::Mul(z, z));
+    }
+
+    // Same as normalize(Vector3) for four vectors
+    static inline void Normalize4(dmSIMD::Vec4f& x, dmSIMD::Vec4f& y, dmSIMD::Vec4f& z)
+    {
+        dmSIMD::Vec4f len_inv = dmSIMD::Div(dmSIMD::Set1(1.0f), dmSIMD::Sqrt(LengthSqr4(x, y, z)));
+        x = dmSIMD::Mul(x, len_inv);
+        y = dmSIMD::Mul(y, len_inv);
+        z = dmSIMD::Mul(z, len_inv);
+    }
+
     void EvaluateParticleProperties(Emitter* emitter, Property* particle_properties, dmParticleDDF::Emitter* emitter_ddf, float dt)
     {
         float properties[PARTICLE_KEY_COUNT];
-        // TODO Optimize this
-        dmArray<Particle>& particles = emitter->m_Particles;
+        ParticleBuffer& particles = emitter->m_Particles;
         uint32_t count = particles.Size();
-        for (uint32_t i = 0; i < count; ++i)
-        {
-            Particle* particle = &particles[i];
-            float x = dmMath::Select(-particle->GetMaxLifeTime(), 0.0f, 1.0f - particle->GetTimeLeft() * particle->GetooMaxLifeTime());
-            uint32_t segment_index = dmMath::Min((uint32_t)(x * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
-
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_SCALE].m_Segments[segment_index], x, properties[PARTICLE_KEY_SCALE])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_RED].m_Segments[segment_index], x, properties[PARTICLE_KEY_RED])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_GREEN].m_Segments[segment_index], x, properties[PARTICLE_KEY_GREEN])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_BLUE].m_Segments[segment_index], x, properties[PARTICLE_KEY_BLUE])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_ALPHA].m_Segments[segment_index], x, properties[PARTICLE_KEY_ALPHA])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_STRETCH_FACTOR_X].m_Segments[segment_index], x, properties[PARTICLE_KEY_STRETCH_FACTOR_X])
-            SAMPLE_PROP(particle_properties[PARTICLE_KEY_STRETCH_FACTOR_Y].m_Segments[segment_index], x, properties[PARTICLE_KEY_STRETCH_FACTOR_Y])
-            Vector4 c = particle->GetSourceColor();
-            particle->SetScale(Vector3(properties[PARTICLE_KEY_SCALE]));
-            particle->SetColor(Vector4(dmMath::Clamp(c.getX() * properties[PARTICLE_KEY_RED], 0.0f, 1.0f),
-                    dmMath::Clamp(c.getY() * properties[PARTICLE_KEY_GREEN], 0.0f, 1.0f),
-                    dmMath::Clamp(c.getZ() * properties[PARTICLE_KEY_BLUE], 0.0f, 1.0f),
-                    dmMath::Clamp(c.getW() * properties[PARTICLE_KEY_ALPHA], 0.0f, 1.0f)));
-            particle->m_StretchFactorX = particle->m_SourceStretchFactorX + (properties[PARTICLE_KEY_STRETCH_FACTOR_X]);
-            particle->m_StretchFactorY = particle->m_SourceStretchFactorY + (properties[PARTICLE_KEY_STRETCH_FACTOR_Y]);
+
+        const Property& scale_property = particle_properties[PARTICLE_KEY_SCALE];
+        const Property& red_property = particle_properties[PARTICLE_KEY_RED];
+        const Property& green_property = particle_properties[PARTICLE_KEY_GREEN];
+        const Property& blue_property = particle_properties[PARTICLE_KEY_BLUE];
+        const Property& alpha_property = particle_properties[PARTICLE_KEY_ALPHA];
+        const Property& stretch_x_property = particle_properties[PARTICLE_KEY_STRETCH_FACTOR_X];
+        const Property& stretch_y_property = particle_properties[PARTICLE_KEY_STRETCH_FACTOR_Y];
+        float* scale_x = particles.Stream(PARTICLE_STREAM_SCALE_X);
+        float* scale_y = particles.Stream(PARTICLE_STREAM_SCALE_Y);
+        float* scale_z = particles.Stream(PARTICLE_STREAM_SCALE_Z);
+        const float* source_color_r = particles.Stream(PARTICLE_STREAM_SOURCE_COLOR_R);
+        const float* source_color_g = particles.Stream(PARTICLE_STREAM_SOURCE_COLOR_G);
+        const float* source_color_b = particles.Stream(PARTICLE_STREAM_SOURCE_COLOR_B);
+        const float* source_color_a = particles.Stream(PARTICLE_STREAM_SOURCE_COLOR_A);
+        float* color_r = particles.Stream(PARTICLE_STREAM_COLOR_R);
+        float* color_g = particles.Stream(PARTICLE_STREAM_COLOR_G);
+        float* color_b = particles.Stream(PARTICLE_STREAM_COLOR_B);
+        float* color_a = particles.Stream(PARTICLE_STREAM_COLOR_A);
+        const float* source_stretch_x = particles.Stream(PARTICLE_STREAM_SOURCE_STRETCH_FACTOR_X);
+        const float* source_stretch_y = particles.Stream(PARTICLE_STREAM_SOURCE_STRETCH_FACTOR_Y);
+        float* stretch_x = particles.Stream(PARTICLE_STREAM_STRETCH_FACTOR_X);
+        float* stretch_y = particles.Stream(PARTICLE_STREAM_STRETCH_FACTOR_Y);
+
+        const dmSIMD::Vec4f zero = dmSIMD::Zero();
+        const dmSIMD::Vec4f one = dmSIMD::Set1(1.0f);
+        uint32_t segment_index[4];
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            dmSIMD::Vec4f x = LifeTime4(particles, i);
+            SegmentIndices4(x, segment_index);
+
+            dmSIMD::Vec4f scale = SampleProperty4(scale_property, segment_index, x);
+            dmSIMD::Store(scale_x + i, scale);
+            dmSIMD::Store(scale_y + i, scale);
+            dmSIMD::Store(scale_z + i, scale);
+
+            dmSIMD::Vec4f red = dmSIMD::Mul(dmSIMD::Load(source_color_r + i), SampleProperty4(red_property, segment_index, x));
+            dmSIMD::Vec4f green = dmSIMD::Mul(dmSIMD::Load(source_color_g + i), SampleProperty4(green_property, segment_index, x));
+            dmSIMD::Vec4f blue = dmSIMD::Mul(dmSIMD::Load(source_color_b + i), SampleProperty4(blue_property, segment_index, x));
+            dmSIMD::Vec4f alpha = dmSIMD::Mul(dmSIMD::Load(source_color_a + i), SampleProperty4(alpha_property, segment_index, x));
+            dmSIMD::Store(color_r + i, dmSIMD::Min(dmSIMD::Max(red, zero), one));
+            dmSIMD::Store(color_g + i, dmSIMD::Min(dmSIMD::Max(green, zero), one));
+            dmSIMD::Store(color_b + i, dmSIMD::Min(dmSIMD::Max(blue, zero), one));
+            dmSIMD::Store(color_a + i, dmSIMD::Min(dmSIMD::Max(alpha, zero), one));
+
+            dmSIMD::Store(stretch_x + i, dmSIMD::Add(dmSIMD::Load(source_stretch_x + i), SampleProperty4(stretch_x_property, segment_index, x)));
+            dmSIMD::Store(stretch_y + i, dmSIMD::Add(dmSIMD::Load(source_stretch_y + i), SampleProperty4(stretch_y_property, segment_index, x)));
         }
 
         if (emitter_ddf->m_ParticleOrientation == PARTICLE_ORIENTATION_MOVEMENT_DIRECTION) {
             for (uint32_t i = 0; i < count; ++i)
             {
-                Particle* particle = &particles[i];
-                float x = dmMath::Select(-particle->GetMaxLifeTime(), 0.0f, 1.0f - particle->GetTimeLeft() * particle->GetooMaxLifeTime());
+                Particle particle = particles[i];
+                float x = dmMath::Select(-particle.GetMaxLifeTime(), 0.0f, 1.0f - particle.GetTimeLeft() * particle.GetooMaxLifeTime());
                 uint32_t segment_index = dmMath::Min((uint32_t)(x * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
                 SAMPLE_PROP(particle_properties[PARTICLE_KEY_ROTATION].m_Segments[segment_index], x, properties[PARTICLE_KEY_ROTATION])
-                particle->SetRotation(particle->GetSourceRotation() * dmVMath::QuatFromAngle(2, DEG_RAD * properties[PARTICLE_KEY_ROTATION]));
-                if (lengthSqr(particle->m_Velocity) > EPSILON)
+                particle.SetRotation(particle.GetSourceRotation() * dmVMath::QuatFromAngle(2, DEG_RAD * properties[PARTICLE_KEY_ROTATION]));
+                Vector3 velocity = particle.GetVelocity();
+                if (lengthSqr(velocity) > EPSILON)
                 {
-                    Vector3 vel_norm = normalize(particle->m_Velocity);
+                    Vector3 vel_norm = normalize(velocity);
                     float y_dot = dot(Vector3::yAxis(), vel_norm);
                     // Corner case, https://gamedev.stackexchange.com/questions/61672/align-a-rotation-to-a-direction
                     Quat q_vel = (dmMath::Abs(y_dot + 1.0f) > EPSILON) ? Quat::rotation(Vector3::yAxis(), vel_norm) : Quat(0.0, 0.0, 1.0, 0.0);
-                    Quat q = particle->GetRotation() * q_vel;
-                    particle->SetRotation(q);
+                    Quat q = particle.GetRotation() * q_vel;
+                    particle.SetRotation(q);
                 }
             }
 
         } else if (emitter_ddf->m_ParticleOrientation == PARTICLE_ORIENTATION_ANGULAR_VELOCITY) {
             for (uint32_t i = 0; i < count; ++i)
             {
-                Particle* particle = &particles[i];
-                float x = dmMath::Select(-particle->GetMaxLifeTime(), 0.0f, 1.0f - particle->GetTimeLeft() * particle->GetooMaxLifeTime());
+                Particle particle = particles[i];
+                float x = dmMath::Select(-particle.GetMaxLifeTime(), 0.0f, 1.0f - particle.GetTimeLeft() * particle.GetooMaxLifeTime());
                 uint32_t segment_index = dmMath::Min((uint32_t)(x * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
                 SAMPLE_PROP(particle_properties[PARTICLE_KEY_ANGULAR_VELOCITY].m_Segments[segment_index], x, properties[PARTICLE_KEY_ANGULAR_VELOCITY])
-                particle->SetRotation(particle->GetRotation() * Quat::rotationZ(DEG_RAD * (particle->m_SourceAngularVelocity * (properties[PARTICLE_KEY_ANGULAR_VELOCITY])) * dt));
+                particle.SetRotation(particle.GetRotation() * Quat::rotationZ(DEG_RAD * (particle.GetSourceAngularVelocity() * (properties[PARTICLE_KEY_ANGULAR_VELOCITY])) * dt));
             }
 
         } else {
             for (uint32_t i = 0; i < count; ++i)
             {
-                Particle* particle = &particles[i];
-                float x = dmMath::Select(-particle->GetMaxLifeTime(), 0.0f, 1.0f - particle->GetTimeLeft() * particle->GetooMaxLifeTime());
+                Particle particle = particles[i];
+                float x = dmMath::Select(-particle.GetMaxLifeTime(), 0.0f, 1.0f - particle.GetTimeLeft() * particle.GetooMaxLifeTime());
                 uint32_t segment_index = dmMath::Min((uint32_t)(x * PROPERTY_SAMPLE_COUNT), PROPERTY_SAMPLE_COUNT - 1);
                 SAMPLE_PROP(particle_properties[PARTICLE_KEY_ROTATION].m_Segments[segment_index], x, properties[PARTICLE_KEY_ROTATION])
-                particle->SetRotation(particle->GetSourceRotation() * dmVMath::QuatFromAngle(2, DEG_RAD * properties[PARTICLE_KEY_ROTATION]));
+                particle.SetRotation(particle.GetSourceRotation() * dmVMath::QuatFromAngle(2, DEG_RAD * properties[PARTICLE_KEY_ROTATION]));
             }
         }
 
     }
 
-    void ApplyAcceleration(dmArray<Particle>& particles, Property* modifier_properties, const Quat& rotation, float scale, float emitter_t, float dt)
+    void ApplyAcceleration(ParticleBuffer& particles, Property* modifier_properties, const Quat& rotation, float scale, float emitter_t, float dt)
     {
         uint32_t particle_count = particles.Size();
         Vector3 acc_step = rotate(rotation, ACCELERATION_LOCAL_DIR) * dt * scale;
@@ -1467,14 +1954,26 @@ namespace dmParticle
         float magnitude;
         SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
         float mag_spread = magnitude_property.m_Spread;
-        for (uint32_t i = 0; i < particle_count; ++i)
+
+        const float* spread_factor = particles.Stream(PARTICLE_STREAM_SPREAD_FACTOR);
+        float* velocity_x = particles.Stream(PARTICLE_STREAM_VELOCITY_X);
+        float* velocity_y = particles.Stream(PARTICLE_STREAM_VELOCITY_Y);
+        float* velocity_z = particles.Stream(PARTICLE_STREAM_VELOCITY_Z);
+        const dmSIMD::Vec4f acc_x = dmSIMD::Set1(acc_step.getX());
+        const dmSIMD::Vec4f acc_y = dmSIMD::Set1(acc_step.getY());
+        const dmSIMD::Vec4f acc_z = dmSIMD::Set1(acc_step.getZ());
+        const dmSIMD::Vec4f magnitude4 = dmSIMD::Set1(magnitude);
+        const dmSIMD::Vec4f mag_spread4 = dmSIMD::Set1(mag_spread);
+        for (uint32_t i = 0; i < particle_count; i += 4)
         {
-            Particle* particle = &particles[i];
-            particle->SetVelocity(particle->GetVelocity() + acc_step * (magnitude + mag_spread * particle->GetSpreadFactor()));
+            dmSIMD::Vec4f applied_magnitude = dmSIMD::Add(magnitude4, dmSIMD::Mul(mag_spread4, dmSIMD::Load(spread_factor + i)));
+            dmSIMD::Store(velocity_x + i, dmSIMD::Add(dmSIMD::Load(velocity_x + i), dmSIMD::Mul(acc_x, applied_magnitude)));
+            dmSIMD::Store(velocity_y + i, dmSIMD::Add(dmSIMD::Load(velocity_y + i), dmSIMD::Mul(acc_y, applied_magnitude)));
+            dmSIMD::Store(velocity_z + i, dmSIMD::Add(dmSIMD::Load(velocity_z + i), dmSIMD::Mul(acc_z, applied_magnitude)));
         }
     }
 
-    void ApplyDrag(dmArray<Particle>& particles, Property* modifier_properties, dmParticleDDF::Modifier* modifier_ddf, const Quat& rotation, float emitter_t, float dt)
+    void ApplyDrag(ParticleBuffer& particles, Property* modifier_properties, dmParticleDDF::Modifier* modifier_ddf, const Quat& rotation, float emitter_t, float dt)
     {
         uint32_t particle_count = particles.Size();
         Vector3 direction = rotate(rotation, DRAG_LOCAL_DIR);
@@ -1483,34 +1982,49 @@ namespace dmParticle
         float magnitude;
         SAMPLE_PROP(magnitude_property.m_Segments[segment_index], emitter_t, magnitude)
         float mag_spread = magnitude_property.m_Spread;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            Vector3 v = particle->GetVelocity();
-            if (modifier_ddf->m_UseDirection)
-                v = projection(Point3(particle->GetVelocity()), direction) * direction;
+
+        const float* spread_factor = particles.Stream(PARTICLE_STREAM_SPREAD_FACTOR);
+        float* velocity_x = particles.Stream(PARTICLE_STREAM_VELOCITY_X);
+        float* velocity_y = particles.Stream(PARTICLE_STREAM_VELOCITY_Y);
+        float* velocity_z = particles.Stream(PARTICLE_STREAM_VELOCITY_Z);
+        const dmSIMD::Vec4f dir_x = dmSIMD::Set1(direction.getX());
+        const dmSIMD::Vec4f dir_y = dmSIMD::Set1(direction.getY());
+        const dmSIMD::Vec4f dir_z = dmSIMD::Set1(direction.getZ());
+        const dmSIMD::Vec4f magnitude4 = dmSIMD::Set1(magnitude);
+        const dmSIMD::Vec4f mag_spread4 = dmSIMD::Set1(mag_spread);
+        const dmSIMD::Vec4f dt4 = dmSIMD::Set1(dt);
+        const dmSIMD::Vec4f one = dmSIMD::Set1(1.0f);
+        bool use_direction = modifier_ddf->m_UseDirection != 0;
+        for (uint32_t i = 0; i < particle_count; i += 4)
+        {
+            dmSIMD::Vec4f vx = dmSIMD::Load(velocity_x + i);
+            dmSIMD::Vec4f vy = dmSIMD::Load(velocity_y + i);
+            dmSIMD::Vec4f vz = dmSIMD::Load(velocity_z + i);
+            dmSIMD::Vec4f dx = vx;
+            dmSIMD::Vec4f dy = vy;
+            dmSIMD::Vec4f dz = vz;
+            if (use_direction)
+            {
+                dmSIMD::Vec4f projection = dmSIMD::Add(dmSIMD::Add(dmSIMD::Mul(vx, dir_x), dmSIMD::Mul(vy, dir_y)), dmSIMD::Mul(vz, dir_z));
+                dx = dmSIMD::Mul(dir_x, projection);
+                dy = dmSIMD::Mul(dir_y, projection);
+                dz = dmSIMD::Mul(dir_z, projection);
+            }
             // Applied drag > 1 means the particle would travel in the reverse direction
-            float applied_drag = dmMath::Min((magnitude + mag_spread * particle->GetSpreadFactor()) * dt, 1.0f);
-            particle->SetVelocity(particle->GetVelocity() - v * applied_drag);
+            dmSIMD::Vec4f applied_magnitude = dmSIMD::Add(magnitude4, dmSIMD::Mul(mag_spread4, dmSIMD::Load(spread_factor + i)));
+            dmSIMD::Vec4f applied_drag = dmSIMD::Min(dmSIMD::Mul(applied_magnitude, dt4), one);
+            dmSIMD::Store(velocity_x + i, dmSIMD::Sub(vx, dmSIMD::Mul(dx, applied_drag)));
+            dmSIMD::Store(velocity_y + i, dmSIMD::Sub(vy, dmSIMD::Mul(dy, applied_drag)));
+            dmSIMD::Store(velocity_z + i, dmSIMD::Sub(vz, dmSIMD::Mul(dz, applied_drag)));
         }
     }
 
-    static Vector3 GetParticleDir(Particle* particle)
+    static Vector3 GetParticleDir(const Particle& particle)
     {
-        return rotate(particle->GetRotation(), PARTICLE_LOCAL_BASE_DIR);
+        return rotate(particle.GetRotation(), PARTICLE_LOCAL_BASE_DIR);
     }
 
-    static Vector3 NonZeroVector3(Vector3 v, float sq_length, Vector3 fallback)
-    {
-        Vector3 result;
-        float neg_sq_length = -sq_length;
-        result.setX(dmMath::Select(neg_sq_length, fallback.getX(), v.getX()));
-        result.setY(dmMath::Select(neg_sq_length, fallback.getY(), v.getY()));
-        result.setZ(dmMath::Select(neg_sq_length, fallback.getZ(), v.getZ()));
-        return result;
-    }
-
-    void ApplyRadial(dmArray<Particle>& particles, Property* modifier_properties, const Point3& position, float scale, float emitter_t, float dt)
+    void ApplyRadial(ParticleBuffer& particles, Property* modifier_properties, const Point3& position, float scale, float emitter_t, float dt)
     {
         uint32_t particle_count = particles.Size();
         const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
@@ -1523,20 +2037,63 @@ namespace dmParticle
         float max_distance = max_distance_property.m_Segments[0].m_Y * scale;
         float max_sq_distance = max_distance * max_distance;
         float applied_factor = dt * scale;
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* particle = &particles[i];
-            Vector3 delta = particle->GetPosition() - position;
-            float delta_sq_len = lengthSqr(delta);
-            float applied_magnitude = magnitude + mag_spread * particle->GetSpreadFactor();
+
+        const float* position_x = particles.Stream(PARTICLE_STREAM_POSITION_X);
+        const float* position_y = particles.Stream(PARTICLE_STREAM_POSITION_Y);
+        const float* position_z = particles.Stream(PARTICLE_STREAM_POSITION_Z);
+        const float* spread_factor = particles.Stream(PARTICLE_STREAM_SPREAD_FACTOR);
+        float* velocity_x = particles.Stream(PARTICLE_STREAM_VELOCITY_X);
+        float* velocity_y = particles.Stream(PARTICLE_STREAM_VELOCITY_Y);
+        float* velocity_z = particles.Stream(PARTICLE_STREAM_VELOCITY_Z);
+        const dmSIMD::Vec4f origin_x = dmSIMD::Set1(position.getX());
+        const dmSIMD::Vec4f origin_y = dmSIMD::Set1(position.getY());
+        const dmSIMD::Vec4f origin_z = dmSIMD::Set1(position.getZ());
+        const dmSIMD::Vec4f magnitude4 = dmSIMD::Set1(magnitude);
+        const dmSIMD::Vec4f mag_spread4 = dmSIMD::Set1(mag_spread);
+        const dmSIMD::Vec4f max_sq_distance4 = dmSIMD::Set1(max_sq_distance);
+        const dmSIMD::Vec4f applied_factor4 = dmSIMD::Set1(applied_factor);
+        const dmSIMD::Vec4f zero = dmSIMD::Zero();
+        for (uint32_t i = 0; i < particle_count; i += 4)
+        {
+            dmSIMD::Vec4f delta_x = dmSIMD::Sub(dmSIMD::Load(position_x + i), origin_x);
+            dmSIMD::Vec4f delta_y = dmSIMD::Sub(dmSIMD::Load(position_y + i), origin_y);
+            dmSIMD::Vec4f delta_z = dmSIMD::Sub(dmSIMD::Load(position_z + i), origin_z);
+            dmSIMD::Vec4f delta_sq_len = LengthSqr4(delta_x, delta_y, delta_z);
+            dmSIMD::Vec4f applied_magnitude = dmSIMD::Add(magnitude4, dmSIMD::Mul(mag_spread4, dmSIMD::Load(spread_factor + i)));
             // 0 acc delta lies outside max dist
-            float a = dmMath::Select(max_sq_distance - delta_sq_len, applied_magnitude, 0.0f);
-            Vector3 dir = normalize(NonZeroVector3(delta, delta_sq_len, GetParticleDir(particle)));
-            particle->SetVelocity(particle->GetVelocity() + dir * a * applied_factor);
+            dmSIMD::Vec4f a = dmSIMD::Select(dmSIMD::Sub(max_sq_distance4, delta_sq_len), applied_magnitude, zero);
+
+            // Particles at the modifier position are pushed along their own direction
+            uint32_t non_zero_mask = dmSIMD::MaskLessThan(zero, delta_sq_len);
+            if (non_zero_mask != 0xf)
+            {
+                float dx[4], dy[4], dz[4];
+                dmSIMD::Store(dx, delta_x);
+                dmSIMD::Store(dy, delta_y);
+                dmSIMD::Store(dz, delta_z);
+                for (uint32_t l = 0; l < 4 && i + l < particle_count; ++l)
+                {
+                    if ((non_zero_mask & (1 << l)) == 0)
+                    {
+                        Vector3 dir = GetParticleDir(particles[i + l]);
+                        dx[l] = dir.getX();
+                        dy[l] = dir.getY();
+                        dz[l] = dir.getZ();
+                    }
+                }
+                delta_x = dmSIMD::Load(dx);
+                delta_y = dmSIMD::Load(dy);
+                delta_z = dmSIMD::Load(dz);
+            }
+            Normalize4(delta_x, delta_y, delta_z);
+
+            dmSIMD::Store(velocity_x + i, dmSIMD::Add(dmSIMD::Load(velocity_x + i), dmSIMD::Mul(dmSIMD::Mul(delta_x, a), applied_factor4)));
+            dmSIMD::Store(velocity_y + i, dmSIMD::Add(dmSIMD::Load(velocity_y + i), dmSIMD::Mul(dmSIMD::Mul(delta_y, a), applied_factor4)));
+            dmSIMD::Store(velocity_z + i, dmSIMD::Add(dmSIMD::Load(velocity_z + i), dmSIMD::Mul(dmSIMD::Mul(delta_z, a), applied_factor4)));
         }
     }
 
-    void ApplyVortex(dmArray<Particle>& particles, Property* modifier_properties, const Point3& position, const Quat& rotation, float scale, float emitter_t, float dt)
+    void ApplyVortex(ParticleBuffer& particles, Property* modifier_properties, const Point3& position, const Quat& rotation, float scale, float emitter_t, float dt)
     {
         uint32_t particle_count = particles.Size();
         const Property& magnitude_property = modifier_properties[MODIFIER_KEY_MAGNITUDE];
@@ -1551,23 +2108,57 @@ namespace dmParticle
         Vector3 axis = rotate(rotation, VORTEX_LOCAL_AXIS);
         Vector3 start = rotate(rotation, VORTEX_LOCAL_START_DIR);
         float applied_factor = dt * scale;
-        for (uint32_t i = 0; i < particle_count; ++i)
+
+        const float* position_x = particles.Stream(PARTICLE_STREAM_POSITION_X);
+        const float* position_y = particles.Stream(PARTICLE_STREAM_POSITION_Y);
+        const float* position_z = particles.Stream(PARTICLE_STREAM_POSITION_Z);
+        const float* spread_factor = particles.Stream(PARTICLE_STREAM_SPREAD_FACTOR);
+        float* velocity_x = particles.Stream(PARTICLE_STREAM_VELOCITY_X);
+        float* velocity_y = particles.Stream(PARTICLE_STREAM_VELOCITY_Y);
+        float* velocity_z = particles.Stream(PARTICLE_STREAM_VELOCITY_Z);
+        const dmSIMD::Vec4f origin_x = dmSIMD::Set1(position.getX());
+        const dmSIMD::Vec4f origin_y = dmSIMD::Set1(position.getY());
+        const dmSIMD::Vec4f origin_z = dmSIMD::Set1(position.getZ());
+        const dmSIMD::Vec4f axis_x = dmSIMD::Set1(axis.getX());
+        const dmSIMD::Vec4f axis_y = dmSIMD::Set1(axis.getY());
+        const dmSIMD::Vec4f axis_z = dmSIMD::Set1(axis.getZ());
+        const dmSIMD::Vec4f start_x = dmSIMD::Set1(start.getX());
+        const dmSIMD::Vec4f start_y = dmSIMD::Set1(start.getY());
+        const dmSIMD::Vec4f start_z = dmSIMD::Set1(start.getZ());
+        const dmSIMD::Vec4f magnitude4 = dmSIMD::Set1(magnitude);
+        const dmSIMD::Vec4f mag_spread4 = dmSIMD::Set1(mag_spread);
+        const dmSIMD::Vec4f max_sq_distance4 = dmSIMD::Set1(max_sq_distance);
+        const dmSIMD::Vec4f applied_factor4 = dmSIMD::Set1(applied_factor);
+        const dmSIMD::Vec4f zero = dmSIMD::Zero();
+        for (uint32_t i = 0; i < particle_count; i += 4)
         {
-            Particle* particle = &particles[i];
             // delta from vortex position
-            Vector3 delta = particle->GetPosition() - position;
+            dmSIMD::Vec4f delta_x = dmSIMD::Sub(dmSIMD::Load(position_x + i), origin_x);
+            dmSIMD::Vec4f delta_y = dmSIMD::Sub(dmSIMD::Load(position_y + i), origin_y);
+            dmSIMD::Vec4f delta_z = dmSIMD::Sub(dmSIMD::Load(position_z + i), origin_z);
             // normal from vortex axis (non-unit)
-            Vector3 normal = delta - projection(Point3(delta), axis) * axis;
+            dmSIMD::Vec4f projection = dmSIMD::Add(dmSIMD::Add(dmSIMD::Mul(delta_x, axis_x), dmSIMD::Mul(delta_y, axis_y)), dmSIMD::Mul(delta_z, axis_z));
+            dmSIMD::Vec4f normal_x = dmSIMD::Sub(delta_x, dmSIMD::Mul(axis_x, projection));
+            dmSIMD::Vec4f normal_y = dmSIMD::Sub(delta_y, dmSIMD::Mul(axis_y, projection));
+            dmSIMD::Vec4f normal_z = dmSIMD::Sub(delta_z, dmSIMD::Mul(axis_z, projection));
             // tangent is the direction of the vortex acceleration
-            Vector3 tangent = cross(axis, normal);
+            dmSIMD::Vec4f tangent_x = dmSIMD::Sub(dmSIMD::Mul(axis_y, normal_z), dmSIMD::Mul(axis_z, normal_y));
+            dmSIMD::Vec4f tangent_y = dmSIMD::Sub(dmSIMD::Mul(axis_z, normal_x), dmSIMD::Mul(axis_x, normal_z));
+            dmSIMD::Vec4f tangent_z = dmSIMD::Sub(dmSIMD::Mul(axis_x, normal_y), dmSIMD::Mul(axis_y, normal_x));
             // In case the particle is directed along the axis, give it a guaranteed orthogonal start
-            tangent = NonZeroVector3(tangent, lengthSqr(tangent), start);
+            dmSIMD::Vec4f neg_tangent_sq_len = dmSIMD::Sub(zero, LengthSqr4(tangent_x, tangent_y, tangent_z));
+            tangent_x = dmSIMD::Select(neg_tangent_sq_len, start_x, tangent_x);
+            tangent_y = dmSIMD::Select(neg_tangent_sq_len, start_y, tangent_y);
+            tangent_z = dmSIMD::Select(neg_tangent_sq_len, start_z, tangent_z);
             // tangent is now guaranteed to be non-zero
-            tangent = normalize(tangent);
+            Normalize4(tangent_x, tangent_y, tangent_z);
             // use normal for max distance test
-            float normal_sq_len = lengthSqr(normal);
-            float acceleration = dmMath::Select(max_sq_distance - normal_sq_len, magnitude + mag_spread * particle->GetSpreadFactor(), 0.0f);
-            particle->SetVelocity(particle->GetVelocity() + tangent * acceleration * applied_factor);
+            dmSIMD::Vec4f normal_sq_len = LengthSqr4(normal_x, normal_y, normal_z);
+            dmSIMD::Vec4f applied_magnitude = dmSIMD::Add(magnitude4, dmSIMD::Mul(mag_spread4, dmSIMD::Load(spread_factor + i)));
+            dmSIMD::Vec4f acceleration = dmSIMD::Select(dmSIMD::Sub(max_sq_distance4, normal_sq_len), applied_magnitude, zero);
+            dmSIMD::Store(velocity_x + i, dmSIMD::Add(dmSIMD::Load(velocity_x + i), dmSIMD::Mul(dmSIMD::Mul(tangent_x, acceleration), applied_factor4)));
+            dmSIMD::Store(velocity_y + i, dmSIMD::Add(dmSIMD::Load(velocity_y + i), dmSIMD::Mul(dmSIMD::Mul(tangent_y, acceleration), applied_factor4)));
+            dmSIMD::Store(velocity_z + i, dmSIMD::Add(dmSIMD::Load(velocity_z + i), dmSIMD::Mul(dmSIMD::Mul(tangent_z, acceleration), applied_factor4)));
         }
     }
 
@@ -1596,7 +2187,7 @@ namespace dmParticle
     {
         DM_PROFILE(__FUNCTION__);
 
-        dmArray<Particle>& particles = emitter->m_Particles;
+        ParticleBuffer& particles = emitter->m_Particles;
         EvaluateParticleProperties(emitter, prototype->m_ParticleProperties, ddf, dt);
         float emitter_t = dmMath::Select(-ddf->m_Duration, 0.0f, emitter->m_Timer / ddf->m_Duration);
         float scale = 1.0f;
@@ -1638,18 +2229,37 @@ namespace dmParticle
             }
         }
         uint32_t particle_count = particles.Size();
-        for (uint32_t i = 0; i < particle_count; ++i)
-        {
-            Particle* p = &particles[i];
+        float* position_x = particles.Stream(PARTICLE_STREAM_POSITION_X);
+        float* position_y = particles.Stream(PARTICLE_STREAM_POSITION_Y);
+        float* position_z = particles.Stream(PARTICLE_STREAM_POSITION_Z);
+        const float* velocity_x = particles.Stream(PARTICLE_STREAM_VELOCITY_X);
+        const float* velocity_y = particles.Stream(PARTICLE_STREAM_VELOCITY_Y);
+        const float* velocity_z = particles.Stream(PARTICLE_STREAM_VELOCITY_Z);
+        float* scale_x = particles.Stream(PARTICLE_STREAM_SCALE_X);
+        float* scale_y = particles.Stream(PARTICLE_STREAM_SCALE_Y);
+        const float* stretch_x = particles.Stream(PARTICLE_STREAM_STRETCH_FACTOR_X);
+        const float* stretch_y = particles.Stream(PARTICLE_STREAM_STRETCH_FACTOR_Y);
+        const dmSIMD::Vec4f dt4 = dmSIMD::Set1(dt);
+        const dmSIMD::Vec4f stretch_scaling = dmSIMD::Set1(STRETCH_SCALING);
+        bool stretch_with_velocity = ddf->m_StretchWithVelocity != 0;
+        for (uint32_t i = 0; i < particle_count; i += 4)
+        {
+            dmSIMD::Vec4f vx = dmSIMD::Load(velocity_x + i);
+            dmSIMD::Vec4f vy = dmSIMD::Load(velocity_y + i);
+            dmSIMD::Vec4f vz = dmSIMD::Load(velocity_z + i);
             // NOTE This velocity integration has a larger error than normal since we don't use the velocity at the
             // beginning of the frame, but it's ok since particle movement does not need to be very exact
-            p->SetPosition(p->GetPosition() + p->m_Velocity * dt);
-
-            p->m_Scale[0] += p->m_Scale[0] * p->m_StretchFactorX;
-            if (!ddf->m_StretchWithVelocity)
-                p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY;
-            else
-                p->m_Scale[1] += p->m_Scale[1] * p->m_StretchFactorY * length(p->m_Velocity) * STRETCH_SCALING;
+            dmSIMD::Store(position_x + i, dmSIMD::Add(dmSIMD::Load(position_x + i), dmSIMD::Mul(vx, dt4)));
+            dmSIMD::Store(position_y + i, dmSIMD::Add(dmSIMD::Load(position_y + i), dmSIMD::Mul(vy, dt4)));
+            dmSIMD::Store(position_z + i, dmSIMD::Add(dmSIMD::Load(position_z + i), dmSIMD::Mul(vz, dt4)));
+
+            dmSIMD::Vec4f sx = dmSIMD::Load(scale_x + i);
+            dmSIMD::Store(scale_x + i, dmSIMD::Add(sx, dmSIMD::Mul(sx, dmSIMD::Load(stretch_x + i))));
+            dmSIMD::Vec4f sy = dmSIMD::Load(scale_y + i);
+            dmSIMD::Vec4f stretch = dmSIMD::Mul(sy, dmSIMD::Load(stretch_y + i));
+            if (stretch_with_velocity)
+                stretch = dmSIMD::Mul(dmSIMD::Mul(stretch, dmSIMD::Sqrt(LengthSqr4(vx, vy, vz))), stretch_scaling);
+            dmSIMD::Store(scale_y + i, dmSIMD::Add(sy, stretch));
         }
     }
 
@@ -18,6 +18,7 @@
 #include <dmsdk/dlib/vmath.h>
 #include <dlib/configfile.h>
 #include <dlib/hash.h>
+#include <dlib/job_system.h>
 #include <ddf/ddf.h>
 #include <graphics/graphics.h>
 #include "particle/particle_ddf.h"
@@ -65,6 +66,11 @@ namespace dmParticle
     extern const char* MAX_EMITTER_COUNT_KEY;
     /// Config key to use for tweaking the total maximum number of particles in a context.
     extern const char* MAX_PARTICLE_COUNT_KEY;
+    /// Config key to use for tweaking the min number of particles in a context for the emitters to be processed on the job threads.
+    extern const char* JOB_MIN_PARTICLE_COUNT_KEY;
+
+    /// Default min number of particles in a context for the emitters to be processed on the job threads (0 disables)
+    static const uint32_t DEFAULT_JOB_MIN_PARTICLE_COUNT = 0;
 
     /**
      * Render constants supplied to the render callback.
@@ -182,6 +188,19 @@ namespace dmParticle
         uint32_t                     m_MixedHashNoMaterial;
     };
 
+    /**
+     * Vertex data to generate for one emitter, see GenerateVertexDataBatch
+     */
+    struct GenerateVertexDataParams
+    {
+        ParticleVertexAttributeInfos m_AttributeInfos;
+        dmVMath::Vector4             m_Color;
+        HInstance                    m_Instance;
+        uint32_t                     m_EmitterIndex;
+        /// Set by GenerateVertexDataBatch
+        GenerateVertexDataResult     m_Result;
+    };
+
     /**
     * Callback for emitter state changed
     */
@@ -238,6 +257,27 @@ namespace dmParticle
     // For tests
     dmVMath::Vector3 GetPosition(HParticleContext context, HInstance instance);
 
+    /**
+     * Set the job system used to update the emitters and generate their vertex data in parallel.
+     * @param context Particle context
+     * @param job_system Job system, or 0x0 to only use the calling thread
+     * @param min_particle_count Min number of particles in the context to use the job workers. 0 disables parallel processing.
+     */
+    void SetJobSystem(HParticleContext context, dmJobSystem::HJobSystem job_system, uint32_t min_particle_count);
+
+    /**
+     * Generates vertex data for several emitters, with the same result as calling GenerateVertexData for each of them in order.
+     * The vertex range of each emitter is calculated first, so the emitters can write their vertices on the job threads.
+     * @param context Particle context
+     * @param dt Time step.
+     * @param params Emitters to generate vertex data for. The result of each emitter is stored in GenerateVertexDataParams::m_Result.
+     * @param params_count Number of emitters
+     * @param vertex_buffer Vertex buffer into which to store the particle vertex data. If this is 0x0, no data will be generated.
+     * @param vertex_buffer_size Size in bytes of the supplied vertex buffer.
+     * @param out_vertex_buffer_size Size in bytes of the total data written to vertex buffer.
+     */
+    void GenerateVertexDataBatch(HParticleContext context, float dt, GenerateVertexDataParams* params, uint32_t params_count, void* vertex_buffer, uint32_t vertex_buffer_size, uint32_t* out_vertex_buffer_size);
+
 #define DM_PARTICLE_PROTO(ret, name,  ...) \
     \
     ret name(__VA_ARGS__);\
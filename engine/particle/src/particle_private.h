@@ -16,8 +16,10 @@
 #ifndef DM_PARTICLE_PRIVATE_H
 #define DM_PARTICLE_PRIVATE_H
 
+#include <assert.h>
 #include <dlib/configfile.h>
 #include <dlib/index_pool.h>
+#include <dlib/job_system.h>
 #include <dlib/transform.h>
 
 #include "particle/particle_ddf.h"
@@ -31,78 +33,187 @@ namespace dmParticle
     struct Prototype;
 
     /**
-     * Key when sorting particles, based on life time with additional index for stable sort
+     * Streams of particle data. Each stream holds one float component of the particle state
+     * for all particles in an emitter (structure-of-arrays).
      */
-    union SortKey
+    enum ParticleStream
     {
-        struct
-        {
-            uint32_t m_Index : 16;  // Index is used to ensure stable sort
-            uint32_t m_LifeTime : 16; // Quantified relative life time
-        };
-        uint32_t     m_Key;
+        /// Position, which is defined in emitter space or world space depending on how the emitter which spawned the particles is tweaked.
+        PARTICLE_STREAM_POSITION_X,
+        PARTICLE_STREAM_POSITION_Y,
+        PARTICLE_STREAM_POSITION_Z,
+        /// Velocity of the particle
+        PARTICLE_STREAM_VELOCITY_X,
+        PARTICLE_STREAM_VELOCITY_Y,
+        PARTICLE_STREAM_VELOCITY_Z,
+        /// Particle scale
+        PARTICLE_STREAM_SCALE_X,
+        PARTICLE_STREAM_SCALE_Y,
+        PARTICLE_STREAM_SCALE_Z,
+        /// Rotation, which is defined in emitter space or world space depending on how the emitter which spawned the particles is tweaked.
+        PARTICLE_STREAM_SOURCE_ROTATION_X,
+        PARTICLE_STREAM_SOURCE_ROTATION_Y,
+        PARTICLE_STREAM_SOURCE_ROTATION_Z,
+        PARTICLE_STREAM_SOURCE_ROTATION_W,
+        PARTICLE_STREAM_ROTATION_X,
+        PARTICLE_STREAM_ROTATION_Y,
+        PARTICLE_STREAM_ROTATION_Z,
+        PARTICLE_STREAM_ROTATION_W,
+        /// Particle color
+        PARTICLE_STREAM_SOURCE_COLOR_R,
+        PARTICLE_STREAM_SOURCE_COLOR_G,
+        PARTICLE_STREAM_SOURCE_COLOR_B,
+        PARTICLE_STREAM_SOURCE_COLOR_A,
+        PARTICLE_STREAM_COLOR_R,
+        PARTICLE_STREAM_COLOR_G,
+        PARTICLE_STREAM_COLOR_B,
+        PARTICLE_STREAM_COLOR_A,
+        /// Time left before the particle dies.
+        PARTICLE_STREAM_TIME_LEFT,
+        /// The duration of this particle.
+        PARTICLE_STREAM_MAX_LIFE_TIME,
+        /// Inverted duration.
+        PARTICLE_STREAM_OO_MAX_LIFE_TIME,
+        /// Factor used for spread
+        PARTICLE_STREAM_SPREAD_FACTOR,
+        /// Particle source size
+        PARTICLE_STREAM_SOURCE_SIZE,
+        /// Particle stretch factor
+        PARTICLE_STREAM_SOURCE_STRETCH_FACTOR_X,
+        PARTICLE_STREAM_SOURCE_STRETCH_FACTOR_Y,
+        PARTICLE_STREAM_STRETCH_FACTOR_X,
+        PARTICLE_STREAM_STRETCH_FACTOR_Y,
+        /// Particle angular velocity
+        PARTICLE_STREAM_SOURCE_ANGULAR_VELOCITY,
+        PARTICLE_STREAM_COUNT
+    };
+
+    struct Particle;
+
+    /**
+     * Buffer of particles stored as one stream per ParticleStream.
+     *
+     * The stride of the streams is the capacity rounded up to a multiple of four, which lets the
+     * simulation kernels process whole groups of four particles. Lanes past the size hold stale data.
+     * Behind the particle streams there is scratch space for the sort keys and a temporary stream used when sorting.
+     *
+     * The buffer is part of the Emitter which is memset and memcpy'd, so it has no constructor or destructor.
+     * A zeroed buffer is empty and the memory has to be released explicitly with SetCapacity(0).
+     */
+    struct ParticleBuffer
+    {
+        inline float* Stream(uint32_t stream)               { return m_Data + stream * m_Stride; }
+        inline const float* Stream(uint32_t stream) const   { return m_Data + stream * m_Stride; }
+        /// Scratch space for one 64 bit sort key per particle
+        inline uint64_t* SortKeys()                         { return (uint64_t*)Stream(PARTICLE_STREAM_COUNT); }
+        /// Scratch stream used when gathering the streams into sorted order
+        inline float* ScratchStream()                       { return Stream(PARTICLE_STREAM_COUNT + 2); }
+
+        inline uint32_t Size() const                        { return m_Size; }
+        inline uint32_t Capacity() const                    { return m_Capacity; }
+        inline uint32_t Remaining() const                   { return m_Capacity - m_Size; }
+        inline bool Empty() const                           { return m_Size == 0; }
+        inline bool Full() const                            { return m_Size == m_Capacity; }
+        inline Particle operator[](uint32_t i);
+
+        /// Set the capacity, keeping the particles that still fit. A capacity of 0 releases the memory.
+        void SetCapacity(uint32_t capacity);
+        void SetSize(uint32_t size);
+        /// Add a zeroed particle and return its index
+        uint32_t Push();
+        /// Remove a particle by moving the last particle into its place
+        void EraseSwap(uint32_t i);
+        void Swap(ParticleBuffer& other);
+
+        float*      m_Data;
+        uint32_t    m_Stride;
+        uint32_t    m_Capacity;
+        uint32_t    m_Size;
     };
 
     /**
-     * Representation of a particle.
+     * Accessor of a single particle in a ParticleBuffer.
      *
      * TODO Separate source state from current (chaining modifiers)
      */
     struct Particle
     {
-#define GET_SET(property, type)\
-        inline type Get##property() const { return m_##property; }\
-        inline void Set##property(type v) { m_##property = v; }\
-
-        GET_SET(Position, dmVMath::Point3)
-        GET_SET(SourceRotation, dmVMath::Quat)
-        GET_SET(Rotation, dmVMath::Quat)
-        GET_SET(Velocity, dmVMath::Vector3)
-        GET_SET(TimeLeft, float)
-        GET_SET(MaxLifeTime, float)
-        GET_SET(ooMaxLifeTime, float)
-        GET_SET(SpreadFactor, float)
-        GET_SET(SourceSize, float)
-        GET_SET(Scale, dmVMath::Vector3)
-        GET_SET(SourceColor, dmVMath::Vector4)
-        GET_SET(Color, dmVMath::Vector4)
-        GET_SET(SortKey, SortKey)
+        Particle(ParticleBuffer* buffer, uint32_t index)
+        : m_Buffer(buffer)
+        , m_Index(index)
+        {
+        }
+
+#define GET_SET(property, stream)\
+        inline float Get##property() const { return Get(stream); }\
+        inline void Set##property(float v) { Set(stream, v); }\
+
+        GET_SET(TimeLeft, PARTICLE_STREAM_TIME_LEFT)
+        GET_SET(MaxLifeTime, PARTICLE_STREAM_MAX_LIFE_TIME)
+        GET_SET(ooMaxLifeTime, PARTICLE_STREAM_OO_MAX_LIFE_TIME)
+        GET_SET(SpreadFactor, PARTICLE_STREAM_SPREAD_FACTOR)
+        GET_SET(SourceSize, PARTICLE_STREAM_SOURCE_SIZE)
+        GET_SET(SourceStretchFactorX, PARTICLE_STREAM_SOURCE_STRETCH_FACTOR_X)
+        GET_SET(SourceStretchFactorY, PARTICLE_STREAM_SOURCE_STRETCH_FACTOR_Y)
+        GET_SET(StretchFactorX, PARTICLE_STREAM_STRETCH_FACTOR_X)
+        GET_SET(StretchFactorY, PARTICLE_STREAM_STRETCH_FACTOR_Y)
+        GET_SET(SourceAngularVelocity, PARTICLE_STREAM_SOURCE_ANGULAR_VELOCITY)
 #undef GET_SET
 
-        /// Position, which is defined in emitter space or world space depending on how the emitter which spawned the particles is tweaked.
-        dmVMath::Point3 m_Position;
-        /// Rotation, which is defined in emitter space or world space depending on how the emitter which spawned the particles is tweaked.
-        dmVMath::Quat m_SourceRotation;
-        dmVMath::Quat m_Rotation;
-        /// Velocity of the particle
-        dmVMath::Vector3 m_Velocity;
-        /// Time left before the particle dies.
-        float       m_TimeLeft;
-        /// The duration of this particle.
-        float       m_MaxLifeTime;
-        /// Inverted duration.
-        float       m_ooMaxLifeTime;
-        /// Factor used for spread
-        float       m_SpreadFactor;
-        /// Particle source size
-        float       m_SourceSize;
-        /// Particle source stretch factor
-        float       m_SourceStretchFactorX;
-        float       m_SourceStretchFactorY;
-        // Particle color
-        dmVMath::Vector4     m_SourceColor;
-        dmVMath::Vector4     m_Color;
-        /// Particle scale
-        dmVMath::Vector3     m_Scale;
-        // Sorting
-        SortKey     m_SortKey;
-        /// Particle stretch factor
-        float       m_StretchFactorX;
-        float       m_StretchFactorY;
-        /// Particle angular velocity
-        float       m_SourceAngularVelocity;
+        inline dmVMath::Point3 GetPosition() const          { return dmVMath::Point3(Get(PARTICLE_STREAM_POSITION_X), Get(PARTICLE_STREAM_POSITION_Y), Get(PARTICLE_STREAM_POSITION_Z)); }
+        inline void SetPosition(const dmVMath::Point3& v)   { Set3(PARTICLE_STREAM_POSITION_X, v.getX(), v.getY(), v.getZ()); }
+        inline dmVMath::Vector3 GetVelocity() const         { return dmVMath::Vector3(Get(PARTICLE_STREAM_VELOCITY_X), Get(PARTICLE_STREAM_VELOCITY_Y), Get(PARTICLE_STREAM_VELOCITY_Z)); }
+        inline void SetVelocity(const dmVMath::Vector3& v)  { Set3(PARTICLE_STREAM_VELOCITY_X, v.getX(), v.getY(), v.getZ()); }
+        inline dmVMath::Vector3 GetScale() const            { return dmVMath::Vector3(Get(PARTICLE_STREAM_SCALE_X), Get(PARTICLE_STREAM_SCALE_Y), Get(PARTICLE_STREAM_SCALE_Z)); }
+        inline void SetScale(const dmVMath::Vector3& v)     { Set3(PARTICLE_STREAM_SCALE_X, v.getX(), v.getY(), v.getZ()); }
+        inline dmVMath::Quat GetSourceRotation() const      { return GetQuat(PARTICLE_STREAM_SOURCE_ROTATION_X); }
+        inline void SetSourceRotation(const dmVMath::Quat& v) { SetQuat(PARTICLE_STREAM_SOURCE_ROTATION_X, v); }
+        inline dmVMath::Quat GetRotation() const            { return GetQuat(PARTICLE_STREAM_ROTATION_X); }
+        inline void SetRotation(const dmVMath::Quat& v)     { SetQuat(PARTICLE_STREAM_ROTATION_X, v); }
+        inline dmVMath::Vector4 GetSourceColor() const      { return GetVector4(PARTICLE_STREAM_SOURCE_COLOR_R); }
+        inline void SetSourceColor(const dmVMath::Vector4& v) { SetVector4(PARTICLE_STREAM_SOURCE_COLOR_R, v); }
+        inline dmVMath::Vector4 GetColor() const            { return GetVector4(PARTICLE_STREAM_COLOR_R); }
+        inline void SetColor(const dmVMath::Vector4& v)     { SetVector4(PARTICLE_STREAM_COLOR_R, v); }
+
+        inline float Get(uint32_t stream) const             { return m_Buffer->Stream(stream)[m_Index]; }
+        inline void Set(uint32_t stream, float v)           { m_Buffer->Stream(stream)[m_Index] = v; }
+
+        ParticleBuffer* m_Buffer;
+        uint32_t        m_Index;
+
+    private:
+        inline void Set3(uint32_t stream, float x, float y, float z)
+        {
+            Set(stream, x);
+            Set(stream + 1, y);
+            Set(stream + 2, z);
+        }
+        inline dmVMath::Quat GetQuat(uint32_t stream) const
+        {
+            return dmVMath::Quat(Get(stream), Get(stream + 1), Get(stream + 2), Get(stream + 3));
+        }
+        inline void SetQuat(uint32_t stream, const dmVMath::Quat& v)
+        {
+            Set3(stream, v.getX(), v.getY(), v.getZ());
+            Set(stream + 3, v.getW());
+        }
+        inline dmVMath::Vector4 GetVector4(uint32_t stream) const
+        {
+            return dmVMath::Vector4(Get(stream), Get(stream + 1), Get(stream + 2), Get(stream + 3));
+        }
+        inline void SetVector4(uint32_t stream, const dmVMath::Vector4& v)
+        {
+            Set3(stream, v.getX(), v.getY(), v.getZ());
+            Set(stream + 3, v.getW());
+        }
     };
 
+    inline Particle ParticleBuffer::operator[](uint32_t i)
+    {
+        assert(i < m_Size);
+        return Particle(this, i);
+    }
+
     /**
      * Representation of an emitter.
      */
@@ -115,7 +226,7 @@ namespace dmParticle
 
         AnimationData           m_AnimationData;
         /// Particle buffer.
-        dmArray<Particle>       m_Particles;
+        ParticleBuffer          m_Particles;
         dmArray<RenderConstant> m_RenderConstants;
         dmVMath::Vector3        m_Velocity;
         dmVMath::Point3         m_LastPosition;
@@ -183,13 +294,42 @@ namespace dmParticle
         uint16_t                m_ScaleAlongZ : 1;
     };
 
+    /**
+     * An emitter of an awake instance, collected by Update() so the emitters can be processed in separate passes.
+     */
+    struct EmitterUpdate
+    {
+        Instance*               m_Instance;
+        Emitter*                m_Emitter;
+        EmitterPrototype*       m_Prototype;
+        dmParticleDDF::Emitter* m_DDF;
+        HInstance               m_InstanceHandle;
+        uint32_t                m_EmitterIndex;
+        /// Whether the particles should be stepped this frame (the emitter is awake and time is not standing still)
+        bool                    m_Simulate;
+    };
+
+    /**
+     * Where to write the vertex data of an emitter, calculated up front by GenerateVertexDataBatch()
+     */
+    struct EmitterVertexRange
+    {
+        Instance*               m_Instance;
+        Emitter*                m_Emitter;
+        dmParticleDDF::Emitter* m_DDF;
+        uint32_t                m_VertexIndex;
+    };
+
     /**
      * Representation of a context to hold a set of emitters.
      */
     struct Context
     {
         Context(uint32_t max_instance_count, uint32_t max_particle_count)
-        : m_AttributeDataPtrIndex(0)
+        : m_JobSystem(0x0)
+        , m_JobMinParticleCount(0)
+        , m_ParticleCount(0)
+        , m_AttributeDataPtrIndex(0)
         , m_MaxParticleCount(max_particle_count)
         , m_NextVersionNumber(1)
         , m_InstanceSeeding(0)
@@ -213,6 +353,16 @@ namespace dmParticle
         dmArray<Instance*>  m_Instances;
         /// Index pool used to index the instance buffer.
         dmIndexPool16       m_InstanceIndexPool;
+        /// Emitters collected during Update()
+        dmArray<EmitterUpdate> m_EmitterUpdates;
+        /// Vertex ranges calculated during GenerateVertexDataBatch()
+        dmArray<EmitterVertexRange> m_EmitterVertexRanges;
+        /// Job system used to process the emitters in parallel, 0x0 to only use the calling thread
+        dmJobSystem::HJobSystem m_JobSystem;
+        /// Min number of particles to use the job system, 0 disables it
+        uint32_t            m_JobMinParticleCount;
+        /// Number of particles alive after the last Update()
+        uint32_t            m_ParticleCount;
         /// An intermediate array of pointers to use for the custom attribute backing data (Editor only!)
         dmArray<void*>      m_AttributeDataPtrs;
         /// An increasing serial number to keep track of when aqcuiring a pointer for the attribute backing data (Editor only!)
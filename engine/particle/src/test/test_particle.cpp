@@ -22,6 +22,7 @@
 #include <dlib/math.h>
 #include <dlib/vmath.h>
 #include <dlib/testutil.h>
+#include <dlib/time.h>
 
 #include <ddf/ddf.h>
 
@@ -198,6 +199,12 @@ uint32_t ParticleCount(dmParticle::Emitter* emitter)
     return emitter->m_Particles.Size();
 }
 
+void GetParticleStreams(dmParticle::Particle particle, float streams[dmParticle::PARTICLE_STREAM_COUNT])
+{
+    for (uint32_t s = 0; s < dmParticle::PARTICLE_STREAM_COUNT; ++s)
+        streams[s] = particle.Get(s);
+}
+
 bool LoadPrototype(const char* filename, dmParticle::HPrototype* prototype)
 {
     char path[128];
@@ -759,8 +766,8 @@ TEST_F(ParticleTest, EmissionSpace)
     dmParticle::Update(m_Context, dt, 0x0);
 
     dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
-    dmParticle::Particle* p = &e->m_Particles[0];
-    ASSERT_EQ(10.0f, p->GetPosition().getX());
+    dmParticle::Particle p = e->m_Particles[0];
+    ASSERT_EQ(10.0f, p.GetPosition().getX());
 
     dmParticle::DestroyInstance(m_Context, instance);
     dmParticle::Particle_DeletePrototype(m_Prototype);
@@ -776,8 +783,8 @@ TEST_F(ParticleTest, EmissionSpace)
     dmParticle::Update(m_Context, dt, 0x0);
 
     e = GetEmitter(m_Context, instance, 0);
-    p = &e->m_Particles[0];
-    ASSERT_EQ(0.0f, p->GetPosition().getX());
+    p = e->m_Particles[0];
+    ASSERT_EQ(0.0f, p.GetPosition().getX());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -853,10 +860,10 @@ TEST_F(ParticleTest, ParticleVelocityStretch)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_NEAR(3.5f, e->m_Particles[0].m_Scale[1], EPSILON);
+    ASSERT_NEAR(3.5f, e->m_Particles[0].GetScale().getY(), EPSILON);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_NEAR(1.0f, e->m_Particles[0].m_Scale[1], EPSILON);
+    ASSERT_NEAR(1.0f, e->m_Particles[0].GetScale().getY(), EPSILON);
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -875,12 +882,12 @@ TEST_F(ParticleTest, ParticleStretch)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_NEAR(2.f, e->m_Particles[0].m_Scale[0], EPSILON);
-    ASSERT_NEAR(4.f, e->m_Particles[0].m_Scale[1], EPSILON);
+    ASSERT_NEAR(2.f, e->m_Particles[0].GetScale().getX(), EPSILON);
+    ASSERT_NEAR(4.f, e->m_Particles[0].GetScale().getY(), EPSILON);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_NEAR(2.f, e->m_Particles[0].m_Scale[0], EPSILON);
-    ASSERT_NEAR(2.f, e->m_Particles[0].m_Scale[1], EPSILON);
+    ASSERT_NEAR(2.f, e->m_Particles[0].GetScale().getX(), EPSILON);
+    ASSERT_NEAR(2.f, e->m_Particles[0].GetScale().getY(), EPSILON);
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1211,36 +1218,36 @@ TEST_F(ParticleTest, EvaluateEmitterProperty)
 
     // t = 0.125, size < 0
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &e->m_Particles[0];
-    ASSERT_GT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    dmParticle::Particle particle = e->m_Particles[0];
+    ASSERT_GT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.25, size = 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_EQ(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_EQ(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.375, size > 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_LT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_LT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.5, size = 1
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_EQ(1.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_EQ(1.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.625, size > 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_LT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_LT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.75, size = 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_EQ(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_EQ(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.875, size < 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_GT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_GT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 1, size = 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_NEAR(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize(), EPSILON);
+    ASSERT_NEAR(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize(), EPSILON);
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1262,10 +1269,10 @@ TEST_F(ParticleTest, EvaluateEmitterPropertySpread)
         dmParticle::StartInstance(m_Context, instance);
 
         dmParticle::Update(m_Context, dt, 0x0);
-        dmParticle::Particle* particle = &emitter->m_Particles[0];
+        dmParticle::Particle particle = emitter->m_Particles[0];
         // NOTE size could potentially be 0, but not likely
-        ASSERT_NE(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
-        ASSERT_GE(1.0f, dmMath::Abs(minElem(particle->GetScale()) * particle->GetSourceSize()));
+        ASSERT_NE(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
+        ASSERT_GE(1.0f, dmMath::Abs(minElem(particle.GetScale()) * particle.GetSourceSize()));
 
         dmParticle::DestroyInstance(m_Context, instance);
     }
@@ -1294,37 +1301,37 @@ TEST_F(ParticleTest, EvaluateParticleProperty)
 
     // t = 0.125, size < 0
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &e->m_Particles[0];
-    ASSERT_GT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    dmParticle::Particle particle = e->m_Particles[0];
+    ASSERT_GT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.25, size = 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_EQ(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_EQ(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.375, size > 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_LT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_LT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.5, size = 1
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_EQ(1.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_EQ(1.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.625, size > 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_LT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_LT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.75, size = 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_EQ(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_EQ(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 0.875, size < 0
     // Updating with a full dt here will make the emitter reach its duration
     dmParticle::Update(m_Context, dt - EPSILON, 0x0);
-    ASSERT_GT(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize());
+    ASSERT_GT(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize());
 
     // t = 1, size = 0
     dmParticle::Update(m_Context, dt, 0x0);
-    ASSERT_NEAR(0.0f, minElem(particle->GetScale()) * particle->GetSourceSize(), EPSILON);
+    ASSERT_NEAR(0.0f, minElem(particle.GetScale()) * particle.GetSourceSize(), EPSILON);
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1345,8 +1352,8 @@ TEST_F(ParticleTest, ParticleInstanceScale)
     dmParticle::Update(m_Context, dt, 0x0);
 
     dmParticle::Emitter* e = GetEmitter(m_Context, instance, 0);
-    dmParticle::Particle* p = &e->m_Particles[0];
-    ASSERT_EQ(2.0f, minElem(p->GetScale()) * p->GetSourceSize());
+    dmParticle::Particle p = e->m_Particles[0];
+    ASSERT_EQ(2.0f, minElem(p.GetScale()) * p.GetSourceSize());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1536,7 +1543,7 @@ TEST_F(ParticleTest, StableSort)
     ASSERT_EQ(particle_count, i->m_Emitters[0].m_Particles.Size());
 
     float x[particle_count];
-    dmParticle::Particle* p = &i->m_Emitters[0].m_Particles[0];
+    dmParticle::ParticleBuffer& p = i->m_Emitters[0].m_Particles;
     // Store x-positions
     for (uint32_t pi = 0; pi < particle_count; ++pi)
     {
@@ -1595,8 +1602,8 @@ TEST_F(ParticleTest, ReloadInstance)
 
     ASSERT_EQ(1u, e->m_Particles.Size());
 
-    dmParticle::Particle original_particle;
-    memcpy(&original_particle, &e->m_Particles[0], sizeof(dmParticle::Particle));
+    float original_particle[dmParticle::PARTICLE_STREAM_COUNT];
+    GetParticleStreams(e->m_Particles[0], original_particle);
 
     uint32_t seed = e->m_Seed;
     float timer = e->m_Timer;
@@ -1607,8 +1614,9 @@ TEST_F(ParticleTest, ReloadInstance)
     ASSERT_EQ(timer, e->m_Timer);
     ASSERT_EQ(seed, e->m_Seed);
     ASSERT_EQ(1u, e->m_Particles.Size());
-    dmParticle::Particle* particle = &e->m_Particles[0];
-    ASSERT_EQ(0, memcmp(&original_particle, particle, sizeof(dmParticle::Particle)));
+    float particle[dmParticle::PARTICLE_STREAM_COUNT];
+    GetParticleStreams(e->m_Particles[0], particle);
+    ASSERT_EQ(0, memcmp(original_particle, particle, sizeof(particle)));
 
     dmParticle::Emitter* e1 = GetEmitter(m_Context, instance, 1);
     ASSERT_EQ(1u, e1->m_Particles.Size());
@@ -1618,8 +1626,8 @@ TEST_F(ParticleTest, ReloadInstance)
     e = GetEmitter(m_Context, instance, 0);
 
     ASSERT_EQ(1u, e->m_Particles.Size());
-    particle = &e->m_Particles[0];
-    ASSERT_EQ(0, memcmp(&original_particle, particle, sizeof(dmParticle::Particle)));
+    GetParticleStreams(e->m_Particles[0], particle);
+    ASSERT_EQ(0, memcmp(original_particle, particle, sizeof(particle)));
 
     // Test reload with max_particle_count changed
     ASSERT_TRUE(ReloadPrototype("reload3.particlefxc", m_Prototype));
@@ -1627,8 +1635,8 @@ TEST_F(ParticleTest, ReloadInstance)
     e = GetEmitter(m_Context, instance, 0);
 
     ASSERT_EQ(2u, e->m_Particles.Size());
-    particle = &e->m_Particles[0];
-    ASSERT_EQ(0, memcmp(&original_particle, particle, sizeof(dmParticle::Particle)));
+    GetParticleStreams(e->m_Particles[0], particle);
+    ASSERT_EQ(0, memcmp(original_particle, particle, sizeof(particle)));
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1655,8 +1663,8 @@ TEST_F(ParticleTest, ReloadInstanceLoop)
     ASSERT_EQ(1u, e->m_Particles.Size());
     float emitter_timer = e->m_Timer;
 
-    dmParticle::Particle original_particle;
-    memcpy(&original_particle, &e->m_Particles[0], sizeof(dmParticle::Particle));
+    float original_particle[dmParticle::PARTICLE_STREAM_COUNT];
+    GetParticleStreams(e->m_Particles[0], original_particle);
 
     ASSERT_TRUE(ReloadPrototype("reload_loop.particlefxc", m_Prototype));
     dmParticle::ReloadInstance(m_Context, instance, true);
@@ -1665,8 +1673,9 @@ TEST_F(ParticleTest, ReloadInstanceLoop)
     ASSERT_EQ(1u, e->m_Particles.Size());
     ASSERT_EQ(emitter_timer, e->m_Timer);
     ASSERT_EQ(1u, e->m_Particles.Size());
-    dmParticle::Particle* particle = &e->m_Particles[0];
-    ASSERT_EQ(0, memcmp(&original_particle, particle, sizeof(dmParticle::Particle)));
+    float particle[dmParticle::PARTICLE_STREAM_COUNT];
+    GetParticleStreams(e->m_Particles[0], particle);
+    ASSERT_EQ(0, memcmp(original_particle, particle, sizeof(particle)));
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1723,19 +1732,19 @@ TEST_F(ParticleTest, AccelerationWorld)
 
     dmParticle::StartInstance(m_Context, instance);
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, particle->GetVelocity().getX());
-    ASSERT_EQ(1.0f, particle->GetVelocity().getY());
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, particle.GetVelocity().getX());
+    ASSERT_EQ(1.0f, particle.GetVelocity().getY());
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::SetRotation(m_Context, instance, Quat::rotationZ(M_PI * 0.5f));
     dmParticle::ResetInstance(m_Context, instance);
     dmParticle::StartInstance(m_Context, instance);
     dmParticle::Update(m_Context, dt, 0x0);
-    particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, particle->GetVelocity().getX());
-    ASSERT_EQ(1.0f, particle->GetVelocity().getY());
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, particle.GetVelocity().getX());
+    ASSERT_EQ(1.0f, particle.GetVelocity().getY());
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1759,8 +1768,8 @@ TEST_F(ParticleTest, AccelerationScaledEmitter)
 
         dmParticle::StartInstance(m_Context, instance);
         dmParticle::Update(m_Context, dt, 0x0);
-        dmParticle::Particle* particle = &inst->m_Emitters[0].m_Particles[0];
-        delta[i] = Vector3(particle->GetPosition());
+        dmParticle::Particle particle = inst->m_Emitters[0].m_Particles[0];
+        delta[i] = Vector3(particle.GetPosition());
 
         dmParticle::DestroyInstance(m_Context, instance);
     }
@@ -1790,8 +1799,8 @@ TEST_F(ParticleTest, AccelerationScaledWorld)
 
         dmParticle::StartInstance(m_Context, instance);
         dmParticle::Update(m_Context, dt, 0x0);
-        dmParticle::Particle* particle = &inst->m_Emitters[0].m_Particles[0];
-        delta[i] = Vector3(particle->GetPosition());
+        dmParticle::Particle particle = inst->m_Emitters[0].m_Particles[0];
+        delta[i] = Vector3(particle.GetPosition());
 
         dmParticle::DestroyInstance(m_Context, instance);
     }
@@ -1813,19 +1822,19 @@ TEST_F(ParticleTest, AccelerationEmitter)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_NEAR(0.0f, particle->GetVelocity().getX(), EPSILON);
-    ASSERT_NEAR(1.0f, particle->GetVelocity().getY(), EPSILON);
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_NEAR(0.0f, particle.GetVelocity().getX(), EPSILON);
+    ASSERT_NEAR(1.0f, particle.GetVelocity().getY(), EPSILON);
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::SetRotation(m_Context, instance, Quat::rotationZ(M_PI));
     dmParticle::ResetInstance(m_Context, instance);
     dmParticle::StartInstance(m_Context, instance);
     dmParticle::Update(m_Context, dt, 0x0);
-    particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_NEAR(0.0f, particle->GetVelocity().getX(), EPSILON);
-    ASSERT_NEAR(1.0f, particle->GetVelocity().getY(), EPSILON);
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_NEAR(0.0f, particle.GetVelocity().getX(), EPSILON);
+    ASSERT_NEAR(1.0f, particle.GetVelocity().getY(), EPSILON);
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1841,22 +1850,22 @@ TEST_F(ParticleTest, AccelerationAnimated)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &emitter->m_Particles[0];
-    ASSERT_EQ(0.0f, particle->GetVelocity().getX());
-    ASSERT_LT(0.0f, particle->GetVelocity().getY());
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    dmParticle::Particle particle = emitter->m_Particles[0];
+    ASSERT_EQ(0.0f, particle.GetVelocity().getX());
+    ASSERT_LT(0.0f, particle.GetVelocity().getY());
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::Update(m_Context, dt, 0x0);
     // New particle at 0 because of sorting
-    particle = &emitter->m_Particles[0];
-    ASSERT_EQ(0.0f, lengthSqr(particle->GetVelocity()));
+    particle = emitter->m_Particles[0];
+    ASSERT_EQ(0.0f, lengthSqr(particle.GetVelocity()));
 
     dmParticle::Update(m_Context, dt, 0x0);
     // New particle at 0 because of sorting
-    particle = &emitter->m_Particles[0];
-    ASSERT_EQ(0.0f, particle->GetVelocity().getX());
-    ASSERT_GT(0.0f, particle->GetVelocity().getY());
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    particle = emitter->m_Particles[0];
+    ASSERT_EQ(0.0f, particle.GetVelocity().getX());
+    ASSERT_GT(0.0f, particle.GetVelocity().getY());
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1873,8 +1882,8 @@ TEST_F(ParticleTest, DragNoDir)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, lengthSqr(particle->GetVelocity()));
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, lengthSqr(particle.GetVelocity()));
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1891,8 +1900,8 @@ TEST_F(ParticleTest, DragDir)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    Vector3 velocity = particle->GetVelocity();
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    Vector3 velocity = particle.GetVelocity();
     ASSERT_NEAR(0.0f, velocity.getX(), EPSILON);
     ASSERT_LT(0.0f, velocity.getY());
     ASSERT_EQ(0.0f, velocity.getZ());
@@ -1912,8 +1921,8 @@ TEST_F(ParticleTest, DragBigMagnitude)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0u, lengthSqr(particle->GetVelocity()));
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0u, lengthSqr(particle.GetVelocity()));
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1930,9 +1939,9 @@ TEST_F(ParticleTest, Radial)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(1.0f, lengthSqr(particle->GetVelocity()));
-    ASSERT_EQ(-1.0f, particle->GetVelocity().getX());
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(1.0f, lengthSqr(particle.GetVelocity()));
+    ASSERT_EQ(-1.0f, particle.GetVelocity().getX());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1949,16 +1958,16 @@ TEST_F(ParticleTest, RadialMaxDistance)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, lengthSqr(particle->GetVelocity()));
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, lengthSqr(particle.GetVelocity()));
 
     // Test with instance scale
     dmParticle::ResetInstance(m_Context, instance);
     dmParticle::SetScale(m_Context, instance, 2.0f);
     dmParticle::StartInstance(m_Context, instance);
     dmParticle::Update(m_Context, dt, 0x0);
-    particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, lengthSqr(particle->GetVelocity()));
+    particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, lengthSqr(particle.GetVelocity()));
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1976,8 +1985,8 @@ TEST_F(ParticleTest, RadialEdgeCase)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(1.0f, lengthSqr(particle->GetVelocity()));
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(1.0f, lengthSqr(particle.GetVelocity()));
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -1994,10 +2003,10 @@ TEST_F(ParticleTest, Vortex)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, particle->GetVelocity().getX());
-    ASSERT_EQ(-1.0f, particle->GetVelocity().getY());
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, particle.GetVelocity().getX());
+    ASSERT_EQ(-1.0f, particle.GetVelocity().getY());
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -2014,16 +2023,16 @@ TEST_F(ParticleTest, VortexMaxDistance)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, lengthSqr(particle->GetVelocity()));
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, lengthSqr(particle.GetVelocity()));
 
     // Test with instance scale
     dmParticle::ResetInstance(m_Context, instance);
     dmParticle::SetScale(m_Context, instance, 2.0f);
     dmParticle::StartInstance(m_Context, instance);
     dmParticle::Update(m_Context, dt, 0x0);
-    particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(0.0f, lengthSqr(particle->GetVelocity()));
+    particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(0.0f, lengthSqr(particle.GetVelocity()));
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -2040,10 +2049,10 @@ TEST_F(ParticleTest, VortexEdgeCase)
     dmParticle::StartInstance(m_Context, instance);
 
     dmParticle::Update(m_Context, dt, 0x0);
-    dmParticle::Particle* particle = &i->m_Emitters[0].m_Particles[0];
-    ASSERT_EQ(-1.0f, particle->GetVelocity().getX());
-    ASSERT_EQ(0.0f, particle->GetVelocity().getY());
-    ASSERT_EQ(0.0f, particle->GetVelocity().getZ());
+    dmParticle::Particle particle = i->m_Emitters[0].m_Particles[0];
+    ASSERT_EQ(-1.0f, particle.GetVelocity().getX());
+    ASSERT_EQ(0.0f, particle.GetVelocity().getY());
+    ASSERT_EQ(0.0f, particle.GetVelocity().getZ());
 
     dmParticle::DestroyInstance(m_Context, instance);
 }
@@ -2139,6 +2148,152 @@ TEST_F(ParticleTest, Stats)
     dmParticle::DestroyInstance(m_Context, instance);
 }
 
+// Measures the simulation and vertex generation throughput for a single emitter with
+// spline properties and all modifier types.
+TEST_F(ParticleTest, Benchmark)
+{
+    const float dt = 1.0f / 60.0f;
+    const uint32_t frame_count = 30;
+    const uint32_t particle_counts[] = { 10000, 50000, 100000, 200000 };
+    const uint32_t max_particle_count = particle_counts[DM_ARRAY_SIZE(particle_counts) - 1];
+
+    ASSERT_TRUE(LoadPrototype("benchmark.particlefxc", &m_Prototype));
+    dmParticle::SetContextMaxParticleCount(m_Context, max_particle_count);
+
+    uint32_t vertex_buffer_size = dmParticle::GetVertexBufferSize(max_particle_count, sizeof(TestVertex));
+    TestVertex* vertex_buffer = new TestVertex[6 * max_particle_count];
+
+    for (uint32_t c = 0; c < DM_ARRAY_SIZE(particle_counts); ++c)
+    {
+        uint32_t particle_count = particle_counts[c];
+        m_Prototype->m_DDF->m_Emitters[0].m_MaxParticleCount = particle_count;
+
+        dmParticle::HInstance instance = dmParticle::CreateInstance(m_Context, m_Prototype, 0x0);
+        dmParticle::StartInstance(m_Context, instance);
+        dmParticle::Update(m_Context, dt, 0x0);
+        ASSERT_EQ(particle_count, ParticleCount(GetEmitter(m_Context, instance, 0)));
+
+        uint64_t start = dmTime::GetTime();
+        for (uint32_t f = 0; f < frame_count; ++f)
+        {
+            dmParticle::Update(m_Context, dt, 0x0);
+        }
+        uint64_t update_time = dmTime::GetTime() - start;
+
+        start = dmTime::GetTime();
+        for (uint32_t f = 0; f < frame_count; ++f)
+        {
+            // The size is accumulated, so each frame writes from the start of the buffer
+            uint32_t out_vertex_buffer_size = 0;
+            dmParticle::GenerateVertexDataResult r = dmParticle::GenerateVertexData(m_Context, dt, instance, 0, m_AttributeInfos, Vector4(1,1,1,1), (void*)vertex_buffer, vertex_buffer_size, &out_vertex_buffer_size);
+            ASSERT_EQ(dmParticle::GENERATE_VERTEX_DATA_OK, r);
+            ASSERT_EQ(6 * particle_count * sizeof(TestVertex), out_vertex_buffer_size);
+        }
+        uint64_t vertex_time = dmTime::GetTime() - start;
+
+        double particles = (double)particle_count * frame_count;
+        printf("%6u particles: update %8.0f particles/ms, vertex data %8.0f particles/ms\n",
+                particle_count,
+                particles * 1000.0 / dmMath::Max(update_time, (uint64_t)1),
+                particles * 1000.0 / dmMath::Max(vertex_time, (uint64_t)1));
+
+        dmParticle::DestroyInstance(m_Context, instance);
+    }
+
+    delete [] vertex_buffer;
+}
+
+static dmJobSystem::HJobSystem CreateParticleJobSystem()
+{
+    dmJobSystem::Params job_system_params;
+    dmJobSystem::SetDefaultParams(&job_system_params);
+    job_system_params.m_Name = "test_particle";
+    job_system_params.m_WorkerCount = 4;
+    return dmJobSystem::New(job_system_params);
+}
+
+TEST_F(ParticleTest, JobSystem)
+{
+    const float dt = 1.0f / 60.0f;
+    const uint32_t particle_count = 10000;
+    const uint32_t instance_count = 4;
+
+    ASSERT_TRUE(LoadPrototype("benchmark.particlefxc", &m_Prototype));
+    m_Prototype->m_DDF->m_Emitters[0].m_MaxParticleCount = particle_count / instance_count;
+
+    // Same instances updated on the calling thread and on the job workers
+    dmParticle::HParticleContext job_context = dmParticle::CreateContext(64, particle_count);
+    dmParticle::SetContextMaxParticleCount(m_Context, particle_count);
+    dmJobSystem::HJobSystem job_system = CreateParticleJobSystem();
+    dmParticle::SetJobSystem(job_context, job_system, 1);
+
+    dmParticle::HParticleContext contexts[] = { m_Context, job_context };
+    dmParticle::GenerateVertexDataParams params[2][instance_count];
+    for (uint32_t c = 0; c < 2; ++c)
+    {
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            dmParticle::HInstance instance = dmParticle::CreateInstance(contexts[c], m_Prototype, 0x0);
+            dmParticle::SetPosition(contexts[c], instance, Point3(i * 10.0f, 0.0f, 0.0f));
+
+            if (c == 1)
+            {
+                // The emitters are seeded from the time, so give both instances the same seeds
+                uint32_t emitter_count = dmParticle::GetInstanceEmitterCount(job_context, instance);
+                for (uint32_t e = 0; e < emitter_count; ++e)
+                {
+                    GetEmitter(job_context, instance, e)->m_OriginalSeed = GetEmitter(m_Context, params[0][i].m_Instance, e)->m_OriginalSeed;
+                }
+                // Apply the seed to the emitter durations and delays
+                dmParticle::ReloadInstance(job_context, instance, false);
+                for (uint32_t e = 0; e < emitter_count; ++e)
+                {
+                    GetEmitter(job_context, instance, e)->m_Seed = GetEmitter(job_context, instance, e)->m_OriginalSeed;
+                }
+            }
+            dmParticle::StartInstance(contexts[c], instance);
+
+            params[c][i].m_AttributeInfos = m_AttributeInfos;
+            params[c][i].m_Color = Vector4(1.0f, 0.5f, 0.25f, 1.0f);
+            params[c][i].m_Instance = instance;
+            params[c][i].m_EmitterIndex = 0;
+        }
+    }
+
+    uint32_t vertex_buffer_size = dmParticle::GetVertexBufferSize(particle_count, sizeof(TestVertex));
+    uint8_t* vertex_buffers[2] = { new uint8_t[vertex_buffer_size], new uint8_t[vertex_buffer_size] };
+
+    for (uint32_t f = 0; f < 10; ++f)
+    {
+        uint32_t out_sizes[2] = { 0, 0 };
+        for (uint32_t c = 0; c < 2; ++c)
+        {
+            dmParticle::Update(contexts[c], dt, 0x0);
+            dmParticle::GenerateVertexDataBatch(contexts[c], dt, params[c], instance_count, vertex_buffers[c], vertex_buffer_size, &out_sizes[c]);
+        }
+
+        ASSERT_EQ(6 * particle_count * sizeof(TestVertex), out_sizes[0]);
+        ASSERT_EQ(out_sizes[0], out_sizes[1]);
+        ASSERT_EQ(0, memcmp(vertex_buffers[0], vertex_buffers[1], out_sizes[0]));
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            ASSERT_EQ(dmParticle::GENERATE_VERTEX_DATA_OK, params[1][i].m_Result);
+        }
+    }
+
+    for (uint32_t c = 0; c < 2; ++c)
+    {
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            dmParticle::DestroyInstance(contexts[c], params[c][i].m_Instance);
+        }
+        delete [] vertex_buffers[c];
+    }
+
+    dmParticle::DestroyContext(job_context);
+    dmJobSystem::Delete(job_system);
+}
+
 dmParticle::FetchAnimationResult FetchPivotAnimationCallback(void* tile_source, dmhash_t animation, dmParticle::AnimationData* out_data)
 {
     if (tile_source == 0x0)
@@ -308,7 +308,7 @@ namespace dmRender
 
         dmGraphics::SetVertexBufferData(debug_renderer.m_VertexBuffer, total_vertex_count * sizeof(DebugVertex), 0, dmGraphics::BUFFER_USAGE_STREAM_DRAW);
 
-        dmRender::RenderListEntry* render_list = dmRender::RenderListAlloc(render_context, total_render_objects);
+        dmRender::RenderListEntry* render_list = dmRender::RenderListAllocDebug(render_context, total_render_objects);
         dmRender::HRenderListDispatch dispatch = dmRender::RenderListMakeDispatch(render_context, &DebugRenderListDispatch, &debug_renderer);
         dmRender::RenderListEntry* write_ptr = render_list;
 
@@ -339,6 +339,6 @@ namespace dmRender
             }
         }
 
-        dmRender::RenderListSubmit(render_context, render_list, write_ptr);
+        dmRender::RenderListSubmitDebug(render_context, render_list, write_ptr);
     }
 }
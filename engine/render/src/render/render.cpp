@@ -21,6 +21,7 @@
 #include <dlib/hashtable.h>
 #include <dlib/profile.h>
 #include <dlib/math.h>
+#include <dlib/time.h>
 #include <dmsdk/dlib/vmath.h>
 #include <dmsdk/dlib/intersection.h>
 
@@ -32,12 +33,16 @@
 #include "font_renderer.h"
 
 DM_PROPERTY_GROUP(rmtp_Render, "Renderer");
+DM_PROPERTY_U32(rmtp_RenderListSortCacheHits, 0, FrameReset, "# draws reusing a sorted render list / frame", &rmtp_Render);
+DM_PROPERTY_U32(rmtp_RenderListSortCacheMisses, 0, FrameReset, "# draws sorting the render list / frame", &rmtp_Render);
+DM_PROPERTY_U32(rmtp_RenderListSortTime, 0, FrameReset, "time spent sorting render lists (us) / frame", &rmtp_Render);
 
 namespace dmRender
 {
     using namespace dmVMath;
 
     const char* RENDER_SOCKET_NAME = "@render";
+    const char* RENDER_LIST_JOB_MIN_ENTRY_COUNT_KEY = "render.list_job_min_entry_count";
 
     StencilTestParams::StencilTestParams() {
         Init();
@@ -141,6 +146,18 @@ namespace dmRender
 
         context->m_RenderListDispatch.SetCapacity(255);
 
+        context->m_JobSystem = 0;
+        context->m_RenderListJobMinEntryCount = DEFAULT_RENDER_LIST_JOB_MIN_ENTRY_COUNT;
+
+        context->m_RenderListVersion = 1;
+        context->m_RenderListSortCacheTick = 0;
+        for (uint32_t i = 0; i < RENDER_LIST_SORT_CACHE_SIZE; ++i)
+        {
+            context->m_RenderListSortCache[i].m_Key = 0;
+            context->m_RenderListSortCache[i].m_Version = 0;
+            context->m_RenderListSortCache[i].m_LastUsed = 0;
+        }
+
         dmMessage::Result r = dmMessage::NewSocket(RENDER_SOCKET_NAME, &context->m_Socket);
         assert(r == dmMessage::RESULT_OK);
         return context;
@@ -170,7 +187,9 @@ namespace dmRender
         render_context->m_RenderListSortIndices.SetSize(0);
         render_context->m_RenderListDispatch.SetSize(0);
         render_context->m_RenderListRanges.SetSize(0);
+        render_context->m_DebugRenderListIndices.SetSize(0);
         render_context->m_FrustumHash = 0xFFFFFFFF; // trigger a first recalculation each frame
+        render_context->m_RenderListVersion++;
     }
 
     HRenderListDispatch RenderListMakeDispatch(HRenderContext render_context, RenderListDispatchFn dispatch_fn, RenderListVisibilityFn visibility_fn, void* user_data)
@@ -200,7 +219,7 @@ namespace dmRender
     //
     // NOTE: Pointer might go invalid after a consecutive call to RenderListAlloc if reallocation
     //       of backing buffer happens.
-    RenderListEntry* RenderListAlloc(HRenderContext render_context, uint32_t entries)
+    static RenderListEntry* AllocRenderListEntries(HRenderContext render_context, uint32_t entries)
     {
         dmArray<RenderListEntry> & render_list = render_context->m_RenderList;
 
@@ -213,11 +232,28 @@ namespace dmRender
 
         uint32_t size = render_list.Size();
         render_list.SetSize(size + entries);
+        return (render_list.Begin() + size);
+    }
 
-        // If we push new items after the last frustum culling, we need to reevaluate it
-        render_context->m_FrustumHash = 0xFFFFFFFF;
+    RenderListEntry* RenderListAlloc(HRenderContext render_context, uint32_t entries)
+    {
+        RenderListEntry* result = AllocRenderListEntries(render_context, entries);
 
-        return (render_list.Begin() + size);
+        if (entries > 0)
+        {
+            // If we push new items after the last frustum culling, we need to reevaluate it
+            render_context->m_FrustumHash = 0xFFFFFFFF;
+            // ...and the sorted render lists are no longer valid
+            render_context->m_RenderListVersion++;
+        }
+
+        return result;
+    }
+
+    RenderListEntry* RenderListAllocDebug(HRenderContext render_context, uint32_t entries)
+    {
+        // The debug entries are never culled, and are merged into the sorted lists when drawing
+        return AllocRenderListEntries(render_context, entries);
     }
 
     // Submit a range of entries (pointers must be from a range allocated by RenderListAlloc, and not between two alloc calls).
@@ -247,20 +283,34 @@ namespace dmRender
 
         render_context->m_RenderListSortIndices.SetSize(render_context->m_RenderListSortIndices.Size() + (end - begin));
 
-        // invalidate the ranges if this is a call to the debug rendering (happening in the middle of the frame)
+        // invalidate the ranges if this is a call happening in the middle of the frame
         render_context->m_RenderListRanges.SetSize(0);
     }
 
-    struct RenderListSorter
+    void RenderListSubmitDebug(HRenderContext render_context, RenderListEntry* begin, RenderListEntry* end)
     {
-        bool operator()(uint32_t a, uint32_t b) const
+        assert(end <= render_context->m_RenderList.End());
+
+        if (end < render_context->m_RenderList.End())
+        {
+            uint32_t list_size = end - render_context->m_RenderList.Begin();
+            render_context->m_RenderList.SetSize(list_size);
+        }
+
+        dmArray<uint32_t>& debug_indices = render_context->m_DebugRenderListIndices;
+        uint32_t count = end - begin;
+        if (debug_indices.Remaining() < count)
         {
-            const RenderListSortValue& u = values[a];
-            const RenderListSortValue& v = values[b];
-            return u.m_SortKey < v.m_SortKey;
+            debug_indices.OffsetCapacity(dmMath::Max<uint32_t>(16, count - debug_indices.Remaining()));
         }
-        RenderListSortValue* values;
-    };
+
+        RenderListEntry *base = render_context->m_RenderList.Begin();
+        for (RenderListEntry* i = begin; i != end; ++i)
+        {
+            i->m_Visibility = dmRender::VISIBILITY_FULL;
+            debug_indices.Push(i - base);
+        }
+    }
 
     void RenderListEnd(HRenderContext render_context)
     {
@@ -275,6 +325,22 @@ namespace dmRender
         render_context->m_SystemFontMap = font_map;
     }
 
+    void SetRenderListJobSystem(HRenderContext render_context, dmJobSystem::HJobSystem job_system, uint32_t min_entry_count)
+    {
+        render_context->m_JobSystem = job_system;
+        render_context->m_RenderListJobMinEntryCount = min_entry_count;
+    }
+
+    dmJobSystem::HJobSystem GetRenderListJobSystem(HRenderContext render_context, uint32_t entry_count)
+    {
+        dmJobSystem::HJobSystem job_system = render_context->m_JobSystem;
+        if (!job_system || dmJobSystem::GetWorkerCount(job_system) == 0 || render_context->m_RenderListJobMinEntryCount == 0 || entry_count < render_context->m_RenderListJobMinEntryCount)
+        {
+            return 0;
+        }
+        return job_system;
+    }
+
     dmGraphics::HContext GetGraphicsContext(HRenderContext render_context)
     {
         return render_context->m_GraphicsContext;
@@ -472,51 +538,75 @@ namespace dmRender
         return false;
     }
 
-    // Compute new sort values for everything that matches tag_mask
-    static void MakeSortBuffer(HRenderContext context, uint32_t tag_count, dmhash_t* tags)
+    // Returns the number of items per chunk when processing count items of the render list,
+    // which is count if they should all be processed on the calling thread
+    static uint32_t GetRenderListJobChunkSize(HRenderContext context, uint32_t count)
     {
-        DM_PROFILE("MakeSortBuffer");
+        dmJobSystem::HJobSystem job_system = GetRenderListJobSystem(context, count);
+        if (!job_system)
+        {
+            return count;
+        }
+        // One chunk per thread (including the calling thread), but not too small chunks
+        uint32_t chunk_count = dmMath::Min(dmJobSystem::GetWorkerCount(job_system) + 1, RENDER_LIST_JOB_MAX_CHUNK_COUNT);
+        return dmMath::Max(RENDER_LIST_JOB_MIN_CHUNK_SIZE, (count + chunk_count - 1) / chunk_count);
+    }
 
-        const uint32_t required_capacity = context->m_RenderListSortIndices.Capacity();
-        // SetCapacity does early out if they are the same, so just call anyway.
-        context->m_RenderListSortBuffer.SetCapacity(required_capacity);
-        context->m_RenderListSortBuffer.SetSize(0);
-        context->m_RenderListSortValues.SetCapacity(required_capacity);
-        context->m_RenderListSortValues.SetSize(context->m_RenderListSortIndices.Size());
+    static void RunRenderListJob(HRenderContext context, dmJobSystem::FParallelFor process, void* job, uint32_t count, uint32_t chunk_size)
+    {
+        if (chunk_size >= count)
+            process(job, 0, count);
+        else
+            dmJobSystem::ParallelFor(context->m_JobSystem, process, job, count, chunk_size);
+    }
 
-        RenderListSortValue* sort_values = context->m_RenderListSortValues.Begin();
-        RenderListEntry* entries = context->m_RenderList.Begin();
+    struct RenderListZWJob
+    {
+        Matrix4                 m_Transform;
+        const RenderListEntry*  m_Entries;
+        const uint32_t*         m_Indices;
+        const RenderListRange*  m_Ranges;
+        uint32_t                m_RangeCount;
+        uint32_t                m_ChunkSize;
+        RenderListSortValue*    m_SortValues;
+        float                   m_MinZW[RENDER_LIST_JOB_MAX_CHUNK_COUNT]; // Per chunk
+        float                   m_MaxZW[RENDER_LIST_JOB_MAX_CHUNK_COUNT];
+    };
 
-        const Matrix4& transform = context->m_ViewProj;
+    static bool RenderListRangeStartLess(uint32_t position, const RenderListRange& range)
+    {
+        return position < range.m_Start;
+    }
+
+    // Writes the z values of the visible world entries in [begin, end) of the sorted render list,
+    // skipping the ranges that don't match the tags
+    static void ComputeRenderListZW(void* _job, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("ComputeRenderListZW");
+        RenderListZWJob* job = (RenderListZWJob*)_job;
+        const Matrix4& transform = job->m_Transform;
+        const RenderListEntry* entries = job->m_Entries;
+        RenderListSortValue* sort_values = job->m_SortValues;
 
         float minZW = FLT_MAX;
         float maxZW = -FLT_MAX;
 
-        RenderListRange* ranges = context->m_RenderListRanges.Begin();
-        uint32_t num_ranges = context->m_RenderListRanges.Size();
-        for( uint32_t r = 0; r < num_ranges; ++r)
+        // The ranges are in the order of the sorted render list, starting at 0
+        const RenderListRange* ranges_end = job->m_Ranges + job->m_RangeCount;
+        const RenderListRange* range = std::upper_bound(job->m_Ranges, ranges_end, begin, RenderListRangeStartLess) - 1;
+        for (; range != ranges_end && range->m_Start < end; ++range)
         {
-            RenderListRange& range = ranges[r];
-
-            MaterialTagList taglist;
-            dmRender::GetMaterialTagList(context, range.m_TagListKey, &taglist);
-
-            range.m_Skip = 0;
-            if (tag_count > 0 && !dmRender::MatchMaterialTags(taglist.m_Count, taglist.m_Tags, tag_count, tags))
-            {
-                range.m_Skip = 1;
+            if (range->m_Skip)
                 continue;
-            }
 
-            // Write z values...
-            int num_visibility_skipped = 0;
-            for (uint32_t i = range.m_Start; i < range.m_Start+range.m_Count; ++i)
+            uint32_t range_begin = dmMath::Max(begin, range->m_Start);
+            uint32_t range_end = dmMath::Min(end, range->m_Start + range->m_Count);
+            for (uint32_t i = range_begin; i < range_end; ++i)
             {
-                uint32_t idx = context->m_RenderListSortIndices[i];
-                RenderListEntry* entry = &entries[idx];
+                uint32_t idx = job->m_Indices[i];
+                const RenderListEntry* entry = &entries[idx];
                 if (entry->m_Visibility == dmRender::VISIBILITY_NONE)
                 {
-                    num_visibility_skipped++;
                     continue;
                 }
 
@@ -531,13 +621,69 @@ namespace dmRender
                 if (zw < minZW) minZW = zw;
                 if (zw > maxZW) maxZW = zw;
             }
+        }
+
+        uint32_t chunk = begin / job->m_ChunkSize;
+        job->m_MinZW[chunk] = minZW;
+        job->m_MaxZW[chunk] = maxZW;
+    }
+
+    // Compute new sort values for everything that matches tag_mask
+    static void MakeSortBuffer(HRenderContext context, uint32_t tag_count, dmhash_t* tags, dmArray<uint32_t>& sort_buffer)
+    {
+        DM_PROFILE("MakeSortBuffer");
+
+        const uint32_t required_capacity = context->m_RenderListSortIndices.Capacity();
+        // SetCapacity does early out if they are the same, so just call anyway.
+        sort_buffer.SetCapacity(required_capacity);
+        sort_buffer.SetSize(0);
+        // Indexed by the render list entries, which also include the debug entries
+        context->m_RenderListSortValues.SetCapacity(context->m_RenderList.Capacity());
+        context->m_RenderListSortValues.SetSize(context->m_RenderList.Size());
+
+        RenderListSortValue* sort_values = context->m_RenderListSortValues.Begin();
+        RenderListEntry* entries = context->m_RenderList.Begin();
 
-            if (num_visibility_skipped == range.m_Count)
+        RenderListRange* ranges = context->m_RenderListRanges.Begin();
+        uint32_t num_ranges = context->m_RenderListRanges.Size();
+        for( uint32_t r = 0; r < num_ranges; ++r)
+        {
+            RenderListRange& range = ranges[r];
+
+            MaterialTagList taglist;
+            dmRender::GetMaterialTagList(context, range.m_TagListKey, &taglist);
+
+            range.m_Skip = 0;
+            if (tag_count > 0 && !dmRender::MatchMaterialTags(taglist.m_Count, taglist.m_Tags, tag_count, tags))
             {
                 range.m_Skip = 1;
             }
         }
 
+        // Write z values...
+        uint32_t count = context->m_RenderListSortIndices.Size();
+        if (count == 0)
+            return;
+
+        RenderListZWJob job;
+        job.m_Transform = context->m_ViewProj;
+        job.m_Entries = entries;
+        job.m_Indices = context->m_RenderListSortIndices.Begin();
+        job.m_Ranges = ranges;
+        job.m_RangeCount = num_ranges;
+        job.m_ChunkSize = GetRenderListJobChunkSize(context, count);
+        job.m_SortValues = sort_values;
+        RunRenderListJob(context, ComputeRenderListZW, &job, count, job.m_ChunkSize);
+
+        float minZW = FLT_MAX;
+        float maxZW = -FLT_MAX;
+        uint32_t chunk_count = (count + job.m_ChunkSize - 1) / job.m_ChunkSize;
+        for (uint32_t i = 0; i < chunk_count; ++i)
+        {
+            minZW = dmMath::Min(minZW, job.m_MinZW[i]);
+            maxZW = dmMath::Max(maxZW, job.m_MaxZW[i]);
+        }
+
         // ... and compute range
         float rc = 0;
         if (maxZW > minZW)
@@ -573,9 +719,294 @@ namespace dmRender
                 sort_values[idx].m_MinorOrder = entry->m_MinorOrder;
                 sort_values[idx].m_BatchKey = entry->m_BatchKey & 0x00ffffff;
                 sort_values[idx].m_Dispatch = entry->m_Dispatch;
-                context->m_RenderListSortBuffer.Push(idx);
+                sort_buffer.Push(idx);
+            }
+        }
+    }
+
+    void RadixSortCountKeys(const uint64_t* keys, uint32_t count, uint32_t* histograms)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint64_t key = keys[i];
+            for (uint32_t pass = 0; pass < 8; ++pass)
+            {
+                histograms[pass * 256 + ((key >> (pass * 8)) & 0xff)]++;
+            }
+        }
+    }
+
+    void RadixSort64(uint64_t* keys, uint32_t* values, uint64_t* tmp_keys, uint32_t* tmp_values, uint32_t count)
+    {
+        if (count < 2)
+            return;
+
+        // One histogram per byte of the key, all counted in a single pass
+        uint32_t histograms[RADIX_SORT_HISTOGRAM_SIZE];
+        memset(histograms, 0, sizeof(histograms));
+        RadixSortCountKeys(keys, count, histograms);
+        RadixSort64(keys, values, tmp_keys, tmp_values, count, histograms);
+    }
+
+    void RadixSort64(uint64_t* keys, uint32_t* values, uint64_t* tmp_keys, uint32_t* tmp_values, uint32_t count, uint32_t* histograms)
+    {
+        if (count < 2)
+            return;
+
+        uint64_t* src_keys = keys;
+        uint32_t* src_values = values;
+        uint64_t* dst_keys = tmp_keys;
+        uint32_t* dst_values = tmp_values;
+        for (uint32_t pass = 0; pass < 8; ++pass)
+        {
+            uint32_t shift = pass * 8;
+            uint32_t* histogram = histograms + pass * 256;
+
+            // All keys have the same byte, e.g. the unused high bits of the order
+            if (histogram[(src_keys[0] >> shift) & 0xff] == count)
+                continue;
+
+            uint32_t offset = 0;
+            for (uint32_t b = 0; b < 256; ++b)
+            {
+                uint32_t c = histogram[b];
+                histogram[b] = offset;
+                offset += c;
+            }
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint64_t key = src_keys[i];
+                uint32_t dst = histogram[(key >> shift) & 0xff]++;
+                dst_keys[dst] = key;
+                dst_values[dst] = src_values[i];
+            }
+
+            uint64_t* swap_keys = src_keys; src_keys = dst_keys; dst_keys = swap_keys;
+            uint32_t* swap_values = src_values; src_values = dst_values; dst_values = swap_values;
+        }
+
+        if (src_keys != keys)
+        {
+            memcpy(keys, src_keys, count * sizeof(uint64_t));
+            memcpy(values, src_values, count * sizeof(uint32_t));
+        }
+    }
+
+    // Returns the scratch buffer for count sort keys, to be filled in before calling SortRenderListKeys
+    static uint64_t* GetRenderListSortKeys(HRenderContext context, uint32_t count)
+    {
+        if (context->m_RenderListSortKeys.Capacity() < count)
+        {
+            context->m_RenderListSortKeys.SetCapacity(count);
+            context->m_RenderListSortKeysTmp.SetCapacity(count);
+            context->m_RenderListSortIndicesTmp.SetCapacity(count);
+        }
+        context->m_RenderListSortKeys.SetSize(count);
+        context->m_RenderListSortKeysTmp.SetSize(count);
+        context->m_RenderListSortIndicesTmp.SetSize(count);
+        return context->m_RenderListSortKeys.Begin();
+    }
+
+    struct RadixSortCountJob
+    {
+        const uint64_t* m_Keys;
+        uint32_t*       m_Histograms;
+        uint32_t        m_ChunkSize;
+    };
+
+    static void RadixSortCountKeysChunk(void* _job, uint32_t begin, uint32_t end)
+    {
+        DM_PROFILE("RadixSortCountKeys");
+        RadixSortCountJob* job = (RadixSortCountJob*)_job;
+        uint32_t* histograms = job->m_Histograms + (begin / job->m_ChunkSize) * RADIX_SORT_HISTOGRAM_SIZE;
+        memset(histograms, 0, RADIX_SORT_HISTOGRAM_SIZE * sizeof(uint32_t));
+        RadixSortCountKeys(job->m_Keys + begin, end - begin, histograms);
+    }
+
+    // Stable sort of the values by the keys from GetRenderListSortKeys. The sorted keys are left in the scratch buffer.
+    // For large render lists, the keys are counted on the job threads.
+    static void SortRenderListKeys(HRenderContext context, uint32_t* values, uint32_t count)
+    {
+        if (count < 2)
+            return;
+
+        uint32_t chunk_size = GetRenderListJobChunkSize(context, count);
+        uint32_t chunk_count = (count + chunk_size - 1) / chunk_size;
+        dmArray<uint32_t>& histograms = context->m_RenderListSortHistograms;
+        if (histograms.Capacity() < chunk_count * RADIX_SORT_HISTOGRAM_SIZE)
+        {
+            histograms.SetCapacity(chunk_count * RADIX_SORT_HISTOGRAM_SIZE);
+        }
+        histograms.SetSize(chunk_count * RADIX_SORT_HISTOGRAM_SIZE);
+
+        RadixSortCountJob job;
+        job.m_Keys = context->m_RenderListSortKeys.Begin();
+        job.m_Histograms = histograms.Begin();
+        job.m_ChunkSize = chunk_size;
+        RunRenderListJob(context, RadixSortCountKeysChunk, &job, count, chunk_size);
+
+        // Sum up the chunks in the first histograms
+        uint32_t* total = histograms.Begin();
+        for (uint32_t c = 1; c < chunk_count; ++c)
+        {
+            const uint32_t* chunk = total + c * RADIX_SORT_HISTOGRAM_SIZE;
+            for (uint32_t i = 0; i < RADIX_SORT_HISTOGRAM_SIZE; ++i)
+            {
+                total[i] += chunk[i];
+            }
+        }
+
+        RadixSort64(context->m_RenderListSortKeys.Begin(), values, context->m_RenderListSortKeysTmp.Begin(), context->m_RenderListSortIndicesTmp.Begin(), count, total);
+    }
+
+    static void SortRenderListIndices(HRenderContext context, dmArray<uint32_t>& sort_buffer)
+    {
+        DM_PROFILE("DrawRenderList_SORT");
+
+        uint32_t count = sort_buffer.Size();
+        const RenderListSortValue* sort_values = context->m_RenderListSortValues.Begin();
+        uint64_t* keys = GetRenderListSortKeys(context, count);
+        uint32_t* indices = sort_buffer.Begin();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            keys[i] = sort_values[indices[i]].m_SortKey;
+        }
+
+        SortRenderListKeys(context, indices, count);
+    }
+
+    // Merges the debug entries flushed so far into a sorted render list. The debug renderer flushes before each draw,
+    // and there are only a few entries, so this is much cheaper than sorting the whole render list again.
+    static dmArray<uint32_t>& MergeDebugRenderList(HRenderContext context, uint32_t tag_count, dmhash_t* tags, RenderListSortCacheEntry* entry)
+    {
+        const dmArray<uint32_t>& debug_indices = context->m_DebugRenderListIndices;
+        uint32_t debug_count = debug_indices.Size();
+        if (debug_count == 0)
+            return entry->m_Indices;
+
+        dmArray<uint32_t>& merged = context->m_RenderListMergedIndices;
+        if (merged.Capacity() < entry->m_Indices.Size() + debug_count)
+        {
+            merged.SetCapacity(entry->m_Indices.Size() + debug_count);
+        }
+        merged.SetSize(0);
+
+        // The radix sort scratch buffers are free here
+        if (context->m_RenderListSortKeysTmp.Capacity() < debug_count)
+        {
+            context->m_RenderListSortKeysTmp.SetCapacity(debug_count);
+            context->m_RenderListSortIndicesTmp.SetCapacity(debug_count);
+        }
+        uint64_t* keys = context->m_RenderListSortKeysTmp.Begin();
+        uint32_t* debug_sorted = context->m_RenderListSortIndicesTmp.Begin();
+
+        // The matching debug entries, in sorted order (stable insertion sort, as there are only a few)
+        const RenderListEntry* entries = context->m_RenderList.Begin();
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < debug_count; ++i)
+        {
+            uint32_t idx = debug_indices[i];
+            const RenderListEntry* e = &entries[idx];
+            if (tag_count > 0)
+            {
+                MaterialTagList taglist;
+                dmRender::GetMaterialTagList(context, e->m_TagListKey, &taglist);
+                if (!dmRender::MatchMaterialTags(taglist.m_Count, taglist.m_Tags, tag_count, tags))
+                    continue;
+            }
+
+            RenderListSortValue value;
+            value.m_SortKey = 0;
+            value.m_MajorOrder = e->m_MajorOrder;
+            value.m_Order = e->m_Order;
+            value.m_MinorOrder = e->m_MinorOrder;
+            value.m_BatchKey = e->m_BatchKey & 0x00ffffff;
+            value.m_Dispatch = e->m_Dispatch;
+
+            uint32_t j = count++;
+            for (; j > 0 && keys[j-1] > value.m_SortKey; --j)
+            {
+                keys[j] = keys[j-1];
+                debug_sorted[j] = debug_sorted[j-1];
+            }
+            keys[j] = value.m_SortKey;
+            debug_sorted[j] = idx;
+        }
+
+        if (count == 0)
+            return entry->m_Indices;
+
+        const uint32_t* sorted = entry->m_Indices.Begin();
+        const uint64_t* sorted_keys = entry->m_Keys.Begin();
+        uint32_t sorted_count = entry->m_Indices.Size();
+        uint32_t s = 0;
+        uint32_t d = 0;
+        while (s < sorted_count || d < count)
+        {
+            if (d == count || (s < sorted_count && sorted_keys[s] <= keys[d]))
+                merged.Push(sorted[s++]);
+            else
+                merged.Push(debug_sorted[d++]);
+        }
+        return merged;
+    }
+
+    // Returns the sorted render list indices matching the predicate. The result only depends on the render list,
+    // the predicate tags, the view projection and the frustum culling, so several draws with the same state in one frame share it.
+    static dmArray<uint32_t>& GetSortedRenderList(HRenderContext context, HPredicate predicate, dmhash_t frustum_hash)
+    {
+        uint32_t tag_count = predicate ? predicate->m_TagCount : 0;
+        dmhash_t* tags = predicate ? predicate->m_Tags : 0;
+
+        HashState64 state;
+        dmHashInit64(&state, false);
+        dmHashUpdateBuffer64(&state, tags, tag_count * sizeof(dmhash_t));
+        dmHashUpdateBuffer64(&state, &context->m_ViewProj, sizeof(Matrix4));
+        dmHashUpdateBuffer64(&state, &frustum_hash, sizeof(frustum_hash));
+        dmhash_t key = dmHashFinal64(&state);
+
+        uint32_t version = context->m_RenderListVersion;
+        uint32_t tick = ++context->m_RenderListSortCacheTick;
+
+        // Look for a match, and otherwise pick an outdated or the least recently used entry
+        RenderListSortCacheEntry* entry = &context->m_RenderListSortCache[0];
+        for (uint32_t i = 0; i < RENDER_LIST_SORT_CACHE_SIZE; ++i)
+        {
+            RenderListSortCacheEntry* e = &context->m_RenderListSortCache[i];
+            if (e->m_Version == version && e->m_Key == key)
+            {
+                e->m_LastUsed = tick;
+                DM_PROPERTY_ADD_U32(rmtp_RenderListSortCacheHits, 1);
+                return MergeDebugRenderList(context, tag_count, tags, e);
             }
+            if (entry->m_Version == version && (e->m_Version != version || e->m_LastUsed < entry->m_LastUsed))
+            {
+                entry = e;
+            }
+        }
+
+        uint64_t start = dmTime::GetTime();
+
+        MakeSortBuffer(context, tag_count, tags, entry->m_Indices);
+        SortRenderListIndices(context, entry->m_Indices);
+        uint32_t count = entry->m_Indices.Size();
+        if (entry->m_Keys.Capacity() < count)
+        {
+            entry->m_Keys.SetCapacity(entry->m_Indices.Capacity());
+        }
+        entry->m_Keys.SetSize(count);
+        if (count > 0)
+        {
+            memcpy(entry->m_Keys.Begin(), context->m_RenderListSortKeys.Begin(), count * sizeof(uint64_t));
         }
+        entry->m_Key = key;
+        entry->m_Version = version;
+        entry->m_LastUsed = tick;
+
+        DM_PROPERTY_ADD_U32(rmtp_RenderListSortCacheMisses, 1);
+        DM_PROPERTY_ADD_U32(rmtp_RenderListSortTime, (uint32_t)(dmTime::GetTime() - start));
+        return MergeDebugRenderList(context, tag_count, tags, entry);
     }
 
     static void CollectRenderEntryRange(void* _ctx, uint32_t tag_list_key, size_t start, size_t count)
@@ -592,27 +1023,6 @@ namespace dmRender
         context->m_RenderListRanges.Push(range);
     }
 
-    void FindRenderListRanges(uint32_t* first, size_t offset, size_t size, RenderListEntry* entries, FindRangeComparator& comp, void* ctx, RangeCallback callback )
-    {
-        if (size == 0)
-            return;
-
-        size_t half = size >> 1;
-        uint32_t* low = first + offset;
-        uint32_t* high = low + size;
-        uint32_t* middle = low + half;
-        uint32_t val = entries[*middle].m_TagListKey;
-
-        low = std::lower_bound(low, middle, *middle, comp);
-        high = std::upper_bound(middle, high, *middle, comp);
-
-        callback(ctx, val, low - first, high - low);
-
-        uint32_t* rangefirst = first + offset;
-        FindRenderListRanges(first, offset, low - rangefirst, entries, comp, ctx, callback);
-        FindRenderListRanges(first, high - first, size - (high - rangefirst), entries, comp, ctx, callback);
-    }
-
     static void SortRenderList(HRenderContext context)
     {
         DM_PROFILE("SortRenderList");
@@ -620,18 +1030,27 @@ namespace dmRender
         if (context->m_RenderList.Empty())
             return;
 
+        uint32_t count = context->m_RenderListSortIndices.Size();
+        uint32_t* indices = context->m_RenderListSortIndices.Begin();
+        const RenderListEntry* entries = context->m_RenderList.Begin();
+
         // First sort on the tag masks
+        uint64_t* keys = GetRenderListSortKeys(context, count);
+        for (uint32_t i = 0; i < count; ++i)
         {
-            RenderListEntrySorter sort;
-            sort.m_Base = context->m_RenderList.Begin();
-            std::stable_sort(context->m_RenderListSortIndices.Begin(), context->m_RenderListSortIndices.End(), sort);
+            keys[i] = entries[indices[i]].m_TagListKey;
         }
-        // Now find the ranges of tag masks
+        SortRenderListKeys(context, indices, count);
+
+        // Now find the ranges of tag masks, in the order of the sorted render list
+        uint32_t start = 0;
+        for (uint32_t i = 1; i <= count; ++i)
         {
-            RenderListEntry* entries = context->m_RenderList.Begin();
-            FindRangeComparator comp;
-            comp.m_Entries = entries;
-            FindRenderListRanges(context->m_RenderListSortIndices.Begin(), 0, context->m_RenderListSortIndices.Size(), entries, comp, context, CollectRenderEntryRange);
+            if (i == count || keys[i] != keys[start])
+            {
+                CollectRenderEntryRange(context, (uint32_t)keys[start], start, i - start);
+                start = i;
+            }
         }
     }
 
@@ -827,18 +1246,11 @@ namespace dmRender
             }
         }
 
-        MakeSortBuffer(context, predicate?predicate->m_TagCount:0, predicate?predicate->m_Tags:0);
+        dmArray<uint32_t>& sort_buffer = GetSortedRenderList(context, predicate, frustum_hash);
 
-        if (context->m_RenderListSortBuffer.Empty())
+        if (sort_buffer.Empty())
             return RESULT_OK;
 
-        {
-            DM_PROFILE("DrawRenderList_SORT");
-            RenderListSorter sort;
-            sort.values = context->m_RenderListSortValues.Begin();
-            std::stable_sort(context->m_RenderListSortBuffer.Begin(), context->m_RenderListSortBuffer.End(), sort);
-        }
-
         // Construct render objects
         context->m_RenderObjects.SetSize(0);
 
@@ -865,15 +1277,15 @@ namespace dmRender
 
         // Make batches for matching dispatch, batch key & minor order
         RenderListEntry *base = context->m_RenderList.Begin();
-        uint32_t *last = context->m_RenderListSortBuffer.Begin();
-        uint32_t count = context->m_RenderListSortBuffer.Size();
+        uint32_t *last = sort_buffer.Begin();
+        uint32_t count = sort_buffer.Size();
 
         {
             DM_PROFILE("Dispatch_Batch");
 
             for (uint32_t i=1;i<=count;i++)
             {
-                uint32_t *idx = context->m_RenderListSortBuffer.Begin() + i;
+                uint32_t *idx = sort_buffer.Begin() + i;
                 const RenderListEntry *last_entry = &base[*last];
                 const RenderListEntry *current_entry = &base[*idx];
 
@@ -21,6 +21,7 @@
 #include <dmsdk/render/render.h>
 
 #include <dlib/hash.h>
+#include <dlib/job_system.h>
 #include <script/script.h>
 #include <script/lua_source_ddf.h>
 #include <graphics/graphics.h>
@@ -30,6 +31,12 @@ namespace dmRender
 {
     extern const char* RENDER_SOCKET_NAME;
 
+    /// Config key to use for tweaking the min number of render list entries for the render list to be sorted on the job threads
+    extern const char* RENDER_LIST_JOB_MIN_ENTRY_COUNT_KEY;
+
+    /// Default min number of render list entries for the render list to be sorted on the job threads (0 disables)
+    static const uint32_t DEFAULT_RENDER_LIST_JOB_MIN_ENTRY_COUNT = 0;
+
     static const uint32_t MAX_MATERIAL_TAG_COUNT = 32; // Max tag count per material
 
     static const dmhash_t VERTEX_STREAM_POSITION   = dmHashString64("position");
@@ -148,6 +155,25 @@ namespace dmRender
 
     void SetSystemFontMap(HRenderContext render_context, HFontMap font_map);
 
+    /**
+     * Set the job system used when sorting the render list.
+     * With at least min_entry_count entries, the z values and the radix sort histograms
+     * are computed in parallel, smaller render lists are sorted on the calling thread.
+     * @param render_context Render context
+     * @param job_system Job system, or 0x0 to only use the calling thread
+     * @param min_entry_count Min number of render list entries to use the job workers. 0 disables parallel processing.
+     */
+    void SetRenderListJobSystem(HRenderContext render_context, dmJobSystem::HJobSystem job_system, uint32_t min_entry_count);
+
+    /**
+     * Get the job system to use when processing entry_count render list entries,
+     * e.g. when frustum culling them in a visibility callback.
+     * @param render_context Render context
+     * @param entry_count Number of render list entries to process
+     * @return The job system, or 0x0 if the entries should be processed on the calling thread
+     */
+    dmJobSystem::HJobSystem GetRenderListJobSystem(HRenderContext render_context, uint32_t entry_count);
+
     dmGraphics::HContext GetGraphicsContext(HRenderContext render_context);
 
     const dmVMath::Matrix4& GetViewProjectionMatrix(HRenderContext render_context);
@@ -221,6 +221,22 @@ namespace dmRender
         };
     };
 
+    const uint32_t RENDER_LIST_SORT_CACHE_SIZE = 4;
+    const uint32_t RENDER_LIST_JOB_MIN_CHUNK_SIZE = 1024;
+    const uint32_t RENDER_LIST_JOB_MAX_CHUNK_COUNT = 16;
+    const uint32_t RADIX_SORT_HISTOGRAM_SIZE = 8 * 256; // One 256 bucket histogram per byte of a 64 bit key
+
+    // The sorted render list indices from a DrawRenderList call. Reused by later calls
+    // in the same frame with the same predicate, view projection and frustum.
+    struct RenderListSortCacheEntry
+    {
+        dmArray<uint32_t>           m_Indices;
+        dmArray<uint64_t>           m_Keys;         // The sort keys of m_Indices, for merging in the debug entries
+        dmhash_t                    m_Key;
+        uint32_t                    m_Version;      // RenderContext::m_RenderListVersion when the entry was sorted
+        uint32_t                    m_LastUsed;
+    };
+
     struct RenderListRange
     {
         uint32_t m_TagListKey;
@@ -253,8 +269,16 @@ namespace dmRender
         dmArray<RenderListEntry>    m_RenderList;
         dmArray<RenderListDispatch> m_RenderListDispatch;
         dmArray<RenderListSortValue>m_RenderListSortValues;
-        dmArray<uint32_t>           m_RenderListSortBuffer;
         dmArray<uint32_t>           m_RenderListSortIndices;
+        RenderListSortCacheEntry    m_RenderListSortCache[RENDER_LIST_SORT_CACHE_SIZE];
+        dmArray<uint64_t>           m_RenderListSortKeys;       // Scratch buffers for the radix sort
+        dmArray<uint64_t>           m_RenderListSortKeysTmp;
+        dmArray<uint32_t>           m_RenderListSortIndicesTmp;
+        dmArray<uint32_t>           m_RenderListSortHistograms; // RADIX_SORT_HISTOGRAM_SIZE counters per job chunk
+        uint32_t                    m_RenderListVersion;        // Incremented when the render list changes (except for the debug entries)
+        dmArray<uint32_t>           m_DebugRenderListIndices;   // Entries flushed by the debug renderer, kept out of the sorted lists
+        dmArray<uint32_t>           m_RenderListMergedIndices;  // A sorted list with the debug entries merged in
+        uint32_t                    m_RenderListSortCacheTick;
         dmArray<RenderListRange>    m_RenderListRanges;         // Maps tagmask to a range in the (sorted) render list
         dmArray<TextureBinding>     m_TextureBindTable;
         dmhash_t                    m_FrustumHash;
@@ -269,6 +293,9 @@ namespace dmRender
 
         dmGraphics::HContext        m_GraphicsContext;
 
+        dmJobSystem::HJobSystem     m_JobSystem;
+        uint32_t                    m_RenderListJobMinEntryCount;
+
         HMaterial                   m_Material;
 
         dmMessage::HSocket          m_Socket;
@@ -293,6 +320,18 @@ namespace dmRender
 
     Result GenerateKey(HRenderContext render_context, const Matrix4& view_matrix);
 
+    // Like RenderListAlloc/RenderListSubmit, for the debug renderer flushing in the middle of a frame.
+    // The entries are kept out of the sorted render lists, so they don't invalidate the cached sorts.
+    RenderListEntry* RenderListAllocDebug(HRenderContext render_context, uint32_t entries);
+    void RenderListSubmitDebug(HRenderContext render_context, RenderListEntry* begin, RenderListEntry* end);
+
+    // Stable sort of values by keys (LSD radix sort). The tmp buffers must hold count elements.
+    void RadixSort64(uint64_t* keys, uint32_t* values, uint64_t* tmp_keys, uint32_t* tmp_values, uint32_t count);
+    // Same as above, using histograms (RADIX_SORT_HISTOGRAM_SIZE counters) already filled in by RadixSortCountKeys. The histograms are modified.
+    void RadixSort64(uint64_t* keys, uint32_t* values, uint64_t* tmp_keys, uint32_t* tmp_values, uint32_t count, uint32_t* histograms);
+    // Adds the bytes of the keys to the histograms
+    void RadixSortCountKeys(const uint64_t* keys, uint32_t count, uint32_t* histograms);
+
     void GetProgramUniformCount(dmGraphics::HProgram program, uint32_t total_constants_count, uint32_t* constant_count_out, uint32_t* samplers_count_out);
     void SetMaterialConstantValues(dmGraphics::HContext graphics_context, dmGraphics::HProgram program, uint32_t total_constants_count, dmHashTable64<dmGraphics::HUniformLocation>& name_hash_to_location, dmArray<RenderConstant>& constants, dmArray<Sampler>& samplers);
 
@@ -310,32 +349,6 @@ namespace dmRender
     bool    GetCanBindTexture(dmGraphics::HTexture texture, HSampler sampler, uint32_t unit);
     int32_t GetMaterialSamplerIndex(HMaterial material, dmhash_t name_hash);
 
-    // Exposed here for unit testing
-    struct RenderListEntrySorter
-    {
-        bool operator()(int a, int b) const
-        {
-            const RenderListEntry& ea = m_Base[a];
-            const RenderListEntry& eb = m_Base[b];
-            return ea.m_TagListKey < eb.m_TagListKey;
-        }
-        RenderListEntry* m_Base;
-    };
-
-    struct FindRangeComparator
-    {
-        RenderListEntry* m_Entries;
-        bool operator() (const uint32_t& a, const uint32_t& b) const
-        {
-            return m_Entries[a].m_TagListKey < m_Entries[b].m_TagListKey;
-        }
-    };
-
-    typedef void (*RangeCallback)(void* ctx, uint32_t val, size_t start, size_t count);
-
-    // Invokes the callback for each range. Two ranges are not guaranteed to preceed/succeed one another.
-    void FindRenderListRanges(uint32_t* first, size_t offset, size_t size, RenderListEntry* entries, FindRangeComparator& comp, void* ctx, RangeCallback callback );
-
     bool FindTagListRange(RenderListRange* ranges, uint32_t num_ranges, uint32_t tag_list_key, RenderListRange& range);
 
 
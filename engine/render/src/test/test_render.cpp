@@ -20,6 +20,7 @@
 #include <testmain/testmain.h>
 #include <dlib/hash.h>
 #include <dlib/math.h>
+#include <dlib/time.h>
 
 #include <script/script.h>
 #include <algorithm> // std::stable_sort
@@ -1191,6 +1192,256 @@ TEST_F(dmRenderTest, TestRenderListOrder)
     ASSERT_EQ(ctx.m_Z, orders[2]);
 }
 
+struct TestRenderListSortCacheCtx
+{
+    dmArray<float> m_Z;
+};
+
+static void TestRenderListSortCacheDispatch(dmRender::RenderListDispatchParams const & params)
+{
+    TestRenderListSortCacheCtx *ctx = (TestRenderListSortCacheCtx*) params.m_UserData;
+    if (params.m_Operation == dmRender::RENDER_LIST_OPERATION_BATCH)
+    {
+        for (uint32_t* i = params.m_Begin; i != params.m_End; ++i)
+        {
+            if (ctx->m_Z.Full())
+                ctx->m_Z.OffsetCapacity(32);
+            ctx->m_Z.Push(params.m_Buf[*i].m_WorldPosition.getZ());
+        }
+    }
+}
+
+static uint32_t CountValidSortCacheEntries(dmRender::HRenderContext context)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < dmRender::RENDER_LIST_SORT_CACHE_SIZE; ++i)
+    {
+        if (context->m_RenderListSortCache[i].m_Version == context->m_RenderListVersion)
+            ++count;
+    }
+    return count;
+}
+
+TEST_F(dmRenderTest, TestRenderListSortCache)
+{
+    TestRenderListSortCacheCtx ctx;
+
+    dmVMath::Matrix4 view = dmVMath::Matrix4::identity();
+    dmVMath::Matrix4 proj = dmVMath::Matrix4::orthographic(0.0f, WIDTH, 0.0f, HEIGHT, -100.0f, 100.0f);
+    dmRender::SetViewMatrix(m_Context, view);
+    dmRender::SetProjectionMatrix(m_Context, proj);
+
+    dmRender::RenderListBegin(m_Context);
+    uint8_t dispatch = dmRender::RenderListMakeDispatch(m_Context, TestRenderListSortCacheDispatch, 0, &ctx);
+
+    const uint32_t n = 16;
+    dmRender::RenderListEntry* out = dmRender::RenderListAlloc(m_Context, n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        dmRender::RenderListEntry& entry = out[i];
+        entry.m_WorldPosition = Point3(0, 0, (float)((i * 7) % n) - 8.0f);
+        entry.m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
+        entry.m_MinorOrder = 0;
+        entry.m_TagListKey = 0;
+        entry.m_Order = 0;
+        entry.m_BatchKey = i;
+        entry.m_Dispatch = dispatch;
+        entry.m_UserData = 0;
+    }
+    dmRender::RenderListSubmit(m_Context, out, out + n);
+    dmRender::RenderListEnd(m_Context);
+
+    ctx.m_Z.SetCapacity(n);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(n, ctx.m_Z.Size());
+    ASSERT_EQ(1U, CountValidSortCacheEntries(m_Context));
+    for (uint32_t i = 1; i < n; ++i)
+    {
+        ASSERT_LT(ctx.m_Z[i-1], ctx.m_Z[i]);
+    }
+
+    // Same state, reuses the sorted list
+    dmArray<float> first_order;
+    first_order.SetCapacity(n);
+    first_order.PushArray(ctx.m_Z.Begin(), n);
+    ctx.m_Z.SetSize(0);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(1U, CountValidSortCacheEntries(m_Context));
+    ASSERT_EQ(n, ctx.m_Z.Size());
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        ASSERT_EQ(first_order[i], ctx.m_Z[i]);
+    }
+
+    // A view facing the other way reverses the order
+    dmRender::SetViewMatrix(m_Context, dmVMath::Matrix4::rotationY((float)M_PI));
+    ctx.m_Z.SetSize(0);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(2U, CountValidSortCacheEntries(m_Context));
+    ASSERT_EQ(n, ctx.m_Z.Size());
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        ASSERT_EQ(first_order[n - 1 - i], ctx.m_Z[i]);
+    }
+
+    // New entries invalidate the sorted lists
+    dmRender::SetViewMatrix(m_Context, view);
+    out = dmRender::RenderListAlloc(m_Context, 1);
+    out->m_WorldPosition = Point3(0, 0, 20.0f);
+    out->m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
+    out->m_MinorOrder = 0;
+    out->m_TagListKey = 0;
+    out->m_Order = 0;
+    out->m_BatchKey = n;
+    out->m_Dispatch = dispatch;
+    out->m_UserData = 0;
+    dmRender::RenderListSubmit(m_Context, out, out + 1);
+    ASSERT_EQ(0U, CountValidSortCacheEntries(m_Context));
+
+    ctx.m_Z.SetCapacity(n + 1);
+    ctx.m_Z.SetSize(0);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(n + 1, ctx.m_Z.Size());
+    ASSERT_EQ(20.0f, ctx.m_Z[n]);
+
+    // Debug entries flushed in the middle of the frame are merged into the sorted list, without invalidating it
+    out = dmRender::RenderListAllocDebug(m_Context, 1);
+    out->m_WorldPosition = Point3(0, 0, -50.0f);
+    out->m_MajorOrder = dmRender::RENDER_ORDER_AFTER_WORLD;
+    out->m_MinorOrder = 0;
+    out->m_TagListKey = 0;
+    out->m_Order = 0xfffffe;
+    out->m_BatchKey = 0;
+    out->m_Dispatch = dispatch;
+    out->m_UserData = 0;
+    dmRender::RenderListSubmitDebug(m_Context, out, out + 1);
+    ASSERT_EQ(1U, CountValidSortCacheEntries(m_Context));
+
+    ctx.m_Z.SetCapacity(n + 2);
+    ctx.m_Z.SetSize(0);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(1U, CountValidSortCacheEntries(m_Context));
+    ASSERT_EQ(n + 2, ctx.m_Z.Size());
+    ASSERT_EQ(20.0f, ctx.m_Z[n]);
+    ASSERT_EQ(-50.0f, ctx.m_Z[n + 1]);
+}
+
+// Fills the render list with count world entries, spread over a few tag lists
+static void FillLargeRenderList(dmRender::HRenderContext context, TestRenderListSortCacheCtx* ctx, uint32_t count)
+{
+    const dmhash_t tags[] = {dmHashString64("tag0"), dmHashString64("tag1"), dmHashString64("tag2")};
+    uint32_t tag_list_keys[DM_ARRAY_SIZE(tags)];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(tags); ++i)
+    {
+        tag_list_keys[i] = dmRender::RegisterMaterialTagList(context, 1, &tags[i]);
+    }
+
+    dmRender::RenderListBegin(context);
+    uint8_t dispatch = dmRender::RenderListMakeDispatch(context, TestRenderListSortCacheDispatch, 0, ctx);
+    dmRender::RenderListEntry* out = dmRender::RenderListAlloc(context, count);
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        dmRender::RenderListEntry& entry = out[i];
+        entry.m_WorldPosition = Point3(0, 0, (float)(seed >> 16) / 65536.0f * 200.0f - 100.0f);
+        entry.m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
+        entry.m_MinorOrder = 0;
+        entry.m_TagListKey = tag_list_keys[i % DM_ARRAY_SIZE(tags)];
+        entry.m_Order = 0;
+        entry.m_BatchKey = i;
+        entry.m_Dispatch = dispatch;
+        entry.m_UserData = 0;
+    }
+    dmRender::RenderListSubmit(context, out, out + count);
+    dmRender::RenderListEnd(context);
+
+    ctx->m_Z.SetCapacity(count);
+    ctx->m_Z.SetSize(0);
+}
+
+static dmJobSystem::HJobSystem CreateRenderListJobSystem()
+{
+    dmJobSystem::Params job_system_params;
+    dmJobSystem::SetDefaultParams(&job_system_params);
+    job_system_params.m_Name = "test_render_list";
+    job_system_params.m_WorkerCount = 4;
+    return dmJobSystem::New(job_system_params);
+}
+
+TEST_F(dmRenderTest, TestRenderListJobSystem)
+{
+    TestRenderListSortCacheCtx ctx;
+    dmRender::SetViewMatrix(m_Context, dmVMath::Matrix4::identity());
+    dmRender::SetProjectionMatrix(m_Context, dmVMath::Matrix4::orthographic(0.0f, WIDTH, 0.0f, HEIGHT, -100.0f, 100.0f));
+
+    const uint32_t n = 10000;
+    FillLargeRenderList(m_Context, &ctx, n);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(n, ctx.m_Z.Size());
+
+    dmArray<float> expected;
+    expected.SetCapacity(n);
+    expected.PushArray(ctx.m_Z.Begin(), n);
+
+    // Same render list sorted on the job workers gives the same order
+    dmJobSystem::HJobSystem job_system = CreateRenderListJobSystem();
+    dmRender::SetRenderListJobSystem(m_Context, job_system, 1);
+    FillLargeRenderList(m_Context, &ctx, n);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    dmRender::SetRenderListJobSystem(m_Context, 0, 0);
+    dmJobSystem::Delete(job_system);
+
+    ASSERT_EQ(n, ctx.m_Z.Size());
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        ASSERT_EQ(expected[i], ctx.m_Z[i]);
+    }
+}
+
+// Benchmark of the render list sorting, on the calling thread and on the job workers
+
+static uint64_t BenchmarkRenderListSort(dmRender::HRenderContext context, TestRenderListSortCacheCtx* ctx, uint32_t count)
+{
+    FillLargeRenderList(context, ctx, count);
+    uint64_t start = dmTime::GetTime();
+    dmRender::DrawRenderList(context, 0, 0, 0);
+    return dmTime::GetTime() - start;
+}
+
+TEST_F(dmRenderTest, BenchmarkRenderListSort)
+{
+    dmJobSystem::HJobSystem job_system = CreateRenderListJobSystem();
+    if (dmJobSystem::GetWorkerCount(job_system) == 0)
+    {
+        dmJobSystem::Delete(job_system);
+        return;
+    }
+
+    TestRenderListSortCacheCtx ctx;
+    dmRender::SetViewMatrix(m_Context, dmVMath::Matrix4::identity());
+    dmRender::SetProjectionMatrix(m_Context, dmVMath::Matrix4::orthographic(0.0f, WIDTH, 0.0f, HEIGHT, -100.0f, 100.0f));
+
+    const uint32_t counts[] = {1000, 10000, 50000, 100000, 200000};
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(counts); ++i)
+    {
+        uint32_t count = counts[i];
+
+        dmRender::SetRenderListJobSystem(m_Context, 0, 0);
+        uint64_t single_thread_time = BenchmarkRenderListSort(m_Context, &ctx, count);
+        ASSERT_EQ(count, ctx.m_Z.Size());
+
+        dmRender::SetRenderListJobSystem(m_Context, job_system, 1);
+        uint64_t job_system_time = BenchmarkRenderListSort(m_Context, &ctx, count);
+        ASSERT_EQ(count, ctx.m_Z.Size());
+
+        printf("%u render list entries: single thread %.3f ms  %u job workers %.3f ms\n",
+                count, single_thread_time / 1000.0f, dmJobSystem::GetWorkerCount(job_system), job_system_time / 1000.0f);
+    }
+    dmRender::SetRenderListJobSystem(m_Context, 0, 0);
+    dmJobSystem::Delete(job_system);
+}
+
 TEST_F(dmRenderTest, TestRenderListDebug)
 {
     // Test submitting debug drawing when there is no other drawing going on
@@ -1437,101 +1688,74 @@ TEST_F(dmRenderTest, TextAlignment)
     }
 }
 
-struct SRangeCtx
-{
-    uint32_t m_NumRanges;
-    dmRender::RenderListRange m_Ranges[16];
-};
-
-static void CollectRenderEntryRange(void* _ctx, uint32_t tag_list_key, size_t start, size_t count)
+TEST_F(dmRenderTest, FindRanges)
 {
-    SRangeCtx* ctx = (SRangeCtx*)_ctx;
-    if (ctx->m_NumRanges >= sizeof(ctx->m_Ranges)/sizeof(ctx->m_Ranges[0]))
+    const dmhash_t tags[] = {dmHashString64("tag0"), dmHashString64("tag1"), dmHashString64("tag2"), dmHashString64("tag3"), dmHashString64("tag4")};
+    const uint32_t tag_count = DM_ARRAY_SIZE(tags);
+    uint32_t tag_list_keys[tag_count];
+    for (uint32_t i = 0; i < tag_count; ++i)
     {
-        return;
+        tag_list_keys[i] = dmRender::RegisterMaterialTagList(m_Context, 1, &tags[i]);
     }
-    dmRender::RenderListRange& range = ctx->m_Ranges[ctx->m_NumRanges++];
-    range.m_TagListKey = tag_list_key;
-    range.m_Start = start;
-    range.m_Count = count;
-}
 
-TEST_F(dmRenderTest, FindRanges)
-{
-    // Create unsorted list
-    const uint32_t count = 32; // Large enough to avoid the initial intro sort
-    dmRender::RenderListEntry entries[count];
-    uint32_t indices[count];
-    for( uint32_t i = 0; i < count; ++i) {
-        indices[i] = i;
-        entries[i].m_Order = i;
-        entries[i].m_TagListKey = i % 5;
+    // Create an unsorted list
+    TestRenderListSortCacheCtx sort_ctx;
+    const uint32_t count = 32;
+    dmRender::RenderListBegin(m_Context);
+    uint8_t dispatch = dmRender::RenderListMakeDispatch(m_Context, TestRenderListSortCacheDispatch, 0, &sort_ctx);
+    dmRender::RenderListEntry* out = dmRender::RenderListAlloc(m_Context, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        dmRender::RenderListEntry& entry = out[i];
+        entry.m_WorldPosition = Point3(0, 0, 0);
+        entry.m_MajorOrder = dmRender::RENDER_ORDER_WORLD;
+        entry.m_MinorOrder = 0;
+        entry.m_TagListKey = tag_list_keys[i % tag_count];
+        entry.m_Order = i;
+        entry.m_BatchKey = 0;
+        entry.m_Dispatch = dispatch;
+        entry.m_UserData = 0;
     }
+    dmRender::RenderListSubmit(m_Context, out, out + count);
+    dmRender::RenderListEnd(m_Context);
+
+    sort_ctx.m_Z.SetCapacity(count);
+    dmRender::DrawRenderList(m_Context, 0, 0, 0);
+    ASSERT_EQ(count, sort_ctx.m_Z.Size());
 
-    // Sort the entries
-    dmRender::RenderListEntrySorter sort;
-    sort.m_Base = entries;
-    std::stable_sort(indices, indices + count, sort);
+    dmRender::RenderListRange* ranges = m_Context->m_RenderListRanges.Begin();
+    uint32_t num_ranges = m_Context->m_RenderListRanges.Size();
+    ASSERT_EQ(tag_count, num_ranges);
 
-    // Make sure it's sorted
-    bool sorted = true;
-    uint32_t last_idx = 0;
-    uint32_t tag_list_key = entries[0].m_TagListKey;
-    for( uint32_t i = 0; i < count; ++i)
+    // The ranges cover the list, in the order of the sorted indices
+    const uint32_t expected_counts[tag_count] = {7, 7, 6, 6, 6};
+    uint32_t start = 0;
+    for (uint32_t i = 0; i < num_ranges; ++i)
     {
-        uint32_t idx = indices[i];
+        ASSERT_EQ(start, ranges[i].m_Start);
+        start += ranges[i].m_Count;
+    }
+    ASSERT_EQ(count, start);
 
-        if (entries[idx].m_TagListKey < tag_list_key)
-        {
-            sorted = false;
-            break;
-        }
-        else if(entries[idx].m_TagListKey > tag_list_key)
-        {
-            last_idx = idx;
-        }
+    const dmRender::RenderListEntry* entries = m_Context->m_RenderList.Begin();
+    const uint32_t* indices = m_Context->m_RenderListSortIndices.Begin();
+    for (uint32_t i = 0; i < tag_count; ++i)
+    {
+        dmRender::RenderListRange range;
+        ASSERT_TRUE(dmRender::FindTagListRange(ranges, num_ranges, tag_list_keys[i], range));
+        ASSERT_EQ(tag_list_keys[i], range.m_TagListKey);
+        ASSERT_EQ(expected_counts[i], range.m_Count);
 
-        if (idx < last_idx)
+        // Stable, so the entries of a tag list keep their order
+        for (uint32_t j = range.m_Start; j < range.m_Start + range.m_Count; ++j)
         {
-            sorted = false;
-            break;
+            ASSERT_EQ(tag_list_keys[i], entries[indices[j]].m_TagListKey);
+            if (j > range.m_Start)
+            {
+                ASSERT_LT(indices[j-1], indices[j]);
+            }
         }
-
-        tag_list_key = entries[idx].m_TagListKey;
-        last_idx = idx;
     }
-    ASSERT_TRUE(sorted);
-
-    SRangeCtx ctx;
-    ctx.m_NumRanges = 0;
-
-    dmRender::FindRangeComparator comp;
-    comp.m_Entries = entries;
-    dmRender::FindRenderListRanges(indices, 0, sizeof(indices)/sizeof(indices[0]), entries, comp, &ctx, CollectRenderEntryRange);
-
-    ASSERT_EQ(5, ctx.m_NumRanges);
-
-    dmRender::RenderListRange range;
-    ASSERT_TRUE(dmRender::FindTagListRange(ctx.m_Ranges, ctx.m_NumRanges, 0, range));
-    ASSERT_EQ(0, range.m_TagListKey);
-    ASSERT_EQ(0, range.m_Start);
-    ASSERT_EQ(7, range.m_Count);
-    ASSERT_TRUE(dmRender::FindTagListRange(ctx.m_Ranges, ctx.m_NumRanges, 1, range));
-    ASSERT_EQ(1, range.m_TagListKey);
-    ASSERT_EQ(7, range.m_Start);
-    ASSERT_EQ(7, range.m_Count);
-    ASSERT_TRUE(dmRender::FindTagListRange(ctx.m_Ranges, ctx.m_NumRanges, 2, range));
-    ASSERT_EQ(2, range.m_TagListKey);
-    ASSERT_EQ(14, range.m_Start);
-    ASSERT_EQ(6, range.m_Count);
-    ASSERT_TRUE(dmRender::FindTagListRange(ctx.m_Ranges, ctx.m_NumRanges, 3, range));
-    ASSERT_EQ(3, range.m_TagListKey);
-    ASSERT_EQ(20, range.m_Start);
-    ASSERT_EQ(6, range.m_Count);
-    ASSERT_TRUE(dmRender::FindTagListRange(ctx.m_Ranges, ctx.m_NumRanges, 4, range));
-    ASSERT_EQ(4, range.m_TagListKey);
-    ASSERT_EQ(26, range.m_Start);
-    ASSERT_EQ(6, range.m_Count);
 }
 
 TEST(Constants, Constant)
@@ -1813,6 +2037,55 @@ TEST(Constants, NamedConstants)
     dmRender::DeleteNamedConstantBuffer(buffer);
 }
 
+struct RadixSortTestPair
+{
+    uint64_t m_Key;
+    uint32_t m_Value;
+};
+
+static bool RadixSortTestPairLess(const RadixSortTestPair& a, const RadixSortTestPair& b)
+{
+    return a.m_Key < b.m_Key;
+}
+
+TEST(Render, RadixSort64)
+{
+    const uint32_t count = 10000;
+    dmArray<uint64_t> keys;
+    dmArray<uint32_t> values;
+    dmArray<uint64_t> tmp_keys;
+    dmArray<uint32_t> tmp_values;
+    dmArray<RadixSortTestPair> expected;
+    keys.SetCapacity(count);
+    values.SetCapacity(count);
+    tmp_keys.SetCapacity(count);
+    tmp_keys.SetSize(count);
+    tmp_values.SetCapacity(count);
+    tmp_values.SetSize(count);
+    expected.SetCapacity(count);
+
+    // Few distinct keys, spread over all bytes, to verify that the sort is stable
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        uint64_t key = (uint64_t)(seed >> 28) << ((seed >> 8) % 8 * 8);
+        RadixSortTestPair pair = {key, i};
+        keys.Push(key);
+        values.Push(i);
+        expected.Push(pair);
+    }
+
+    std::stable_sort(expected.Begin(), expected.End(), RadixSortTestPairLess);
+    dmRender::RadixSort64(keys.Begin(), values.Begin(), tmp_keys.Begin(), tmp_values.Begin(), count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(expected[i].m_Key, keys[i]);
+        ASSERT_EQ(expected[i].m_Value, values[i]);
+    }
+}
+
 static bool BatchEntryTestEq(int* a, int* b)
 {
     return *a == *b;
@@ -0,0 +1,42 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+// 
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+// 
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "resource.h"
+#include "resource_private.h"
+#include "load_queue.h"
+
+#include <string.h>
+
+namespace dmLoadQueue
+{
+    void CreateResource(dmResource::HFactory factory, const char* name, const PreloadInfo* info, const void* buffer, uint32_t buffer_size, LoadResult* load_result)
+    {
+        dmResource::SResourceDescriptor* resource = &load_result->m_Resource;
+        memset(resource, 0, sizeof(*resource));
+        resource->m_NameHash           = info->m_CanonicalPathHash;
+        resource->m_ReferenceCount     = 1;
+        resource->m_ResourceType       = info->m_ResourceType;
+        resource->m_ResourceSizeOnDisc = buffer_size;
+
+        dmResource::ResourceCreateParams params;
+        params.m_Factory     = factory;
+        params.m_Context     = info->m_Context;
+        params.m_PreloadData = load_result->m_PreloadData;
+        params.m_Resource    = resource;
+        params.m_Filename    = name;
+        params.m_Buffer      = buffer;
+        params.m_BufferSize  = buffer_size;
+        load_result->m_CreateResult = info->m_CreateFunction(params);
+    }
+} // namespace dmLoadQueue
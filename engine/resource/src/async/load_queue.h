@@ -28,6 +28,13 @@ namespace dmLoadQueue
         RESULT_INVALID_PARAM = -2
     };
 
+    struct QueueParams
+    {
+        uint32_t m_WorkerCount;    // Number of load threads
+        uint32_t m_Slots;          // Max number of requests in flight
+        uint32_t m_MaxPendingData; // Loaded bytes waiting for EndLoad/FreeLoad before the workers pause
+    };
+
     typedef struct Queue* HQueue;
     typedef struct Request* HRequest;
 
@@ -36,6 +43,12 @@ namespace dmLoadQueue
         dmResource::FResourcePreload m_CompleteFunction;
         dmResource::PreloadHintInfo  m_HintInfo;
         void*                        m_Context;
+        bool                         m_ZeroCopy; // Try to use the archive memory directly instead of loading into a buffer
+
+        // Set for types with a thread safe create function, which is then called on the load thread after preload
+        dmResource::FResourceCreate  m_CreateFunction;
+        void*                        m_ResourceType;
+        dmhash_t                     m_CanonicalPathHash;
     };
 
     struct LoadResult
@@ -43,8 +56,15 @@ namespace dmLoadQueue
         dmResource::Result m_LoadResult;
         dmResource::Result m_PreloadResult;
         void* m_PreloadData;
+        bool m_ZeroCopy; // The buffer points into read only archive memory, and outlives the request
+        // RESULT_PENDING unless the create function was called on the load thread
+        dmResource::Result m_CreateResult;
+        dmResource::SResourceDescriptor m_Resource;
     };
 
+    // Runs the create step of a thread safe resource type on the loaded data. Used by the queue implementations
+    void CreateResource(dmResource::HFactory factory, const char* name, const PreloadInfo* info, const void* buffer, uint32_t buffer_size, LoadResult* load_result);
+
     HQueue CreateQueue(dmResource::HFactory factory);
     void DeleteQueue(HQueue queue);
 
@@ -53,6 +73,7 @@ namespace dmLoadQueue
     HRequest BeginLoad(HQueue queue, const char* name, const char* canonical_path, PreloadInfo* info);
 
     // Actual load result will be put in load_result. Ptrs can be handled until FreeLoad has been called.
+    // Requests may complete in any order.
     Result EndLoad(HQueue queue, HRequest request, void** buf, uint32_t* size, LoadResult* load_result);
 
     // Free once completed.
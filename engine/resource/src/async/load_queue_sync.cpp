@@ -73,9 +73,24 @@ namespace dmLoadQueue
             return RESULT_INVALID_PARAM;
         }
 
-        load_result->m_LoadResult    = dmResource::LoadResource(queue->m_Factory, request->m_CanonicalPath, request->m_Name, buf, size);
+        load_result->m_LoadResult    = dmResource::RESULT_NOT_SUPPORTED;
         load_result->m_PreloadResult = dmResource::RESULT_PENDING;
         load_result->m_PreloadData   = 0;
+        load_result->m_ZeroCopy      = false;
+        load_result->m_CreateResult  = dmResource::RESULT_PENDING;
+
+        if (request->m_PreloadInfo.m_ZeroCopy)
+        {
+            const void* data = 0;
+            load_result->m_LoadResult = dmResource::GetResourceData(queue->m_Factory, request->m_CanonicalPath, &data, size);
+            load_result->m_ZeroCopy   = load_result->m_LoadResult == dmResource::RESULT_OK;
+            *buf                      = (void*)data;
+        }
+
+        if (load_result->m_LoadResult == dmResource::RESULT_NOT_SUPPORTED)
+        {
+            load_result->m_LoadResult = dmResource::LoadResource(queue->m_Factory, request->m_CanonicalPath, request->m_Name, buf, size);
+        }
 
         if (load_result->m_LoadResult == dmResource::RESULT_OK && request->m_PreloadInfo.m_CompleteFunction)
         {
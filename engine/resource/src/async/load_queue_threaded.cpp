@@ -26,43 +26,45 @@
 
 namespace dmLoadQueue
 {
-    // Implementation of dmLoadQueue with a thread that loads items in the order they are supplied,
+    // Implementation of dmLoadQueue with a pool of threads that load items in the order they are supplied,
+    // but may complete them in any order. The preloader checks each request with EndLoad so it doesn't care.
 
     // Default to small buffers since a lot of what is loaded are just small objects anyway.
     // That way we can have more in flight, but throttle when max pending data grows too large anyway
     const uint64_t DEFAULT_CAPACITY = 5 * 1024;
 
-    // Once the loader has this amount not picked up, it will stop loading more.
-    // This sets the bandwidth of the loader.
-    const uint64_t MAX_PENDING_DATA = 4 * 1024 * 1024;
-    const uint32_t QUEUE_SLOTS      = 16;
-
     struct Request
     {
         const char*                m_Name;
         const char*                m_CanonicalPath;
         dmResource::LoadBufferType m_Buffer;
+        const void*                m_Data; // Either m_Buffer or the archive memory
+        uint32_t                   m_DataSize;
         PreloadInfo                m_PreloadInfo;
         LoadResult                 m_Result;
     };
 
     struct Queue
     {
-        Request                                 m_Request[QUEUE_SLOTS];
+        Request*                                m_Request;
+        dmArray<dmThread::Thread>               m_Threads;
         dmResource::HFactory                    m_Factory;
         dmMutex::HMutex                         m_Mutex;
         dmConditionVariable::HConditionVariable m_WakeupCond;
-        dmThread::Thread                        m_Thread;
+        uint32_t                                m_Slots;
+        // Once the loader has this amount not picked up, it will stop loading more.
+        // This sets the bandwidth of the loader.
+        uint64_t                                m_MaxPendingData;
         uint32_t                                m_Front;
         uint32_t                                m_Back;
-        uint32_t                                m_Loaded;
+        uint32_t                                m_Dispatched;
         uint64_t                                m_BytesWaiting;
         bool                                    m_Shutdown;
 
         // Circular queue with indexing as follow (exclusive end)
         //
-        //          m_Back           m_Loaded   m_Front
-        // [N/A]   [loaded] [loaded] [to-load]  [N/A]
+        //          m_Back                     m_Dispatched   m_Front
+        // [N/A]   [loaded] [loading] [loaded] [to-load]      [N/A]
         //
     };
 
@@ -72,17 +74,17 @@ namespace dmLoadQueue
         // that are waiting to be picked up by the preloader. In the case of the queue being filled
         // with only large requests (say only 4Mb textures), this throttles a bit so memory consumption
         // does not run away.
-        if (queue->m_BytesWaiting >= MAX_PENDING_DATA)
+        if (queue->m_BytesWaiting >= queue->m_MaxPendingData)
         {
             return 0x0;
         }
 
-        if (queue->m_Loaded == queue->m_Front)
+        if (queue->m_Dispatched == queue->m_Front)
         {
             return 0x0;
         }
 
-        return &queue->m_Request[queue->m_Loaded % QUEUE_SLOTS];
+        return &queue->m_Request[(queue->m_Dispatched++) % queue->m_Slots];
     }
 
     static void LoadThread(void* arg)
@@ -98,7 +100,6 @@ namespace dmLoadQueue
                 {
                     // Just finished one (from previous iteration)
                     queue->m_BytesWaiting += current->m_Buffer.Capacity();
-                    queue->m_Loaded++;
                     current->m_Result = result;
                     current           = 0;
                 }
@@ -110,11 +111,12 @@ namespace dmLoadQueue
                 current = GetNextRequest(queue);
                 if (current == 0x0)
                 {
-                    // Nothing to do, reset any buffers of inactive requests that are not at default capacity
-                    for (uint32_t i = 0; i < QUEUE_SLOTS; ++i)
+                    // Nothing to do, reset any buffers of freed requests that are not at default capacity.
+                    // Other workers may still be loading into the buffers of active requests.
+                    for (uint32_t i = 0; i < queue->m_Slots; ++i)
                     {
                         Request* r = &queue->m_Request[i];
-                        if (r->m_Buffer.Size() == 0)
+                        if (r->m_Name == 0x0 && r->m_Buffer.Size() == 0)
                         {
                             if (r->m_Buffer.Capacity() > DEFAULT_CAPACITY)
                             {
@@ -139,20 +141,38 @@ namespace dmLoadQueue
                     current->m_Buffer.SetCapacity(DEFAULT_CAPACITY);
                 }
 
-                result.m_LoadResult = dmResource::LoadResourceFromBuffer(queue->m_Factory, current->m_CanonicalPath, current->m_Name, &size, &current->m_Buffer);
+                const void* data       = 0;
+                result.m_LoadResult    = dmResource::RESULT_NOT_SUPPORTED;
                 result.m_PreloadResult = dmResource::RESULT_PENDING;
                 result.m_PreloadData   = 0;
+                result.m_ZeroCopy      = false;
+                result.m_CreateResult  = dmResource::RESULT_PENDING;
+
+                if (current->m_PreloadInfo.m_ZeroCopy)
+                {
+                    result.m_LoadResult = dmResource::GetResourceData(queue->m_Factory, current->m_CanonicalPath, &data, &size);
+                    result.m_ZeroCopy   = result.m_LoadResult == dmResource::RESULT_OK;
+                }
+
+                if (result.m_LoadResult == dmResource::RESULT_NOT_SUPPORTED)
+                {
+                    result.m_LoadResult = dmResource::LoadResourceFromBuffer(queue->m_Factory, current->m_CanonicalPath, current->m_Name, &size, &current->m_Buffer);
+                    data                = current->m_Buffer.Begin();
+                    assert(result.m_LoadResult != dmResource::RESULT_OK || current->m_Buffer.Size() == size);
+                }
+
+                current->m_Data     = data;
+                current->m_DataSize = size;
 
                 if (result.m_LoadResult == dmResource::RESULT_OK)
                 {
-                    assert(current->m_Buffer.Size() == size);
                     if (current->m_PreloadInfo.m_CompleteFunction)
                     {
                         dmResource::ResourcePreloadParams params;
                         params.m_Factory       = queue->m_Factory;
                         params.m_Context       = current->m_PreloadInfo.m_Context;
-                        params.m_Buffer        = current->m_Buffer.Begin();
-                        params.m_BufferSize    = current->m_Buffer.Size();
+                        params.m_Buffer        = data;
+                        params.m_BufferSize    = size;
                         params.m_HintInfo      = &current->m_PreloadInfo.m_HintInfo;
                         params.m_PreloadData   = &result.m_PreloadData;
                         result.m_PreloadResult = current->m_PreloadInfo.m_CompleteFunction(params);
@@ -161,6 +181,11 @@ namespace dmLoadQueue
                     {
                         result.m_PreloadResult = dmResource::RESULT_OK;
                     }
+
+                    if (result.m_PreloadResult == dmResource::RESULT_OK && current->m_PreloadInfo.m_CreateFunction)
+                    {
+                        CreateResource(queue->m_Factory, current->m_Name, &current->m_PreloadInfo, data, size, &result);
+                    }
                 }
             }
         }
@@ -168,16 +193,26 @@ namespace dmLoadQueue
 
     HQueue CreateQueue(dmResource::HFactory factory)
     {
-        Queue* q          = new Queue();
-        q->m_Factory      = factory;
-        q->m_Front        = 0;
-        q->m_Back         = 0;
-        q->m_Loaded       = 0;
-        q->m_Shutdown     = false;
-        q->m_BytesWaiting = 0;
-        q->m_Mutex        = dmMutex::New();
-        q->m_WakeupCond   = dmConditionVariable::New();
-        q->m_Thread       = dmThread::New(&LoadThread, 65536, q, "AsyncLoad");
+        const QueueParams* params = dmResource::GetLoadQueueParams(factory);
+
+        Queue* q            = new Queue();
+        q->m_Factory        = factory;
+        q->m_Slots          = params->m_Slots;
+        q->m_MaxPendingData = params->m_MaxPendingData;
+        q->m_Request        = new Request[q->m_Slots]();
+        q->m_Front          = 0;
+        q->m_Back           = 0;
+        q->m_Dispatched     = 0;
+        q->m_Shutdown       = false;
+        q->m_BytesWaiting   = 0;
+        q->m_Mutex          = dmMutex::New();
+        q->m_WakeupCond     = dmConditionVariable::New();
+
+        q->m_Threads.SetCapacity(params->m_WorkerCount);
+        for (uint32_t i = 0; i < params->m_WorkerCount; ++i)
+        {
+            q->m_Threads.Push(dmThread::New(&LoadThread, 65536, q, "AsyncLoad"));
+        }
 
         return q;
     }
@@ -187,12 +222,16 @@ namespace dmLoadQueue
         {
             dmMutex::ScopedLock lk(queue->m_Mutex);
             queue->m_Shutdown = true;
-            // Wake up the worker so it can exit and allow us to join
-            dmConditionVariable::Signal(queue->m_WakeupCond);
+            // Wake up the workers so they can exit and allow us to join
+            dmConditionVariable::Broadcast(queue->m_WakeupCond);
+        }
+        for (uint32_t i = 0; i < queue->m_Threads.Size(); ++i)
+        {
+            dmThread::Join(queue->m_Threads[i]);
         }
-        dmThread::Join(queue->m_Thread);
         dmConditionVariable::Delete(queue->m_WakeupCond);
         dmMutex::Delete(queue->m_Mutex);
+        delete[] queue->m_Request;
         delete queue;
     }
 
@@ -206,22 +245,19 @@ namespace dmLoadQueue
         dmMutex::ScopedLock lk(queue->m_Mutex);
 
         // Refuse more if full.
-        if ((queue->m_Front - queue->m_Back) == QUEUE_SLOTS)
+        if ((queue->m_Front - queue->m_Back) == queue->m_Slots)
             return 0;
 
-        if (queue->m_Loaded == queue->m_Front)
-        {
-            // The worker is sleeping waiting for request, wake it up
-            dmConditionVariable::Signal(queue->m_WakeupCond);
-        }
-
-        Request* req         = &queue->m_Request[(queue->m_Front++) % QUEUE_SLOTS];
+        Request* req         = &queue->m_Request[(queue->m_Front++) % queue->m_Slots];
         req->m_Name          = name;
         req->m_CanonicalPath = canonical_path;
 
         req->m_PreloadInfo         = *info;
         req->m_Result.m_LoadResult = dmResource::RESULT_PENDING;
 
+        // Wake up a sleeping worker, if any. The others might be busy with earlier requests
+        dmConditionVariable::Signal(queue->m_WakeupCond);
+
         return req;
     }
 
@@ -231,8 +267,8 @@ namespace dmLoadQueue
         if (request->m_Result.m_LoadResult == dmResource::RESULT_PENDING)
             return RESULT_PENDING;
 
-        *buf         = request->m_Buffer.Begin();
-        *size        = request->m_Buffer.Size();
+        *buf         = (void*)request->m_Data;
+        *size        = request->m_DataSize;
         *load_result = request->m_Result;
 
         return RESULT_OK;
@@ -242,26 +278,32 @@ namespace dmLoadQueue
     {
         dmMutex::ScopedLock lk(queue->m_Mutex);
 
-        uint32_t old_bytes_waiting = queue->m_BytesWaiting;
+        uint64_t old_bytes_waiting = queue->m_BytesWaiting;
 
         // Make sure we don't copy any data if we reallocate the buffer
         request->m_Buffer.SetSize(0);
 
         uint32_t buffer_capacity = request->m_Buffer.Capacity();
         queue->m_BytesWaiting -= buffer_capacity;
-        // If we either have blocked further processing by exceeding MAX_PENDING_DATA or
-        // the buffer has a non-default capacity, we want to wake up the worker
-        if (buffer_capacity != DEFAULT_CAPACITY || (old_bytes_waiting >= MAX_PENDING_DATA && queue->m_BytesWaiting < MAX_PENDING_DATA))
+        if (old_bytes_waiting >= queue->m_MaxPendingData && queue->m_BytesWaiting < queue->m_MaxPendingData)
+        {
+            // All workers may have been blocked by exceeding the max pending data, wake them up
+            dmConditionVariable::Broadcast(queue->m_WakeupCond);
+        }
+        else if (buffer_capacity != DEFAULT_CAPACITY)
         {
-            // Wake up thread, we can now fit a new request
+            // Wake up a worker to shrink the buffer
             dmConditionVariable::Signal(queue->m_WakeupCond);
         }
 
         // Clean up picked up requests
+        request->m_Data          = 0x0;
+        request->m_DataSize      = 0;
         request->m_Name          = 0x0;
         request->m_CanonicalPath = 0x0;
 
-        while (queue->m_Back != queue->m_Loaded && queue->m_Request[queue->m_Back % QUEUE_SLOTS].m_Name == 0x0)
+        // Requests can complete in any order, so only step past the ones that are already freed
+        while (queue->m_Back != queue->m_Dispatched && queue->m_Request[queue->m_Back % queue->m_Slots].m_Name == 0x0)
         {
             queue->m_Back++;
         }
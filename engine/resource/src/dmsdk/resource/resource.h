@@ -516,7 +516,8 @@ namespace dmResource
     typedef Result (*FDecryptResource)(void* buffer, uint32_t buffer_len);
 
     /*#
-     * Registers a custom resource decryption function
+     * Registers a custom resource decryption function.
+     * The function may be called from several resource load threads at once.
      * @name RegisterResourceDecryptionFunction
      * @param decrypt_resource [type: dmResource::FDecryptResource] The decryption function
     */
@@ -96,6 +96,7 @@ static Result DoMount(ArchiveLoader* loader, const dmURI::Parts* uri, HArchive b
         memcpy(&archive->m_Uri, uri, sizeof(dmURI::Parts));
         archive->m_Loader = loader;
         archive->m_Internal = internal;
+        archive->m_Mutex = dmMutex::New();
         *out_archive = archive;
     }
     return result;
@@ -114,6 +115,7 @@ Result CreateMount(ArchiveLoader* loader, void* internal, HArchive* out_archive)
     memset(archive, 0, sizeof(Archive));
     archive->m_Loader = loader;
     archive->m_Internal = internal;
+    archive->m_Mutex = dmMutex::New();
     *out_archive = archive;
     return RESULT_OK;
 }
@@ -121,22 +123,59 @@ Result CreateMount(ArchiveLoader* loader, void* internal, HArchive* out_archive)
 Result Unmount(HArchive archive)
 {
     Result result = archive->m_Loader->m_Unmount(archive->m_Internal);
+    dmMutex::Delete(archive->m_Mutex);
     delete archive;
     return result;
 }
 
+// Locks the archive, unless the loader can read from several threads at once
+struct ArchiveReadScope
+{
+    dmMutex::HMutex m_Mutex;
+    ArchiveReadScope(HArchive archive)
+    : m_Mutex(archive->m_Loader->m_ThreadSafeRead ? 0 : archive->m_Mutex)
+    {
+        if (m_Mutex)
+            dmMutex::Lock(m_Mutex);
+    }
+    ~ArchiveReadScope()
+    {
+        if (m_Mutex)
+            dmMutex::Unlock(m_Mutex);
+    }
+};
+
 Result GetFileSize(HArchive archive, dmhash_t path_hash, const char* path, uint32_t* file_size)
 {
+    ArchiveReadScope scope(archive);
     return archive->m_Loader->m_GetFileSize(archive->m_Internal, path_hash, path, file_size);
 }
 
 Result ReadFile(HArchive archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_len)
 {
+    ArchiveReadScope scope(archive);
     return archive->m_Loader->m_ReadFile(archive->m_Internal, path_hash, path, buffer, buffer_len);
 }
 
+Result GetFileData(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len)
+{
+    ArchiveReadScope scope(archive);
+    if (archive->m_Loader->m_GetFileData)
+        return archive->m_Loader->m_GetFileData(archive->m_Internal, path_hash, path, data, data_len);
+    return RESULT_NOT_SUPPORTED;
+}
+
+Result GetFileOffset(HArchive archive, dmhash_t path_hash, const char* path, uint64_t* offset)
+{
+    ArchiveReadScope scope(archive);
+    if (archive->m_Loader->m_GetFileOffset)
+        return archive->m_Loader->m_GetFileOffset(archive->m_Internal, path_hash, path, offset);
+    return RESULT_NOT_SUPPORTED;
+}
+
 Result GetManifest(HArchive archive, dmResource::HManifest* out_manifest)
 {
+    ArchiveReadScope scope(archive);
     if (archive->m_Loader->m_GetManifest)
         return archive->m_Loader->m_GetManifest(archive->m_Internal, out_manifest);
     return RESULT_NOT_SUPPORTED;
@@ -144,6 +183,7 @@ Result GetManifest(HArchive archive, dmResource::HManifest* out_manifest)
 
 Result SetManifest(HArchive archive, dmResource::HManifest manifest)
 {
+    DM_MUTEX_SCOPED_LOCK(archive->m_Mutex);
     if (archive->m_Loader->m_SetManifest)
         return archive->m_Loader->m_SetManifest(archive->m_Internal, manifest);
     return RESULT_NOT_SUPPORTED;
@@ -157,6 +197,7 @@ Result GetUri(HArchive archive, dmURI::Parts* out_uri)
 
 Result WriteFile(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t* buffer, uint32_t buffer_len)
 {
+    DM_MUTEX_SCOPED_LOCK(archive->m_Mutex);
     if (archive->m_Loader->m_WriteFile)
         return archive->m_Loader->m_WriteFile(archive->m_Internal, path_hash, path, buffer, buffer_len);
     dmLogError("Archive type '%s' doesn't support writing files", dmHashReverseSafe64(archive->m_Loader->m_NameHash));
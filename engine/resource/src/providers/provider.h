@@ -51,6 +51,8 @@ namespace dmResourceProvider
     typedef Result (*FGetFileSize)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint32_t* file_size);
     typedef Result (*FReadFile)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_len);
     typedef Result (*FWriteFile)(HArchiveInternal archive, dmhash_t path_hash, const char* path, const uint8_t* buffer, uint32_t buffer_len);
+    typedef Result (*FGetFileData)(HArchiveInternal archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len); // Optional. Read only view into archive memory
+    typedef Result (*FGetFileOffset)(HArchiveInternal archive, dmhash_t path_hash, const char* path, uint64_t* offset); // Optional. Where the file is stored, for reading files in storage order
     typedef Result (*FGetManifest)(HArchiveInternal, dmResource::HManifest*); // In order for other providers to get the base manifest
     typedef Result (*FSetManifest)(HArchiveInternal, dmResource::HManifest);  // In order to set a downloaded manifest to a provider
 
@@ -72,6 +74,9 @@ namespace dmResourceProvider
     Result GetFileSize(HArchive archive, dmhash_t path_hash, const char* path, uint32_t* file_size);
     Result ReadFile(HArchive archive, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_len);
     Result WriteFile(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t* buffer, uint32_t buffer_len);
+    // Returns RESULT_NOT_SUPPORTED if the file cannot be accessed without a copy. The data is valid while the archive is mounted
+    Result GetFileData(HArchive archive, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len);
+    Result GetFileOffset(HArchive archive, dmhash_t path_hash, const char* path, uint64_t* offset);
 
 
     // Plugin API
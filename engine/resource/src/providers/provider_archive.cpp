@@ -234,6 +234,30 @@ namespace dmResourceProviderArchive
         return dmResourceProvider::RESULT_NOT_FOUND;
     }
 
+    static dmResourceProvider::Result GetFileData(dmResourceProvider::HArchiveInternal internal, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_len)
+    {
+        GameArchiveFile* archive = (GameArchiveFile*)internal;
+        EntryInfo* entry = archive->m_EntryMap.Get(path_hash);
+        if (!entry)
+            return dmResourceProvider::RESULT_NOT_FOUND;
+
+        dmResourceArchive::Result r = dmResourceArchive::GetEntryDataView(archive->m_ArchiveIndex, entry->m_ArchiveInfo, (const void**)data, data_len);
+        if (r == dmResourceArchive::RESULT_OK)
+            return dmResourceProvider::RESULT_OK;
+        return dmResourceProvider::RESULT_NOT_SUPPORTED;
+    }
+
+    static dmResourceProvider::Result GetFileOffset(dmResourceProvider::HArchiveInternal internal, dmhash_t path_hash, const char* path, uint64_t* offset)
+    {
+        GameArchiveFile* archive = (GameArchiveFile*)internal;
+        EntryInfo* entry = archive->m_EntryMap.Get(path_hash);
+        if (!entry)
+            return dmResourceProvider::RESULT_NOT_FOUND;
+
+        *offset = dmEndian::ToNetwork(entry->m_ArchiveInfo->m_ResourceDataOffset);
+        return dmResourceProvider::RESULT_OK;
+    }
+
     static dmResourceProvider::Result GetManifest(dmResourceProvider::HArchiveInternal internal, dmResource::HManifest* out_manifest)
     {
         GameArchiveFile* archive = (GameArchiveFile*)internal;
@@ -253,6 +277,9 @@ namespace dmResourceProviderArchive
         loader->m_GetManifest   = GetManifest;
         loader->m_GetFileSize   = GetFileSize;
         loader->m_ReadFile      = ReadFile;
+        loader->m_GetFileData   = GetFileData;
+        loader->m_GetFileOffset = GetFileOffset;
+        loader->m_ThreadSafeRead = true; // The archive is read only, see dmResourceArchive::ReadEntry
     }
 
     DM_DECLARE_ARCHIVE_LOADER(ResourceProviderArchive, "archive", SetupArchiveLoader);
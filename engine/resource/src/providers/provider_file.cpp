@@ -119,6 +119,7 @@ namespace dmResourceProviderFile
         loader->m_Unmount       = Unmount;
         loader->m_GetFileSize   = GetFileSize;
         loader->m_ReadFile      = ReadFile;
+        loader->m_ThreadSafeRead = true; // Each read opens the file
     }
 
     DM_DECLARE_ARCHIVE_LOADER(ResourceProviderFile, "file", SetupArchiveLoader);
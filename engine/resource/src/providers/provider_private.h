@@ -16,6 +16,7 @@
 #define DM_RESOURCE_PROVIDER_PRIVATE_H
 
 #include "provider.h"
+#include <dlib/mutex.h>
 #include <dlib/uri.h>
 
 namespace dmResourceProvider
@@ -25,6 +26,7 @@ namespace dmResourceProvider
         const ArchiveLoader*    m_Loader;
         void*                   m_Internal; // Each provider may have its own type to handle the code efficiently
         dmURI::Parts            m_Uri;
+        dmMutex::HMutex         m_Mutex;    // Serializes the calls to the loader, unless it has m_ThreadSafeRead set
     };
 
     struct ArchiveLoader
@@ -39,6 +41,9 @@ namespace dmResourceProvider
         FGetFileSize            m_GetFileSize;
         FReadFile               m_ReadFile;
         FWriteFile              m_WriteFile;        // For writeable archives
+        FGetFileData            m_GetFileData;      // For archives that can hand out their memory directly
+        FGetFileOffset          m_GetFileOffset;    // For archives that store their files in a single file
+        bool                    m_ThreadSafeRead;   // The read functions may be called from several threads at once
 
         void Verify();
 
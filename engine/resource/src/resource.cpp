@@ -41,10 +41,12 @@
 #include <dlib/uri.h>
 
 #include "resource.h"
+#include "resource_load_trace.h"
 #include "resource_manifest.h"
 #include "resource_mounts.h"
 #include "resource_private.h"
 #include "resource_util.h"
+#include "async/load_queue.h"
 #include <resource/resource_ddf.h>
 
 #include "providers/provider.h"         // dmResourceProviderArchive::Result
@@ -63,6 +65,7 @@
  */
 
 DM_PROPERTY_U32(rmtp_Resource, 0, FrameReset, "# resources");
+DM_PROPERTY_U32(rmtp_PrefetchHits, 0, FrameReset, "# resources loaded from prefetched data / frame");
 
 namespace dmResource
 {
@@ -77,6 +80,12 @@ const char* BUNDLE_PUBLIC_KEY_FILENAME          = "game.public.der";
 
 
 const char* MAX_RESOURCES_KEY = "resource.max_resources";
+const char* LOAD_QUEUE_WORKER_COUNT_KEY = "resource.load_queue_worker_count";
+const char* LOAD_QUEUE_SLOTS_KEY = "resource.load_queue_slots";
+const char* LOAD_QUEUE_MAX_PENDING_DATA_KEY = "resource.load_queue_max_pending_data";
+const char* LOAD_TRACE_KEY = "resource.load_trace";
+const char* RECORD_LOAD_TRACE_KEY = "resource.record_load_trace";
+const char* PREFETCH_MAX_DATA_KEY = "resource.prefetch_max_data";
 
 struct ResourceReloadedCallbackPair
 {
@@ -120,6 +129,15 @@ struct SResourceFactory
     dmResourceProvider::HArchive                 m_BuiltinMount;
     dmResourceProvider::HArchive                 m_BaseArchiveMount;
 
+    // Settings for the async load queues created by the preloaders
+    dmLoadQueue::QueueParams                     m_LoadQueueParams;
+
+    // Load traces per preloader root, and the prefetchers of the running preloaders (guarded by m_LoadMutex)
+    TLoadTraces*                                 m_LoadTraces;
+    dmArray<HPrefetcher>                         m_Prefetchers;
+    uint32_t                                     m_PrefetchMaxData;
+    bool                                         m_RecordLoadTraces;
+
     // Serial version that increases per resource insertion
     uint16_t                                     m_Version;
 };
@@ -167,6 +185,10 @@ void SetDefaultNewFactoryParams(struct NewFactoryParams* params)
     memset(params, 0, sizeof(NewFactoryParams));
     params->m_MaxResources = 1024;
     params->m_Flags = RESOURCE_FACTORY_FLAGS_EMPTY;
+    params->m_LoadQueueWorkerCount = 1;
+    params->m_LoadQueueSlots = 16;
+    params->m_LoadQueueMaxPendingData = 4 * 1024 * 1024;
+    params->m_PrefetchMaxData = 8 * 1024 * 1024;
 
     params->m_ArchiveManifest.m_Data = 0;
     params->m_ArchiveManifest.m_Size = 0;
@@ -334,6 +356,10 @@ HFactory NewFactory(NewFactoryParams* params, const char* uri)
 
     factory->m_ResourceTypesCount = 0;
 
+    factory->m_LoadQueueParams.m_WorkerCount    = dmMath::Max(1u, params->m_LoadQueueWorkerCount);
+    factory->m_LoadQueueParams.m_Slots          = dmMath::Max(1u, params->m_LoadQueueSlots);
+    factory->m_LoadQueueParams.m_MaxPendingData = dmMath::Max(1u, params->m_LoadQueueMaxPendingData);
+
     const uint32_t table_size = dmMath::Max(1u, (3 * params->m_MaxResources) / 4);
     factory->m_Resources = new dmHashTable64<SResourceDescriptor>();
     factory->m_Resources->SetCapacity(table_size, params->m_MaxResources);
@@ -361,6 +387,9 @@ HFactory NewFactory(NewFactoryParams* params, const char* uri)
         AddBuiltinMount(factory, params);
     }
 
+    factory->m_LoadTraces = new TLoadTraces();
+    factory->m_PrefetchMaxData = dmMath::Max(1u, params->m_PrefetchMaxData);
+
     factory->m_LoadMutex = dmMutex::New();
     return factory;
 }
@@ -381,6 +410,12 @@ void DeleteFactory(HFactory factory)
         dmMutex::Delete(factory->m_LoadMutex);
     }
 
+    if (factory->m_LoadTraces)
+    {
+        ClearLoadTraces(factory->m_LoadTraces);
+        delete factory->m_LoadTraces;
+    }
+
     ReleaseBuiltinsArchive(factory);
 
     if (factory->m_Mounts)
@@ -472,12 +507,97 @@ Result RegisterType(HFactory factory,
     resource_type.m_PostCreateFunction = post_create_function;
     resource_type.m_DestroyFunction = destroy_function;
     resource_type.m_RecreateFunction = recreate_function;
+    resource_type.m_ZeroCopy = false;
+    resource_type.m_ThreadSafeCreate = false;
 
     factory->m_ResourceTypes[factory->m_ResourceTypesCount++] = resource_type;
 
     return RESULT_OK;
 }
 
+const dmLoadQueue::QueueParams* GetLoadQueueParams(HFactory factory)
+{
+    return &factory->m_LoadQueueParams;
+}
+
+void SetRecordLoadTraces(HFactory factory, bool record)
+{
+    factory->m_RecordLoadTraces = record;
+}
+
+bool IsRecordingLoadTraces(HFactory factory)
+{
+    return factory->m_RecordLoadTraces;
+}
+
+void AddLoadTrace(HFactory factory, dmhash_t root_path_hash, LoadTrace* trace)
+{
+    SetLoadTrace(factory->m_LoadTraces, root_path_hash, trace);
+}
+
+void GetLoadTraces(HFactory factory, dmArray<uint8_t>* data)
+{
+    WriteLoadTraces(factory->m_LoadTraces, data);
+}
+
+Result SetLoadTraces(HFactory factory, const void* data, uint32_t data_size)
+{
+    return ReadLoadTraces(factory->m_LoadTraces, data, data_size);
+}
+
+HPrefetcher StartPrefetch(HFactory factory, dmhash_t root_path_hash)
+{
+    LoadTrace** trace = factory->m_LoadTraces->Get(root_path_hash);
+    if (!trace)
+        return 0;
+
+    HPrefetcher prefetcher = NewPrefetcher(factory->m_Mounts, *trace, factory->m_PrefetchMaxData);
+    if (!prefetcher)
+        return 0;
+
+    dmMutex::ScopedLock lk(factory->m_LoadMutex);
+    if (factory->m_Prefetchers.Full())
+    {
+        factory->m_Prefetchers.OffsetCapacity(4);
+    }
+    factory->m_Prefetchers.Push(prefetcher);
+    return prefetcher;
+}
+
+void StopPrefetch(HFactory factory, HPrefetcher prefetcher)
+{
+    {
+        dmMutex::ScopedLock lk(factory->m_LoadMutex);
+        for (uint32_t i = 0; i < factory->m_Prefetchers.Size(); ++i)
+        {
+            if (factory->m_Prefetchers[i] == prefetcher)
+            {
+                factory->m_Prefetchers.EraseSwap(i);
+                break;
+            }
+        }
+    }
+    DeletePrefetcher(prefetcher);
+}
+
+Result SetTypeZeroCopy(HFactory factory, const char* extension, bool zero_copy)
+{
+    SResourceType* resource_type = FindResourceType(factory, extension);
+    if (resource_type == 0)
+        return RESULT_UNKNOWN_RESOURCE_TYPE;
+    resource_type->m_ZeroCopy = zero_copy;
+    return RESULT_OK;
+}
+
+Result SetTypeThreadSafeCreate(HFactory factory, const char* extension, bool thread_safe)
+{
+    SResourceType* resource_type = FindResourceType(factory, extension);
+    if (resource_type == 0)
+        return RESULT_UNKNOWN_RESOURCE_TYPE;
+    resource_type->m_ThreadSafeCreate = thread_safe;
+    return RESULT_OK;
+}
+
 struct SResourceDependencyCallback
 {
     FGetDependency  m_Callback;
@@ -522,16 +642,29 @@ dmResourceProvider::HArchive GetBaseArchive(HFactory factory)
 }
 
 // Assumes m_LoadMutex is already held
-static Result LoadResourceFromBufferLocked(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
+// If the resource is being prefetched and reading is non null, it's set to the prefetcher to wait for
+static bool TakePrefetchedResourceLocked(HFactory factory, dmhash_t normalized_path_hash, LoadBufferType* buffer, uint32_t* resource_size, HPrefetcher* reading)
 {
-    DM_PROFILE(__FUNCTION__);
-
-    char normalized_path[RESOURCE_PATH_MAX];
-    GetCanonicalPath(path, normalized_path); // normalize the path
-
-    // Let's find the resource in the current mounts
+    for (uint32_t i = 0; i < factory->m_Prefetchers.Size(); ++i)
+    {
+        bool is_reading = false;
+        if (TakePrefetchedResource(factory->m_Prefetchers[i], normalized_path_hash, buffer, resource_size, reading ? &is_reading : 0))
+        {
+            DM_PROPERTY_ADD_U32(rmtp_PrefetchHits, 1);
+            return true;
+        }
+        if (is_reading)
+        {
+            *reading = factory->m_Prefetchers[i];
+            return false;
+        }
+    }
+    return false;
+}
 
-    dmhash_t normalized_path_hash = dmHashString64(normalized_path);
+// The mounts have their own lock
+static Result ReadResourceFromMounts(HFactory factory, dmhash_t normalized_path_hash, const char* normalized_path, uint32_t* resource_size, LoadBufferType* buffer)
+{
     uint32_t file_size;
     dmResource::Result r = dmResourceMounts::GetResourceSize(factory->m_Mounts, normalized_path_hash, normalized_path, &file_size);
     if (r == dmResource::RESULT_OK)
@@ -553,12 +686,66 @@ static Result LoadResourceFromBufferLocked(HFactory factory, const char* path, c
     return RESULT_RESOURCE_NOT_FOUND;
 }
 
-// Takes the lock.
+// Assumes m_LoadMutex is already held
+static Result LoadResourceFromBufferLocked(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
+{
+    DM_PROFILE(__FUNCTION__);
+
+    char normalized_path[RESOURCE_PATH_MAX];
+    GetCanonicalPath(path, normalized_path); // normalize the path
+
+    // Let's find the resource in the current mounts
+
+    dmhash_t normalized_path_hash = dmHashString64(normalized_path);
+
+    // Don't wait for a prefetch in progress while holding the lock
+    if (TakePrefetchedResourceLocked(factory, normalized_path_hash, buffer, resource_size, 0))
+        return RESULT_OK;
+
+    return ReadResourceFromMounts(factory, normalized_path_hash, normalized_path, resource_size, buffer);
+}
+
+// Takes the lock, but only while looking at the prefetchers, so that several load threads can read at once.
 Result LoadResourceFromBuffer(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer)
 {
-    // Called from async queue so we wrap around a lock
-    dmMutex::ScopedLock lk(factory->m_LoadMutex);
-    return LoadResourceFromBufferLocked(factory, path, original_name, resource_size, buffer);
+    DM_PROFILE(__FUNCTION__);
+
+    char normalized_path[RESOURCE_PATH_MAX];
+    GetCanonicalPath(path, normalized_path); // normalize the path
+
+    dmhash_t normalized_path_hash = dmHashString64(normalized_path);
+
+    HPrefetcher reading = 0;
+    {
+        dmMutex::ScopedLock lk(factory->m_LoadMutex);
+        if (TakePrefetchedResourceLocked(factory, normalized_path_hash, buffer, resource_size, &reading))
+            return RESULT_OK;
+    }
+
+    // The prefetcher is kept alive until we've waited for it
+    if (reading && WaitForPrefetchedResource(reading, normalized_path_hash, buffer, resource_size))
+    {
+        DM_PROPERTY_ADD_U32(rmtp_PrefetchHits, 1);
+        return RESULT_OK;
+    }
+
+    return ReadResourceFromMounts(factory, normalized_path_hash, normalized_path, resource_size, buffer);
+}
+
+// Doesn't take the lock, the mounts have their own.
+Result GetResourceData(HFactory factory, const char* path, const void** data, uint32_t* resource_size)
+{
+    char normalized_path[RESOURCE_PATH_MAX];
+    GetCanonicalPath(path, normalized_path); // normalize the path
+
+    dmhash_t normalized_path_hash = dmHashString64(normalized_path);
+    const uint8_t* resource_data = 0;
+    Result r = dmResourceMounts::GetResourceData(factory->m_Mounts, normalized_path_hash, normalized_path, &resource_data, resource_size);
+    if (r == RESULT_OK)
+    {
+        *data = resource_data;
+    }
+    return r;
 }
 
 // Assumes m_LoadMutex is already held
@@ -745,12 +932,26 @@ static Result CreateAndLoadResource(HFactory factory, const char* name, void** r
 
     void* buffer         = 0;
     uint32_t buffer_size = 0;
-    Result result = LoadResource(factory, canonical_path, name, &buffer, &buffer_size);
-    if (result != RESULT_OK)
+    Result result        = RESULT_NOT_SUPPORTED;
+    if (resource_type->m_ZeroCopy)
+    {
+        const void* data;
+        result = GetResourceData(factory, canonical_path, &data, &buffer_size);
+        buffer = (void*)data;
+    }
+    if (result == RESULT_NOT_SUPPORTED)
+    {
+        result = LoadResource(factory, canonical_path, name, &buffer, &buffer_size);
+        if (result != RESULT_OK)
+        {
+            return result;
+        }
+        assert(buffer == factory->m_Buffer.Begin());
+    }
+    else if (result != RESULT_OK)
     {
         return result;
     }
-    assert(buffer == factory->m_Buffer.Begin());
 
     return DoCreateResource(factory, resource_type, name, canonical_path, canonical_path_hash, buffer, buffer_size, resource);
 }
@@ -49,6 +49,21 @@ namespace dmResource
      */
     extern const char* MAX_RESOURCES_KEY;
 
+    /**
+     * Configuration keys used to tweak the async load queue of each preloader.
+     */
+    extern const char* LOAD_QUEUE_WORKER_COUNT_KEY;
+    extern const char* LOAD_QUEUE_SLOTS_KEY;
+    extern const char* LOAD_QUEUE_MAX_PENDING_DATA_KEY;
+
+    /**
+     * Configuration keys for the load traces. LOAD_TRACE_KEY is the resource path of a trace file
+     * to prefetch with, RECORD_LOAD_TRACE_KEY a file path to record a new trace file to.
+     */
+    extern const char* LOAD_TRACE_KEY;
+    extern const char* RECORD_LOAD_TRACE_KEY;
+    extern const char* PREFETCH_MAX_DATA_KEY;
+
     extern const char* BUNDLE_INDEX_FILENAME;
     extern const char* BUNDLE_DATA_FILENAME;
 
@@ -132,7 +147,19 @@ namespace dmResource
         EmbeddedResource m_ArchiveData;
         EmbeddedResource m_ArchiveManifest;
 
-        uint32_t m_Reserved[5];
+        /// Number of load threads used by each preloader. Default is 1. The resource preload functions run on these threads
+        uint32_t m_LoadQueueWorkerCount;
+
+        /// Max number of load requests in flight for each preloader. Default is 16
+        uint32_t m_LoadQueueSlots;
+
+        /// Loaded bytes not yet picked up by the preloader before loading pauses. Default is 4MB
+        uint32_t m_LoadQueueMaxPendingData;
+
+        /// Prefetched bytes not yet picked up by the preloaders before prefetching pauses. Default is 8MB
+        uint32_t m_PrefetchMaxData;
+
+        uint32_t m_Reserved[1];
 
         NewFactoryParams()
         {
@@ -323,6 +350,57 @@ namespace dmResource
      */
     void DeletePreloader(HPreloader preloader);
 
+    /**
+     * Preloader statistics
+     */
+    struct PreloaderStats
+    {
+        /// Number of requests currently in the request tree
+        uint32_t m_RequestCount;
+        /// Most requests held at the same time
+        uint32_t m_PeakRequestCount;
+        /// Deepest level of the request tree, the root is at level 0
+        uint32_t m_MaxDepth;
+        /// Bytes allocated for the request tree and the paths
+        uint32_t m_ArenaSize;
+        /// Resources loaded from prefetched data (see SetLoadTraces)
+        uint32_t m_PrefetchHitCount;
+    };
+
+    /**
+     * Get the statistics of a preloader
+     * @param preloader Preloader
+     * @param stats [out] The statistics
+     */
+    void GetPreloaderStats(HPreloader preloader, PreloaderStats* stats);
+
+    /**
+     * Record the resources each preloader loads, in the order they are loaded.
+     * The trace of a preloader is stored when the preloader is deleted, and replaces any previous trace for
+     * the same root resource.
+     * @param factory Factory handle
+     * @param record true to record load traces
+     */
+    void SetRecordLoadTraces(HFactory factory, bool record);
+
+    /**
+     * Get the load traces of the factory, in a compact binary format
+     * @param factory Factory handle
+     * @param data [out] The serialized load traces
+     */
+    void GetLoadTraces(HFactory factory, dmArray<uint8_t>* data);
+
+    /**
+     * Set the load traces, replacing the traces of the same root resources. The next time a preloader is created
+     * for a root resource with a trace, the traced resources are read ahead of the preloader, in the order they
+     * are stored in the archive.
+     * @param factory Factory handle
+     * @param data Load traces as returned by GetLoadTraces
+     * @param data_size Size of the data
+     * @return RESULT_OK on success
+     */
+    Result SetLoadTraces(HFactory factory, const void* data, uint32_t data_size);
+
     /**
      * Returns the mutex held when loading asynchronous
      * @param factory Factory handle
@@ -410,6 +488,31 @@ namespace dmResource
     Result LoadResource(HFactory factory, const char* path, const char* original_name, void** buffer, uint32_t* resource_size);
     // load with own buffer
     Result LoadResourceFromBuffer(HFactory factory, const char* path, const char* original_name, uint32_t* resource_size, LoadBufferType* buffer);
+    // get a read only view of the data directly from the archive (e.g. memory mapped). Returns RESULT_NOT_SUPPORTED if it has to be loaded into a buffer
+    Result GetResourceData(HFactory factory, const char* path, const void** data, uint32_t* resource_size);
+
+    /**
+     * Allow resources of a type to be created directly from the archive memory, when the archive supports it.
+     * Only enable this for types that never write to the buffer in their preload or create functions.
+     * @param factory Factory handle
+     * @param extension File extension of the resource type
+     * @param zero_copy true to use the archive memory directly
+     * @return RESULT_OK on success
+     */
+    Result SetTypeZeroCopy(HFactory factory, const char* extension, bool zero_copy);
+
+    /**
+     * Let the preloader call the create function of a type on a load thread, right after the preload function.
+     * The main thread then only inserts the created resource. Only enable this for types whose create function
+     * doesn't call PreloadHint, dmResource::Get or any other api that must be used from the main thread (e.g. graphics).
+     * The resource doesn't wait for the children hinted by its preload function. Once it is created, those children
+     * are removed from the preloader, and any of them that are still loading are waited for and then discarded.
+     * @param factory Factory handle
+     * @param extension File extension of the resource type
+     * @param thread_safe true to create the resources on a load thread
+     * @return RESULT_OK on success
+     */
+    Result SetTypeThreadSafeCreate(HFactory factory, const char* extension, bool thread_safe);
 }
 
 #endif // RESOURCE_H
@@ -520,6 +520,8 @@ namespace dmResourceArchive
         if (!resource_memmapped)
         {
             // we need to read from the file on disc
+            // Only the file access is locked, the decryption and decompression below may run on several threads at once
+            DM_MUTEX_SCOPED_LOCK(afi->m_Mutex);
             FILE* resource_file = afi->m_FileResourceData;
             fseek(resource_file, resource_offset, SEEK_SET);
 
@@ -614,6 +616,24 @@ namespace dmResourceArchive
         return dmResourceArchive::RESULT_OK;
     }
 
+    Result GetEntryDataView(HArchiveIndexContainer archive, const EntryData* entry, const void** data, uint32_t* size)
+    {
+        // We always assume it's in Host format, since it may arrive from memory mapped data
+        const uint32_t flags            = dmEndian::ToNetwork(entry->m_Flags);
+        const uint32_t resource_offset  = dmEndian::ToNetwork(entry->m_ResourceDataOffset);
+
+        // Encrypted data is decrypted in place, and compressed data needs a buffer to decompress to
+        const ArchiveFileIndex* afi = archive->m_ArchiveFileIndex;
+        if (!afi->m_IsMemMapped || (flags & (ENTRY_FLAG_ENCRYPTED | ENTRY_FLAG_COMPRESSED)))
+        {
+            return RESULT_NOT_SUPPORTED;
+        }
+
+        *data = (const void*)((uintptr_t)afi->m_ResourceData + resource_offset);
+        *size = dmEndian::ToNetwork(entry->m_ResourceSize);
+        return RESULT_OK;
+    }
+
     Result WriteArchiveIndex(const char* path, ArchiveIndex* ai)
     {
         // Write to temporary index file, filename liveupdate.arci.tmp
@@ -23,6 +23,7 @@
 #include <dlib/uri.h>
 #include <dlib/align.h>
 #include <dlib/array.h>
+#include <dlib/mutex.h>
 #include <dlib/path.h> // DMPATH_MAX_PATH
 
 
@@ -50,6 +51,7 @@ namespace dmResourceArchive
         RESULT_OUTBUFFER_TOO_SMALL = -4,
         RESULT_ALREADY_STORED = -5,
         RESULT_INVALID_DATA = -6,
+        RESULT_NOT_SUPPORTED = -7,
         RESULT_UNKNOWN = -1000,
     };
 
@@ -96,6 +98,11 @@ namespace dmResourceArchive
         ArchiveFileIndex()
         {
             memset(this, 0, sizeof(ArchiveFileIndex));
+            m_Mutex = dmMutex::New();
+        }
+        ~ArchiveFileIndex()
+        {
+            dmMutex::Delete(m_Mutex);
         }
         char        m_Path[DMPATH_MAX_PATH];
         uint8_t*    m_Hashes;           // Sorted list of filenames (i.e. hashes)
@@ -104,6 +111,7 @@ namespace dmResourceArchive
         uint8_t*    m_ResourceData;     // mem-mapped game.arcd
         uint32_t    m_ResourceSize;     // the size of the memory mapped region
         bool        m_IsMemMapped;      // Is the data memory mapped?
+        dmMutex::HMutex m_Mutex;        // Guards the position of m_FileResourceData, so that entries can be read from several threads
     };
 
     struct ArchiveIndexContainer
@@ -212,6 +220,18 @@ namespace dmResourceArchive
      */
     Result ReadEntry(HArchiveIndexContainer archive, const EntryData* entry, void* buffer);
 
+    /**
+     * Get a read only view of a resource in a memory mapped archive, without copying it.
+     * Only uncompressed and unencrypted entries can be viewed in place.
+     * The data is valid as long as the archive is loaded.
+     * @param archive archive index handle
+     * @param entry_data entry data
+     * @param data [out] pointer to the resource data within the archive
+     * @param size [out] the size of the resource
+     * @return RESULT_OK on success, RESULT_NOT_SUPPORTED if the entry must be read with ReadEntry
+     */
+    Result GetEntryDataView(HArchiveIndexContainer archive, const EntryData* entry, const void** data, uint32_t* size);
+
     /**
      * Delete archive index. Only required for archives created with LoadArchive function
      * @param archive archive index handle
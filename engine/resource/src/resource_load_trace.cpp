@@ -0,0 +1,476 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "resource_load_trace.h"
+#include "resource_mounts.h"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm> // std::sort
+
+#include <dlib/condition_variable.h>
+#include <dlib/math.h>
+#include <dlib/mutex.h>
+#include <dlib/profile.h>
+#include <dlib/thread.h>
+
+namespace dmResource
+{
+    static const uint32_t LOAD_TRACE_MAGIC   = 0x544C4D44; // "DMLT"
+    static const uint32_t LOAD_TRACE_VERSION = 1;
+
+    struct LoadTraceFileHeader
+    {
+        uint32_t m_Magic;
+        uint32_t m_Version;
+        uint32_t m_TraceCount;
+    };
+
+    struct LoadTraceFileTrace
+    {
+        dmhash_t m_RootPathHash;
+        uint32_t m_EntryCount;
+        uint32_t m_PathsSize;
+        // Followed by the entries and the paths
+    };
+
+    void AddLoadTraceEntry(LoadTrace* trace, dmhash_t path_hash, const char* path, uint32_t size)
+    {
+        uint32_t path_len = strlen(path) + 1;
+        if (trace->m_Paths.Remaining() < path_len)
+        {
+            trace->m_Paths.OffsetCapacity(dmMath::Max(path_len, trace->m_Paths.Capacity() / 2 + 256));
+        }
+        if (trace->m_Entries.Full())
+        {
+            trace->m_Entries.OffsetCapacity(trace->m_Entries.Capacity() / 2 + 32);
+        }
+
+        LoadTraceEntry entry;
+        entry.m_PathHash   = path_hash;
+        entry.m_Size       = size;
+        entry.m_PathOffset = trace->m_Paths.Size();
+        trace->m_Entries.Push(entry);
+        trace->m_Paths.PushArray(path, path_len);
+    }
+
+    static void DeleteTraceCallback(void*, const dmhash_t*, LoadTrace** trace)
+    {
+        delete *trace;
+    }
+
+    void ClearLoadTraces(TLoadTraces* traces)
+    {
+        traces->Iterate(DeleteTraceCallback, (void*)0);
+        traces->Clear();
+    }
+
+    void SetLoadTrace(TLoadTraces* traces, dmhash_t root_path_hash, LoadTrace* trace)
+    {
+        LoadTrace** existing = traces->Get(root_path_hash);
+        if (existing)
+        {
+            delete *existing;
+            *existing = trace;
+            return;
+        }
+        if (traces->Full())
+        {
+            uint32_t capacity = traces->Capacity() + 16;
+            traces->SetCapacity((2*capacity)/3, capacity);
+        }
+        traces->Put(root_path_hash, trace);
+    }
+
+    static void Append(dmArray<uint8_t>* out, const void* data, uint32_t size)
+    {
+        if (out->Remaining() < size)
+        {
+            out->OffsetCapacity(dmMath::Max(size, out->Capacity() / 2 + 1024));
+        }
+        out->PushArray((const uint8_t*)data, size);
+    }
+
+    static void WriteTraceCallback(dmArray<uint8_t>* out, const dmhash_t* root_path_hash, LoadTrace** _trace)
+    {
+        LoadTrace* trace = *_trace;
+        LoadTraceFileTrace header;
+        header.m_RootPathHash = *root_path_hash;
+        header.m_EntryCount   = trace->m_Entries.Size();
+        header.m_PathsSize    = trace->m_Paths.Size();
+        Append(out, &header, sizeof(header));
+        Append(out, trace->m_Entries.Begin(), trace->m_Entries.Size() * sizeof(LoadTraceEntry));
+        Append(out, trace->m_Paths.Begin(), trace->m_Paths.Size());
+    }
+
+    void WriteLoadTraces(TLoadTraces* traces, dmArray<uint8_t>* out)
+    {
+        out->SetSize(0);
+
+        LoadTraceFileHeader header;
+        header.m_Magic      = LOAD_TRACE_MAGIC;
+        header.m_Version    = LOAD_TRACE_VERSION;
+        header.m_TraceCount = traces->Size();
+        Append(out, &header, sizeof(header));
+
+        traces->Iterate(WriteTraceCallback, out);
+    }
+
+    Result ReadLoadTraces(TLoadTraces* traces, const void* data, uint32_t data_size)
+    {
+        const uint8_t* cursor = (const uint8_t*)data;
+        const uint8_t* end    = cursor + data_size;
+
+        LoadTraceFileHeader header;
+        if (data_size < sizeof(header))
+            return RESULT_INVALID_DATA;
+        memcpy(&header, cursor, sizeof(header));
+        cursor += sizeof(header);
+
+        if (header.m_Magic != LOAD_TRACE_MAGIC)
+            return RESULT_INVALID_DATA;
+        if (header.m_Version != LOAD_TRACE_VERSION)
+            return RESULT_VERSION_MISMATCH;
+
+        for (uint32_t i = 0; i < header.m_TraceCount; ++i)
+        {
+            LoadTraceFileTrace trace_header;
+            if ((uint32_t)(end - cursor) < sizeof(trace_header))
+                return RESULT_INVALID_DATA;
+            memcpy(&trace_header, cursor, sizeof(trace_header));
+            cursor += sizeof(trace_header);
+
+            uint64_t entries_size = (uint64_t)trace_header.m_EntryCount * sizeof(LoadTraceEntry);
+            if ((uint64_t)(end - cursor) < entries_size + trace_header.m_PathsSize)
+                return RESULT_INVALID_DATA;
+
+            LoadTrace* trace = new LoadTrace;
+            trace->m_Entries.SetCapacity(trace_header.m_EntryCount);
+            trace->m_Entries.SetSize(trace_header.m_EntryCount);
+            memcpy(trace->m_Entries.Begin(), cursor, (uint32_t)entries_size);
+            cursor += entries_size;
+
+            trace->m_Paths.SetCapacity(trace_header.m_PathsSize);
+            trace->m_Paths.SetSize(trace_header.m_PathsSize);
+            memcpy(trace->m_Paths.Begin(), cursor, trace_header.m_PathsSize);
+            cursor += trace_header.m_PathsSize;
+
+            bool valid = trace_header.m_PathsSize == 0 || trace->m_Paths.Back() == 0;
+            for (uint32_t j = 0; j < trace_header.m_EntryCount && valid; ++j)
+            {
+                valid = trace->m_Entries[j].m_PathOffset < trace_header.m_PathsSize;
+            }
+            if (!valid)
+            {
+                delete trace;
+                return RESULT_INVALID_DATA;
+            }
+
+            SetLoadTrace(traces, trace_header.m_RootPathHash, trace);
+        }
+        return RESULT_OK;
+    }
+
+    enum PrefetchState
+    {
+        PREFETCH_STATE_PENDING,
+        PREFETCH_STATE_READING,
+        PREFETCH_STATE_READY,
+        PREFETCH_STATE_TAKEN,
+    };
+
+    struct PrefetchBuffer
+    {
+        LoadBufferType* m_Data; // Handed over to the load thread that takes it
+        uint32_t      m_Size;
+        PrefetchState m_State;
+    };
+
+    struct PrefetchEntry
+    {
+        dmhash_t m_PathHash;
+        uint64_t m_Order;
+        uint32_t m_PathOffset;
+        uint32_t m_Index;
+    };
+
+    struct Prefetcher
+    {
+        dmResourceMounts::HContext                  m_Mounts;
+        dmArray<PrefetchEntry>                      m_Entries;
+        dmArray<char>                               m_Paths;
+        dmHashTable64<PrefetchBuffer>               m_Buffers;
+        dmMutex::HMutex                             m_Mutex;
+        dmConditionVariable::HConditionVariable     m_Cond; // Broadcast whenever a buffer changes state
+        dmThread::Thread                            m_Thread;
+        uint32_t                                    m_PendingData;
+        uint32_t                                    m_MaxData;
+        uint32_t                                    m_HitCount;
+        uint32_t                                    m_EvictIndex; // The oldest entry in m_Entries that may still be ready
+        uint32_t                                    m_WaiterCount; // Load threads that will call WaitForPrefetchedResource
+        bool                                        m_Cancel;
+    };
+
+    struct PrefetchOrderPred
+    {
+        bool operator()(const PrefetchEntry& a, const PrefetchEntry& b) const
+        {
+            if (a.m_Order != b.m_Order)
+                return a.m_Order < b.m_Order;
+            return a.m_Index < b.m_Index;
+        }
+    };
+
+    static const uint64_t PREFETCH_ORDER_MISSING = 0xFFFFFFFFFFFFFFFFULL;
+
+    // Assumes the prefetcher mutex is held
+    // Frees the oldest buffer that is ready but not taken, among the entries read before end_index
+    static bool EvictOldestBuffer(Prefetcher* prefetcher, uint32_t end_index)
+    {
+        // Only the prefetch thread reads, so all entries before end_index are done reading
+        for (; prefetcher->m_EvictIndex < end_index; ++prefetcher->m_EvictIndex)
+        {
+            PrefetchBuffer* buffer = prefetcher->m_Buffers.Get(prefetcher->m_Entries[prefetcher->m_EvictIndex].m_PathHash);
+            if (buffer->m_State != PREFETCH_STATE_READY)
+                continue;
+
+            prefetcher->m_PendingData -= buffer->m_Size;
+            delete buffer->m_Data;
+            buffer->m_Data  = 0;
+            buffer->m_State = PREFETCH_STATE_TAKEN;
+            prefetcher->m_EvictIndex++;
+            return true;
+        }
+        return false;
+    }
+
+    static void PrefetchThread(void* arg)
+    {
+        Prefetcher* prefetcher = (Prefetcher*)arg;
+
+        {
+            DM_PROFILE("PrefetchSort");
+            for (uint32_t i = 0; i < prefetcher->m_Entries.Size(); ++i)
+            {
+                PrefetchEntry& entry = prefetcher->m_Entries[i];
+                const char* path     = &prefetcher->m_Paths[entry.m_PathOffset];
+                if (dmResourceMounts::GetResourceReadOrder(prefetcher->m_Mounts, entry.m_PathHash, path, &entry.m_Order) != RESULT_OK)
+                {
+                    entry.m_Order = PREFETCH_ORDER_MISSING;
+                }
+            }
+            std::sort(prefetcher->m_Entries.Begin(), prefetcher->m_Entries.End(), PrefetchOrderPred());
+        }
+
+        for (uint32_t i = 0; i < prefetcher->m_Entries.Size(); ++i)
+        {
+            const PrefetchEntry& entry = prefetcher->m_Entries[i];
+            if (entry.m_Order == PREFETCH_ORDER_MISSING)
+                break;
+
+            const char* path = &prefetcher->m_Paths[entry.m_PathOffset];
+
+            // Memory mapped files need no reading
+            const uint8_t* mapped_data;
+            uint32_t size;
+            if (dmResourceMounts::GetResourceData(prefetcher->m_Mounts, entry.m_PathHash, path, &mapped_data, &size) == RESULT_OK)
+                continue;
+            if (dmResourceMounts::GetResourceSize(prefetcher->m_Mounts, entry.m_PathHash, path, &size) != RESULT_OK)
+                continue;
+
+            {
+                DM_MUTEX_SCOPED_LOCK(prefetcher->m_Mutex);
+                while (!prefetcher->m_Cancel && prefetcher->m_PendingData > 0 && prefetcher->m_PendingData + size > prefetcher->m_MaxData)
+                {
+                    // Buffers that are never taken (e.g. the resource was already loaded) would otherwise block us
+                    if (EvictOldestBuffer(prefetcher, i))
+                        continue;
+                    dmConditionVariable::Wait(prefetcher->m_Cond, prefetcher->m_Mutex);
+                }
+                if (prefetcher->m_Cancel)
+                    return;
+
+                PrefetchBuffer* buffer = prefetcher->m_Buffers.Get(entry.m_PathHash);
+                if (buffer->m_State != PREFETCH_STATE_PENDING)
+                    continue;
+                buffer->m_State = PREFETCH_STATE_READING;
+                prefetcher->m_PendingData += size;
+            }
+
+            DM_PROFILE("Prefetch");
+            LoadBufferType* data = new LoadBufferType;
+            data->SetCapacity(size);
+            data->SetSize(size);
+            Result r = dmResourceMounts::ReadResource(prefetcher->m_Mounts, entry.m_PathHash, path, (uint8_t*)data->Begin(), size);
+
+            DM_MUTEX_SCOPED_LOCK(prefetcher->m_Mutex);
+            PrefetchBuffer* buffer = prefetcher->m_Buffers.Get(entry.m_PathHash);
+            if (r == RESULT_OK)
+            {
+                buffer->m_Data  = data;
+                buffer->m_Size  = size;
+                buffer->m_State = PREFETCH_STATE_READY;
+            }
+            else
+            {
+                delete data;
+                prefetcher->m_PendingData -= size;
+                buffer->m_State = PREFETCH_STATE_TAKEN;
+            }
+            dmConditionVariable::Broadcast(prefetcher->m_Cond);
+        }
+    }
+
+    HPrefetcher NewPrefetcher(dmResourceMounts::HContext mounts, const LoadTrace* trace, uint32_t max_data)
+    {
+#if defined(DM_HAS_THREADS)
+        Prefetcher* prefetcher    = new Prefetcher;
+        prefetcher->m_Mounts      = mounts;
+        prefetcher->m_PendingData = 0;
+        prefetcher->m_MaxData     = max_data;
+        prefetcher->m_HitCount    = 0;
+        prefetcher->m_EvictIndex  = 0;
+        prefetcher->m_WaiterCount = 0;
+        prefetcher->m_Cancel      = false;
+
+        uint32_t count = trace->m_Entries.Size();
+        prefetcher->m_Entries.SetCapacity(count);
+        prefetcher->m_Buffers.SetCapacity(dmMath::Max(1u, (2*count)/3), dmMath::Max(1u, count));
+        prefetcher->m_Paths.SetCapacity(trace->m_Paths.Size());
+        prefetcher->m_Paths.PushArray(trace->m_Paths.Begin(), trace->m_Paths.Size());
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const LoadTraceEntry& trace_entry = trace->m_Entries[i];
+            if (prefetcher->m_Buffers.Get(trace_entry.m_PathHash))
+                continue;
+
+            PrefetchBuffer buffer = { 0, 0, PREFETCH_STATE_PENDING };
+            prefetcher->m_Buffers.Put(trace_entry.m_PathHash, buffer);
+
+            PrefetchEntry entry;
+            entry.m_PathHash   = trace_entry.m_PathHash;
+            entry.m_Order      = 0;
+            entry.m_PathOffset = trace_entry.m_PathOffset;
+            entry.m_Index      = i;
+            prefetcher->m_Entries.Push(entry);
+        }
+
+        prefetcher->m_Mutex  = dmMutex::New();
+        prefetcher->m_Cond   = dmConditionVariable::New();
+        prefetcher->m_Thread = dmThread::New(PrefetchThread, 65536, prefetcher, "ResPrefetch");
+        return prefetcher;
+#else
+        (void)mounts;
+        (void)trace;
+        (void)max_data;
+        return 0;
+#endif
+    }
+
+    static void FreeBufferCallback(void*, const dmhash_t*, PrefetchBuffer* buffer)
+    {
+        delete buffer->m_Data;
+    }
+
+    void DeletePrefetcher(HPrefetcher prefetcher)
+    {
+        {
+            DM_MUTEX_SCOPED_LOCK(prefetcher->m_Mutex);
+            prefetcher->m_Cancel = true;
+            dmConditionVariable::Broadcast(prefetcher->m_Cond);
+        }
+        dmThread::Join(prefetcher->m_Thread);
+
+        {
+            // The thread is done, so the waiters are only finishing up
+            DM_MUTEX_SCOPED_LOCK(prefetcher->m_Mutex);
+            while (prefetcher->m_WaiterCount > 0)
+            {
+                dmConditionVariable::Wait(prefetcher->m_Cond, prefetcher->m_Mutex);
+            }
+        }
+
+        prefetcher->m_Buffers.Iterate(FreeBufferCallback, (void*)0);
+        dmConditionVariable::Delete(prefetcher->m_Cond);
+        dmMutex::Delete(prefetcher->m_Mutex);
+        delete prefetcher;
+    }
+
+    // Assumes the prefetcher mutex is held
+    static bool TakeBuffer(HPrefetcher prefetcher, PrefetchBuffer* buffer, LoadBufferType* out_buffer, uint32_t* resource_size)
+    {
+        if (buffer->m_State != PREFETCH_STATE_READY)
+        {
+            buffer->m_State = PREFETCH_STATE_TAKEN;
+            return false;
+        }
+
+        // Hand over the read data, and free the previous buffer of the load thread
+        out_buffer->Swap(*buffer->m_Data);
+        *resource_size = buffer->m_Size;
+
+        delete buffer->m_Data;
+        prefetcher->m_PendingData -= buffer->m_Size;
+        prefetcher->m_HitCount++;
+        buffer->m_Data  = 0;
+        buffer->m_State = PREFETCH_STATE_TAKEN;
+        dmConditionVariable::Broadcast(prefetcher->m_Cond);
+        return true;
+    }
+
+    bool TakePrefetchedResource(HPrefetcher prefetcher, dmhash_t path_hash, LoadBufferType* out_buffer, uint32_t* resource_size, bool* reading)
+    {
+        DM_MUTEX_SCOPED_LOCK(prefetcher->m_Mutex);
+        PrefetchBuffer* buffer = prefetcher->m_Buffers.Get(path_hash);
+        if (!buffer)
+            return false;
+
+        if (buffer->m_State == PREFETCH_STATE_READING)
+        {
+            // It's already on its way, so it's faster to wait for it than to read it again
+            if (reading)
+            {
+                prefetcher->m_WaiterCount++;
+                *reading = true;
+            }
+            return false;
+        }
+
+        return TakeBuffer(prefetcher, buffer, out_buffer, resource_size);
+    }
+
+    bool WaitForPrefetchedResource(HPrefetcher prefetcher, dmhash_t path_hash, LoadBufferType* out_buffer, uint32_t* resource_size)
+    {
+        DM_MUTEX_SCOPED_LOCK(prefetcher->m_Mutex);
+        assert(prefetcher->m_WaiterCount > 0);
+
+        PrefetchBuffer* buffer = prefetcher->m_Buffers.Get(path_hash);
+        while (buffer->m_State == PREFETCH_STATE_READING)
+        {
+            dmConditionVariable::Wait(prefetcher->m_Cond, prefetcher->m_Mutex);
+        }
+
+        bool taken = TakeBuffer(prefetcher, buffer, out_buffer, resource_size);
+        prefetcher->m_WaiterCount--;
+        dmConditionVariable::Broadcast(prefetcher->m_Cond);
+        return taken;
+    }
+
+    uint32_t GetPrefetchHitCount(HPrefetcher prefetcher)
+    {
+        DM_MUTEX_SCOPED_LOCK(prefetcher->m_Mutex);
+        return prefetcher->m_HitCount;
+    }
+}
@@ -0,0 +1,77 @@
+// Copyright 2020-2024 The Defold Foundation
+// Copyright 2014-2020 King
+// Copyright 2009-2014 Ragnar Svensson, Christian Murray
+// Licensed under the Defold License version 1.0 (the "License"); you may not use
+// this file except in compliance with the License.
+//
+// You may obtain a copy of the License, together with FAQs at
+// https://www.defold.com/license
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DM_RESOURCE_LOAD_TRACE_H
+#define DM_RESOURCE_LOAD_TRACE_H
+
+#include <dlib/array.h>
+#include <dlib/hash.h>
+#include <dlib/hashtable.h>
+#include "resource.h"
+
+namespace dmResourceMounts
+{
+    typedef struct ResourceMountsContext* HContext;
+}
+
+// A load trace is the list of resources a preloader loaded, in the order they were loaded.
+// The traces are stored per preloader root, and the next time the same root is preloaded
+// a prefetcher reads the traced resources ahead of the preloader, in the order they are
+// stored in the archives.
+
+namespace dmResource
+{
+    struct LoadTraceEntry
+    {
+        dmhash_t m_PathHash;    // Canonical path hash
+        uint32_t m_Size;
+        uint32_t m_PathOffset;  // Offset of the canonical path in m_Paths
+    };
+
+    struct LoadTrace
+    {
+        dmArray<LoadTraceEntry> m_Entries;
+        dmArray<char>           m_Paths;
+    };
+
+    void AddLoadTraceEntry(LoadTrace* trace, dmhash_t path_hash, const char* path, uint32_t size);
+
+    typedef dmHashTable64<LoadTrace*> TLoadTraces;
+
+    void ClearLoadTraces(TLoadTraces* traces);
+    // Takes ownership of the trace, replacing any previous trace for the same root
+    void SetLoadTrace(TLoadTraces* traces, dmhash_t root_path_hash, LoadTrace* trace);
+
+    // The traces are stored in native byte order
+    void WriteLoadTraces(TLoadTraces* traces, dmArray<uint8_t>* out);
+    Result ReadLoadTraces(TLoadTraces* traces, const void* data, uint32_t data_size);
+
+    typedef struct Prefetcher* HPrefetcher;
+
+    // Starts reading the traced resources on a separate thread, holding at most max_data bytes
+    // at a time. When that is full, the oldest data that hasn't been taken is dropped.
+    // Returns 0 on platforms without threads.
+    HPrefetcher NewPrefetcher(dmResourceMounts::HContext mounts, const LoadTrace* trace, uint32_t max_data);
+    void DeletePrefetcher(HPrefetcher prefetcher);
+
+    // Hands over the prefetched data by swapping it into buffer, if it has been read. Resources that are asked for before they
+    // are read won't be read by the prefetcher.
+    // If the resource is being read and reading is non null, it's set to true and the caller must call
+    // WaitForPrefetchedResource, which keeps the prefetcher alive until then.
+    bool TakePrefetchedResource(HPrefetcher prefetcher, dmhash_t path_hash, LoadBufferType* buffer, uint32_t* resource_size, bool* reading);
+    bool WaitForPrefetchedResource(HPrefetcher prefetcher, dmhash_t path_hash, LoadBufferType* buffer, uint32_t* resource_size);
+    uint32_t GetPrefetchHitCount(HPrefetcher prefetcher);
+}
+
+#endif // DM_RESOURCE_LOAD_TRACE_H
@@ -20,10 +20,13 @@
 #include "providers/provider.h"
 #include <resource/liveupdate_ddf.h>
 
+#include <dlib/atomic.h>
 #include <dlib/dstrings.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
 #include <dlib/mutex.h>
 #include <dlib/sys.h>
+#include <dlib/time.h>
 #include <algorithm> // std::sort
 
 namespace dmResourceMounts
@@ -54,7 +57,8 @@ struct ResourceMountsContext
     dmHashTable64<CustomFile>       m_CustomFiles;
     dmResourceProvider::HArchive    m_ResourceBaseArchive;
     dmMutex::HMutex                 m_Mutex;
-
+    // Reads in progress without the lock, see BeginRead()
+    int32_atomic_t                  m_ReadCount;
 };
 
 
@@ -65,6 +69,7 @@ static dmResource::Result ProviderResultToResult(dmResourceProvider::Result resu
     case dmResourceProvider::RESULT_OK:         return dmResource::RESULT_OK;
     case dmResourceProvider::RESULT_IO_ERROR:   return dmResource::RESULT_IO_ERROR;
     case dmResourceProvider::RESULT_NOT_FOUND:  return dmResource::RESULT_RESOURCE_NOT_FOUND;
+    case dmResourceProvider::RESULT_NOT_SUPPORTED: return dmResource::RESULT_NOT_SUPPORTED;
     default:                                    return dmResource::RESULT_UNKNOWN_ERROR;
     }
 }
@@ -77,6 +82,7 @@ HContext Create(dmResourceProvider::HArchive base_archive)
     ctx->m_Mounts.SetCapacity(2);
     ctx->m_Mutex = dmMutex::New();
     ctx->m_ResourceBaseArchive = base_archive;
+    ctx->m_ReadCount = 0;
     return ctx;
 }
 
@@ -164,12 +170,24 @@ dmResource::Result AddMount(HContext ctx, const char* name, dmResourceProvider::
     return dmResource::RESULT_OK;
 }
 
+// Assumes mutex lock is held. No new reads can start, and the ones in progress may use any of the mounts
+static void WaitForReads(HContext ctx)
+{
+    while (dmAtomicGet32(&ctx->m_ReadCount) != 0)
+    {
+        dmTime::Sleep(100);
+    }
+}
+
 // Assumes mutex lock is held
 static dmResource::Result RemoveMountByIndexInternal(HContext ctx, uint32_t index)
 {
     if (index >= ctx->m_Mounts.Size())
         return dmResource::RESULT_RESOURCE_NOT_FOUND;
 
+    // The caller may unmount the archive once it's removed
+    WaitForReads(ctx);
+
     ctx->m_Mounts.EraseSwap(index); // TODO: We'd like an Erase() function in dmArray, to keep the internal ordering
     SortMounts(ctx->m_Mounts);
 
@@ -203,6 +221,7 @@ dmResource::Result RemoveAndUnmountByName(HContext ctx, const char* name)
         ArchiveMount& mount = ctx->m_Mounts[i];
         if (strcmp(mount.m_Name, name) == 0)
         {
+            WaitForReads(ctx);
             dmResourceProvider::Unmount(mount.m_Archive);
             return RemoveMountByIndexInternal(ctx, i);
         }
@@ -355,6 +374,8 @@ dmResource::Result GetMountByName(HContext ctx, const char* name, SGetMountResul
 
 static dmResource::Result DestroyMounts(HContext ctx)
 {
+    WaitForReads(ctx);
+
     uint32_t size = ctx->m_Mounts.Size();
     for (uint32_t i = 0; i < size; ++i)
     {
@@ -429,7 +450,10 @@ dmResource::Result ResourceExists(HContext ctx, dmhash_t path_hash)
     return GetResourceSize(ctx, path_hash, 0, &resource_size);
 }
 
-dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_size)
+// Finds the first mount containing the file, and keeps it mounted until EndRead() is called.
+// This lets the load threads read, decompress and decrypt files at the same time, without holding the lock.
+// Returns 0 if the file wasn't found in the mounts, or if the lookup failed (see out_result)
+static dmResourceProvider::HArchive BeginRead(HContext ctx, dmhash_t path_hash, const char* path, dmResource::Result* out_result)
 {
     DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
 
@@ -437,24 +461,105 @@ dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* pa
     for (uint32_t i = 0; i < size; ++i)
     {
         ArchiveMount& mount = ctx->m_Mounts[i];
-        dmResourceProvider::Result result = dmResourceProvider::ReadFile(mount.m_Archive, path_hash, path, buffer, buffer_size);
+        // We must only look at the first mount containing the file, or we might return stale data
+        uint32_t file_size;
+        dmResourceProvider::Result result = dmResourceProvider::GetFileSize(mount.m_Archive, path_hash, path, &file_size);
         if (dmResourceProvider::RESULT_NOT_FOUND == result)
             continue;
+        *out_result = ProviderResultToResult(result);
+        if (dmResourceProvider::RESULT_OK != result)
+            return 0;
+
+        DebugPrintMount(3, mount);
+        dmAtomicIncrement32(&ctx->m_ReadCount);
+        return mount.m_Archive;
+    }
+
+    *out_result = dmResource::RESULT_RESOURCE_NOT_FOUND;
+    return 0;
+}
+
+static void EndRead(HContext ctx)
+{
+    dmAtomicDecrement32(&ctx->m_ReadCount);
+}
+
+dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_size)
+{
+    dmResource::Result r;
+    dmResourceProvider::HArchive archive = BeginRead(ctx, path_hash, path, &r);
+    if (archive)
+    {
+        dmResourceProvider::Result result = dmResourceProvider::ReadFile(archive, path_hash, path, buffer, buffer_size);
+        EndRead(ctx);
         if (dmResourceProvider::RESULT_OK == result)
         {
             DM_RESOURCE_DBG_LOG(3, "ReadResource: %s (%u bytes)\n", path, buffer_size);
-            DebugPrintMount(3, mount);
             return dmResource::RESULT_OK;
         }
         return ProviderResultToResult(result);
     }
 
+    if (dmResource::RESULT_RESOURCE_NOT_FOUND != r)
+        return r;
+
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
     if (!ctx->m_CustomFiles.Empty())
         return ReadCustomResource(ctx, path_hash, buffer, buffer_size);
 
     return dmResource::RESULT_RESOURCE_NOT_FOUND;
 }
 
+dmResource::Result GetResourceData(HContext ctx, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_size)
+{
+    dmResource::Result r;
+    dmResourceProvider::HArchive archive = BeginRead(ctx, path_hash, path, &r);
+    if (archive)
+    {
+        dmResourceProvider::Result result = dmResourceProvider::GetFileData(archive, path_hash, path, data, data_size);
+        EndRead(ctx);
+        if (dmResourceProvider::RESULT_OK == result)
+        {
+            DM_RESOURCE_DBG_LOG(3, "GetResourceData: %s (%u bytes)\n", path, *data_size);
+            return dmResource::RESULT_OK;
+        }
+        return ProviderResultToResult(result);
+    }
+
+    if (dmResource::RESULT_RESOURCE_NOT_FOUND != r)
+        return r;
+
+    // Custom files may be removed at any time, so we always copy those
+    return dmResource::RESULT_NOT_SUPPORTED;
+}
+
+dmResource::Result GetResourceReadOrder(HContext ctx, dmhash_t path_hash, const char* path, uint64_t* order)
+{
+    DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
+
+    uint32_t size = ctx->m_Mounts.Size();
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        ArchiveMount& mount = ctx->m_Mounts[i];
+        uint32_t file_size;
+        dmResourceProvider::Result result = dmResourceProvider::GetFileSize(mount.m_Archive, path_hash, path, &file_size);
+        if (dmResourceProvider::RESULT_NOT_FOUND == result)
+            continue;
+        if (dmResourceProvider::RESULT_OK != result)
+            return ProviderResultToResult(result);
+
+        uint64_t offset = 0xFFFFFFFF;
+        result = dmResourceProvider::GetFileOffset(mount.m_Archive, path_hash, path, &offset);
+        if (dmResourceProvider::RESULT_OK != result && dmResourceProvider::RESULT_NOT_SUPPORTED != result)
+            return ProviderResultToResult(result);
+
+        *order = ((uint64_t)i << 32) | dmMath::Min(offset, (uint64_t)0xFFFFFFFF);
+        return dmResource::RESULT_OK;
+    }
+
+    return dmResource::RESULT_RESOURCE_NOT_FOUND;
+}
+
 dmResource::Result ReadResource(HContext ctx, const char* path, dmhash_t path_hash, dmArray<char>* buffer)
 {
     DM_MUTEX_SCOPED_LOCK(ctx->m_Mutex);
@@ -51,6 +51,12 @@ namespace dmResourceMounts
     dmResource::Result GetResourceSize(HContext ctx, dmhash_t path_hash, const char* path, uint32_t* resource_size);
     dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, uint8_t* buffer, uint32_t buffer_size);
     dmResource::Result ReadResource(HContext ctx, dmhash_t path_hash, const char* path, dmArray<char>* buffer);
+    // Gets a read only view of the resource data, if the mount can provide one (e.g. a memory mapped archive).
+    // Returns RESULT_NOT_SUPPORTED if the resource has to be read with ReadResource. The data is valid while the archive is mounted.
+    dmResource::Result GetResourceData(HContext ctx, dmhash_t path_hash, const char* path, const uint8_t** data, uint32_t* data_size);
+    // Gets a sort key for reading resources in the order they're stored: the mount index in the upper 32 bits, and the
+    // offset within the archive in the lower. Resources whose mount doesn't know their offset are sorted last within that mount.
+    dmResource::Result GetResourceReadOrder(HContext ctx, dmhash_t path_hash, const char* path, uint64_t* order);
 
     struct SGetMountResult
     {
@@ -13,25 +13,34 @@
 // specific language governing permissions and limitations under the License.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <time.h>
 
 #include <dlib/profile.h>
+#include <dlib/array.h>
 #include <dlib/dstrings.h>
 #include <dlib/hash.h>
 #include <dlib/hashtable.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
 #include <dlib/uri.h>
 #include <dlib/time.h>
 #include <dlib/spinlock.h>
 
 #include "block_allocator.h"
 #include "resource.h"
+#include "resource_load_trace.h"
 #include "resource_private.h"
 #include "resource_util.h"
 #include "async/load_queue.h"
 
+DM_PROPERTY_U32(rmtp_PreloaderTime, 0, FrameReset, "time spent updating preloaders on the main thread (us) / frame");
+DM_PROPERTY_U32(rmtp_PreloaderThreadCreates, 0, FrameReset, "# resources created on the load threads / frame");
+DM_PROPERTY_U32(rmtp_PreloaderPeakRequests, 0, FrameReset, "sum of the peak request counts of the updated preloaders / frame");
+DM_PROPERTY_U32(rmtp_PreloaderTreeDepth, 0, FrameReset, "deepest request tree of the last updated preloader / frame");
+
 namespace dmResource
 {
     // The preloader works as follow; a tree is constructed with each resource to be loaded as a node in the tree.
@@ -71,8 +80,9 @@ namespace dmResource
     // to each request item. The path cache is also syncronized with the same spinlock as the new preloader hints array.
     // The path cache is not touched by the UpdatePreloader code, we keep the internalized pointers in the item.
 
-    // If max number of preload items is reached or the path cache is full new items added to the preloader will
-    // be thrown away and can potentially cause synced loading of those resources.
+    // The request tree and the path cache grow on demand. Their memory comes from an arena owned by the preloader,
+    // which is released all at once when the preloader is deleted. Requests are allocated in pages so that
+    // pointers to them stay valid as the tree grows.
 
     struct PathDescriptor
     {
@@ -83,7 +93,7 @@ namespace dmResource
         dmhash_t m_CanonicalPathHash;
     };
 
-    typedef int16_t TRequestIndex;
+    typedef int32_t TRequestIndex;
 
     struct PreloadRequest
     {
@@ -92,7 +102,7 @@ namespace dmResource
         TRequestIndex m_Parent;
         TRequestIndex m_FirstChild;
         TRequestIndex m_NextSibling;
-        uint16_t m_PendingChildCount;
+        uint32_t m_PendingChildCount;
 
         // Set once resources have started loading, they have a load request
         dmLoadQueue::HRequest m_LoadRequest;
@@ -100,6 +110,7 @@ namespace dmResource
         // Set for items that are pending and waiting for children to complete
         void* m_Buffer;
         uint32_t m_BufferSize;
+        bool m_BufferIsArchiveData; // Points into archive memory, and is not owned by the preloader
 
         // Set once preload function has run
         void* m_PreloadData;
@@ -118,24 +129,67 @@ namespace dmResource
     };
 
 
-    // The preloader will function even down to a value of 1 here (the root object)
-    // and sets the limit of how large a dependencies tree can be stored. Since nodes
-    // are always present with all their children inserted (unless there was not room)
-    // the required size is something the sum of all children on each level down along
-    // the largest branch.
+    // The initial sizes covers a typical collection. Since nodes are always present with all
+    // their children inserted, the required number of requests is something the sum of all
+    // children on each level down along the largest branch.
 
-    typedef dmHashTable<dmhash_t, uint32_t> TPathHashTable;
+    typedef dmHashTable<dmhash_t, const char*> TPathHashTable;
     typedef dmHashTable<dmhash_t, bool> TPathInProgressTable;
 
-    static const uint32_t MAX_PRELOADER_REQUESTS         = 1024;
-    static const uint32_t PATH_IN_PROGRESS_TABLE_SIZE    = MAX_PRELOADER_REQUESTS / 3;
-    static const uint32_t PATH_IN_PROGRESS_CAPACITY      = MAX_PRELOADER_REQUESTS;
-    static const uint32_t PATH_IN_PROGRESS_HASHDATA_SIZE = (PATH_IN_PROGRESS_TABLE_SIZE * sizeof(uint32_t)) + (PATH_IN_PROGRESS_CAPACITY * sizeof(TPathInProgressTable::Entry));
-    static const uint32_t PATH_AVERAGE_LENGTH            = 40;
-    static const uint32_t MAX_PRELOADER_PATHS            = 1536;
-    static const uint32_t PATH_BUFFER_TABLE_SIZE         = 509;
-    static const uint32_t PATH_BUFFER_TABLE_CAPACITY     = MAX_PRELOADER_PATHS;
-    static const uint32_t PATH_BUFFER_HASHDATA_SIZE      = (PATH_BUFFER_TABLE_SIZE * sizeof(uint32_t)) + (PATH_BUFFER_TABLE_CAPACITY * sizeof(TPathHashTable::Entry));
+    static const uint32_t REQUEST_PAGE_SHIFT          = 8;
+    static const uint32_t REQUEST_PAGE_SIZE           = 1 << REQUEST_PAGE_SHIFT;
+    static const uint32_t PATH_IN_PROGRESS_CAPACITY   = REQUEST_PAGE_SIZE;
+    static const uint32_t PATH_BUFFER_TABLE_CAPACITY  = 512;
+    static const uint32_t ARENA_BLOCK_SIZE            = 32 * 1024;
+
+    // Bump allocator, freeing all its memory at once
+    struct PreloaderArena
+    {
+        dmArray<uint8_t*> m_Blocks;
+        uint8_t*          m_Cursor;
+        uint32_t          m_Left;
+        uint32_t          m_Size; // Total size of all blocks
+    };
+
+    static void* ArenaAlloc(PreloaderArena* arena, uint32_t size)
+    {
+        size = (size + 15) & ~15u;
+        if (size > arena->m_Left)
+        {
+            uint32_t block_size = dmMath::Max(size, ARENA_BLOCK_SIZE);
+            uint8_t* block      = (uint8_t*)malloc(block_size);
+            if (arena->m_Blocks.Full())
+            {
+                arena->m_Blocks.OffsetCapacity(16);
+            }
+            arena->m_Blocks.Push(block);
+            arena->m_Size += block_size;
+
+            // Large allocations get a block of their own, keep filling the current one
+            if (block_size > ARENA_BLOCK_SIZE && arena->m_Left > 0)
+            {
+                return block;
+            }
+            arena->m_Cursor = block;
+            arena->m_Left   = block_size;
+        }
+        void* result = arena->m_Cursor;
+        arena->m_Cursor += size;
+        arena->m_Left -= size;
+        return result;
+    }
+
+    static void ArenaReset(PreloaderArena* arena)
+    {
+        for (uint32_t i = 0; i < arena->m_Blocks.Size(); ++i)
+        {
+            free(arena->m_Blocks[i]);
+        }
+        arena->m_Blocks.SetSize(0);
+        arena->m_Cursor = 0;
+        arena->m_Left   = 0;
+        arena->m_Size   = 0;
+    }
 
     struct PendingHint
     {
@@ -145,35 +199,28 @@ namespace dmResource
 
     struct ResourcePreloader
     {
-        ResourcePreloader()
-            : m_InProgress(&m_PathInProgressData, PATH_IN_PROGRESS_TABLE_SIZE, PATH_IN_PROGRESS_CAPACITY)
-        {
-        }
         struct SyncedData
         {
-            SyncedData()
-                : m_PathLookup(m_LookupData, PATH_BUFFER_TABLE_SIZE, PATH_BUFFER_TABLE_CAPACITY)
-                , m_PathDataUsed(0)
-            {
-            }
             dmArray<PendingHint> m_NewHints;
             TPathHashTable m_PathLookup;
-            uint8_t m_LookupData[PATH_BUFFER_HASHDATA_SIZE];
-            char m_PathData[MAX_PRELOADER_PATHS * PATH_AVERAGE_LENGTH];
-            uint32_t m_PathDataUsed;
+            // Holds the internalized paths and the request pages
+            PreloaderArena m_Arena;
         } m_SyncedData;
 
         dmSpinlock::Spinlock m_SyncedDataSpinlock;
 
-        PreloadRequest m_Request[MAX_PRELOADER_REQUESTS];
+        // The request tree, REQUEST_PAGE_SIZE requests per page
+        dmArray<PreloadRequest*> m_RequestPages;
 
         // list of free nodes
-        TRequestIndex m_Freelist[MAX_PRELOADER_REQUESTS];
-        uint32_t m_FreelistSize;
+        dmArray<TRequestIndex> m_Freelist;
         dmLoadQueue::HQueue m_LoadQueue;
         HFactory m_Factory;
         TPathInProgressTable m_InProgress;
-        uint8_t m_PathInProgressData[PATH_IN_PROGRESS_HASHDATA_SIZE];
+
+        // Stats
+        uint32_t m_PeakRequestCount;
+        uint32_t m_MaxDepth;
 
         // used instead of dynamic allocs as far as it lasts.
         dmBlockAllocator::HContext m_BlockAllocator;
@@ -188,27 +235,62 @@ namespace dmResource
         TRequestIndex m_PersistResourceCount;
 
         dmArray<void*> m_PersistedResources;
+
+        // Set when recording load traces
+        LoadTrace* m_LoadTrace;
+        // Set when a load trace exists for the root resource
+        HPrefetcher m_Prefetcher;
     };
 
+    static inline PreloadRequest* GetRequest(ResourcePreloader* preloader, TRequestIndex index)
+    {
+        return &preloader->m_RequestPages[index >> REQUEST_PAGE_SHIFT][index & (REQUEST_PAGE_SIZE - 1)];
+    }
+
+    static inline uint32_t GetRequestCapacity(ResourcePreloader* preloader)
+    {
+        return preloader->m_RequestPages.Size() * REQUEST_PAGE_SIZE;
+    }
+
+    // Adds a page of requests and puts them on the free list
+    static void GrowRequests(ResourcePreloader* preloader)
+    {
+        PreloadRequest* page;
+        {
+            DM_SPINLOCK_SCOPED_LOCK(preloader->m_SyncedDataSpinlock)
+            page = (PreloadRequest*)ArenaAlloc(&preloader->m_SyncedData.m_Arena, sizeof(PreloadRequest) * REQUEST_PAGE_SIZE);
+        }
+
+        TRequestIndex first = (TRequestIndex)GetRequestCapacity(preloader);
+        if (preloader->m_RequestPages.Full())
+        {
+            preloader->m_RequestPages.OffsetCapacity(16);
+        }
+        preloader->m_RequestPages.Push(page);
+
+        // Lowest index first out, as for the first page
+        preloader->m_Freelist.SetCapacity(GetRequestCapacity(preloader));
+        for (TRequestIndex i = first + REQUEST_PAGE_SIZE - 1; i >= first; --i)
+        {
+            preloader->m_Freelist.Push(i);
+        }
+    }
+
     const char* InternalizePath(ResourcePreloader::SyncedData* preloader_synced_data, dmhash_t path_hash, const char* path, uint32_t path_len)
     {
-        uint32_t* path_lookup = preloader_synced_data->m_PathLookup.Get(path_hash);
+        const char** path_lookup = preloader_synced_data->m_PathLookup.Get(path_hash);
         if (path_lookup != 0x0)
         {
-            return &preloader_synced_data->m_PathData[*path_lookup];
+            return *path_lookup;
         }
         if (preloader_synced_data->m_PathLookup.Full())
         {
-            return 0x0;
-        }
-        if (preloader_synced_data->m_PathDataUsed + path_len + 1 > sizeof(preloader_synced_data->m_PathData))
-        {
-            return 0x0;
+            uint32_t capacity = preloader_synced_data->m_PathLookup.Capacity() * 2;
+            preloader_synced_data->m_PathLookup.SetCapacity((2*capacity)/3, capacity);
         }
-        char* result = &preloader_synced_data->m_PathData[preloader_synced_data->m_PathDataUsed];
+        char* result = (char*)ArenaAlloc(&preloader_synced_data->m_Arena, path_len + 1);
         dmStrlCpy(result, path, path_len + 1);
-        preloader_synced_data->m_PathLookup.Put(path_hash, preloader_synced_data->m_PathDataUsed);
-        preloader_synced_data->m_PathDataUsed += path_len + 1;
+        preloader_synced_data->m_PathLookup.Put(path_hash, result);
         return result;
     }
 
@@ -262,18 +344,8 @@ namespace dmResource
 
         DM_SPINLOCK_SCOPED_LOCK(preloader->m_SyncedDataSpinlock)
         {
-            out_path_descriptor.m_InternalizedName = InternalizePath(&preloader->m_SyncedData, out_path_descriptor.m_NameHash, name, name_len);
-            if (out_path_descriptor.m_InternalizedName == 0x0)
-            {
-                dmSpinlock::Unlock(&preloader->m_SyncedDataSpinlock);
-                return RESULT_OUT_OF_MEMORY;
-            }
+            out_path_descriptor.m_InternalizedName          = InternalizePath(&preloader->m_SyncedData, out_path_descriptor.m_NameHash, name, name_len);
             out_path_descriptor.m_InternalizedCanonicalPath = InternalizePath(&preloader->m_SyncedData, out_path_descriptor.m_CanonicalPathHash, canonical_path, canonical_path_len);
-            if (out_path_descriptor.m_InternalizedCanonicalPath == 0x0)
-            {
-                dmSpinlock::Unlock(&preloader->m_SyncedDataSpinlock);
-                return RESULT_OUT_OF_MEMORY;
-            }
         }
 
         return RESULT_OK;
@@ -290,6 +362,11 @@ namespace dmResource
     {
         dmhash_t path_hash = path_descriptor->m_CanonicalPathHash;
         assert(preloader->m_InProgress.Get(path_hash) == 0x0);
+        if (preloader->m_InProgress.Full())
+        {
+            uint32_t capacity = preloader->m_InProgress.Capacity() * 2;
+            preloader->m_InProgress.SetCapacity((2*capacity)/3, capacity);
+        }
         preloader->m_InProgress.Put(path_hash, true);
     }
 
@@ -302,44 +379,44 @@ namespace dmResource
 
     static void PreloaderTreeInsert(ResourcePreloader* preloader, TRequestIndex index, TRequestIndex parent)
     {
-        PreloadRequest* reqs      = &preloader->m_Request[0];
-        reqs[index].m_NextSibling = reqs[parent].m_FirstChild;
-        reqs[index].m_Parent      = parent;
-        reqs[parent].m_FirstChild = index;
-        reqs[parent].m_PendingChildCount += 1;
+        PreloadRequest* req        = GetRequest(preloader, index);
+        PreloadRequest* parent_req = GetRequest(preloader, parent);
+        req->m_NextSibling         = parent_req->m_FirstChild;
+        req->m_Parent              = parent;
+        parent_req->m_FirstChild   = index;
+        parent_req->m_PendingChildCount += 1;
     }
 
     static void RemoveFromParentPendingCount(ResourcePreloader* preloader, PreloadRequest* req)
     {
         if (req->m_Parent != -1)
         {
-            assert(preloader->m_Request[req->m_Parent].m_PendingChildCount > 0);
-            preloader->m_Request[req->m_Parent].m_PendingChildCount -= 1;
+            assert(GetRequest(preloader, req->m_Parent)->m_PendingChildCount > 0);
+            GetRequest(preloader, req->m_Parent)->m_PendingChildCount -= 1;
         }
     }
 
     static Result PreloadPathDescriptor(HPreloader preloader, TRequestIndex parent, const PathDescriptor& path_descriptor)
     {
         // Quick deduplication, check if the child is already listed under the current parent
-        TRequestIndex child = preloader->m_Request[parent].m_FirstChild;
+        TRequestIndex child = GetRequest(preloader, parent)->m_FirstChild;
         while (child != -1)
         {
-            if (preloader->m_Request[child].m_PathDescriptor.m_NameHash == path_descriptor.m_NameHash)
+            if (GetRequest(preloader, child)->m_PathDescriptor.m_NameHash == path_descriptor.m_NameHash)
             {
                 return RESULT_ALREADY_REGISTERED;
             }
-            child = preloader->m_Request[child].m_NextSibling;
+            child = GetRequest(preloader, child)->m_NextSibling;
         }
 
-        if (!preloader->m_FreelistSize)
+        if (preloader->m_Freelist.Empty())
         {
-            // Preload queue is exhausted; this is not fatal, it just means the resource will be loaded
-            // inside the main thread which may cause stuttering
-            return RESULT_OUT_OF_MEMORY;
+            GrowRequests(preloader);
         }
 
-        TRequestIndex new_req = preloader->m_Freelist[--preloader->m_FreelistSize];
-        PreloadRequest* req   = &preloader->m_Request[new_req];
+        TRequestIndex new_req = preloader->m_Freelist.Back();
+        preloader->m_Freelist.Pop();
+        PreloadRequest* req   = GetRequest(preloader, new_req);
         memset(req, 0, sizeof(PreloadRequest));
         req->m_PathDescriptor    = path_descriptor;
         req->m_FirstChild        = -1;
@@ -350,19 +427,25 @@ namespace dmResource
         // Check for recursive resources, if it is, mark with loop error, the recursive load result will
         // be checked for in the PreloaderUpdateOneItem and the result will be propagated to the resource
         // preloaded creator.
+        uint32_t depth      = 0;
         TRequestIndex go_up = parent;
         while (go_up != -1)
         {
-            if (preloader->m_Request[go_up].m_PathDescriptor.m_CanonicalPathHash == path_descriptor.m_CanonicalPathHash)
+            ++depth;
+            if (GetRequest(preloader, go_up)->m_PathDescriptor.m_CanonicalPathHash == path_descriptor.m_CanonicalPathHash)
             {
                 req->m_LoadResult = RESULT_RESOURCE_LOOP_ERROR;
                 assert(parent != -1);
-                assert(preloader->m_Request[parent].m_PendingChildCount > 0);
-                preloader->m_Request[parent].m_PendingChildCount -= 1;
+                assert(GetRequest(preloader, parent)->m_PendingChildCount > 0);
+                GetRequest(preloader, parent)->m_PendingChildCount -= 1;
                 break;
             }
-            go_up = preloader->m_Request[go_up].m_Parent;
+            go_up = GetRequest(preloader, go_up)->m_Parent;
         }
+
+        uint32_t request_count        = GetRequestCapacity(preloader) - preloader->m_Freelist.Size();
+        preloader->m_PeakRequestCount = dmMath::Max(preloader->m_PeakRequestCount, request_count);
+        preloader->m_MaxDepth         = dmMath::Max(preloader->m_MaxDepth, depth);
         return RESULT_OK;
     }
 
@@ -404,12 +487,12 @@ namespace dmResource
     // Only supports removing the first child, which is all the preloader uses anyway.
     static void PreloaderRemoveLeaf(ResourcePreloader* preloader, TRequestIndex index)
     {
-        assert(preloader->m_FreelistSize < MAX_PRELOADER_REQUESTS);
+        assert(preloader->m_Freelist.Size() < GetRequestCapacity(preloader));
 
-        PreloadRequest* me = &preloader->m_Request[index];
+        PreloadRequest* me = GetRequest(preloader, index);
         assert(me->m_FirstChild == -1);
         assert(me->m_PendingChildCount == 0);
-        PreloadRequest* parent = &preloader->m_Request[me->m_Parent];
+        PreloadRequest* parent = GetRequest(preloader, me->m_Parent);
         assert(parent->m_FirstChild == index);
 
         if (me->m_Resource)
@@ -431,13 +514,103 @@ namespace dmResource
             RemoveFromParentPendingCount(preloader, me);
         }
 
-        preloader->m_Freelist[preloader->m_FreelistSize++] = index;
+        preloader->m_Freelist.Push(index);
+    }
+
+    // The preload data belongs to the create function (see CreateResource), so a resource with
+    // preload data is created and destroyed right away to free it.
+    static void DiscardPreloadedResource(ResourcePreloader* preloader, PreloadRequest* req, void* preload_data, const void* buffer, uint32_t buffer_size)
+    {
+        SResourceType* resource_type = req->m_PathDescriptor.m_ResourceType;
+
+        SResourceDescriptor tmp_resource;
+        memset(&tmp_resource, 0, sizeof(tmp_resource));
+        tmp_resource.m_NameHash           = req->m_PathDescriptor.m_CanonicalPathHash;
+        tmp_resource.m_ReferenceCount     = 1;
+        tmp_resource.m_ResourceType       = (void*)resource_type;
+        tmp_resource.m_ResourceSizeOnDisc = buffer_size;
+
+        ResourceCreateParams params;
+        params.m_Factory     = preloader->m_Factory;
+        params.m_Context     = resource_type->m_Context;
+        params.m_PreloadData = preload_data;
+        params.m_Resource    = &tmp_resource;
+        params.m_Filename    = req->m_PathDescriptor.m_InternalizedName;
+        params.m_Buffer      = buffer;
+        params.m_BufferSize  = buffer_size;
+        if (resource_type->m_CreateFunction(params) == RESULT_OK)
+        {
+            ResourceDestroyParams destroy_params;
+            destroy_params.m_Factory  = preloader->m_Factory;
+            destroy_params.m_Context  = resource_type->m_Context;
+            destroy_params.m_Resource = &tmp_resource;
+            resource_type->m_DestroyFunction(destroy_params);
+        }
+    }
+
+    // Drops what a request holds from a load that has started, before the request is removed.
+    // Loads are only started once the parent is loaded, so this only happens below resources that
+    // don't wait for their children (see SetTypeThreadSafeCreate).
+    static void CancelLoad(ResourcePreloader* preloader, PreloadRequest* req)
+    {
+        if (req->m_LoadRequest)
+        {
+            // A load thread may be working on it, and the load queue can't take it back, so wait for it
+            void* buffer;
+            uint32_t buffer_size;
+            dmLoadQueue::LoadResult load_result;
+            while (dmLoadQueue::EndLoad(preloader->m_LoadQueue, req->m_LoadRequest, &buffer, &buffer_size, &load_result) == dmLoadQueue::RESULT_PENDING)
+            {
+                dmTime::Sleep(100);
+            }
+
+            if (load_result.m_CreateResult == RESULT_OK)
+            {
+                SResourceType* resource_type = (SResourceType*)load_result.m_Resource.m_ResourceType;
+                ResourceDestroyParams params;
+                params.m_Factory  = preloader->m_Factory;
+                params.m_Context  = resource_type->m_Context;
+                params.m_Resource = &load_result.m_Resource;
+                resource_type->m_DestroyFunction(params);
+            }
+            else if (load_result.m_PreloadData && load_result.m_CreateResult == RESULT_PENDING)
+            {
+                DiscardPreloadedResource(preloader, req, load_result.m_PreloadData, buffer, buffer_size);
+            }
+
+            dmLoadQueue::FreeLoad(preloader->m_LoadQueue, req->m_LoadRequest);
+            req->m_LoadRequest = 0;
+            preloader->m_LoadQueueFull = false;
+            UnmarkPathInProgress(preloader, &req->m_PathDescriptor);
+
+            // Insert the hints of the load, so they are removed with the rest of the children
+            PopHints(preloader);
+        }
+        else if (req->m_Buffer)
+        {
+            // Loaded, and waiting for its children
+            if (req->m_PreloadData)
+            {
+                DiscardPreloadedResource(preloader, req, req->m_PreloadData, req->m_Buffer, req->m_BufferSize);
+                req->m_PreloadData = 0;
+            }
+            if (!req->m_BufferIsArchiveData)
+            {
+                dmBlockAllocator::Free(preloader->m_BlockAllocator, req->m_Buffer, req->m_BufferSize);
+            }
+            req->m_Buffer              = 0;
+            req->m_BufferIsArchiveData = false;
+            UnmarkPathInProgress(preloader, &req->m_PathDescriptor);
+        }
     }
 
     static void RemoveChildren(ResourcePreloader* preloader, PreloadRequest* req)
     {
         while (req->m_FirstChild != -1)
         {
+            PreloadRequest* child = GetRequest(preloader, req->m_FirstChild);
+            CancelLoad(preloader, child);
+            RemoveChildren(preloader, child);
             PreloaderRemoveLeaf(preloader, req->m_FirstChild);
         }
         assert(req->m_PendingChildCount == 0);
@@ -446,23 +619,25 @@ namespace dmResource
     HPreloader NewPreloader(HFactory factory, const dmArray<const char*>& names)
     {
         ResourcePreloader* preloader = new ResourcePreloader();
-        // root is always allocated so we don't add index zero in the free list
-        for (uint32_t i = 0; i < MAX_PRELOADER_REQUESTS - 1; i++)
-        {
-            preloader->m_Freelist[i] = MAX_PRELOADER_REQUESTS - i - 1;
-        }
-
-        preloader->m_FreelistSize = MAX_PRELOADER_REQUESTS - 1;
-
         preloader->m_Factory         = factory;
         preloader->m_LoadQueue       = dmLoadQueue::CreateQueue(factory);
         dmSpinlock::Create(&preloader->m_SyncedDataSpinlock);
 
+        memset(&preloader->m_SyncedData.m_Arena, 0, sizeof(PreloaderArena));
+        preloader->m_SyncedData.m_PathLookup.SetCapacity((2*PATH_BUFFER_TABLE_CAPACITY)/3, PATH_BUFFER_TABLE_CAPACITY);
+        preloader->m_InProgress.SetCapacity((2*PATH_IN_PROGRESS_CAPACITY)/3, PATH_IN_PROGRESS_CAPACITY);
+
+        // root is always allocated so we don't keep index zero in the free list
+        GrowRequests(preloader);
+        preloader->m_Freelist.Pop();
+        preloader->m_PeakRequestCount = 1;
+        preloader->m_MaxDepth         = 0;
+
         preloader->m_PersistResourceCount = 0;
         preloader->m_PersistedResources.SetCapacity(names.Size());
 
         // Insert root.
-        PreloadRequest* root = &preloader->m_Request[0];
+        PreloadRequest* root = GetRequest(preloader, 0);
         memset(root, 0x00, sizeof(PreloadRequest));
 
         root->m_LoadResult        = MakePathDescriptor(preloader, names[0], root->m_PathDescriptor);
@@ -472,16 +647,24 @@ namespace dmResource
         preloader->m_PersistResourceCount++;
 
         // Post create setup
-        preloader->m_PostCreateCallbacks.SetCapacity(MAX_PRELOADER_REQUESTS / 8);
+        preloader->m_PostCreateCallbacks.SetCapacity(REQUEST_PAGE_SIZE / 2);
         preloader->m_LoadQueueFull           = false;
         preloader->m_CreateComplete          = false;
         preloader->m_PostCreateCallbackIndex = 0;
 
         preloader->m_BlockAllocator = dmBlockAllocator::CreateContext();
 
+        preloader->m_LoadTrace  = 0;
+        preloader->m_Prefetcher = 0;
         if (root->m_LoadResult == RESULT_OK)
         {
             root->m_LoadResult = RESULT_PENDING;
+
+            if (IsRecordingLoadTraces(factory))
+            {
+                preloader->m_LoadTrace = new LoadTrace;
+            }
+            preloader->m_Prefetcher = StartPrefetch(factory, root->m_PathDescriptor.m_CanonicalPathHash);
         }
 
         // Add remaining items as children of root (first item).
@@ -506,6 +689,8 @@ namespace dmResource
         return NewPreloader(factory, names);
     }
 
+    static void CommitResource(HPreloader preloader, PreloadRequest* req, SResourceDescriptor* created_resource);
+
     // CreateResource operation ends either with
     //   1) Having created the resource and free:d all buffers => RESULT_OK + m_Resource
     //   2) Having failed, (or created and destroyed), leaving => RESULT_SOME_ERROR + everything free:d
@@ -543,9 +728,13 @@ namespace dmResource
             params.m_BufferSize               = req->m_BufferSize;
             req->m_LoadResult                 = resource_type->m_CreateFunction(params);
 
-            dmBlockAllocator::Free(preloader->m_BlockAllocator, req->m_Buffer, req->m_BufferSize);
+            if (!req->m_BufferIsArchiveData)
+            {
+                dmBlockAllocator::Free(preloader->m_BlockAllocator, req->m_Buffer, req->m_BufferSize);
+            }
 
-            req->m_Buffer = 0;
+            req->m_Buffer              = 0;
+            req->m_BufferIsArchiveData = false;
         }
         else
         {
@@ -555,13 +744,22 @@ namespace dmResource
             req->m_LoadResult                 = resource_type->m_CreateFunction(params);
         }
 
+        CommitResource(preloader, req, &tmp_resource);
+    }
+
+    // Takes care of a resource that was created, either by CreateResource or on the load thread
+    static void CommitResource(HPreloader preloader, PreloadRequest* req, SResourceDescriptor* created_resource)
+    {
+        SResourceDescriptor& tmp_resource = *created_resource;
+        SResourceType* resource_type      = req->m_PathDescriptor.m_ResourceType;
+
         if (req->m_LoadResult == RESULT_OK)
         {
             if (resource_type->m_PostCreateFunction)
             {
                 if (preloader->m_PostCreateCallbacks.Full())
                 {
-                    preloader->m_PostCreateCallbacks.OffsetCapacity(MAX_PRELOADER_REQUESTS / 8);
+                    preloader->m_PostCreateCallbacks.OffsetCapacity(REQUEST_PAGE_SIZE / 2);
                 }
                 preloader->m_PostCreateCallbacks.SetSize(preloader->m_PostCreateCallbacks.Size() + 1);
                 ResourcePostCreateParamsInternal& ip = preloader->m_PostCreateCallbacks.Back();
@@ -675,7 +873,7 @@ namespace dmResource
         {
             return false;
         }
-        PreloadRequest* parent_req = &preloader->m_Request[parent];
+        PreloadRequest* parent_req = GetRequest(preloader, parent);
         if (parent_req->m_PendingChildCount > 0)
         {
             return false;
@@ -696,6 +894,11 @@ namespace dmResource
         // Pop any hints the load/preload of the item that may have been generated
         PopHints(preloader);
 
+        if (preloader->m_LoadTrace && load_result.m_LoadResult == RESULT_OK)
+        {
+            AddLoadTraceEntry(preloader->m_LoadTrace, req->m_PathDescriptor.m_CanonicalPathHash, req->m_PathDescriptor.m_InternalizedCanonicalPath, buffer_size);
+        }
+
         // Propagate errors
         if (load_result.m_LoadResult != RESULT_OK)
         {
@@ -717,13 +920,29 @@ namespace dmResource
 
         bool created_resource = false;
 
+        if (load_result.m_CreateResult != RESULT_PENDING && req->m_FirstChild != -1)
+        {
+            // Types created on the load thread don't wait for children, so any hints were just a head start
+            RemoveChildren(preloader, req);
+        }
+
         // If no children, do the create step immediately with the buffer in place
         if (req->m_FirstChild == -1)
         {
             if (req->m_LoadResult == RESULT_PENDING)
             {
-                // Create the resource using the loading buffer directly.
-                CreateResource(preloader, req, buffer, buffer_size);
+                if (load_result.m_CreateResult != RESULT_PENDING)
+                {
+                    // Created on the load thread, we only need to insert it
+                    req->m_LoadResult = load_result.m_CreateResult;
+                    CommitResource(preloader, req, &load_result.m_Resource);
+                    DM_PROPERTY_ADD_U32(rmtp_PreloaderThreadCreates, 1);
+                }
+                else
+                {
+                    // Create the resource using the loading buffer directly.
+                    CreateResource(preloader, req, buffer, buffer_size);
+                }
                 created_resource = true;
             }
             UnmarkPathInProgress(preloader, &req->m_PathDescriptor);
@@ -735,8 +954,17 @@ namespace dmResource
         else
         {
             // Keep the loaded bytes until we have loaded all children
-            req->m_Buffer = dmBlockAllocator::Allocate(preloader->m_BlockAllocator, buffer_size);
-            memcpy(req->m_Buffer, buffer, buffer_size);
+            if (load_result.m_ZeroCopy)
+            {
+                // The archive memory stays valid, no need to copy it
+                req->m_Buffer = buffer;
+                req->m_BufferIsArchiveData = true;
+            }
+            else
+            {
+                req->m_Buffer = dmBlockAllocator::Allocate(preloader->m_BlockAllocator, buffer_size);
+                memcpy(req->m_Buffer, buffer, buffer_size);
+            }
             req->m_BufferSize = buffer_size;
             dmLoadQueue::FreeLoad(preloader->m_LoadQueue, req->m_LoadRequest);
             req->m_LoadRequest = 0;
@@ -753,7 +981,7 @@ namespace dmResource
         DM_PROFILE("PreloaderUpdateOneItem");
         while (index >= 0)
         {
-            PreloadRequest* req = &preloader->m_Request[index];
+            PreloadRequest* req = GetRequest(preloader, index);
             switch (req->m_LoadResult)
             {
                 case RESULT_PENDING:
@@ -859,6 +1087,13 @@ namespace dmResource
         info.m_HintInfo.m_Parent    = index;
         info.m_CompleteFunction     = req->m_PathDescriptor.m_ResourceType->m_PreloadFunction;
         info.m_Context              = req->m_PathDescriptor.m_ResourceType->m_Context;
+        info.m_ZeroCopy             = req->m_PathDescriptor.m_ResourceType->m_ZeroCopy;
+        if (req->m_PathDescriptor.m_ResourceType->m_ThreadSafeCreate)
+        {
+            info.m_CreateFunction    = req->m_PathDescriptor.m_ResourceType->m_CreateFunction;
+            info.m_ResourceType      = req->m_PathDescriptor.m_ResourceType;
+            info.m_CanonicalPathHash = req->m_PathDescriptor.m_CanonicalPathHash;
+        }
 
         // If we can't add the request to the load queue it is because the queue is full
         // We will try again once we completed loading of an item via dmLoadQueue::EndLoad
@@ -917,17 +1152,15 @@ namespace dmResource
         return ret;
     }
 
-    Result UpdatePreloader(HPreloader preloader, FPreloaderCompleteCallback complete_callback, PreloaderCompleteCallbackParams* complete_callback_params, uint32_t soft_time_limit)
+    static Result DoUpdatePreloader(HPreloader preloader, FPreloaderCompleteCallback complete_callback, PreloaderCompleteCallbackParams* complete_callback_params, uint32_t soft_time_limit)
     {
-        DM_PROFILE("UpdatePreloader");
-
         uint64_t start           = dmTime::GetTime();
         uint32_t empty_runs      = 0;
         bool close_to_time_limit = soft_time_limit < 1000;
 
         do
         {
-            Result root_result        = preloader->m_Request[0].m_LoadResult;
+            Result root_result        = GetRequest(preloader, 0)->m_LoadResult;
             Result post_create_result = RESULT_OK;
             if (preloader->m_PostCreateCallbackIndex < preloader->m_PostCreateCallbacks.Size())
             {
@@ -940,7 +1173,7 @@ namespace dmResource
                         // Just waiting for the post-create functions to complete
                         // If main result is RESULT_OK pick up any errors from
                         // post create function
-                        preloader->m_Request[0].m_LoadResult = post_create_result;
+                        GetRequest(preloader, 0)->m_LoadResult = post_create_result;
                     }
                     continue;
                 }
@@ -966,7 +1199,7 @@ namespace dmResource
                     {
                         if (!complete_callback(complete_callback_params))
                         {
-                            preloader->m_Request[0].m_LoadResult = RESULT_NOT_LOADED;
+                            GetRequest(preloader, 0)->m_LoadResult = RESULT_NOT_LOADED;
                         }
                         empty_runs = 0;
                         // We need to continue to do all post create functions
@@ -1015,6 +1248,28 @@ namespace dmResource
         return RESULT_PENDING;
     }
 
+    Result UpdatePreloader(HPreloader preloader, FPreloaderCompleteCallback complete_callback, PreloaderCompleteCallbackParams* complete_callback_params, uint32_t soft_time_limit)
+    {
+        DM_PROFILE("UpdatePreloader");
+
+        uint64_t start = dmTime::GetTime();
+        Result result  = DoUpdatePreloader(preloader, complete_callback, complete_callback_params, soft_time_limit);
+        DM_PROPERTY_ADD_U32(rmtp_PreloaderTime, (uint32_t)(dmTime::GetTime() - start));
+        DM_PROPERTY_ADD_U32(rmtp_PreloaderPeakRequests, preloader->m_PeakRequestCount);
+        DM_PROPERTY_SET_U32(rmtp_PreloaderTreeDepth, preloader->m_MaxDepth);
+        return result;
+    }
+
+    void GetPreloaderStats(HPreloader preloader, PreloaderStats* stats)
+    {
+        stats->m_RequestCount     = GetRequestCapacity(preloader) - preloader->m_Freelist.Size();
+        stats->m_PeakRequestCount = preloader->m_PeakRequestCount;
+        stats->m_MaxDepth         = preloader->m_MaxDepth;
+        stats->m_PrefetchHitCount = preloader->m_Prefetcher ? GetPrefetchHitCount(preloader->m_Prefetcher) : 0;
+        DM_SPINLOCK_SCOPED_LOCK(preloader->m_SyncedDataSpinlock)
+        stats->m_ArenaSize        = preloader->m_SyncedData.m_Arena.m_Size;
+    }
+
     void DeletePreloader(HPreloader preloader)
     {
         // Since Preload calls need their Create calls done and PostCreate calls must always follow Create calls.
@@ -1029,8 +1284,25 @@ namespace dmResource
             dmLogWarning("Waiting for preloader to complete.");
         }
 
+        if (preloader->m_Prefetcher)
+        {
+            StopPrefetch(preloader->m_Factory, preloader->m_Prefetcher);
+        }
+
+        if (preloader->m_LoadTrace)
+        {
+            if (GetRequest(preloader, 0)->m_LoadResult == RESULT_OK)
+            {
+                AddLoadTrace(preloader->m_Factory, GetRequest(preloader, 0)->m_PathDescriptor.m_CanonicalPathHash, preloader->m_LoadTrace);
+            }
+            else
+            {
+                delete preloader->m_LoadTrace;
+            }
+        }
+
         // Release root and persisted resources
-        preloader->m_PersistedResources.Push(preloader->m_Request[0].m_Resource);
+        preloader->m_PersistedResources.Push(GetRequest(preloader, 0)->m_Resource);
         for (uint32_t i = 0; i < preloader->m_PersistedResources.Size(); ++i)
         {
             void* resource = preloader->m_PersistedResources[i];
@@ -1039,11 +1311,12 @@ namespace dmResource
             Release(preloader->m_Factory, resource);
         }
 
-        assert(preloader->m_FreelistSize == (MAX_PRELOADER_REQUESTS - 1));
+        assert(preloader->m_Freelist.Size() == (GetRequestCapacity(preloader) - 1));
         dmLoadQueue::DeleteQueue(preloader->m_LoadQueue);
 
         dmBlockAllocator::DeleteContext(preloader->m_BlockAllocator);
 
+        ArenaReset(&preloader->m_SyncedData.m_Arena);
         dmSpinlock::Destroy(&preloader->m_SyncedDataSpinlock);
         delete preloader;
     }
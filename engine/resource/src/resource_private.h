@@ -33,6 +33,16 @@
     #define DM_RESOURCE_DBG_LOG(__LEVEL__, ...)
 #endif
 
+namespace dmLoadQueue
+{
+    struct QueueParams;
+}
+
+namespace dmResource
+{
+    struct LoadTrace;
+    typedef struct Prefetcher* HPrefetcher;
+}
 
 namespace dmResource
 {
@@ -52,6 +62,8 @@ namespace dmResource
         FResourcePostCreate m_PostCreateFunction;
         FResourceDestroy    m_DestroyFunction;
         FResourceRecreate   m_RecreateFunction;
+        bool                m_ZeroCopy; // The buffer may point directly into (read only) archive memory
+        bool                m_ThreadSafeCreate; // The create function may run on a load thread
     };
 
     struct SResourceDescriptor;
@@ -65,6 +77,14 @@ namespace dmResource
     uint32_t GetCanonicalPathFromBase(const char* base_dir, const char* relative_dir, char* buf);
 
     SResourceType* FindResourceType(SResourceFactory* factory, const char* extension);
+    const dmLoadQueue::QueueParams* GetLoadQueueParams(HFactory factory);
+
+    bool IsRecordingLoadTraces(HFactory factory);
+    // Takes ownership of the trace
+    void AddLoadTrace(HFactory factory, dmhash_t root_path_hash, LoadTrace* trace);
+    // Starts prefetching the trace of the root resource, if there is one
+    HPrefetcher StartPrefetch(HFactory factory, dmhash_t root_path_hash);
+    void StopPrefetch(HFactory factory, HPrefetcher prefetcher);
     uint32_t GetRefCount(HFactory factory, void* resource);
     uint32_t GetRefCount(HFactory factory, dmhash_t identifier);
 
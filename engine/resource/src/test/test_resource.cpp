@@ -14,10 +14,12 @@
 
 #include <dlib/log.h>
 
+#include <dlib/array.h>
 #include <dlib/atomic.h>
 #include <dlib/dstrings.h>
 #include <dlib/hash.h>
 #include <dlib/log.h>
+#include <dlib/math.h>
 #include <dlib/message.h>
 #include <dlib/socket.h>
 #include <dlib/sys.h>
@@ -227,6 +229,12 @@ protected:
         m_FooResourcePostCreateCallCount = 0;
         m_FooResourceDestroyCallCount = 0;
 
+        NewTestFactory(&m_Factory);
+        m_ResourceName = "/test.cont";
+    }
+
+    void NewTestFactory(dmResource::HFactory* factory)
+    {
         dmResource::NewFactoryParams params;
         params.m_MaxResources = 16;
 
@@ -240,16 +248,15 @@ protected:
         }
 #endif
 
-        m_Factory = dmResource::NewFactory(&params, original_mount_path);
+        *factory = dmResource::NewFactory(&params, original_mount_path);
 
-        ASSERT_NE((void*) 0, m_Factory);
-        m_ResourceName = "/test.cont";
+        ASSERT_NE((void*) 0, *factory);
 
         dmResource::Result e;
-        e = dmResource::RegisterType(m_Factory, "cont", this, &ResourceContainerPreload, &ResourceContainerCreate, 0, &ResourceContainerDestroy, 0);
+        e = dmResource::RegisterType(*factory, "cont", this, &ResourceContainerPreload, &ResourceContainerCreate, 0, &ResourceContainerDestroy, 0);
         ASSERT_EQ(dmResource::RESULT_OK, e);
 
-        e = dmResource::RegisterType(m_Factory, "foo", this, 0, &FooResourceCreate, &FooResourcePostCreate, &FooResourceDestroy, 0);
+        e = dmResource::RegisterType(*factory, "foo", this, 0, &FooResourceCreate, &FooResourcePostCreate, &FooResourceDestroy, 0);
         ASSERT_EQ(dmResource::RESULT_OK, e);
     }
 
@@ -844,7 +851,7 @@ TEST_P(GetResourceTest, PreloadGetParallell)
 
 TEST_P(GetResourceTest, PreloadGetManyRefs)
 {
-    // this has more references than the preloader can fit into its tree
+    // this has a lot of references, and some of them are missing
     dmResource::HPreloader pr = dmResource::NewPreloader(m_Factory, "/many_refs.cont");
 
     uint32_t timeout = 100*1000;
@@ -863,6 +870,85 @@ TEST_P(GetResourceTest, PreloadGetManyRefs)
 }
 
 
+TEST_P(GetResourceTest, LoadTracePrefetch)
+{
+    // Record the load order of the test collection
+    dmResource::SetRecordLoadTraces(m_Factory, true);
+    void* resource = 0;
+    ASSERT_EQ(dmResource::RESULT_OK, PreloaderGet(m_Factory, m_ResourceName, &resource));
+    dmResource::Release(m_Factory, resource);
+
+    dmArray<uint8_t> traces;
+    dmResource::GetLoadTraces(m_Factory, &traces);
+    ASSERT_LT(0u, traces.Size());
+
+    // Replay the load on new factories, without and with prefetching
+    for (uint32_t prefetch = 0; prefetch < 2; ++prefetch)
+    {
+        dmResource::HFactory factory = 0;
+        NewTestFactory(&factory);
+        ASSERT_NE((void*)0, factory);
+        if (prefetch)
+        {
+            ASSERT_EQ(dmResource::RESULT_OK, dmResource::SetLoadTraces(factory, traces.Begin(), traces.Size()));
+
+            dmArray<uint8_t> read_traces;
+            dmResource::GetLoadTraces(factory, &read_traces);
+            ASSERT_EQ(traces.Size(), read_traces.Size());
+            ASSERT_EQ(0, memcmp(traces.Begin(), read_traces.Begin(), traces.Size()));
+        }
+
+        uint64_t start = dmTime::GetTime();
+        dmResource::HPreloader pr = dmResource::NewPreloader(factory, m_ResourceName);
+        if (prefetch)
+        {
+            // Give the prefetcher a head start, or the preloader may ask for the few small files before they are read
+            dmTime::Sleep(100000);
+        }
+        dmResource::Result r;
+        do
+        {
+            r = dmResource::UpdatePreloader(pr, 0, 0, 1000);
+        } while (r == dmResource::RESULT_PENDING);
+        uint64_t end = dmTime::GetTime();
+        ASSERT_EQ(dmResource::RESULT_OK, r);
+
+        dmResource::PreloaderStats stats;
+        dmResource::GetPreloaderStats(pr, &stats);
+        // Memory mapped archives are used in place, and aren't prefetched
+        const void* mapped_data;
+        uint32_t mapped_size;
+        bool mapped = dmResource::GetResourceData(factory, m_ResourceName, &mapped_data, &mapped_size) == dmResource::RESULT_OK;
+        if (!prefetch || mapped)
+        {
+            ASSERT_EQ(0u, stats.m_PrefetchHitCount);
+        }
+        else
+        {
+            ASSERT_LT(0u, stats.m_PrefetchHitCount);
+        }
+        printf("Preload %s %s prefetch: %.3f ms (%u prefetched)\n", m_ResourceName, prefetch ? "with" : "without", (end - start) / 1000.0f, stats.m_PrefetchHitCount);
+
+        dmResource::DeletePreloader(pr);
+        dmResource::DeleteFactory(factory);
+    }
+}
+
+TEST_P(GetResourceTest, LoadTraceInvalid)
+{
+    const char garbage[] = "not a load trace";
+    ASSERT_EQ(dmResource::RESULT_INVALID_DATA, dmResource::SetLoadTraces(m_Factory, garbage, sizeof(garbage)));
+
+    dmResource::SetRecordLoadTraces(m_Factory, true);
+    void* resource = 0;
+    ASSERT_EQ(dmResource::RESULT_OK, PreloaderGet(m_Factory, m_ResourceName, &resource));
+    dmResource::Release(m_Factory, resource);
+
+    dmArray<uint8_t> traces;
+    dmResource::GetLoadTraces(m_Factory, &traces);
+    ASSERT_EQ(dmResource::RESULT_INVALID_DATA, dmResource::SetLoadTraces(m_Factory, traces.Begin(), traces.Size() - 1));
+}
+
 TEST_P(GetResourceTest, PreloadGetAbort)
 {
     // Must not leak or crash
@@ -1531,6 +1617,274 @@ TEST_F(ResourceTest, ManifestBundledResourcesVerificationFail)
     dmResource::DeleteManifest(manifest);
 }
 
+// Generated files for the load queue tests. The list file hints all the other files.
+struct LoadQueueBenchContext
+{
+    int32_t m_PreloadCount;
+    int32_t m_CreateCount;
+};
+
+static dmResource::Result BenchListPreload(const dmResource::ResourcePreloadParams& params)
+{
+    const char* text = (const char*)params.m_Buffer;
+    const char* end = text + params.m_BufferSize;
+    while (text < end)
+    {
+        const char* line_end = (const char*)memchr(text, '\n', end - text);
+        if (!line_end)
+            line_end = end;
+        char name[64];
+        dmStrlCpy(name, text, dmMath::Min((uint32_t)sizeof(name), (uint32_t)(line_end - text) + 1));
+        dmResource::PreloadHint(params.m_HintInfo, name);
+        text = line_end + 1;
+    }
+    return dmResource::RESULT_OK;
+}
+
+static dmResource::Result BenchItemPreload(const dmResource::ResourcePreloadParams& params)
+{
+    // Stand in for the decoding work done by the real resource types
+    dmhash_t hash = 0;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        hash ^= dmHashBuffer64(params.m_Buffer, params.m_BufferSize);
+    }
+    *params.m_PreloadData = (void*)(uintptr_t)hash;
+
+    LoadQueueBenchContext* ctx = (LoadQueueBenchContext*)params.m_Context;
+    dmAtomicIncrement32(&ctx->m_PreloadCount);
+    return dmResource::RESULT_OK;
+}
+
+static dmResource::Result BenchCreate(const dmResource::ResourceCreateParams& params)
+{
+    // May be called from the load threads (see SetTypeThreadSafeCreate)
+    LoadQueueBenchContext* ctx = (LoadQueueBenchContext*)params.m_Context;
+    params.m_Resource->m_Resource = (void*)(uintptr_t)(dmAtomicIncrement32(&ctx->m_CreateCount) + 1);
+    return dmResource::RESULT_OK;
+}
+
+static dmResource::Result BenchDestroy(const dmResource::ResourceDestroyParams& params)
+{
+    return dmResource::RESULT_OK;
+}
+
+class LoadQueueTest : public jc_test_base_class
+{
+protected:
+    // More requests than the preloader starts out with
+    static const uint32_t FILE_COUNT = 4000;
+    static const uint32_t FILE_SIZE = 4 * 1024;
+
+    virtual void SetUp()
+    {
+        m_FileData.SetCapacity(FILE_COUNT * FILE_SIZE);
+        m_FileData.SetSize(FILE_COUNT * FILE_SIZE);
+        uint32_t seed = 17;
+        for (uint32_t i = 0; i < m_FileData.Size(); ++i)
+        {
+            seed = seed * 1664525 + 1013904223;
+            m_FileData[i] = (uint8_t)(seed >> 24);
+        }
+
+        m_List.SetCapacity(FILE_COUNT * 24);
+        for (uint32_t i = 0; i < FILE_COUNT; ++i)
+        {
+            char name[32];
+            uint32_t len = dmSnPrintf(name, sizeof(name), "/bench/%u.benchitem\n", i);
+            m_List.PushArray(name, len);
+        }
+        m_BenchFilesWritten = false;
+    }
+
+    virtual void TearDown()
+    {
+        if (m_BenchFilesWritten)
+        {
+            RemoveBenchFiles();
+        }
+    }
+
+    // Writes the files to disk, for the loads to go through the file system instead of memory
+    bool WriteBenchFiles()
+    {
+        m_BenchFilesWritten = true;
+        char path[512];
+        dmTestUtil::MakeHostPathf(path, sizeof(path), "%s/bench", TMP_DIR);
+        dmSys::Mkdir(path, 0755);
+        for (uint32_t i = 0; i <= FILE_COUNT; ++i)
+        {
+            GetBenchFilePath(i, path, sizeof(path));
+            FILE* f = fopen(path, "wb");
+            if (!f)
+                return false;
+            const void* data = i < FILE_COUNT ? (const void*)&m_FileData[i * FILE_SIZE] : (const void*)m_List.Begin();
+            uint32_t size = i < FILE_COUNT ? FILE_SIZE : m_List.Size();
+            bool ok = fwrite(data, 1, size, f) == size;
+            fclose(f);
+            if (!ok)
+                return false;
+        }
+        return true;
+    }
+
+    void RemoveBenchFiles()
+    {
+        char path[512];
+        for (uint32_t i = 0; i <= FILE_COUNT; ++i)
+        {
+            GetBenchFilePath(i, path, sizeof(path));
+            dmSys::Unlink(path);
+        }
+        dmTestUtil::MakeHostPathf(path, sizeof(path), "%s/bench", TMP_DIR);
+        dmSys::Rmdir(path);
+    }
+
+    // The item files, followed by the list file
+    static void GetBenchFilePath(uint32_t i, char* path, uint32_t path_size)
+    {
+        if (i < FILE_COUNT)
+            dmTestUtil::MakeHostPathf(path, path_size, "%s/bench/%u.benchitem", TMP_DIR, i);
+        else
+            dmTestUtil::MakeHostPathf(path, path_size, "%s/bench/root.benchlist", TMP_DIR);
+    }
+
+    dmResource::HFactory NewBenchFactory(uint32_t worker_count, uint32_t slots, uint32_t max_pending_data, bool file_backed = false)
+    {
+        dmResource::NewFactoryParams params;
+        params.m_MaxResources = FILE_COUNT + 16;
+        params.m_LoadQueueWorkerCount = worker_count;
+        params.m_LoadQueueSlots = slots;
+        params.m_LoadQueueMaxPendingData = max_pending_data;
+        dmResource::HFactory factory = dmResource::NewFactory(&params, MOUNT_DIR);
+        if (!factory)
+            return 0;
+
+        memset(&m_Context, 0, sizeof(m_Context));
+        dmResource::RegisterType(factory, "benchlist", &m_Context, BenchListPreload, BenchCreate, 0, BenchDestroy, 0);
+        dmResource::RegisterType(factory, "benchitem", &m_Context, BenchItemPreload, BenchCreate, 0, BenchDestroy, 0);
+
+        if (file_backed)
+            return factory;
+
+        dmResource::AddFile(factory, "/bench/root.benchlist", m_List.Size(), m_List.Begin());
+        for (uint32_t i = 0; i < FILE_COUNT; ++i)
+        {
+            char name[32];
+            dmSnPrintf(name, sizeof(name), "/bench/%u.benchitem", i);
+            dmResource::AddFile(factory, name, FILE_SIZE, &m_FileData[i * FILE_SIZE]);
+        }
+        return factory;
+    }
+
+    dmResource::Result Preload(dmResource::HFactory factory)
+    {
+        dmResource::HPreloader pr = dmResource::NewPreloader(factory, "/bench/root.benchlist");
+        dmResource::Result r;
+        do
+        {
+            r = dmResource::UpdatePreloader(pr, 0, 0, 1000);
+        } while (r == dmResource::RESULT_PENDING);
+        dmResource::DeletePreloader(pr);
+        return r;
+    }
+
+    dmArray<uint8_t>        m_FileData;
+    dmArray<char>           m_List;
+    LoadQueueBenchContext   m_Context;
+    bool                    m_BenchFilesWritten;
+};
+
+TEST_F(LoadQueueTest, ManyWorkers)
+{
+    // Few slots and a small budget, to make the workers wait for each other
+    dmResource::HFactory factory = NewBenchFactory(4, 3, FILE_SIZE * 2);
+    ASSERT_NE((void*)0, factory);
+
+    ASSERT_EQ(dmResource::RESULT_OK, Preload(factory));
+    ASSERT_EQ((int32_t)FILE_COUNT, dmAtomicGet32(&m_Context.m_PreloadCount));
+    ASSERT_EQ((int32_t)FILE_COUNT + 1, dmAtomicGet32(&m_Context.m_CreateCount));
+
+    dmResource::DeleteFactory(factory);
+}
+
+TEST_F(LoadQueueTest, PreloaderStats)
+{
+    dmResource::HFactory factory = NewBenchFactory(2, 16, 4 * 1024 * 1024);
+    ASSERT_NE((void*)0, factory);
+
+    dmResource::HPreloader pr = dmResource::NewPreloader(factory, "/bench/root.benchlist");
+    dmResource::Result r;
+    do
+    {
+        r = dmResource::UpdatePreloader(pr, 0, 0, 1000);
+    } while (r == dmResource::RESULT_PENDING);
+    ASSERT_EQ(dmResource::RESULT_OK, r);
+
+    // All the items are hinted at once, so the tree must have grown to hold them
+    dmResource::PreloaderStats stats;
+    dmResource::GetPreloaderStats(pr, &stats);
+    ASSERT_EQ(1u, stats.m_RequestCount);
+    ASSERT_EQ(FILE_COUNT + 1, stats.m_PeakRequestCount);
+    ASSERT_EQ(1u, stats.m_MaxDepth);
+    ASSERT_LT(0u, stats.m_ArenaSize);
+
+    dmResource::DeletePreloader(pr);
+
+    ASSERT_EQ((int32_t)FILE_COUNT, dmAtomicGet32(&m_Context.m_PreloadCount));
+    ASSERT_EQ((int32_t)FILE_COUNT + 1, dmAtomicGet32(&m_Context.m_CreateCount));
+
+    dmResource::DeleteFactory(factory);
+}
+
+TEST_F(LoadQueueTest, Benchmark)
+{
+    ASSERT_TRUE(WriteBenchFiles());
+
+    const uint32_t worker_counts[] = {1, 2, 4, 8};
+    uint64_t single_worker_time = 0;
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(worker_counts); ++i)
+    {
+        dmResource::HFactory factory = NewBenchFactory(worker_counts[i], 32, 4 * 1024 * 1024, true);
+        ASSERT_NE((void*)0, factory);
+
+        uint64_t start = dmTime::GetTime();
+        dmResource::Result r = Preload(factory);
+        uint64_t time = dmTime::GetTime() - start;
+
+        ASSERT_EQ(dmResource::RESULT_OK, r);
+        ASSERT_EQ((int32_t)FILE_COUNT, dmAtomicGet32(&m_Context.m_PreloadCount));
+        ASSERT_EQ((int32_t)FILE_COUNT + 1, dmAtomicGet32(&m_Context.m_CreateCount));
+        dmResource::DeleteFactory(factory);
+
+        if (i == 0)
+            single_worker_time = time;
+        printf("Load %u files with %u workers: %.2f ms, %.2fx the speed of 1 worker\n", FILE_COUNT, worker_counts[i],
+                time / 1000.0f, single_worker_time / (float)dmMath::Max((uint64_t)1, time));
+    }
+}
+
+TEST_F(LoadQueueTest, ThreadSafeCreate)
+{
+    for (uint32_t thread_safe = 0; thread_safe < 2; ++thread_safe)
+    {
+        dmResource::HFactory factory = NewBenchFactory(4, 32, 4 * 1024 * 1024);
+        ASSERT_NE((void*)0, factory);
+        ASSERT_EQ(dmResource::RESULT_OK, dmResource::SetTypeThreadSafeCreate(factory, "benchitem", thread_safe != 0));
+
+        uint64_t start = dmTime::GetTime();
+        ASSERT_EQ(dmResource::RESULT_OK, Preload(factory));
+        uint64_t end = dmTime::GetTime();
+
+        ASSERT_EQ((int32_t)FILE_COUNT, dmAtomicGet32(&m_Context.m_PreloadCount));
+        ASSERT_EQ((int32_t)FILE_COUNT + 1, dmAtomicGet32(&m_Context.m_CreateCount));
+
+        printf("Load %u resources, thread safe create %s: %.2f ms\n", FILE_COUNT, thread_safe ? "on" : "off", (end - start) / 1000.0f);
+
+        dmResource::DeleteFactory(factory);
+    }
+}
+
 TEST(ResourceUtil, HexDigestLength)
 {
     uint32_t actual = 0;
@@ -678,6 +678,98 @@ TEST(dmResourceArchive, Wrap_Compressed)
     dmResourceArchive::Delete(archive);
 }
 
+// Counts the resource bytes that are handed out as views into the archive, and the ones that need a buffer.
+// The bytes needing a buffer are the extra memory a load costs, which we can check on every platform,
+// unlike the peak resident set size of the process.
+static void TestEntryDataView(dmResourceArchive::HArchiveIndexContainer archive, const uint8_t* arcd, uint32_t arcd_size, const uint8_t (*hashes)[20], bool mem_mapped, uint32_t* bytes_viewed, uint32_t* bytes_copied)
+{
+    *bytes_viewed = 0;
+    *bytes_copied = 0;
+    for (uint32_t i = 0; i < (sizeof(path_hash) / sizeof(path_hash[0])); ++i)
+    {
+        if (IsLiveUpdateResource(path_hash[i])) continue;
+
+        dmResourceArchive::EntryData* entry;
+        dmResourceArchive::Result result = dmResourceArchive::FindEntry(archive, hashes[i], 20, &entry);
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+
+        uint32_t flags = dmEndian::ToNetwork(entry->m_Flags);
+        bool needs_copy = !mem_mapped || (flags & (dmResourceArchive::ENTRY_FLAG_ENCRYPTED | dmResourceArchive::ENTRY_FLAG_COMPRESSED));
+
+        const void* data = 0;
+        uint32_t size = 0;
+        result = dmResourceArchive::GetEntryDataView(archive, entry, &data, &size);
+        if (needs_copy)
+        {
+            ASSERT_EQ(dmResourceArchive::RESULT_NOT_SUPPORTED, result);
+            *bytes_copied += dmEndian::ToNetwork(entry->m_ResourceSize);
+            continue;
+        }
+
+        ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+        // The view must point into the archive data, not into a copy
+        ASSERT_GE((uintptr_t)data, (uintptr_t)arcd);
+        ASSERT_LE((uintptr_t)data + size, (uintptr_t)arcd + arcd_size);
+        ASSERT_EQ(strlen(content[i]), size);
+        ASSERT_EQ(0, memcmp(content[i], data, size));
+        *bytes_viewed += size;
+    }
+}
+
+// The size of the resources in the archive, not counting the liveupdate ones
+static uint32_t GetArchiveContentSize()
+{
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < (sizeof(path_hash) / sizeof(path_hash[0])); ++i)
+    {
+        if (!IsLiveUpdateResource(path_hash[i]))
+            size += strlen(content[i]);
+    }
+    return size;
+}
+
+TEST(dmResourceArchive, GetEntryDataView)
+{
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    dmResourceArchive::Result result = dmResourceArchive::WrapArchiveBuffer((void*) RESOURCES_ARCI, RESOURCES_ARCI_SIZE, true, RESOURCES_ARCD, RESOURCES_ARCD_SIZE, true, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+    uint32_t bytes_viewed, bytes_copied;
+    TestEntryDataView(archive, RESOURCES_ARCD, RESOURCES_ARCD_SIZE, content_hash, true, &bytes_viewed, &bytes_copied);
+    ASSERT_GT(bytes_viewed, 0U);
+    ASSERT_EQ(GetArchiveContentSize(), bytes_viewed + bytes_copied);
+    dmResourceArchive::Delete(archive);
+}
+
+TEST(dmResourceArchive, GetEntryDataView_Compressed)
+{
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    dmResourceArchive::Result result = dmResourceArchive::WrapArchiveBuffer((void*) RESOURCES_COMPRESSED_ARCI, RESOURCES_COMPRESSED_ARCI_SIZE, true, (void*) RESOURCES_COMPRESSED_ARCD, RESOURCES_COMPRESSED_ARCD_SIZE, true, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+    uint32_t bytes_viewed, bytes_copied;
+    TestEntryDataView(archive, RESOURCES_COMPRESSED_ARCD, RESOURCES_COMPRESSED_ARCD_SIZE, compressed_content_hash, true, &bytes_viewed, &bytes_copied);
+    ASSERT_GT(bytes_copied, 0U);
+    ASSERT_EQ(GetArchiveContentSize(), bytes_viewed + bytes_copied);
+    dmResourceArchive::Delete(archive);
+}
+
+TEST(dmResourceArchive, GetEntryDataView_FromDisk)
+{
+    dmResourceArchive::HArchiveIndexContainer archive = 0;
+    char archive_path[512];
+    char resource_path[512];
+    dmTestUtil::MakeHostPath(archive_path, sizeof(archive_path), "build/src/test/resources.arci");
+    dmTestUtil::MakeHostPath(resource_path, sizeof(resource_path), "build/src/test/resources.arcd");
+
+    dmResourceArchive::Result result = dmResourceArchive::LoadArchiveFromFile(archive_path, resource_path, &archive);
+    ASSERT_EQ(dmResourceArchive::RESULT_OK, result);
+    // Files read with fopen/fread always need a buffer
+    uint32_t bytes_viewed, bytes_copied;
+    TestEntryDataView(archive, 0, 0, content_hash, false, &bytes_viewed, &bytes_copied);
+    ASSERT_EQ(0U, bytes_viewed);
+    ASSERT_EQ(GetArchiveContentSize(), bytes_copied);
+    dmResourceArchive::Delete(archive);
+}
+
 TEST(dmResourceArchive, LoadFromDisk)
 {
     dmResourceArchive::HArchiveIndexContainer archive = 0;
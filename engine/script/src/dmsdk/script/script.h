@@ -278,6 +278,19 @@ namespace dmScript
      */
     void PushVector3(lua_State* L, const dmVMath::Vector3& v);
 
+    /*# push a dmVMath::Vector3 onto the Lua stack, reusing an existing value
+     * If the value at index is a vector3, the value is written into it and it is pushed onto the stack again.
+     * If the value at index is nil or none, a new vector3 is pushed like dmScript::PushVector3.
+     * Lets script functions write their results into values supplied by the caller, without creating garbage.
+     * Will increase the stack by 1.
+     * @note throws a luaL_error if the value at index is of another type
+     * @name dmScript::PushVector3Into
+     * @param L [type:lua_State*] Lua state
+     * @param index [type:int] Index of the value to write into
+     * @param v [type:dmVMath::Vector3] dmVMath::Vector3 value to push
+     */
+    void PushVector3Into(lua_State* L, int index, const dmVMath::Vector3& v);
+
     /*# check if the value is a dmVMath::Vector3
      *
      * Check if the value in the supplied index on the lua stack is a dmVMath::Vector3.
@@ -315,6 +328,19 @@ namespace dmScript
      */
     void PushVector4(lua_State* L, const dmVMath::Vector4& v);
 
+    /*# push a dmVMath::Vector4 onto the Lua stack, reusing an existing value
+     * If the value at index is a vector4, the value is written into it and it is pushed onto the stack again.
+     * If the value at index is nil or none, a new vector4 is pushed like dmScript::PushVector4.
+     * Lets script functions write their results into values supplied by the caller, without creating garbage.
+     * Will increase the stack by 1.
+     * @note throws a luaL_error if the value at index is of another type
+     * @name dmScript::PushVector4Into
+     * @param L [type:lua_State*] Lua state
+     * @param index [type:int] Index of the value to write into
+     * @param v [type:dmVMath::Vector4] dmVMath::Vector4 value to push
+     */
+    void PushVector4Into(lua_State* L, int index, const dmVMath::Vector4& v);
+
     /*# check if the value is a dmVMath::Vector3
      *
      * Check if the value in the supplied index on the lua stack is a dmVMath::Vector3.
@@ -352,6 +378,19 @@ namespace dmScript
      */
     void PushQuat(lua_State* L, const dmVMath::Quat& q);
 
+    /*# push a dmVMath::Quat onto the Lua stack, reusing an existing value
+     * If the value at index is a quat, the value is written into it and it is pushed onto the stack again.
+     * If the value at index is nil or none, a new quat is pushed like dmScript::PushQuat.
+     * Lets script functions write their results into values supplied by the caller, without creating garbage.
+     * Will increase the stack by 1.
+     * @note throws a luaL_error if the value at index is of another type
+     * @name dmScript::PushQuatInto
+     * @param L [type:lua_State*] Lua state
+     * @param index [type:int] Index of the value to write into
+     * @param quat [type:dmVMath::Quat] dmVMath::Quat value to push
+     */
+    void PushQuatInto(lua_State* L, int index, const dmVMath::Quat& q);
+
     /*# check if the value is a dmVMath::Vector3
      *
      * Check if the value in the supplied index on the lua stack is a dmVMath::Quat.
@@ -389,6 +428,19 @@ namespace dmScript
      */
     void PushMatrix4(lua_State* L, const dmVMath::Matrix4& m);
 
+    /*# push a dmVMath::Matrix4 onto the Lua stack, reusing an existing value
+     * If the value at index is a matrix4, the value is written into it and it is pushed onto the stack again.
+     * If the value at index is nil or none, a new matrix4 is pushed like dmScript::PushMatrix4.
+     * Lets script functions write their results into values supplied by the caller, without creating garbage.
+     * Will increase the stack by 1.
+     * @note throws a luaL_error if the value at index is of another type
+     * @name dmScript::PushMatrix4Into
+     * @param L [type:lua_State*] Lua state
+     * @param index [type:int] Index of the value to write into
+     * @param matrix [type:dmVMath::Matrix4] dmVMath::Matrix4 value to push
+     */
+    void PushMatrix4Into(lua_State* L, int index, const dmVMath::Matrix4& m);
+
     /*# check if the value is a dmVMath::Matrix4
      *
      * Check if the value in the supplied index on the lua stack is a dmVMath::Matrix4.
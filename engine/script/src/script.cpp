@@ -19,6 +19,7 @@
 #include <dlib/math.h>
 #include <dlib/pprint.h>
 #include <dlib/profile.h>
+#include <dlib/time.h>
 
 #include "script_private.h"
 #include "script_hash.h"
@@ -41,6 +42,9 @@ extern "C"
 }
 
 DM_PROPERTY_GROUP(rmtp_Script, "");
+DM_PROPERTY_U32(rmtp_ScriptGCAllocated, 0, FrameReset, "# bytes allocated by lua this frame", &rmtp_Script);
+DM_PROPERTY_U32(rmtp_ScriptGCTime, 0, FrameReset, "time (us) spent in the incremental gc this frame", &rmtp_Script);
+DM_PROPERTY_U32(rmtp_ScriptGCSteps, 0, FrameReset, "# incremental gc steps this frame", &rmtp_Script);
 
 namespace dmScript
 {
@@ -69,6 +73,11 @@ namespace dmScript
     const char SCRIPT_METATABLE_TYPE_HASH_KEY_NAME[] = "__dmengine_type";
     static const uint32_t SCRIPT_METATABLE_TYPE_HASH_KEY = dmHashBufferNoReverse32(SCRIPT_METATABLE_TYPE_HASH_KEY_NAME, sizeof(SCRIPT_METATABLE_TYPE_HASH_KEY_NAME) - 1);
 
+    const char* SCRIPT_GC_BUDGET_KEY = "script.gc_budget";
+    const char* SCRIPT_GC_STEP_SIZE_KEY = "script.gc_step_size";
+
+    static const uint32_t DEFAULT_GC_STEP_SIZE = 16;
+
     // A debug value for profiling lua references
     int g_LuaReferenceCount = 0;
 
@@ -83,7 +92,18 @@ namespace dmScript
         context->m_ResourceFactory = factory;
         context->m_LuaState = lua_open();
         context->m_ContextTableRef = LUA_NOREF;
+        context->m_GCBudget = 0;
+        context->m_GCStepSize = DEFAULT_GC_STEP_SIZE;
+        context->m_GCWorkTime = 0;
+        context->m_GCFrameTime = 0;
+        context->m_GCLastCount = 0;
+        memset(&context->m_GCStats, 0, sizeof(context->m_GCStats));
         context->m_EnableExtensions = enable_extensions;
+        if (config_file)
+        {
+            context->m_GCBudget = (uint32_t)dmMath::Max(0, dmConfigFile::GetInt(config_file, SCRIPT_GC_BUDGET_KEY, 0));
+            context->m_GCStepSize = (uint32_t)dmMath::Max(1, dmConfigFile::GetInt(config_file, SCRIPT_GC_STEP_SIZE_KEY, DEFAULT_GC_STEP_SIZE));
+        }
         return context;
     }
 
@@ -230,6 +250,62 @@ namespace dmScript
         context->m_ScriptExtensions.Push(script_extension);
     }
 
+    static uint32_t GetLuaGCCountBytes(lua_State* L)
+    {
+        return (uint32_t)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + (uint32_t)lua_gc(L, LUA_GCCOUNTB, 0);
+    }
+
+    // The collector may use half of the time the previous frame waited for vsync,
+    // but never less than a quarter or more than four times the configured budget.
+    static uint32_t GetGCFrameBudget(HContext context)
+    {
+        uint32_t budget = context->m_GCBudget;
+        if (context->m_GCFrameTime == 0)
+            return budget;
+
+        uint32_t slack = 0;
+        if (context->m_GCWorkTime < context->m_GCFrameTime)
+            slack = context->m_GCFrameTime - context->m_GCWorkTime;
+
+        return dmMath::Clamp(slack / 2, budget / 4, budget * 4);
+    }
+
+    static void UpdateGC(HContext context)
+    {
+        DM_PROFILE("GC");
+        lua_State* L = context->m_LuaState;
+
+        uint32_t count = GetLuaGCCountBytes(L);
+        GCStats& stats = context->m_GCStats;
+        stats.m_AllocatedBytes = count > context->m_GCLastCount ? count - context->m_GCLastCount : 0;
+        stats.m_Time = 0;
+        stats.m_Steps = 0;
+
+        if (context->m_GCBudget != 0)
+        {
+            uint64_t start = dmTime::GetTime();
+            uint64_t end = start + GetGCFrameBudget(context);
+            uint64_t now = start;
+            do
+            {
+                ++stats.m_Steps;
+                // Stop when a cycle finishes, there is nothing more to gain this frame
+                bool cycle_done = lua_gc(L, LUA_GCSTEP, context->m_GCStepSize) != 0;
+                now = dmTime::GetTime();
+                if (cycle_done)
+                    break;
+            } while (now < end);
+
+            stats.m_Time = (uint32_t)(now - start);
+            count = GetLuaGCCountBytes(L);
+        }
+        context->m_GCLastCount = count;
+
+        DM_PROPERTY_ADD_U32(rmtp_ScriptGCAllocated, stats.m_AllocatedBytes);
+        DM_PROPERTY_ADD_U32(rmtp_ScriptGCTime, stats.m_Time);
+        DM_PROPERTY_ADD_U32(rmtp_ScriptGCSteps, stats.m_Steps);
+    }
+
     void Update(HContext context)
     {
         for (HScriptExtension* l = context->m_ScriptExtensions.Begin(); l != context->m_ScriptExtensions.End(); ++l)
@@ -239,6 +315,24 @@ namespace dmScript
                 (*l)->Update(context);
             }
         }
+
+        UpdateGC(context);
+    }
+
+    void SetGCBudget(HContext context, uint32_t budget)
+    {
+        context->m_GCBudget = budget;
+    }
+
+    void SetGCFrameTime(HContext context, uint32_t work_time, uint32_t frame_time)
+    {
+        context->m_GCWorkTime = work_time;
+        context->m_GCFrameTime = frame_time;
+    }
+
+    void GetGCStats(HContext context, GCStats* stats)
+    {
+        *stats = context->m_GCStats;
     }
 
     void Finalize(HContext context)
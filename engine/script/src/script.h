@@ -205,6 +205,44 @@ namespace dmScript
      */
     void Update(HContext context);
 
+    /// Config key for the time (in microseconds) Update() may spend on incremental garbage collection each frame. 0 disables it.
+    extern const char* SCRIPT_GC_BUDGET_KEY;
+    /// Config key for the amount (in kilobytes) of collection done in each incremental step
+    extern const char* SCRIPT_GC_STEP_SIZE_KEY;
+
+    /**
+     * Sets the time Update() may spend on incremental garbage collection each frame.
+     * The automatic collection of the lua allocator isn't paused, so collection may still happen
+     * outside of Update() when the memory grows faster than the budget can collect it.
+     * @param context script context
+     * @param budget time in microseconds. 0 leaves the collection to the lua allocator.
+     */
+    void SetGCBudget(HContext context, uint32_t budget);
+
+    /**
+     * Tells the garbage collection scheduler how long the previous frame took compared to the target frame time.
+     * When the frame finished early, more of the slack is spent on collection, and when it finished
+     * late, the collection is cut back.
+     * @param context script context
+     * @param work_time time (in microseconds) spent working on the previous frame, excluding the wait for vsync
+     * @param frame_time the target frame time (in microseconds). 0 if unknown.
+     */
+    void SetGCFrameTime(HContext context, uint32_t work_time, uint32_t frame_time);
+
+    struct GCStats
+    {
+        uint32_t m_AllocatedBytes;  // Bytes allocated since the previous Update(), net of what the lua allocator collected itself
+        uint32_t m_Time;            // Time (in microseconds) spent collecting in the last Update()
+        uint32_t m_Steps;           // Number of incremental steps done in the last Update()
+    };
+
+    /**
+     * Gets the garbage collection stats of the last Update()
+     * @param context script context
+     * @param stats [type: GCStats*] the out stats
+     */
+    void GetGCStats(HContext context, GCStats* stats);
+
     /**
      * Finalize script libraries
      * @param context script context
@@ -77,6 +77,12 @@ namespace dmScript
         dmArray<HScriptExtension>   m_ScriptExtensions;
         lua_State*                  m_LuaState;
         int                         m_ContextTableRef;
+        uint32_t                    m_GCBudget;         // Microseconds per frame, 0 if disabled
+        uint32_t                    m_GCStepSize;       // Kilobytes per step
+        uint32_t                    m_GCWorkTime;       // Microseconds of work the previous frame
+        uint32_t                    m_GCFrameTime;      // Target frame time in microseconds, 0 if unknown
+        uint32_t                    m_GCLastCount;      // Bytes in use after the previous Update()
+        GCStats                     m_GCStats;
         bool                        m_EnableExtensions;
     };
 
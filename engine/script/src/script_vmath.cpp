@@ -43,6 +43,9 @@ namespace dmScript
      * - The matrix type (`vmath.matrix4`) can be multiplied with numbers, other matrices
      *   and `vmath.vector4` values.
      * - All types performs equality comparison by each component value.
+     * - Functions that return a new vector, quaternion or matrix take an optional last `out` argument.
+     *   The result is stored in `out` instead of a new value, which avoids creating garbage in code that
+     *   runs every frame. Example: `vmath.add(self.position, self.velocity, self.position)`
      *
      * The following components are available for the various types:
      *
@@ -1665,7 +1668,8 @@ namespace dmScript
      *
      * @name vmath.inv
      * @param m1 [type:matrix4] matrix to invert
-     * @return m [type:matrix4] inverse of the supplied matrix
+     * @param [out] [type:matrix4] optional matrix to store the result in, instead of creating a new one
+     * @return m [type:matrix4] inverse of the supplied matrix, `out` if supplied
      * @examples
      *
      * ```lua
@@ -1679,7 +1683,7 @@ namespace dmScript
     {
         const Matrix4* m = CheckMatrix4(L, 1);
         Matrix4 mi = dmVMath::Inverse(*m);
-        PushMatrix4(L, mi);
+        PushMatrix4Into(L, 2, mi);
         return 1;
     }
 
@@ -1693,7 +1697,8 @@ namespace dmScript
      *
      * @name vmath.ortho_inv
      * @param m1 [type:matrix4] ortho-normalized matrix to invert
-     * @return m [type:matrix4] inverse of the supplied matrix
+     * @param [out] [type:matrix4] optional matrix to store the result in, instead of creating a new one
+     * @return m [type:matrix4] inverse of the supplied matrix, `out` if supplied
      * @examples
      *
      * ```lua
@@ -1707,7 +1712,7 @@ namespace dmScript
     {
         const Matrix4* m = CheckMatrix4(L, 1);
         Matrix4 mi = dmVMath::OrthoInverse(*m);
-        PushMatrix4(L, mi);
+        PushMatrix4Into(L, 2, mi);
         return 1;
     }
 
@@ -1863,7 +1868,8 @@ namespace dmScript
      *
      * @name vmath.normalize
      * @param v1 [type:vector3|vector4|quat] vector to normalize
-     * @return v [type:vector3|vector4|quat] new normalized vector
+     * @param [out] [type:vector3|vector4|quat] optional value of the same type to store the result in, instead of creating a new one. Can be `v1`
+     * @return v [type:vector3|vector4|quat] new normalized vector, `out` if supplied
      * @examples
      *
      * ```lua
@@ -1871,6 +1877,7 @@ namespace dmScript
      * local norm_vec = vmath.normalize(vec)
      * print(norm_vec) --> vmath.vector3(0.26726123690605, 0.5345224738121, 0.80178368091583)
      * print(vmath.length(norm_vec)) --> 0.99999994039536
+     * vmath.normalize(vec, vec) -- normalizes vec in place
      * ```
      */
     static int Normalize(lua_State* L)
@@ -1879,17 +1886,17 @@ namespace dmScript
         if (type == SCRIPT_TYPE_VECTOR3)
         {
             Vector3* v = CheckVector3(L, 1);
-            PushVector3(L, dmVMath::Normalize(*v));
+            PushVector3Into(L, 2, dmVMath::Normalize(*v));
         }
         else if (type == SCRIPT_TYPE_VECTOR4)
         {
             Vector4* v = CheckVector4(L, 1);
-            PushVector4(L, dmVMath::Normalize(*v));
+            PushVector4Into(L, 2, dmVMath::Normalize(*v));
         }
         else if (type == SCRIPT_TYPE_QUAT)
         {
             Quat* value = CheckQuat(L, 1);
-            PushQuat(L, dmVMath::Normalize(*value));
+            PushQuatInto(L, 2, dmVMath::Normalize(*value));
         }
         else
         {
@@ -1911,7 +1918,8 @@ namespace dmScript
      * @name vmath.cross
      * @param v1 [type:vector3] first vector
      * @param v2 [type:vector3] second vector
-     * @return v [type:vector3] a new vector representing the cross product
+     * @param [out] [type:vector3] optional vector to store the result in, instead of creating a new one
+     * @return v [type:vector3] a new vector representing the cross product, `out` if supplied
      * @examples
      *
      * ```lua
@@ -1926,7 +1934,7 @@ namespace dmScript
     {
         Vector3* v1 = CheckVector3(L, 1);
         Vector3* v2 = CheckVector3(L, 2);
-        PushVector3(L, dmVMath::Cross(*v1, *v2));
+        PushVector3Into(L, 3, dmVMath::Cross(*v1, *v2));
         return 1;
     }
 
@@ -1943,7 +1951,8 @@ namespace dmScript
      * @param t [type:number] interpolation parameter, 0-1
      * @param v1 [type:vector3|vector4] vector to lerp from
      * @param v2 [type:vector3|vector4] vector to lerp to
-     * @return v [type:vector3|vector4] the lerped vector
+     * @param [out] [type:vector3|vector4] optional vector to store the result in, instead of creating a new one
+     * @return v [type:vector3|vector4] the lerped vector, `out` if supplied
      * @examples
      *
      * ```lua
@@ -1976,7 +1985,8 @@ namespace dmScript
      * @param t [type:number] interpolation parameter, 0-1
      * @param q1 [type:quaternion] quaternion to lerp from
      * @param q2 [type:quaternion] quaternion to lerp to
-     * @return q [type:quaternion] the lerped quaternion
+     * @param [out] [type:quaternion] optional quaternion to store the result in, instead of creating a new one
+     * @return q [type:quaternion] the lerped quaternion, `out` if supplied
      * @examples
      *
      * ```lua
@@ -2038,21 +2048,21 @@ namespace dmScript
             {
                 Vector3* v1 = CheckVector3(L, 2);
                 Vector3* v2 = CheckVector3(L, 3);
-                PushVector3(L, dmVMath::Lerp(t, *v1, *v2));
+                PushVector3Into(L, 4, dmVMath::Lerp(t, *v1, *v2));
                 return 1;
             }
             else if (type1 == SCRIPT_TYPE_VECTOR4 && type2 == SCRIPT_TYPE_VECTOR4)
             {
                 Vector4* v1 = CheckVector4(L, 2);
                 Vector4* v2 = CheckVector4(L, 3);
-                PushVector4(L, dmVMath::Lerp(t, *v1, *v2));
+                PushVector4Into(L, 4, dmVMath::Lerp(t, *v1, *v2));
                 return 1;
             }
             else if (type1 == SCRIPT_TYPE_QUAT && type2 == SCRIPT_TYPE_QUAT)
             {
                 Quat* q1 = CheckQuat(L, 2);
                 Quat* q2 = CheckQuat(L, 3);
-                PushQuat(L, dmVMath::Lerp(t, *q1, *q2));
+                PushQuatInto(L, 4, dmVMath::Lerp(t, *q1, *q2));
                 return 1;
             }
         }
@@ -2083,7 +2093,8 @@ namespace dmScript
      * @param t [type:number] interpolation parameter, 0-1
      * @param v1 [type:vector3|vector4] vector to slerp from
      * @param v2 [type:vector3|vector4] vector to slerp to
-     * @return v [type:vector3|vector4] the slerped vector
+     * @param [out] [type:vector3|vector4] optional vector to store the result in, instead of creating a new one
+     * @return v [type:vector3|vector4] the slerped vector, `out` if supplied
      * @examples
      *
      * ```lua
@@ -2119,7 +2130,8 @@ namespace dmScript
      * @param t [type:number] interpolation parameter, 0-1
      * @param q1 [type:quaternion] quaternion to slerp from
      * @param q2 [type:quaternion] quaternion to slerp to
-     * @return q [type:quaternion] the slerped quaternion
+     * @param [out] [type:quaternion] optional quaternion to store the result in, instead of creating a new one
+     * @return q [type:quaternion] the slerped quaternion, `out` if supplied
      * @examples
      *
      * ```lua
@@ -2150,21 +2162,21 @@ namespace dmScript
             {
                 Quat* q1 = (Quat*)lua_touserdata(L, 2);
                 Quat* q2 = (Quat*)lua_touserdata(L, 3);
-                PushQuat(L, dmVMath::Slerp(t, *q1, *q2));
+                PushQuatInto(L, 4, dmVMath::Slerp(t, *q1, *q2));
                 return 1;
             }
             else if (type1 == SCRIPT_TYPE_VECTOR4 && type2 == SCRIPT_TYPE_VECTOR4)
             {
                 Vector4* v1 = CheckVector4(L, 2);
                 Vector4* v2 = CheckVector4(L, 3);
-                PushVector4(L, dmVMath::Slerp(t, *v1, *v2));
+                PushVector4Into(L, 4, dmVMath::Slerp(t, *v1, *v2));
                 return 1;
             }
             else if (type1 == SCRIPT_TYPE_VECTOR3 && type2 == SCRIPT_TYPE_VECTOR3)
             {
                 Vector3* v1 = CheckVector3(L, 2);
                 Vector3* v2 = CheckVector3(L, 3);
-                PushVector3(L, dmVMath::Slerp(t, *v1, *v2));
+                PushVector3Into(L, 4, dmVMath::Slerp(t, *v1, *v2));
                 return 1;
             }
         }
@@ -2181,7 +2193,8 @@ namespace dmScript
      *
      * @name vmath.conj
      * @param q1 [type:quaternion] quaternion of which to calculate the conjugate
-     * @return q [type:quaternion] the conjugate
+     * @param [out] [type:quaternion] optional quaternion to store the result in, instead of creating a new one
+     * @return q [type:quaternion] the conjugate, `out` if supplied
      * @examples
      *
      * ```lua
@@ -2192,7 +2205,7 @@ namespace dmScript
     static int Conj(lua_State* L)
     {
         Quat* q = CheckQuat(L, 1);
-        PushQuat(L, dmVMath::Conjugate(*q));
+        PushQuatInto(L, 2, dmVMath::Conjugate(*q));
         return 1;
     }
 
@@ -2205,7 +2218,8 @@ namespace dmScript
      * @name vmath.rotate
      * @param q [type:quaternion] quaternion
      * @param v1 [type:vector3] vector to rotate
-     * @return v [type:vector3] the rotated vector
+     * @param [out] [type:vector3] optional vector to store the result in, instead of creating a new one
+     * @return v [type:vector3] the rotated vector, `out` if supplied
      * @examples
      *
      * ```lua
@@ -2218,7 +2232,7 @@ namespace dmScript
     {
         Quat* q = CheckQuat(L, 1);
         Vector3* v = CheckVector3(L, 2);
-        PushVector3(L, dmVMath::Rotate(*q, *v));
+        PushVector3Into(L, 3, dmVMath::Rotate(*q, *v));
         return 1;
     }
 
@@ -2264,7 +2278,8 @@ namespace dmScript
      * @name vmath.mul_per_elem
      * @param v1 [type:vector3|vector4] first vector
      * @param v2 [type:vector3|vector4] second vector
-     * @return v [type:vector3|vector4] multiplied vector
+     * @param [out] [type:vector3|vector4] optional vector to store the result in, instead of creating a new one
+     * @return v [type:vector3|vector4] multiplied vector, `out` if supplied
      * @examples
      *
      * ```lua
@@ -2284,13 +2299,13 @@ namespace dmScript
         {
             Vector3* v1 = CheckVector3(L, 1);
             Vector3* v2 = CheckVector3(L, 2);
-            PushVector3(L, dmVMath::MulPerElem(*v1, *v2));
+            PushVector3Into(L, 3, dmVMath::MulPerElem(*v1, *v2));
         }
         else if (type1 == SCRIPT_TYPE_VECTOR4 && type2 == SCRIPT_TYPE_VECTOR4)
         {
             Vector4* v1 = CheckVector4(L, 1);
             Vector4* v2 = CheckVector4(L, 2);
-            PushVector4(L, dmVMath::MulPerElem(*v1, *v2));
+            PushVector4Into(L, 3, dmVMath::MulPerElem(*v1, *v2));
         }
         else
         {
@@ -2299,6 +2314,189 @@ namespace dmScript
         return 1;
     }
 
+    /*# adds two vectors
+     *
+     * Adds two vectors of the same type, like the `+` operator. The result can be
+     * stored in an existing vector instead of a new one, which avoids creating garbage
+     * in code that runs every frame.
+     *
+     * @name vmath.add
+     * @param v1 [type:vector3|vector4] first vector
+     * @param v2 [type:vector3|vector4] second vector
+     * @param [out] [type:vector3|vector4] optional vector of the same type to store the result in. Can be `v1` or `v2`
+     * @return v [type:vector3|vector4] the sum of the vectors, `out` if supplied
+     * @examples
+     *
+     * ```lua
+     * function update(self, dt)
+     *     -- self.position = self.position + self.velocity, without creating a new vector
+     *     vmath.add(self.position, self.velocity, self.position)
+     * end
+     * ```
+     */
+    static int Add(lua_State* L)
+    {
+        const ScriptUserType type1 = GetType(L, 1);
+        const ScriptUserType type2 = GetType(L, 2);
+
+        if (type1 != type2)
+        {
+            return luaL_error(L, "%s.%s Arguments needs to be of same type!", SCRIPT_LIB_NAME, "add");
+        }
+        if (type1 == SCRIPT_TYPE_VECTOR3)
+        {
+            Vector3* v1 = CheckVector3(L, 1);
+            Vector3* v2 = CheckVector3(L, 2);
+            PushVector3Into(L, 3, *v1 + *v2);
+        }
+        else if (type1 == SCRIPT_TYPE_VECTOR4)
+        {
+            Vector4* v1 = CheckVector4(L, 1);
+            Vector4* v2 = CheckVector4(L, 2);
+            PushVector4Into(L, 3, *v1 + *v2);
+        }
+        else
+        {
+            return luaL_error(L, "%s.%s accepts (%s|%s) as arguments.", SCRIPT_LIB_NAME, "add", SCRIPT_TYPE_NAME_VECTOR3, SCRIPT_TYPE_NAME_VECTOR4);
+        }
+        return 1;
+    }
+
+    /*# subtracts two vectors
+     *
+     * Subtracts the second vector from the first, like the `-` operator. The result can be
+     * stored in an existing vector instead of a new one, which avoids creating garbage
+     * in code that runs every frame.
+     *
+     * @name vmath.sub
+     * @param v1 [type:vector3|vector4] vector to subtract from
+     * @param v2 [type:vector3|vector4] vector to subtract
+     * @param [out] [type:vector3|vector4] optional vector of the same type to store the result in. Can be `v1` or `v2`
+     * @return v [type:vector3|vector4] the difference of the vectors, `out` if supplied
+     * @examples
+     *
+     * ```lua
+     * function update(self, dt)
+     *     vmath.sub(self.target, self.position, self.to_target)
+     * end
+     * ```
+     */
+    static int Sub(lua_State* L)
+    {
+        const ScriptUserType type1 = GetType(L, 1);
+        const ScriptUserType type2 = GetType(L, 2);
+
+        if (type1 != type2)
+        {
+            return luaL_error(L, "%s.%s Arguments needs to be of same type!", SCRIPT_LIB_NAME, "sub");
+        }
+        if (type1 == SCRIPT_TYPE_VECTOR3)
+        {
+            Vector3* v1 = CheckVector3(L, 1);
+            Vector3* v2 = CheckVector3(L, 2);
+            PushVector3Into(L, 3, *v1 - *v2);
+        }
+        else if (type1 == SCRIPT_TYPE_VECTOR4)
+        {
+            Vector4* v1 = CheckVector4(L, 1);
+            Vector4* v2 = CheckVector4(L, 2);
+            PushVector4Into(L, 3, *v1 - *v2);
+        }
+        else
+        {
+            return luaL_error(L, "%s.%s accepts (%s|%s) as arguments.", SCRIPT_LIB_NAME, "sub", SCRIPT_TYPE_NAME_VECTOR3, SCRIPT_TYPE_NAME_VECTOR4);
+        }
+        return 1;
+    }
+
+    /*# multiplies a vector by a number, or two quaternions
+     *
+     * Scales a vector by a number, or multiplies two quaternions, like the `*` operator.
+     * The result can be stored in an existing value instead of a new one, which avoids
+     * creating garbage in code that runs every frame.
+     *
+     * @name vmath.mul
+     * @param v1 [type:vector3|vector4|quaternion] vector to scale, or the first quaternion
+     * @param v2 [type:number|quaternion] scale factor, or the second quaternion
+     * @param [out] [type:vector3|vector4|quaternion] optional value of the same type as `v1` to store the result in. Can be `v1`
+     * @return v [type:vector3|vector4|quaternion] the product, `out` if supplied
+     * @examples
+     *
+     * ```lua
+     * function update(self, dt)
+     *     -- self.position = self.position + self.velocity * dt, without creating new vectors
+     *     vmath.mul(self.velocity, dt, self.step)
+     *     vmath.add(self.position, self.step, self.position)
+     * end
+     * ```
+     */
+    static int Mul(lua_State* L)
+    {
+        const ScriptUserType type = GetType(L, 1);
+        if (type == SCRIPT_TYPE_VECTOR3)
+        {
+            Vector3* v = CheckVector3(L, 1);
+            float s = (float) luaL_checknumber(L, 2);
+            PushVector3Into(L, 3, *v * s);
+        }
+        else if (type == SCRIPT_TYPE_VECTOR4)
+        {
+            Vector4* v = CheckVector4(L, 1);
+            float s = (float) luaL_checknumber(L, 2);
+            PushVector4Into(L, 3, *v * s);
+        }
+        else if (type == SCRIPT_TYPE_QUAT)
+        {
+            Quat* q1 = CheckQuat(L, 1);
+            Quat* q2 = CheckQuat(L, 2);
+            PushQuatInto(L, 3, *q1 * *q2);
+        }
+        else
+        {
+            return luaL_error(L, "%s.%s accepts (%s|%s|%s) as first argument.", SCRIPT_LIB_NAME, "mul", SCRIPT_TYPE_NAME_VECTOR3, SCRIPT_TYPE_NAME_VECTOR4, SCRIPT_TYPE_NAME_QUAT);
+        }
+        return 1;
+    }
+
+    /*# divides a vector by a number
+     *
+     * Divides a vector by a number, like the `/` operator. The result can be
+     * stored in an existing vector instead of a new one, which avoids creating garbage
+     * in code that runs every frame.
+     *
+     * @name vmath.div
+     * @param v1 [type:vector3|vector4] vector to divide
+     * @param n [type:number] number to divide by
+     * @param [out] [type:vector3|vector4] optional vector of the same type to store the result in. Can be `v1`
+     * @return v [type:vector3|vector4] the divided vector, `out` if supplied
+     * @examples
+     *
+     * ```lua
+     * vmath.div(self.sum, self.count, self.average)
+     * ```
+     */
+    static int Div(lua_State* L)
+    {
+        const ScriptUserType type = GetType(L, 1);
+        if (type == SCRIPT_TYPE_VECTOR3)
+        {
+            Vector3* v = CheckVector3(L, 1);
+            float s = (float) luaL_checknumber(L, 2);
+            PushVector3Into(L, 3, *v / s);
+        }
+        else if (type == SCRIPT_TYPE_VECTOR4)
+        {
+            Vector4* v = CheckVector4(L, 1);
+            float s = (float) luaL_checknumber(L, 2);
+            PushVector4Into(L, 3, *v / s);
+        }
+        else
+        {
+            return luaL_error(L, "%s.%s accepts (%s|%s) as first argument.", SCRIPT_LIB_NAME, "div", SCRIPT_TYPE_NAME_VECTOR3, SCRIPT_TYPE_NAME_VECTOR4);
+        }
+        return 1;
+    }
+
     static const luaL_reg methods[] =
     {
         {SCRIPT_TYPE_NAME_VECTOR, Vector_new},
@@ -2335,6 +2533,10 @@ namespace dmScript
         {"inv", Inverse},
         {"ortho_inv", OrthoInverse},
         {"mul_per_elem", MulPerElem},
+        {"add", Add},
+        {"sub", Sub},
+        {"mul", Mul},
+        {"div", Div},
         {0, 0}
     };
 
@@ -2388,6 +2590,18 @@ namespace dmScript
         lua_setmetatable(L, -2);
     }
 
+    void PushVector3Into(lua_State* L, int index, const Vector3& v)
+    {
+        if (lua_isnoneornil(L, index))
+        {
+            PushVector3(L, v);
+            return;
+        }
+        Vector3* out = (Vector3*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_VECTOR3], 0);
+        *out = v;
+        lua_pushvalue(L, index);
+    }
+
     Vector3* CheckVector3(lua_State* L, int index)
     {
         Vector3* v = (Vector3*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_VECTOR3], 0);
@@ -2406,6 +2620,18 @@ namespace dmScript
         lua_setmetatable(L, -2);
     }
 
+    void PushVector4Into(lua_State* L, int index, const Vector4& v)
+    {
+        if (lua_isnoneornil(L, index))
+        {
+            PushVector4(L, v);
+            return;
+        }
+        Vector4* out = (Vector4*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_VECTOR4], 0);
+        *out = v;
+        lua_pushvalue(L, index);
+    }
+
     Vector4* CheckVector4(lua_State* L, int index)
     {
         Vector4* v = (Vector4*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_VECTOR4], 0);
@@ -2424,6 +2650,18 @@ namespace dmScript
         lua_setmetatable(L, -2);
     }
 
+    void PushQuatInto(lua_State* L, int index, const Quat& q)
+    {
+        if (lua_isnoneornil(L, index))
+        {
+            PushQuat(L, q);
+            return;
+        }
+        Quat* out = (Quat*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_QUAT], 0);
+        *out = q;
+        lua_pushvalue(L, index);
+    }
+
     Quat* CheckQuat(lua_State* L, int index)
     {
         Quat* q = (Quat*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_QUAT], 0);
@@ -2442,6 +2680,18 @@ namespace dmScript
         lua_setmetatable(L, -2);
     }
 
+    void PushMatrix4Into(lua_State* L, int index, const Matrix4& m)
+    {
+        if (lua_isnoneornil(L, index))
+        {
+            PushMatrix4(L, m);
+            return;
+        }
+        Matrix4* out = (Matrix4*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_MATRIX4], 0);
+        *out = m;
+        lua_pushvalue(L, index);
+    }
+
     Matrix4* CheckMatrix4(lua_State* L, int index)
     {
         Matrix4* m = (Matrix4*)CheckUserType(L, index, TYPE_HASHES[SCRIPT_TYPE_MATRIX4], 0);
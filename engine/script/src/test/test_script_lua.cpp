@@ -1067,6 +1067,50 @@ TEST_F(ScriptTestLua, LuaBooleanFunctions)
 
 #undef USE_PANIC_FN
 
+TEST_F(ScriptTestLua, IncrementalGC)
+{
+    int top = lua_gettop(L);
+
+    // Without a budget, the collection is left to the lua allocator
+    ASSERT_TRUE(RunString(L, "garbage = {} for i=1,50000 do garbage[i] = { i } end"));
+    dmScript::Update(m_Context);
+    dmScript::GCStats stats;
+    dmScript::GetGCStats(m_Context, &stats);
+    ASSERT_EQ(0u, stats.m_Steps);
+    ASSERT_EQ(0u, stats.m_Time);
+
+    ASSERT_TRUE(RunString(L, "garbage = {} for i=1,50000 do garbage[i] = { i } end"));
+    dmScript::Update(m_Context);
+    dmScript::GetGCStats(m_Context, &stats);
+    ASSERT_LT(0u, stats.m_AllocatedBytes);
+
+    dmScript::SetGCBudget(m_Context, 1000);
+    uint32_t count = dmScript::GetLuaGCCount(L);
+    ASSERT_TRUE(RunString(L, "garbage = nil"));
+
+    // The scheduler collects the garbage over a number of frames
+    bool collected = false;
+    for (uint32_t i = 0; i < 1000 && !collected; ++i)
+    {
+        dmScript::Update(m_Context);
+        dmScript::GetGCStats(m_Context, &stats);
+        ASSERT_LT(0u, stats.m_Steps);
+        collected = dmScript::GetLuaGCCount(L) < count / 2;
+    }
+    ASSERT_TRUE(collected);
+
+    // A frame that is behind still makes some progress
+    dmScript::SetGCFrameTime(m_Context, 20000, 16666);
+    dmScript::Update(m_Context);
+    dmScript::GetGCStats(m_Context, &stats);
+    ASSERT_LT(0u, stats.m_Steps);
+
+    dmScript::SetGCBudget(m_Context, 0);
+    dmScript::SetGCFrameTime(m_Context, 0, 0);
+
+    ASSERT_EQ(top, lua_gettop(L));
+}
+
 int main(int argc, char **argv)
 {
     TestMainPlatformInit();
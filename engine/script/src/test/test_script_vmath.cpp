@@ -362,6 +362,16 @@ TEST_F(ScriptVmathTest, TestToValueFn)
     ASSERT_EQ(top, lua_gettop(L));
 }
 
+TEST_F(ScriptVmathTest, TestOut)
+{
+    ASSERT_TRUE(RunFile(L, "test_vmath_out.luac"));
+}
+
+TEST_F(ScriptVmathTest, BenchmarkSteering)
+{
+    ASSERT_TRUE(RunFile(L, "test_vmath_benchmark.luac"));
+}
+
 int main(int argc, char **argv)
 {
     TestMainPlatformInit();
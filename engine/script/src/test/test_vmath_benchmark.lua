@@ -0,0 +1,106 @@
+-- Copyright 2020-2024 The Defold Foundation
+-- Copyright 2014-2020 King
+-- Copyright 2009-2014 Ragnar Svensson, Christian Murray
+-- Licensed under the Defold License version 1.0 (the "License"); you may not use
+-- this file except in compliance with the License.
+-- 
+-- You may obtain a copy of the License, together with FAQs at
+-- https://www.defold.com/license
+-- 
+-- Unless required by applicable law or agreed to in writing, software distributed
+-- under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+-- CONDITIONS OF ANY KIND, either express or implied. See the License for the
+-- specific language governing permissions and limitations under the License.
+
+
+-- A typical steering workload: every agent steers towards its target and integrates
+-- its velocity, once with the vmath operators and once with the out arguments.
+
+local AGENT_COUNT = 1000
+local FRAME_COUNT = 100
+local DT = 1 / 60
+local MAX_SPEED = 100
+local MAX_FORCE = 50
+
+local function create_agents()
+    local agents = {}
+    for i = 1, AGENT_COUNT do
+        agents[i] = {
+            position = vmath.vector3(i, i * 2, 0),
+            velocity = vmath.vector3(1, 0, 0),
+            target = vmath.vector3(-i, 500 - i, 0),
+            -- temporaries for the out version
+            desired = vmath.vector3(),
+            steer = vmath.vector3(),
+        }
+    end
+    return agents
+end
+
+local function update_operators(agents, dt)
+    for i = 1, #agents do
+        local agent = agents[i]
+        local desired = vmath.normalize(agent.target - agent.position) * MAX_SPEED
+        local steer = desired - agent.velocity
+        if vmath.length_sqr(steer) > MAX_FORCE * MAX_FORCE then
+            steer = vmath.normalize(steer) * MAX_FORCE
+        end
+        agent.velocity = agent.velocity + steer * dt
+        agent.position = agent.position + agent.velocity * dt
+    end
+end
+
+local function update_out(agents, dt)
+    for i = 1, #agents do
+        local agent = agents[i]
+        local desired = agent.desired
+        local steer = agent.steer
+        vmath.sub(agent.target, agent.position, desired)
+        vmath.normalize(desired, desired)
+        vmath.mul(desired, MAX_SPEED, desired)
+        vmath.sub(desired, agent.velocity, steer)
+        if vmath.length_sqr(steer) > MAX_FORCE * MAX_FORCE then
+            vmath.normalize(steer, steer)
+            vmath.mul(steer, MAX_FORCE, steer)
+        end
+        vmath.mul(steer, dt, steer)
+        vmath.add(agent.velocity, steer, agent.velocity)
+        vmath.mul(agent.velocity, dt, steer)
+        vmath.add(agent.position, steer, agent.position)
+    end
+end
+
+local function measure(name, update)
+    local agents = create_agents()
+    collectgarbage("collect")
+
+    -- Allocated bytes per frame, with the collector stopped
+    collectgarbage("stop")
+    local start_kb = collectgarbage("count")
+    for frame = 1, FRAME_COUNT do
+        update(agents, DT)
+    end
+    local bytes_per_frame = (collectgarbage("count") - start_kb) * 1024 / FRAME_COUNT
+    collectgarbage("restart")
+    collectgarbage("collect")
+
+    -- Time per frame, including the incremental collection of the garbage
+    local start_time = os.clock()
+    for frame = 1, FRAME_COUNT do
+        update(agents, DT)
+    end
+    local ms_per_frame = (os.clock() - start_time) * 1000 / FRAME_COUNT
+
+    print(string.format("%-10s %d agents: %8.0f bytes/frame %7.3f ms/frame", name, AGENT_COUNT, bytes_per_frame, ms_per_frame))
+    return agents, bytes_per_frame
+end
+
+local agents_operators, bytes_operators = measure("operators", update_operators)
+local agents_out, bytes_out = measure("out", update_out)
+
+-- Both versions compute the same thing
+for i = 1, AGENT_COUNT do
+    local d = agents_operators[i].position - agents_out[i].position
+    assert(vmath.length(d) < 0.01, "the versions differ")
+end
+assert(bytes_out * 10 < bytes_operators, "the out version should create much less garbage")
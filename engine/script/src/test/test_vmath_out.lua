@@ -0,0 +1,107 @@
+-- Copyright 2020-2024 The Defold Foundation
+-- Copyright 2014-2020 King
+-- Copyright 2009-2014 Ragnar Svensson, Christian Murray
+-- Licensed under the Defold License version 1.0 (the "License"); you may not use
+-- this file except in compliance with the License.
+-- 
+-- You may obtain a copy of the License, together with FAQs at
+-- https://www.defold.com/license
+-- 
+-- Unless required by applicable law or agreed to in writing, software distributed
+-- under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+-- CONDITIONS OF ANY KIND, either express or implied. See the License for the
+-- specific language governing permissions and limitations under the License.
+
+
+local function near(a, b)
+    return math.abs(a - b) < 0.000001
+end
+
+-- add, sub, mul, div return new values without out
+local v = vmath.add(vmath.vector3(1, 2, 3), vmath.vector3(2, 3, 4))
+assert(v == vmath.vector3(3, 5, 7), "add")
+v = vmath.sub(vmath.vector4(1, 2, 3, 4), vmath.vector4(2, 3, 4, 5))
+assert(v == vmath.vector4(-1, -1, -1, -1), "sub")
+v = vmath.mul(vmath.vector3(1, 2, 3), 2)
+assert(v == vmath.vector3(2, 4, 6), "mul")
+v = vmath.div(vmath.vector4(2, 4, 6, 8), 2)
+assert(v == vmath.vector4(1, 2, 3, 4), "div")
+local q = vmath.mul(vmath.quat_rotation_z(0.5), vmath.quat_rotation_z(0.25))
+local expected = vmath.quat_rotation_z(0.75)
+assert(near(q.z, expected.z) and near(q.w, expected.w), "mul quat")
+
+-- the result is written into out, which is returned
+local out = vmath.vector3()
+local a = vmath.vector3(1, 2, 3)
+local b = vmath.vector3(2, 3, 4)
+assert(vmath.add(a, b, out) == out, "add does not return out")
+assert(out == vmath.vector3(3, 5, 7), "add out")
+assert(a == vmath.vector3(1, 2, 3) and b == vmath.vector3(2, 3, 4), "add changed the arguments")
+vmath.sub(a, b, out)
+assert(out == vmath.vector3(-1, -1, -1), "sub out")
+vmath.mul(a, 3, out)
+assert(out == vmath.vector3(3, 6, 9), "mul out")
+vmath.div(out, 3, out)
+assert(out == vmath.vector3(1, 2, 3), "div out")
+
+-- out can be one of the arguments
+local p = vmath.vector3(1, 1, 1)
+local vel = vmath.vector3(1, 2, 3)
+vmath.add(p, vel, p)
+assert(p == vmath.vector3(2, 3, 4), "add in place")
+vmath.sub(vel, p, p)
+assert(p == vmath.vector3(-1, -1, -1), "sub in place, second argument")
+vmath.mul(p, -2, p)
+assert(p == vmath.vector3(2, 2, 2), "mul in place")
+
+local v4 = vmath.vector4(1, 2, 3, 4)
+vmath.add(v4, v4, v4)
+assert(v4 == vmath.vector4(2, 4, 6, 8), "add vector4 in place")
+
+-- existing functions with out
+v = vmath.vector3(1.2, 1.6, 0)
+assert(vmath.normalize(v, v) == v, "normalize does not return out")
+assert(near(v.x, 0.6) and near(v.y, 0.8), "normalize in place")
+
+out = vmath.vector3()
+vmath.cross(vmath.vector3(1, 0, 0), vmath.vector3(0, 1, 0), out)
+assert(out == vmath.vector3(0, 0, 1), "cross out")
+
+vmath.lerp(0.5, vmath.vector3(1, 0, 0), vmath.vector3(0, -1, 0), out)
+assert(out == vmath.vector3(0.5, -0.5, 0), "lerp out")
+assert(vmath.lerp(0.5, 0, 2, out) == 1, "lerp numbers ignore out")
+
+vmath.slerp(0.5, vmath.vector3(1, 0, 0), vmath.vector3(0, -1, 0), out)
+local sq2 = math.sqrt(2)
+assert(near(out.x, 0.5 * sq2) and near(out.y, -0.5 * sq2), "slerp out")
+
+vmath.mul_per_elem(vmath.vector3(1, 2, 3), vmath.vector3(5, 6, 7), out)
+assert(out == vmath.vector3(5, 12, 21), "mul_per_elem out")
+
+local rot = vmath.quat_rotation_z(math.pi * 0.5)
+vmath.rotate(rot, vmath.vector3(1, 0, 0), out)
+assert(near(out.x, 0) and near(out.y, 1), "rotate out")
+
+local qout = vmath.quat()
+vmath.conj(vmath.quat(1, 2, 3, 4), qout)
+assert(qout == vmath.quat(-1, -2, -3, 4), "conj out")
+vmath.normalize(vmath.quat(0, 0, 0, 2), qout)
+assert(qout == vmath.quat(0, 0, 0, 1), "normalize quat out")
+vmath.lerp(0.5, vmath.quat(0, 0, 0, 1), vmath.quat(0, 0, 0, 1), qout)
+assert(qout == vmath.quat(0, 0, 0, 1), "lerp quat out")
+
+local m = vmath.matrix4_translation(vmath.vector3(1, 2, 3))
+local mout = vmath.matrix4()
+assert(vmath.ortho_inv(m, mout) == mout, "ortho_inv does not return out")
+assert(mout.m03 == -1 and mout.m13 == -2 and mout.m23 == -3, "ortho_inv out")
+vmath.inv(m, mout)
+assert(mout.m03 == -1 and mout.m13 == -2 and mout.m23 == -3, "inv out")
+
+-- nil out creates a new value
+v = vmath.add(a, b, nil)
+assert(v == vmath.vector3(3, 5, 7), "add nil out")
+
+-- out of the wrong type is an error
+assert(not pcall(vmath.add, a, b, vmath.vector4()), "add into vector4")
+assert(not pcall(vmath.normalize, a, vmath.quat()), "normalize into quat")
+assert(not pcall(vmath.add, a, vmath.vector4()), "add of different types")
@@ -13,14 +13,17 @@
 // specific language governing permissions and limitations under the License.
 
 #include <stdint.h>
+#include <algorithm>
 #include <dlib/array.h>
 #include <dlib/atomic.h>
-#include <dlib/hashtable.h>
+#include <dlib/hashmap.h>
 #include <dlib/index_pool.h>
+#include <dlib/job_system.h>
 #include <dlib/log.h>
 #include <dlib/math.h>
 #include <dlib/mutex.h>
 #include <dlib/profile.h>
+#include <dlib/simd.h>
 #include <dlib/thread.h>
 #include <dlib/time.h>
 #include <dmsdk/dlib/vmath.h>
@@ -33,6 +36,17 @@
 #include <math.h>
 #include <cfloat>
 
+DM_PROPERTY_GROUP(rmtp_SoundMixer, "Sound Mixer");
+DM_PROPERTY_U32(rmtp_SoundDecodeJobs, 0, FrameReset, "# decode-ahead jobs / frame", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundDecodeUnderruns, 0, FrameReset, "# times the mixer waited for decoded frames / frame", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundDecodeUnderrunsTotal, 0, NoFlags, "# times the mixer waited for decoded frames", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundPCMCacheHits, 0, FrameReset, "# instances of sounds in the PCM cache / frame", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundPCMCacheMisses, 0, FrameReset, "# instances of compressed sounds not in the PCM cache / frame", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundPCMCacheSize, 0, NoFlags, "Bytes of decoded sounds in the PCM cache", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundVoices, 0, NoFlags, "# playing instances that are mixed", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundVirtualVoices, 0, NoFlags, "# playing instances that are inaudible or over the voice limit", &rmtp_SoundMixer);
+DM_PROPERTY_U32(rmtp_SoundCommandsDeferred, 0, FrameReset, "# commands that waited for room in the mixer command queue / frame", &rmtp_SoundMixer);
+
 /**
  * Defold simple sound system
  * NOTE: Must units is in frames, i.e a sample in time with N channels
@@ -45,11 +59,15 @@ namespace dmSound
     #define SOUND_MAX_MIX_CHANNELS (2)
     #define SOUND_OUTBUFFER_COUNT (6)
     #define SOUND_MAX_SPEED (5)
+    // Must be a power of two
+    #define SOUND_COMMAND_QUEUE_SIZE (1024)
 
     // TODO: How many bits?
     const uint32_t RESAMPLE_FRACTION_BITS = 31;
 
     const dmhash_t MASTER_GROUP_HASH = dmHashString64("master");
+    // The master group is always the first group created
+    const uint16_t MASTER_GROUP_INDEX = 0;
     const uint32_t GROUP_MEMORY_BUFFER_COUNT = 64;
 
     static void SoundThread(void* ctx);
@@ -149,22 +167,92 @@ namespace dmSound
         return ramp;
     }
 
+    /**
+     * A compressed sound decoded to PCM. It's stored as a WAV, so that instances of it are
+     * played with the WAV decoder, which only copies the frames.
+     * Only used by the game thread. The memory is freed by the mixer, after the instances using it.
+     */
+    struct PCMCacheEntry
+    {
+        uint32_t      m_RefCount;   // One for the cache, and one for each instance
+        uint32_t      m_Size;       // Bytes, including this header
+        uint32_t      m_WavSize;
+        uint32_t      m_LastUse;    // SoundSystem::m_PCMCacheTime when an instance was last created
+        // Followed by the WAV
+    };
+
+    /**
+     * A sound being decoded into a PCMCacheEntry on a decode worker, see StartPCMCacheFill().
+     * Only used by the game thread, apart from the job.
+     */
+    struct PCMCacheFill
+    {
+        dmJobSystem::Counter    m_Counter;
+        dmSoundCodec::HDecoder  m_Decoder;
+        dmSoundCodec::Info      m_Info;
+        dmSoundCodec::Result    m_Result;
+        PCMCacheEntry*          m_Entry;    // m_MaxSize bytes, the WAV data is written by the job
+        uint32_t                m_MaxSize;
+        uint32_t                m_Decoded;
+    };
+
     struct SoundData
     {
         dmhash_t      m_NameHash;
         void*         m_Data;
         int           m_Size;
+        PCMCacheEntry* m_PCMCacheEntry;
+        PCMCacheFill* m_PCMCacheFill;
         // Index in m_SoundData
         uint16_t      m_Index;
         SoundDataType m_Type;
         uint16_t      m_RefCount;
+        uint8_t       m_PCMUncacheable; // Too large for the PCM cache, or failed to decode
     };
 
+    /**
+     * Decode-ahead buffer of a compressed sound instance. A decode job fills it on a worker thread while
+     * the mixer consumes it, so the mixer only copies PCM. Single producer, single consumer.
+     * The positions are byte counters that wrap around at 2^32, and are masked with the (power of two) size.
+     * While a job is running (m_Counter is non zero) the job owns the decoder.
+     */
+    struct DecodeStream
+    {
+        char*                   m_Buffer;
+        uint32_t                m_Size;
+        uint32_t                m_MixSize;          // Bytes of one mix buffer at normal speed
+        int32_atomic_t          m_ReadPos;          // Advanced by the mixer
+        int32_atomic_t          m_WritePos;         // Advanced by the decode job
+        dmJobSystem::Counter    m_Counter;
+
+        // Set by the mixer before a job is started. How many times the job may restart the stream, negative for no limit
+        int32_t                 m_LoopCount;
+
+        // Set by the job, read by the mixer once the job has finished
+        dmSoundCodec::Result    m_Result;
+        uint32_t                m_FirstRestartPos;
+        uint16_t                m_RestartCount;
+        uint8_t                 m_EndOfStream;
+
+        // Mixer state
+        uint8_t                 m_HasLoopPos;
+        uint8_t                 m_Primed;           // Frames have been mixed, so missing frames are underruns
+        uint32_t                m_LoopPos;          // First restart of the stream that hasn't been mixed yet
+    };
+
+    /*
+     * The decoder and indices are set up by NewSoundInstance(), the rest of the state belongs to the mixer.
+     * The game thread changes the mixer state through commands, see PushCommand()
+     */
     struct SoundInstance
     {
+        // Playing state as seen by the game thread, (generation << 1) | playing. Play/Stop/Pause set it and bump
+        // the generation. The mixer only clears it when the sound ends, if no newer Play/Stop/Pause has been made.
+        int32_atomic_t m_IsPlaying;
         dmSoundCodec::HDecoder m_Decoder;
         void*       m_Frames;
-        dmhash_t    m_Group;
+        DecodeStream m_Stream;  // Only used if m_Stream.m_Buffer is set
+        PCMCacheEntry* m_PCMCacheEntry; // The decoded sound played by m_Decoder, if any
 
         Value       m_Gain;     // default: 1.0f
         Value       m_Pan;      // 0 = -45deg left, 1 = 45 deg right
@@ -172,18 +260,26 @@ namespace dmSound
         uint32_t    m_FrameCount;
         uint64_t    m_FrameFraction;
 
+        uint32_t    m_PlayGeneration; // Generation of the last Play/Stop/Pause applied by the mixer
+
         uint16_t    m_Index;
         uint16_t    m_SoundDataIndex;
+        uint16_t    m_GroupIndex;
         uint8_t     m_Looping : 1;
         uint8_t     m_EndOfStream : 1;
         uint8_t     m_Playing : 1;
-        uint8_t     : 5;
+        uint8_t     m_Virtual : 1;  // Advances without being decoded or mixed, see UpdateVoices()
+        uint8_t     m_Mixed : 1;    // Was mixed in the last update, so it's faded out before it becomes virtual
+        uint8_t     : 3;
         int8_t      m_Loopcounter; // if set to 3, there will be 3 loops effectively playing the sound 4 times.
+        uint8_t     m_Priority;
     };
 
     struct SoundGroup
     {
         dmhash_t m_NameHash;
+        // Last gain set on the game thread
+        float    m_RequestedGain;
         Value    m_Gain;
         float*   m_MixBuffer;
         float    m_SumSquaredMemory[SOUND_MAX_MIX_CHANNELS * GROUP_MEMORY_BUFFER_COUNT];
@@ -191,21 +287,82 @@ namespace dmSound
         int      m_NextMemorySlot;
     };
 
+    enum CommandType
+    {
+        COMMAND_PLAY,
+        COMMAND_STOP,
+        COMMAND_PAUSE,
+        COMMAND_SET_LOOPING,
+        COMMAND_SET_PARAMETER,
+        COMMAND_SET_INSTANCE_GROUP,
+        COMMAND_SET_PRIORITY,
+        COMMAND_DELETE_INSTANCE,
+        COMMAND_ADD_GROUP,
+        COMMAND_SET_GROUP_GAIN,
+        COMMAND_DELETE_SOUND_DATA,
+        COMMAND_FREE,
+    };
+
+    /**
+     * Change of the mixer state, requested from the game thread
+     */
+    struct Command
+    {
+        void*       m_Data;     // Mix buffer for COMMAND_ADD_GROUP, memory for COMMAND_FREE
+        float       m_Value;
+        uint32_t    m_Generation; // Playing state generation for COMMAND_PLAY, COMMAND_STOP and COMMAND_PAUSE
+        uint16_t    m_Index;    // Instance, group or sound data index
+        uint16_t    m_GroupIndex;
+        uint8_t     m_Type;
+        uint8_t     m_Parameter;
+        int8_t      m_LoopCounter;
+        uint8_t     m_Flag;
+    };
+
     struct SoundSystem
     {
         dmSoundCodec::HCodecContext   m_CodecContext;
         DeviceType*                   m_DeviceType;
         HDevice                       m_Device;
         dmThread::Thread              m_Thread;
+        // Protects the instance, sound data and decoder pools
         dmMutex::HMutex               m_Mutex;
 
+        // Single producer (game thread), single consumer (mixer) ring of commands
+        Command*                m_Commands;
+        int32_atomic_t          m_CommandReadIndex;
+        int32_atomic_t          m_CommandWriteIndex;
+        // Commands waiting for room in the queue. Only used by the game thread
+        dmArray<Command>        m_CommandBacklog;
+
         dmArray<SoundInstance>  m_Instances;
         dmIndexPool16           m_InstancesPool;
 
+        // Workers decoding compressed sounds ahead of the mixer. 0 if disabled
+        dmJobSystem::HJobSystem m_DecodeJobs;
+        uint32_t                m_DecodeAheadBuffers;
+        int32_atomic_t          m_DecodeJobCount;
+        int32_atomic_t          m_DecodeUnderrunCount;  // Since the last Update()
+        int32_atomic_t          m_DecodeUnderrunTotal;
+
+        // Compressed sounds decoded to PCM, see GetPCMCacheEntry(). Only used by the game thread
+        uint32_t                m_PCMCacheCapacity; // Bytes, 0 if disabled
+        uint32_t                m_PCMCacheSize;
+        uint32_t                m_PCMCacheFillSize; // Bytes allocated by the fills in progress
+        uint32_t                m_PCMCacheTime;
+        uint32_t                m_PCMCacheHits;
+        uint32_t                m_PCMCacheMisses;
+
+        // Voice management, see UpdateVoices()
+        uint32_t                m_MaxVoices;        // 0 if there is no limit
+        dmArray<uint16_t>       m_Voices;           // Indices of the audible instances
+        int32_atomic_t          m_VoiceCount;
+        int32_atomic_t          m_VirtualVoiceCount;
+
         dmArray<SoundData>      m_SoundData;
         dmIndexPool16           m_SoundDataPool;
 
-        dmHashTable<dmhash_t, int> m_GroupMap;
+        dmHashMap64<int> m_GroupMap;
         SoundGroup              m_Groups[MAX_GROUPS];
 
         int32_atomic_t          m_IsRunning;
@@ -255,6 +412,10 @@ namespace dmSound
         params->m_BufferSize = 12 * 4096;
         params->m_FrameCount = 768;
         params->m_MaxInstances = 256;
+        params->m_DecodeAheadBuffers = 0;
+        params->m_DecodeThreadCount = 1;
+        params->m_PCMCacheSize = 0;
+        params->m_MaxVoices = 0;
         params->m_UseThread = true;
     }
 
@@ -279,12 +440,472 @@ namespace dmSound
         return RESULT_DEVICE_NOT_FOUND;
     }
 
+    static inline Command NewCommand(CommandType type, uint16_t index)
+    {
+        Command command;
+        memset(&command, 0, sizeof(command));
+        command.m_Type = (uint8_t) type;
+        command.m_Index = index;
+        return command;
+    }
+
+    static void ResetInstance(SoundInstance* instance)
+    {
+        instance->m_Gain.Reset(1.0f);
+        instance->m_Pan.Reset(0.5f);
+        instance->m_Speed = 1.0f;
+        instance->m_FrameCount = 0;
+        instance->m_FrameFraction = 0;
+        instance->m_GroupIndex = MASTER_GROUP_INDEX;
+        instance->m_Looping = 0;
+        instance->m_EndOfStream = 0;
+        instance->m_Playing = 0;
+        instance->m_Virtual = 0;
+        instance->m_Mixed = 0;
+        instance->m_Loopcounter = 0;
+        instance->m_Priority = 0;
+        instance->m_PlayGeneration = 0;
+    }
+
+    // Called by the mixer when an instance stops playing by itself
+    static inline void EndInstance(SoundInstance* instance)
+    {
+        instance->m_Playing = 0;
+        // The game thread may have played the sound again, after the play that just ended
+        int32_t playing = (int32_t) ((instance->m_PlayGeneration << 1) | 1);
+        dmAtomicCompareStore32(&instance->m_IsPlaying, playing & ~1, playing);
+    }
+
+    // Called by the game thread. Returns the generation to pass to the mixer with the command
+    static uint32_t SetIsPlaying(SoundInstance* instance, bool playing)
+    {
+        uint32_t generation = ((uint32_t) dmAtomicGet32(&instance->m_IsPlaying) >> 1) + 1;
+        dmAtomicStore32(&instance->m_IsPlaying, (int32_t) ((generation << 1) | (playing ? 1 : 0)));
+        return generation;
+    }
+
+    static void SetInstanceParameter(SoundInstance* instance, Parameter parameter, float value)
+    {
+        bool reset = !instance->m_Playing;
+        switch(parameter)
+        {
+            case PARAMETER_GAIN:
+                instance->m_Gain.Set(value, reset);
+                break;
+            case PARAMETER_PAN:
+                instance->m_Pan.Set(value, reset);
+                break;
+            case PARAMETER_SPEED:
+                instance->m_Speed = value;
+                break;
+            default:
+                break;
+        }
+    }
+
+    static void ApplyGroupGain(SoundSystem* sound, uint16_t group_index, float gain)
+    {
+        // If all playing sounds is currently at gain zero
+        // we can safely do a hard reset of the group gain
+        bool reset = true;
+        uint32_t instances = sound->m_Instances.Size();
+        for (uint32_t i = 0; i < instances; ++i)
+        {
+            SoundInstance* instance = &sound->m_Instances[i];
+            if (!instance->m_Playing && instance->m_FrameCount == 0)
+            {
+                continue;
+            }
+            if (instance->m_GroupIndex != group_index)
+            {
+                continue;
+            }
+            if (instance->m_Gain.m_Prev == 0.0)
+            {
+                continue;
+            }
+            reset = false;
+            break;
+        }
+        SoundGroup* group = &sound->m_Groups[group_index];
+        group->m_Gain.Set(gain, reset);
+    }
+
+    static uint32_t NextPowerOfTwo(uint32_t v)
+    {
+        uint32_t p = 1;
+        while (p < v)
+        {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    static inline bool IsDecodePending(DecodeStream* stream)
+    {
+        return dmAtomicGet32(&stream->m_Counter.m_Value) != 0;
+    }
+
+    // Waits for the decode job of the instance, if any, so that the mixer can use the decoder
+    static void WaitForDecode(SoundSystem* sound, SoundInstance* instance)
+    {
+        DecodeStream* stream = &instance->m_Stream;
+        if (stream->m_Buffer && IsDecodePending(stream))
+        {
+            DM_PROFILE("WaitForDecode");
+            dmJobSystem::WaitForCounter(sound->m_DecodeJobs, &stream->m_Counter);
+        }
+    }
+
+    static void WaitForAllDecodes(SoundSystem* sound)
+    {
+        uint32_t instances = sound->m_Instances.Size();
+        for (uint32_t i = 0; i < instances; ++i)
+        {
+            WaitForDecode(sound, &sound->m_Instances[i]);
+        }
+    }
+
+    // Empties the decode-ahead buffer. Any decode job must have finished
+    static void ResetStream(DecodeStream* stream)
+    {
+        dmAtomicStore32(&stream->m_ReadPos, 0);
+        dmAtomicStore32(&stream->m_WritePos, 0);
+        stream->m_LoopCount = 0;
+        stream->m_Result = dmSoundCodec::RESULT_OK;
+        stream->m_FirstRestartPos = 0;
+        stream->m_RestartCount = 0;
+        stream->m_EndOfStream = 0;
+        stream->m_HasLoopPos = 0;
+        stream->m_Primed = 0;
+        stream->m_LoopPos = 0;
+    }
+
+    // Applies the result of a finished decode job to the instance
+    static dmSoundCodec::Result CollectDecodeResult(SoundInstance* instance)
+    {
+        DecodeStream* stream = &instance->m_Stream;
+        if (stream->m_RestartCount > 0)
+        {
+            if (instance->m_Loopcounter > 0)
+            {
+                instance->m_Loopcounter = (int8_t) dmMath::Max(0, (int32_t) instance->m_Loopcounter - (int32_t) stream->m_RestartCount);
+            }
+            // Remember where the stream was restarted, in case looping is turned off before it's mixed
+            uint32_t read_pos = (uint32_t) stream->m_ReadPos;
+            if (!stream->m_HasLoopPos && (int32_t) (stream->m_FirstRestartPos - read_pos) >= 0)
+            {
+                stream->m_LoopPos = stream->m_FirstRestartPos;
+                stream->m_HasLoopPos = 1;
+            }
+            stream->m_RestartCount = 0;
+        }
+        return stream->m_Result;
+    }
+
+    // Fills the free part of the decode-ahead buffer. Runs on a decode worker
+    static void DecodeJob(void* _sound, void* _instance)
+    {
+        DM_PROFILE(__FUNCTION__);
+        SoundSystem* sound = (SoundSystem*) _sound;
+        SoundInstance* instance = (SoundInstance*) _instance;
+        DecodeStream* stream = &instance->m_Stream;
+        const uint32_t size = stream->m_Size;
+
+        // Only the job writes the write position
+        uint32_t write_pos = (uint32_t) stream->m_WritePos;
+        bool restarted = false;
+        dmSoundCodec::Result r = dmSoundCodec::RESULT_OK;
+        while (true)
+        {
+            uint32_t free = size - (write_pos - (uint32_t) dmAtomicGet32(&stream->m_ReadPos));
+            if (free == 0)
+            {
+                break;
+            }
+
+            uint32_t offset = write_pos & (size - 1);
+            uint32_t n = dmMath::Min(free, size - offset);
+            uint32_t decoded = 0;
+            r = dmSoundCodec::Decode(sound->m_CodecContext, instance->m_Decoder, stream->m_Buffer + offset, n, &decoded);
+            if (r != dmSoundCodec::RESULT_OK)
+            {
+                break;
+            }
+
+            write_pos += decoded;
+            // Full barrier, so the frames are written before they are published
+            dmAtomicAdd32(&stream->m_WritePos, (int32_t) decoded);
+
+            if (decoded < n)
+            {
+                // End of the stream. A stream without frames is never restarted
+                if (stream->m_LoopCount == 0 || (restarted && decoded == 0))
+                {
+                    stream->m_EndOfStream = 1;
+                    break;
+                }
+
+                if (stream->m_LoopCount > 0)
+                {
+                    stream->m_LoopCount--;
+                }
+                if (stream->m_RestartCount == 0)
+                {
+                    stream->m_FirstRestartPos = write_pos;
+                }
+                stream->m_RestartCount++;
+                dmSoundCodec::Reset(sound->m_CodecContext, instance->m_Decoder);
+                restarted = true;
+            }
+            else
+            {
+                restarted = false;
+            }
+        }
+        stream->m_Result = r;
+    }
+
+    // Starts a decode job if the instance is playing and has room for at least one mix buffer
+    static void ScheduleDecode(SoundSystem* sound, SoundInstance* instance)
+    {
+        DecodeStream* stream = &instance->m_Stream;
+        if (!instance->m_Playing || IsDecodePending(stream))
+        {
+            return;
+        }
+        if (CollectDecodeResult(instance) != dmSoundCodec::RESULT_OK || stream->m_EndOfStream)
+        {
+            return;
+        }
+
+        uint32_t used = (uint32_t) stream->m_WritePos - (uint32_t) stream->m_ReadPos;
+        if (stream->m_Size - used < stream->m_MixSize)
+        {
+            return;
+        }
+
+        stream->m_LoopCount = instance->m_Looping ? instance->m_Loopcounter : 0;
+        dmAtomicIncrement32(&sound->m_DecodeJobCount);
+        dmJobSystem::Run(sound->m_DecodeJobs, DecodeJob, sound, instance, &stream->m_Counter, 0);
+    }
+
+    // Copies up to size bytes of decoded frames. Returns the number of bytes copied
+    static uint32_t ReadStream(DecodeStream* stream, char* out, uint32_t size)
+    {
+        uint32_t read_pos = (uint32_t) stream->m_ReadPos;
+        uint32_t available = (uint32_t) dmAtomicGet32(&stream->m_WritePos) - read_pos;
+        uint32_t n = dmMath::Min(size, available);
+        uint32_t offset = read_pos & (stream->m_Size - 1);
+        uint32_t first = dmMath::Min(n, stream->m_Size - offset);
+        memcpy(out, stream->m_Buffer + offset, first);
+        memcpy(out + first, stream->m_Buffer, n - first);
+        // Full barrier, so the frames are read before the space is handed back to the job
+        dmAtomicAdd32(&stream->m_ReadPos, (int32_t) n);
+
+        if (stream->m_HasLoopPos && (int32_t) (read_pos + n - stream->m_LoopPos) > 0)
+        {
+            stream->m_HasLoopPos = 0;
+        }
+        return n;
+    }
+
+    static void ApplyCommand(SoundSystem* sound, const Command& command)
+    {
+        switch (command.m_Type)
+        {
+            case COMMAND_PLAY:
+                {
+                    SoundInstance* instance = &sound->m_Instances[command.m_Index];
+                    instance->m_Playing = 1;
+                    instance->m_PlayGeneration = command.m_Generation;
+                    if (instance->m_Stream.m_Buffer)
+                    {
+                        ScheduleDecode(sound, instance);
+                    }
+                }
+                break;
+            case COMMAND_STOP:
+                {
+                    SoundInstance* instance = &sound->m_Instances[command.m_Index];
+                    instance->m_Playing = 0;
+                    instance->m_Mixed = 0;
+                    instance->m_PlayGeneration = command.m_Generation;
+                    WaitForDecode(sound, instance);
+                    dmSoundCodec::Reset(sound->m_CodecContext, instance->m_Decoder);
+                    if (instance->m_Stream.m_Buffer)
+                    {
+                        ResetStream(&instance->m_Stream);
+                    }
+                }
+                break;
+            case COMMAND_PAUSE:
+                sound->m_Instances[command.m_Index].m_Playing = !command.m_Flag;
+                sound->m_Instances[command.m_Index].m_PlayGeneration = command.m_Generation;
+                break;
+            case COMMAND_SET_LOOPING:
+                {
+                    SoundInstance* instance = &sound->m_Instances[command.m_Index];
+                    DecodeStream* stream = &instance->m_Stream;
+                    if (stream->m_Buffer)
+                    {
+                        WaitForDecode(sound, instance);
+                        CollectDecodeResult(instance);
+                    }
+
+                    instance->m_Looping = command.m_Flag;
+                    instance->m_Loopcounter = command.m_LoopCounter;
+
+                    // If the stream has been restarted ahead of the mixer, but shouldn't loop anymore, it ends at the restart
+                    bool loop = instance->m_Looping && instance->m_Loopcounter != 0;
+                    if (stream->m_Buffer && stream->m_HasLoopPos && !loop)
+                    {
+                        dmAtomicStore32(&stream->m_WritePos, (int32_t) stream->m_LoopPos);
+                        stream->m_EndOfStream = 1;
+                        stream->m_HasLoopPos = 0;
+                    }
+                }
+                break;
+            case COMMAND_SET_PARAMETER:
+                SetInstanceParameter(&sound->m_Instances[command.m_Index], (Parameter) command.m_Parameter, command.m_Value);
+                break;
+            case COMMAND_SET_INSTANCE_GROUP:
+                sound->m_Instances[command.m_Index].m_GroupIndex = command.m_GroupIndex;
+                break;
+            case COMMAND_SET_PRIORITY:
+                sound->m_Instances[command.m_Index].m_Priority = command.m_Flag;
+                break;
+            case COMMAND_DELETE_INSTANCE:
+                {
+                    SoundInstance* instance = &sound->m_Instances[command.m_Index];
+                    WaitForDecode(sound, instance);
+                    free(instance->m_Stream.m_Buffer);
+                    ResetStream(&instance->m_Stream);
+                    instance->m_Stream.m_Buffer = 0;
+
+                    DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+                    dmSoundCodec::DeleteDecoder(sound->m_CodecContext, instance->m_Decoder);
+                    instance->m_Decoder = 0;
+                    instance->m_SoundDataIndex = 0xffff;
+                    instance->m_Index = 0xffff;
+                    ResetInstance(instance);
+                    sound->m_InstancesPool.Push(command.m_Index);
+                }
+                break;
+            case COMMAND_ADD_GROUP:
+                {
+                    SoundGroup* group = &sound->m_Groups[command.m_Index];
+                    group->m_Gain.Reset(1.0f);
+                    group->m_MixBuffer = (float*) command.m_Data;
+                }
+                break;
+            case COMMAND_SET_GROUP_GAIN:
+                ApplyGroupGain(sound, command.m_Index, command.m_Value);
+                break;
+            case COMMAND_DELETE_SOUND_DATA:
+                {
+                    SoundData* sound_data = &sound->m_SoundData[command.m_Index];
+                    free(sound_data->m_Data);
+                    sound_data->m_Data = 0;
+                    DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+                    sound_data->m_Index = 0xffff;
+                    sound->m_SoundDataPool.Push(command.m_Index);
+                }
+                break;
+            case COMMAND_FREE:
+                // The memory may be sound data that is being decoded ahead
+                WaitForAllDecodes(sound);
+                free(command.m_Data);
+                break;
+            default:
+                assert(0);
+        }
+    }
+
+    // Must only be called from the game thread
+    static bool TryPushCommand(SoundSystem* sound, const Command& command)
+    {
+        // Only the game thread writes the write index
+        uint32_t write_index = (uint32_t) sound->m_CommandWriteIndex;
+        if (write_index - (uint32_t) dmAtomicGet32(&sound->m_CommandReadIndex) >= SOUND_COMMAND_QUEUE_SIZE)
+        {
+            return false;
+        }
+
+        sound->m_Commands[write_index & (SOUND_COMMAND_QUEUE_SIZE - 1)] = command;
+        // Full barrier, so the command is written before it's published
+        dmAtomicIncrement32(&sound->m_CommandWriteIndex);
+        return true;
+    }
+
+    // Moves the commands that didn't fit to the queue, in order. Returns true if all of them were moved.
+    // Must only be called from the game thread
+    static bool FlushCommandBacklog(SoundSystem* sound)
+    {
+        dmArray<Command>& backlog = sound->m_CommandBacklog;
+        uint32_t count = backlog.Size();
+        uint32_t pushed = 0;
+        while (pushed < count && TryPushCommand(sound, backlog[pushed]))
+        {
+            ++pushed;
+        }
+        if (pushed > 0)
+        {
+            memmove(backlog.Begin(), backlog.Begin() + pushed, (count - pushed) * sizeof(Command));
+            backlog.SetSize(count - pushed);
+        }
+        return backlog.Empty();
+    }
+
+    /*
+     * Without a sound thread the command is applied directly. Otherwise it's added to the command queue,
+     * which the sound thread drains before mixing, so the game thread never waits for a mix to finish.
+     * If the queue is full, the command waits on the game thread until there is room, see Update().
+     * Must only be called from the game thread.
+     */
+    static void PushCommand(SoundSystem* sound, const Command& command)
+    {
+        if (!sound->m_Thread)
+        {
+            ApplyCommand(sound, command);
+            return;
+        }
+
+        // The commands waiting for room must be applied first
+        if (FlushCommandBacklog(sound) && TryPushCommand(sound, command))
+        {
+            return;
+        }
+
+        dmArray<Command>& backlog = sound->m_CommandBacklog;
+        if (backlog.Full())
+        {
+            backlog.OffsetCapacity(dmMath::Max(64U, backlog.Capacity()));
+        }
+        backlog.Push(command);
+        DM_PROPERTY_ADD_U32(rmtp_SoundCommandsDeferred, 1);
+    }
+
+    static void ProcessCommands(SoundSystem* sound)
+    {
+        DM_PROFILE(__FUNCTION__);
+        // Only the sound thread writes the read index
+        uint32_t read_index = (uint32_t) sound->m_CommandReadIndex;
+        uint32_t write_index = (uint32_t) dmAtomicGet32(&sound->m_CommandWriteIndex);
+        for (uint32_t i = read_index; i != write_index; ++i)
+        {
+            ApplyCommand(sound, sound->m_Commands[i & (SOUND_COMMAND_QUEUE_SIZE - 1)]);
+        }
+        // Full barrier, so the commands are read before their slots are handed back
+        dmAtomicAdd32(&sound->m_CommandReadIndex, (int32_t) (write_index - read_index));
+    }
+
     static int GetOrCreateGroup(const char* group_name)
     {
         dmhash_t group_hash = dmHashString64(group_name);
 
         SoundSystem* sound = g_SoundSystem;
-        if (sound->m_GroupMap.Full()) {
+        if (sound->m_GroupMap.Size() >= MAX_GROUPS) {
             return -1;
         }
 
@@ -295,11 +916,16 @@ namespace dmSound
         uint32_t index = sound->m_GroupMap.Size();
         SoundGroup* group = &sound->m_Groups[index];
         group->m_NameHash = group_hash;
-        group->m_Gain.Reset(1.0f);
+        group->m_RequestedGain = 1.0f;
         size_t mix_buffer_size = sound->m_FrameCount * sizeof(float) * SOUND_MAX_MIX_CHANNELS;
-        group->m_MixBuffer = (float*) malloc(mix_buffer_size);
-        memset(group->m_MixBuffer, 0, mix_buffer_size);
+        float* mix_buffer = (float*) malloc(mix_buffer_size);
+        memset(mix_buffer, 0, mix_buffer_size);
         sound->m_GroupMap.Put(group_hash, index);
+
+        // The mixer starts mixing the group once it has the mix buffer
+        Command command = NewCommand(COMMAND_ADD_GROUP, (uint16_t) index);
+        command.m_Data = mix_buffer;
+        PushCommand(sound, command);
         return index;
     }
 
@@ -337,6 +963,11 @@ namespace dmSound
         sound->m_HasWindowFocus = true; // Assume we startup with the window focused
         sound->m_DeviceType = device_type;
         sound->m_Device = device;
+        sound->m_Thread = 0;
+        sound->m_Mutex = 0;
+        sound->m_Commands = 0;
+        dmAtomicStore32(&sound->m_CommandReadIndex, 0);
+        dmAtomicStore32(&sound->m_CommandWriteIndex, 0);
         dmSoundCodec::NewCodecContextParams codec_params;
         codec_params.m_MaxDecoders = params->m_MaxInstances;
         sound->m_CodecContext = dmSoundCodec::New(&codec_params);
@@ -345,6 +976,10 @@ namespace dmSound
         uint32_t max_buffers = params->m_MaxBuffers;
         uint32_t max_sources = params->m_MaxSources;
         uint32_t max_instances = params->m_MaxInstances;
+        uint32_t decode_ahead_buffers = params->m_DecodeAheadBuffers;
+        uint32_t decode_thread_count = params->m_DecodeThreadCount;
+        uint32_t pcm_cache_size = params->m_PCMCacheSize;
+        uint32_t max_voices = params->m_MaxVoices;
 
         if (config)
         {
@@ -353,8 +988,41 @@ namespace dmSound
             max_buffers = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_buffers", (int32_t) max_buffers);
             max_sources = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_sources", (int32_t) max_sources);
             max_instances = (uint32_t) dmConfigFile::GetInt(config, "sound.max_sound_instances", (int32_t) max_instances);
+            decode_ahead_buffers = (uint32_t) dmConfigFile::GetInt(config, "sound.decode_ahead_buffers", (int32_t) decode_ahead_buffers);
+            decode_thread_count = (uint32_t) dmConfigFile::GetInt(config, "sound.decode_thread_count", (int32_t) decode_thread_count);
+            pcm_cache_size = (uint32_t) dmConfigFile::GetInt(config, "sound.pcm_cache_size", (int32_t) pcm_cache_size);
+            max_voices = (uint32_t) dmConfigFile::GetInt(config, "sound.max_voices", (int32_t) max_voices);
+        }
+
+        sound->m_PCMCacheCapacity = pcm_cache_size * 1024;
+        sound->m_PCMCacheSize = 0;
+        sound->m_PCMCacheFillSize = 0;
+        sound->m_PCMCacheTime = 0;
+        sound->m_PCMCacheHits = 0;
+        sound->m_PCMCacheMisses = 0;
+
+        sound->m_DecodeJobs = 0;
+        sound->m_DecodeAheadBuffers = 0;
+        dmAtomicStore32(&sound->m_DecodeJobCount, 0);
+        dmAtomicStore32(&sound->m_DecodeUnderrunCount, 0);
+        dmAtomicStore32(&sound->m_DecodeUnderrunTotal, 0);
+        // The PCM cache is also filled on the decode workers
+        if ((decode_ahead_buffers > 0 || pcm_cache_size > 0) && decode_thread_count > 0)
+        {
+            dmJobSystem::Params job_params;
+            dmJobSystem::SetDefaultParams(&job_params);
+            job_params.m_Name = "sound_decode";
+            job_params.m_WorkerCount = decode_thread_count;
+            job_params.m_QueueCapacity = max_instances;
+            sound->m_DecodeJobs = dmJobSystem::New(job_params);
+            sound->m_DecodeAheadBuffers = decode_ahead_buffers;
         }
 
+        sound->m_MaxVoices = max_voices;
+        sound->m_Voices.SetCapacity(max_instances);
+        dmAtomicStore32(&sound->m_VoiceCount, 0);
+        dmAtomicStore32(&sound->m_VirtualVoiceCount, 0);
+
         sound->m_Instances.SetCapacity(max_instances);
         sound->m_Instances.SetSize(max_instances);
         sound->m_InstancesPool.SetCapacity(max_instances);
@@ -367,8 +1035,8 @@ namespace dmSound
             // NOTE: +1 for "over-fetch" when up-sampling
             // NOTE: and x SOUND_MAX_SPEED for potential pitch range
             instance->m_Frames = malloc((params->m_FrameCount * SOUND_MAX_SPEED + 1) * sizeof(int16_t) * SOUND_MAX_MIX_CHANNELS);
-            instance->m_FrameCount = 0;
-            instance->m_Speed = 1.0f;
+            dmJobSystem::InitCounter(&instance->m_Stream.m_Counter);
+            ResetInstance(instance);
         }
 
         sound->m_SoundData.SetCapacity(max_sound_data);
@@ -377,6 +1045,8 @@ namespace dmSound
         for (uint32_t i = 0; i < max_sound_data; ++i)
         {
             sound->m_SoundData[i].m_Index = 0xffff;
+            sound->m_SoundData[i].m_PCMCacheEntry = 0;
+            sound->m_SoundData[i].m_PCMCacheFill = 0;
         }
 
         sound->m_MixRate = device_info.m_MixRate;
@@ -386,23 +1056,25 @@ namespace dmSound
         }
         sound->m_NextOutBuffer = 0;
 
-        sound->m_GroupMap.SetCapacity(MAX_GROUPS * 2 + 1, MAX_GROUPS);
+        sound->m_GroupMap.SetCapacity(MAX_GROUPS);
         for (uint32_t i = 0; i < MAX_GROUPS; ++i) {
             memset(&sound->m_Groups[i], 0, sizeof(SoundGroup));
         }
 
+        // No sound thread yet, so the group is added directly
         int master_index = GetOrCreateGroup("master");
+        assert(master_index == MASTER_GROUP_INDEX);
         SoundGroup* master = &sound->m_Groups[master_index];
         master->m_Gain.Reset(master_gain);
+        master->m_RequestedGain = master_gain;
 
         dmAtomicStore32(&sound->m_IsRunning, 1);
         dmAtomicStore32(&sound->m_IsPaused, 0);
         dmAtomicStore32(&sound->m_Status, (int)RESULT_NOTHING_TO_PLAY);
 
-        sound->m_Thread = 0;
-        sound->m_Mutex = 0;
         if (params->m_UseThread)
         {
+            sound->m_Commands = (Command*) malloc(SOUND_COMMAND_QUEUE_SIZE * sizeof(Command));
             sound->m_Mutex = dmMutex::New();
             sound->m_Thread = dmThread::New((dmThread::ThreadStart)SoundThread, 0x80000, sound, "sound");
         }
@@ -420,7 +1092,15 @@ namespace dmSound
         if (sound->m_Thread)
         {
             dmThread::Join(sound->m_Thread);
+            // Free the instances and memory still in the queue
+            ProcessCommands(sound);
+            for (uint32_t i = 0; i < sound->m_CommandBacklog.Size(); ++i)
+            {
+                ApplyCommand(sound, sound->m_CommandBacklog[i]);
+            }
+            sound->m_CommandBacklog.SetSize(0);
             dmMutex::Delete(sound->m_Mutex);
+            free(sound->m_Commands);
         }
 
         PlatformFinalize();
@@ -429,6 +1109,20 @@ namespace dmSound
 
         if (sound)
         {
+            // Runs the decode jobs still in the queue before the decoders are deleted
+            dmJobSystem::Delete(sound->m_DecodeJobs);
+
+            for (uint32_t i = 0; i < sound->m_SoundData.Size(); ++i)
+            {
+                PCMCacheFill* fill = sound->m_SoundData[i].m_PCMCacheFill;
+                if (fill)
+                {
+                    dmSoundCodec::DeleteDecoder(sound->m_CodecContext, fill->m_Decoder);
+                    free(fill->m_Entry);
+                    delete fill;
+                }
+            }
+
             dmSoundCodec::Delete(sound->m_CodecContext);
 
             for (uint32_t i = 0; i < sound->m_Instances.Size(); ++i)
@@ -437,9 +1131,15 @@ namespace dmSound
                 instance->m_Index = 0xffff;
                 instance->m_SoundDataIndex = 0xffff;
                 free(instance->m_Frames);
+                free(instance->m_Stream.m_Buffer);
                 memset(instance, 0, sizeof(*instance));
             }
 
+            for (uint32_t i = 0; i < sound->m_SoundData.Size(); ++i)
+            {
+                free(sound->m_SoundData[i].m_PCMCacheEntry);
+            }
+
             for (int i = 0; i < SOUND_OUTBUFFER_COUNT; ++i) {
                 free((void*) sound->m_OutBuffers[i]);
             }
@@ -470,6 +1170,251 @@ namespace dmSound
     }
 
 
+    static inline char* GetWav(PCMCacheEntry* entry)
+    {
+        return (char*) (entry + 1);
+    }
+
+    static char* WriteU16(char* out, uint16_t v)
+    {
+        out[0] = (char) (v & 0xff);
+        out[1] = (char) (v >> 8);
+        return out + 2;
+    }
+
+    static char* WriteU32(char* out, uint32_t v)
+    {
+        out = WriteU16(out, (uint16_t) (v & 0xffff));
+        return WriteU16(out, (uint16_t) (v >> 16));
+    }
+
+    static const uint32_t WAV_HEADER_SIZE = 44;
+
+    static void WriteWavHeader(char* out, const dmSoundCodec::Info& info, uint32_t data_size)
+    {
+        uint32_t block_align = info.m_Channels * (info.m_BitsPerSample / 8);
+        memcpy(out, "RIFF", 4);
+        out = WriteU32(out + 4, WAV_HEADER_SIZE - 8 + data_size);
+        memcpy(out, "WAVEfmt ", 8);
+        out = WriteU32(out + 8, 16);
+        out = WriteU16(out, 1); // PCM
+        out = WriteU16(out, info.m_Channels);
+        out = WriteU32(out, info.m_Rate);
+        out = WriteU32(out, info.m_Rate * block_align);
+        out = WriteU16(out, (uint16_t) block_align);
+        out = WriteU16(out, info.m_BitsPerSample);
+        memcpy(out, "data", 4);
+        WriteU32(out + 4, data_size);
+    }
+
+    // Decodes the whole sound into the entry of the fill. Runs on a decode worker
+    static void FillPCMCacheJob(void* _sound, void* _fill)
+    {
+        DM_PROFILE(__FUNCTION__);
+        SoundSystem* sound = (SoundSystem*) _sound;
+        PCMCacheFill* fill = (PCMCacheFill*) _fill;
+        const uint32_t header_size = sizeof(PCMCacheEntry) + WAV_HEADER_SIZE;
+        uint32_t capacity = (fill->m_MaxSize - header_size) & ~3u; // Whole frames
+        fill->m_Result = dmSoundCodec::Decode(sound->m_CodecContext, fill->m_Decoder, GetWav(fill->m_Entry) + WAV_HEADER_SIZE, capacity, &fill->m_Decoded);
+        // If the buffer was filled, the sound is probably longer
+        if (fill->m_Result == dmSoundCodec::RESULT_OK && fill->m_Decoded >= capacity)
+        {
+            fill->m_Result = dmSoundCodec::RESULT_OUT_OF_RESOURCES;
+        }
+    }
+
+    // Starts decoding the whole sound on a decode worker, if it fits in max_size bytes
+    static void StartPCMCacheFill(SoundSystem* sound, SoundData* sound_data, dmSoundCodec::Format format, uint32_t max_size)
+    {
+        const uint32_t header_size = sizeof(PCMCacheEntry) + WAV_HEADER_SIZE;
+        if (max_size <= header_size)
+        {
+            sound_data->m_PCMUncacheable = 1;
+            return;
+        }
+
+        dmSoundCodec::HDecoder decoder;
+        {
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+            dmSoundCodec::Result r = dmSoundCodec::NewDecoder(sound->m_CodecContext, format, sound_data->m_Data, sound_data->m_Size, &decoder);
+            if (r != dmSoundCodec::RESULT_OK)
+            {
+                sound_data->m_PCMUncacheable = 1;
+                return;
+            }
+        }
+
+        PCMCacheFill* fill = new PCMCacheFill;
+        dmJobSystem::InitCounter(&fill->m_Counter);
+        fill->m_Decoder = decoder;
+        dmSoundCodec::GetInfo(sound->m_CodecContext, decoder, &fill->m_Info);
+        fill->m_Result = dmSoundCodec::RESULT_OK;
+        fill->m_Entry = (PCMCacheEntry*) malloc(max_size);
+        fill->m_MaxSize = max_size;
+        fill->m_Decoded = 0;
+
+        sound_data->m_PCMCacheFill = fill;
+        sound->m_PCMCacheFillSize += max_size;
+        dmJobSystem::Run(sound->m_DecodeJobs, FillPCMCacheJob, sound, fill, &fill->m_Counter, 0);
+    }
+
+    // Waits for the fill of the sound, if any, and returns the decoded sound. Returns 0 if it couldn't be decoded,
+    // or if keep is false
+    static PCMCacheEntry* FinishPCMCacheFill(SoundSystem* sound, SoundData* sound_data, bool keep)
+    {
+        PCMCacheFill* fill = sound_data->m_PCMCacheFill;
+        if (!fill)
+        {
+            return 0;
+        }
+
+        dmJobSystem::WaitForCounter(sound->m_DecodeJobs, &fill->m_Counter);
+        sound_data->m_PCMCacheFill = 0;
+        sound->m_PCMCacheFillSize -= fill->m_MaxSize;
+        {
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
+            dmSoundCodec::DeleteDecoder(sound->m_CodecContext, fill->m_Decoder);
+        }
+
+        PCMCacheEntry* entry = fill->m_Entry;
+        uint32_t decoded = fill->m_Decoded;
+        bool ok = fill->m_Result == dmSoundCodec::RESULT_OK && decoded > 0;
+        dmSoundCodec::Info info = fill->m_Info;
+        delete fill;
+
+        if (!keep || !ok)
+        {
+            free(entry);
+            return 0;
+        }
+
+        const uint32_t header_size = sizeof(PCMCacheEntry) + WAV_HEADER_SIZE;
+        entry = (PCMCacheEntry*) realloc(entry, header_size + decoded);
+        entry->m_RefCount = 1;
+        entry->m_Size = header_size + decoded;
+        entry->m_WavSize = WAV_HEADER_SIZE + decoded;
+        entry->m_LastUse = 0;
+        WriteWavHeader(GetWav(entry), info, decoded);
+        return entry;
+    }
+
+    static void ReleasePCMCacheEntry(SoundSystem* sound, PCMCacheEntry* entry)
+    {
+        if (--entry->m_RefCount == 0)
+        {
+            // Freed by the mixer, after the instances that used it are deleted
+            Command command = NewCommand(COMMAND_FREE, 0);
+            command.m_Data = entry;
+            PushCommand(sound, command);
+        }
+    }
+
+    static void RemoveFromPCMCache(SoundSystem* sound, SoundData* sound_data)
+    {
+        PCMCacheEntry* entry = sound_data->m_PCMCacheEntry;
+        if (entry)
+        {
+            sound_data->m_PCMCacheEntry = 0;
+            sound->m_PCMCacheSize -= entry->m_Size;
+            ReleasePCMCacheEntry(sound, entry);
+        }
+    }
+
+    // Bytes that are free, or can be freed by evicting sounds without instances
+    static uint32_t GetPCMCacheRoom(SoundSystem* sound)
+    {
+        uint32_t used = sound->m_PCMCacheSize + sound->m_PCMCacheFillSize;
+        if (used >= sound->m_PCMCacheCapacity)
+        {
+            return 0;
+        }
+        uint32_t room = sound->m_PCMCacheCapacity - used;
+        for (uint32_t i = 0; i < sound->m_SoundData.Size(); ++i)
+        {
+            PCMCacheEntry* entry = sound->m_SoundData[i].m_PCMCacheEntry;
+            if (entry && entry->m_RefCount == 1)
+            {
+                room += entry->m_Size;
+            }
+        }
+        return room;
+    }
+
+    // Evicts the least recently used sounds without instances
+    static void MakeRoomInPCMCache(SoundSystem* sound, uint32_t size)
+    {
+        while (sound->m_PCMCacheSize + sound->m_PCMCacheFillSize + size > sound->m_PCMCacheCapacity)
+        {
+            SoundData* lru = 0;
+            for (uint32_t i = 0; i < sound->m_SoundData.Size(); ++i)
+            {
+                PCMCacheEntry* entry = sound->m_SoundData[i].m_PCMCacheEntry;
+                if (entry && entry->m_RefCount == 1 && (!lru || (int32_t) (entry->m_LastUse - lru->m_PCMCacheEntry->m_LastUse) < 0))
+                {
+                    lru = &sound->m_SoundData[i];
+                }
+            }
+            assert(lru);
+            RemoveFromPCMCache(sound, lru);
+        }
+    }
+
+    /*
+     * Returns the decoded sound for a new instance, with a reference added, or 0 if the
+     * instance should decode the sound itself. Short compressed sounds are decoded on a decode
+     * worker when the first instance is created, and kept while there is room for them.
+     */
+    static PCMCacheEntry* GetPCMCacheEntry(SoundSystem* sound, SoundData* sound_data, dmSoundCodec::Format format)
+    {
+        if (sound->m_PCMCacheCapacity == 0 || !sound->m_DecodeJobs || format != dmSoundCodec::FORMAT_VORBIS)
+        {
+            return 0;
+        }
+
+        // Pick up the decoded sound once it's done
+        PCMCacheFill* fill = sound_data->m_PCMCacheFill;
+        if (fill && dmAtomicGet32(&fill->m_Counter.m_Value) == 0)
+        {
+            PCMCacheEntry* decoded = FinishPCMCacheFill(sound, sound_data, true);
+            if (!decoded)
+            {
+                sound_data->m_PCMUncacheable = 1;
+            }
+            else if (GetPCMCacheRoom(sound) < decoded->m_Size)
+            {
+                // The cached sounds are all playing. Try again on a later instance
+                free(decoded);
+            }
+            else
+            {
+                MakeRoomInPCMCache(sound, decoded->m_Size);
+                sound_data->m_PCMCacheEntry = decoded;
+                sound->m_PCMCacheSize += decoded->m_Size;
+            }
+        }
+
+        PCMCacheEntry* entry = sound_data->m_PCMCacheEntry;
+        if (!entry)
+        {
+            sound->m_PCMCacheMisses++;
+            DM_PROPERTY_ADD_U32(rmtp_SoundPCMCacheMisses, 1);
+
+            // Only short sounds are cached. Meanwhile, the instances decode the sound themselves
+            uint32_t max_size = sound->m_PCMCacheCapacity / 4;
+            if (!sound_data->m_PCMUncacheable && !sound_data->m_PCMCacheFill && GetPCMCacheRoom(sound) >= max_size)
+            {
+                StartPCMCacheFill(sound, sound_data, format, max_size);
+            }
+            return 0;
+        }
+
+        sound->m_PCMCacheHits++;
+        DM_PROPERTY_ADD_U32(rmtp_SoundPCMCacheHits, 1);
+        entry->m_LastUse = ++sound->m_PCMCacheTime;
+        entry->m_RefCount++;
+        return entry;
+    }
+
     static Result SetSoundDataNoLock(HSoundData sound_data, const void* sound_buffer, uint32_t sound_buffer_size)
     {
         free(sound_data->m_Data);
@@ -502,6 +1447,9 @@ namespace dmSound
         sd->m_Index = index;
         sd->m_Data = 0;
         sd->m_Size = 0;
+        sd->m_PCMCacheEntry = 0;
+        sd->m_PCMCacheFill = 0;
+        sd->m_PCMUncacheable = 0;
         sd->m_RefCount = 1;
 
         Result result = SetSoundDataNoLock(sd, sound_buffer, sound_buffer_size);
@@ -515,8 +1463,26 @@ namespace dmSound
 
     Result SetSoundData(HSoundData sound_data, const void* sound_buffer, uint32_t sound_buffer_size)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        return SetSoundDataNoLock(sound_data, sound_buffer, sound_buffer_size);
+        // The fill decodes the previous data
+        FinishPCMCacheFill(g_SoundSystem, sound_data, false);
+
+        void* prev_data;
+        {
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
+            prev_data = sound_data->m_Data;
+            sound_data->m_Data = 0;
+            SetSoundDataNoLock(sound_data, sound_buffer, sound_buffer_size);
+        }
+
+        // The mixer may still be decoding the previous data
+        Command command = NewCommand(COMMAND_FREE, 0);
+        command.m_Data = prev_data;
+        PushCommand(g_SoundSystem, command);
+
+        // Instances already playing the decoded previous data keep it
+        RemoveFromPCMCache(g_SoundSystem, sound_data);
+        sound_data->m_PCMUncacheable = 0;
+        return RESULT_OK;
     }
 
     uint32_t GetSoundResourceSize(HSoundData sound_data)
@@ -526,21 +1492,21 @@ namespace dmSound
 
     Result DeleteSoundData(HSoundData sound_data)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        
-        sound_data->m_RefCount --;
-        if (sound_data->m_RefCount > 0)
+        uint16_t ref_count;
         {
-            return RESULT_OK;
+            DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
+            ref_count = --sound_data->m_RefCount;
         }
 
-        if (sound_data->m_Data != 0x0)
-            free((void*) sound_data->m_Data);
-
-        SoundSystem* sound = g_SoundSystem;
-        sound->m_SoundDataPool.Push(sound_data->m_Index);
-        sound_data->m_Index = 0xffff;
+        if (ref_count > 0)
+        {
+            return RESULT_OK;
+        }
 
+        // Deleted after the instances using it
+        FinishPCMCacheFill(g_SoundSystem, sound_data, false);
+        RemoveFromPCMCache(g_SoundSystem, sound_data);
+        PushCommand(g_SoundSystem, NewCommand(COMMAND_DELETE_SOUND_DATA, sound_data->m_Index));
         return RESULT_OK;
     }
 
@@ -559,6 +1525,16 @@ namespace dmSound
             assert(0);
         }
 
+        // Instances of decoded sounds play the PCM with the WAV decoder
+        const void* data = sound_data->m_Data;
+        uint32_t data_size = sound_data->m_Size;
+        PCMCacheEntry* pcm = GetPCMCacheEntry(ss, sound_data, codec_format);
+        if (pcm) {
+            codec_format = dmSoundCodec::FORMAT_WAV;
+            data = GetWav(pcm);
+            data_size = pcm->m_WavSize;
+        }
+
         uint16_t index;
         {
             DM_MUTEX_OPTIONAL_SCOPED_LOCK(ss->m_Mutex);
@@ -567,60 +1543,74 @@ namespace dmSound
             {
                 *sound_instance = 0;
                 dmLogError("Out of sound data instance slots (%u). Increase the project setting 'sound.max_sound_instances'", ss->m_InstancesPool.Capacity());
+                if (pcm) {
+                    pcm->m_RefCount--; // The cache still holds a reference
+                }
                 return RESULT_OUT_OF_INSTANCES;
             }
 
-            dmSoundCodec::Result r = dmSoundCodec::NewDecoder(ss->m_CodecContext, codec_format, sound_data->m_Data, sound_data->m_Size, &decoder);
+            dmSoundCodec::Result r = dmSoundCodec::NewDecoder(ss->m_CodecContext, codec_format, data, data_size, &decoder);
             if (r != dmSoundCodec::RESULT_OK) {
                 dmLogError("Failed to decode sound (%d)", r);
+                if (pcm) {
+                    pcm->m_RefCount--; // The cache still holds a reference
+                }
                 return RESULT_INVALID_STREAM_DATA;
             }
 
             index = ss->m_InstancesPool.Pop();
+            sound_data->m_RefCount ++;
         }
 
-        sound_data->m_RefCount ++;
-
         SoundInstance* si = &ss->m_Instances[index];
         assert(si->m_Index == 0xffff);
 
+        // Compressed sounds are decoded ahead on the decode workers, if enabled
+        if (codec_format == dmSoundCodec::FORMAT_VORBIS && ss->m_DecodeAheadBuffers > 0)
+        {
+            dmSoundCodec::Info info;
+            dmSoundCodec::GetInfo(ss->m_CodecContext, decoder, &info);
+            if ((info.m_BitsPerSample == 16 || info.m_BitsPerSample == 8) && (info.m_Channels == 1 || info.m_Channels == 2))
+            {
+                DecodeStream* stream = &si->m_Stream;
+                stream->m_MixSize = ss->m_FrameCount * info.m_Channels * (info.m_BitsPerSample / 8);
+                stream->m_Size = NextPowerOfTwo((ss->m_DecodeAheadBuffers + 1) * stream->m_MixSize);
+                stream->m_Buffer = (char*) malloc(stream->m_Size);
+            }
+        }
+
+        // The mixer state of the instance was reset when it was deleted
         si->m_SoundDataIndex = sound_data->m_Index;
         si->m_Index = index;
-        si->m_Gain.Reset(1.0f);
-        si->m_Pan.Reset(0.5f);
-        si->m_Looping = 0;
-        si->m_EndOfStream = 0;
-        si->m_Playing = 0;
         si->m_Decoder = decoder;
-        si->m_Group = MASTER_GROUP_HASH;
+        si->m_PCMCacheEntry = pcm;
+        SetIsPlaying(si, false);
 
         *sound_instance = si;
 
         return RESULT_OK;
     }
 
-    static void StopNoLock(SoundSystem* sound, HSoundInstance sound_instance);
-
     Result DeleteSoundInstance(HSoundInstance sound_instance)
     {
         SoundSystem* sound = g_SoundSystem;
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(sound->m_Mutex);
 
         if (IsPlaying(sound_instance))
         {
             dmLogError("Deleting playing sound instance (%s)", GetSoundName(sound, sound_instance));
-            StopNoLock(sound, sound_instance);
+            SetIsPlaying(sound_instance, false);
         }
 
-        uint16_t index = sound_instance->m_Index;
-        sound->m_InstancesPool.Push(index);
-        sound_instance->m_Index = 0xffff;
-        DeleteSoundData(&sound->m_SoundData[sound_instance->m_SoundDataIndex]);
-        sound_instance->m_SoundDataIndex = 0xffff;
-        dmSoundCodec::DeleteDecoder(sound->m_CodecContext, sound_instance->m_Decoder);
-        sound_instance->m_Decoder = 0;
-        sound_instance->m_FrameCount = 0;
-        sound_instance->m_Speed = 1.0f;
+        // The instance slot is reused once the mixer has deleted the instance
+        uint16_t sound_data_index = sound_instance->m_SoundDataIndex;
+        PCMCacheEntry* pcm = sound_instance->m_PCMCacheEntry;
+        sound_instance->m_PCMCacheEntry = 0;
+        PushCommand(sound, NewCommand(COMMAND_DELETE_INSTANCE, sound_instance->m_Index));
+        if (pcm)
+        {
+            ReleasePCMCacheEntry(sound, pcm);
+        }
+        DeleteSoundData(&sound->m_SoundData[sound_data_index]);
 
         return RESULT_OK;
     }
@@ -633,19 +1623,19 @@ namespace dmSound
 
     Result SetInstanceGroup(HSoundInstance instance, dmhash_t group_hash)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
             return RESULT_NO_SUCH_GROUP;
         }
-        instance->m_Group = group_hash;
+        Command command = NewCommand(COMMAND_SET_INSTANCE_GROUP, instance->m_Index);
+        command.m_GroupIndex = (uint16_t) *index;
+        PushCommand(sound, command);
         return RESULT_OK;
     }
 
     Result AddGroup(const char* group)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
         int index = GetOrCreateGroup(group);
         if (index == -1) {
             return RESULT_OUT_OF_GROUPS;
@@ -655,42 +1645,23 @@ namespace dmSound
 
     Result SetGroupGain(dmhash_t group_hash, float gain)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
             return RESULT_NO_SUCH_GROUP;
         }
 
-        // If all playing sounds is currently at gain zero
-        // we can safely do a hard reset of the group gain
-        bool reset = true;
-        uint32_t instances = sound->m_Instances.Size();
-        for (uint32_t i = 0; i < instances; ++i)
-        {
-            SoundInstance* instance = &sound->m_Instances[i];
-            if (instance->m_Group != group_hash)
-            {
-                continue;
-            }
-            if (instance->m_Playing || instance->m_FrameCount > 0)
-            {
-                if (instance->m_Gain.m_Prev == 0.0)
-                {
-                    continue;
-                }
-                reset = false;
-                break;
-            }
-        }
         SoundGroup* group = &sound->m_Groups[*index];
-        group->m_Gain.Set(gain, reset);
+        group->m_RequestedGain = gain;
+
+        Command command = NewCommand(COMMAND_SET_GROUP_GAIN, (uint16_t) *index);
+        command.m_Value = gain;
+        PushCommand(sound, command);
         return RESULT_OK;
     }
 
     Result GetGroupGain(dmhash_t group_hash, float* gain)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
@@ -698,13 +1669,12 @@ namespace dmSound
         }
 
         SoundGroup* group = &sound->m_Groups[*index];
-        *gain = group->m_Gain.m_Next;
+        *gain = group->m_RequestedGain;
         return RESULT_OK;
     }
 
     Result GetGroupHashes(uint32_t* count, dmhash_t* buffer)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
         SoundSystem* sound = g_SoundSystem;
         uint32_t size = sound->m_GroupMap.Size();
         assert(*count >= size);
@@ -716,10 +1686,9 @@ namespace dmSound
         return RESULT_OK;
     }
 
+    // The group meters are read while the mixer updates them, so they may be a mix buffer behind
     Result GetGroupRMS(dmhash_t group_hash, float window, float* rms_left, float* rms_right)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
@@ -750,8 +1719,6 @@ namespace dmSound
 
     Result GetGroupPeak(dmhash_t group_hash, float window, float* peak_left, float* peak_right)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-
         SoundSystem* sound = g_SoundSystem;
         int* index = sound->m_GroupMap.Get(group_hash);
         if (!index) {
@@ -780,22 +1747,17 @@ namespace dmSound
 
     Result Play(HSoundInstance sound_instance)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Playing = 1;
+        Command command = NewCommand(COMMAND_PLAY, sound_instance->m_Index);
+        command.m_Generation = SetIsPlaying(sound_instance, true);
+        PushCommand(g_SoundSystem, command);
         return RESULT_OK;
     }
 
-    static void StopNoLock(SoundSystem* sound, HSoundInstance sound_instance)
-    {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Playing = 0;
-        dmSoundCodec::Reset(sound->m_CodecContext, sound_instance->m_Decoder);
-    }
-
     Result Stop(HSoundInstance sound_instance)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        StopNoLock(g_SoundSystem, sound_instance);
+        Command command = NewCommand(COMMAND_STOP, sound_instance->m_Index);
+        command.m_Generation = SetIsPlaying(sound_instance, false);
+        PushCommand(g_SoundSystem, command);
         return RESULT_OK;
     }
 
@@ -803,8 +1765,10 @@ namespace dmSound
     {
         if (!g_SoundSystem)
             return RESULT_OK;
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Playing = (uint8_t)!pause;
+        Command command = NewCommand(COMMAND_PAUSE, sound_instance->m_Index);
+        command.m_Flag = (uint8_t) pause;
+        command.m_Generation = SetIsPlaying(sound_instance, !pause);
+        PushCommand(g_SoundSystem, command);
         return RESULT_OK;
     }
 
@@ -817,51 +1781,184 @@ namespace dmSound
        return g_SoundSystem->m_PlayCounter++;
     }
 
-    bool IsPlaying(HSoundInstance sound_instance)
+    bool IsPlaying(HSoundInstance sound_instance)
+    {
+        return (dmAtomicGet32(&sound_instance->m_IsPlaying) & 1) != 0; // && !sound_instance->m_EndOfStream;
+    }
+
+    Result SetLooping(HSoundInstance sound_instance, bool looping, int8_t loopcounter)
+    {
+        Command command = NewCommand(COMMAND_SET_LOOPING, sound_instance->m_Index);
+        command.m_Flag = (uint8_t) looping;
+        command.m_LoopCounter = loopcounter;
+        PushCommand(g_SoundSystem, command);
+        return RESULT_OK;
+    }
+
+    Result SetPriority(HSoundInstance sound_instance, uint8_t priority)
+    {
+        Command command = NewCommand(COMMAND_SET_PRIORITY, sound_instance->m_Index);
+        command.m_Flag = priority;
+        PushCommand(g_SoundSystem, command);
+        return RESULT_OK;
+    }
+
+    Result SetParameter(HSoundInstance sound_instance, Parameter parameter, const Vector4& value)
+    {
+        float v = value.getX();
+        switch(parameter)
+        {
+            case PARAMETER_GAIN:
+                v = dmMath::Max(0.0f, v);
+                break;
+            case PARAMETER_PAN:
+                v = dmMath::Max(-1.0f, dmMath::Min(1.0f, v));
+                v = (v + 1.0f) * 0.5f; // map [-1,1] to [0,1] for easier calculations later
+                break;
+            case PARAMETER_SPEED:
+                v = dmMath::Max(0.0f, dmMath::Min((float)SOUND_MAX_SPEED, v));
+                break;
+            default:
+                dmLogError("Invalid parameter: %d (%s)\n", parameter, GetSoundName(g_SoundSystem, sound_instance));
+                return RESULT_INVALID_PROPERTY;
+        }
+
+        Command command = NewCommand(COMMAND_SET_PARAMETER, sound_instance->m_Index);
+        command.m_Parameter = (uint8_t) parameter;
+        command.m_Value = v;
+        PushCommand(g_SoundSystem, command);
+        return RESULT_OK;
+    }
+
+    static inline void GetPanScale(float pan, float* left_scale, float* right_scale)
+    {
+        // Constant power panning: https://www.cs.cmu.edu/~music/icm-online/readings/panlaws/index.html
+        const float theta = pan * M_PI_2;
+        *left_scale = cosf(theta);
+        *right_scale = sinf(theta);
+    }
+
+    // Values of a Ramp for two interleaved stereo frames, [v(i), v(i), v(i+1), v(i+1)], and the step to the next two frames
+    static inline void GetRampValues(const Ramp& ramp, dmSIMD::Vec4f* value, dmSIMD::Vec4f* step)
+    {
+        const float frame_step = (ramp.m_To - ramp.m_From) * ramp.m_TotalSamplesRecip;
+        const float v[4] = { ramp.m_From, ramp.m_From, ramp.m_From + frame_step, ramp.m_From + frame_step };
+        *value = dmSIMD::Load(v);
+        *step = dmSIMD::Set1(2.0f * frame_step);
+    }
+
+    // Number of frames per pan ramp segment. Must be even, since the frames are mixed two at a time.
+    static const uint32_t PAN_RAMP_SEGMENT_FRAMES = 32;
+    // Largest pan angle (radians) covered by a segment, i.e. a power dip of at most 20*log10(cos(0.25/2)) ~= -0.07 dB
+    static const float PAN_RAMP_SEGMENT_MAX_ANGLE = 0.25f;
+
+    /**
+     * Ramped gain and pan scales for two interleaved stereo frames at a time, i.e. the lanes are
+     * [left(i), right(i), left(i+1), right(i+1)]. During a pan ramp, the pan law is evaluated at the
+     * ends of short segments (PAN_RAMP_SEGMENT_FRAMES frames, or less if the ramp covers a large
+     * angle), and the scales are interpolated linearly within each segment. The scales are then
+     * on a chord of at most PAN_RAMP_SEGMENT_MAX_ANGLE radians, so the power stays within ~0.1 dB
+     * of the pan law (see the PanRamp test). With constant pan this matches the pan law.
+     */
+    struct StereoRamp
+    {
+        dmSIMD::Vec4f m_Gain;
+        dmSIMD::Vec4f m_GainStep;
+        dmSIMD::Vec4f m_Pan;
+        dmSIMD::Vec4f m_PanStep;
+        float         m_PanFrom;        // Pan at the start of the next segment
+        float         m_PanFrameStep;   // Pan change per frame
+        uint32_t      m_SegmentFrames;
+        uint32_t      m_SegmentLeft;    // Calls to Next() left in the current segment
+
+        StereoRamp(const Ramp& gain, const Ramp& pan)
+        {
+            GetRampValues(gain, &m_Gain, &m_GainStep);
+
+            m_PanFrom = pan.m_From;
+            m_PanFrameStep = (pan.m_To - pan.m_From) * pan.m_TotalSamplesRecip;
+            if (m_PanFrameStep == 0.0f)
+            {
+                float left, right;
+                GetPanScale(pan.m_From, &left, &right);
+                const float p[4] = { left, right, left, right };
+                m_Pan = dmSIMD::Load(p);
+                m_PanStep = dmSIMD::Set1(0.0f);
+                m_SegmentFrames = 0;
+                m_SegmentLeft = 0xFFFFFFFF;
+                return;
+            }
+
+            m_SegmentFrames = PAN_RAMP_SEGMENT_FRAMES;
+            const float frame_angle = fabsf(m_PanFrameStep) * (float) M_PI_2;
+            if (frame_angle * m_SegmentFrames > PAN_RAMP_SEGMENT_MAX_ANGLE)
+            {
+                m_SegmentFrames = dmMath::Max(2U, (uint32_t) (PAN_RAMP_SEGMENT_MAX_ANGLE / frame_angle) & ~1U);
+            }
+            NextPanSegment();
+        }
+
+        // Evaluates the pan law at the ends of the next segment, and interpolates between them
+        void NextPanSegment()
+        {
+            const float pan_to = m_PanFrom + m_PanFrameStep * m_SegmentFrames;
+
+            float left_from, right_from, left_to, right_to;
+            GetPanScale(m_PanFrom, &left_from, &right_from);
+            GetPanScale(pan_to, &left_to, &right_to);
+            const float recip = 1.0f / m_SegmentFrames;
+            const float left_step = (left_to - left_from) * recip;
+            const float right_step = (right_to - right_from) * recip;
+
+            const float p[4] = { left_from, right_from, left_from + left_step, right_from + right_step };
+            const float ps[4] = { 2.0f * left_step, 2.0f * right_step, 2.0f * left_step, 2.0f * right_step };
+            m_Pan = dmSIMD::Load(p);
+            m_PanStep = dmSIMD::Load(ps);
+
+            m_PanFrom = pan_to;
+            m_SegmentLeft = m_SegmentFrames / 2;
+        }
+
+        // Returns the scales for the next two frames
+        inline dmSIMD::Vec4f Next()
+        {
+            dmSIMD::Vec4f scale = dmSIMD::Mul(m_Gain, m_Pan);
+            m_Gain = dmSIMD::Add(m_Gain, m_GainStep);
+            m_Pan = dmSIMD::Add(m_Pan, m_PanStep);
+            if (--m_SegmentLeft == 0)
+                NextPanSegment();
+            return scale;
+        }
+    };
+
+    // Adds two interleaved stereo frames, scaled by the ramp, to the mix buffer
+    static inline void MixFrames(float* mix_buffer, dmSIMD::Vec4f frames, StereoRamp& ramp)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        return sound_instance->m_Playing; // && !sound_instance->m_EndOfStream;
+        dmSIMD::Store(mix_buffer, dmSIMD::MulAdd(frames, ramp.Next(), dmSIMD::Load(mix_buffer)));
     }
 
-    Result SetLooping(HSoundInstance sound_instance, bool looping, int8_t loopcounter)
+    // Adds a single frame, used for the last frame when the frame count is odd
+    static inline void MixFrame(float* mix_buffer, float left, float right, StereoRamp& ramp)
     {
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-        sound_instance->m_Looping = (uint32_t) looping;
-        sound_instance->m_Loopcounter = loopcounter;
-        return RESULT_OK;
+        float scale[4];
+        dmSIMD::Store(scale, ramp.Next());
+        mix_buffer[0] += left * scale[0];
+        mix_buffer[1] += right * scale[1];
     }
 
-    Result SetParameter(HSoundInstance sound_instance, Parameter parameter, const Vector4& value)
+    // a + (b - a) * t, per lane
+    static inline dmSIMD::Vec4f Lerp(const float* a, const float* b, const float* t)
     {
-        bool reset = !sound_instance->m_Playing;
-        switch(parameter)
-        {
-            case PARAMETER_GAIN:
-                sound_instance->m_Gain.Set(dmMath::Max(0.0f, value.getX()), reset);
-                break;
-            case PARAMETER_PAN:
-                {
-                    float pan = dmMath::Max(-1.0f, dmMath::Min(1.0f, value.getX()));
-                    pan = (pan + 1.0f) * 0.5f; // map [-1,1] to [0,1] for easier calculations later
-                    sound_instance->m_Pan.Set(pan, reset);
-                }
-                break;
-            case PARAMETER_SPEED:
-                sound_instance->m_Speed = dmMath::Max(0.0f, dmMath::Min((float)SOUND_MAX_SPEED, value.getX()));
-                break;
-            default:
-                dmLogError("Invalid parameter: %d (%s)\n", parameter, GetSoundName(g_SoundSystem, sound_instance));
-                return RESULT_INVALID_PROPERTY;
-        }
-        return RESULT_OK;
+        dmSIMD::Vec4f va = dmSIMD::Load(a);
+        return dmSIMD::MulAdd(dmSIMD::Sub(dmSIMD::Load(b), va), dmSIMD::Load(t), va);
     }
 
-    static inline void GetPanScale(float pan, float* left_scale, float* right_scale)
+    // Advances the fixed point read position of the resamplers one output frame
+    static inline void StepFrame(uint64_t delta, uint64_t* frac, uint32_t* index)
     {
-        // Constant power panning: https://www.cs.cmu.edu/~music/icm-online/readings/panlaws/index.html
-        const float theta = pan * M_PI_2;
-        *left_scale = cosf(theta);
-        *right_scale = sinf(theta);
+        *frac += delta;
+        *index += (uint32_t)(*frac >> RESAMPLE_FRACTION_BITS);
+        *frac &= ((1U << RESAMPLE_FRACTION_BITS) - 1U); // Keep lower RESAMPLE_FRACTION_BITS bits. Clear higher.
     }
 
     /*
@@ -873,6 +1970,16 @@ namespace dmSound
      * scale: changes the scale of the samples when mixed by multiplying their values with the 'scale' template param.
      */
     template <typename T, int offset, int scale>
+    static inline float ToFloat(T s)
+    {
+        return (float) ((s - offset) * scale);
+    }
+
+    /*
+     * The mixers process two output frames per iteration. The source samples are gathered (and converted) to
+     * interleaved stereo lanes, and then interpolated, scaled and accumulated four lanes at a time.
+     */
+    template <typename T, int offset, int scale>
     static void MixResampleUpMono(const MixContext* mix_context, SoundInstance* instance, uint32_t rate, uint32_t mix_rate, float* mix_buffer, uint32_t mix_buffer_count)
     {
         const uint32_t mask = (1U << RESAMPLE_FRACTION_BITS) - 1U;
@@ -890,31 +1997,34 @@ namespace dmSound
         // We never overfetch for identity mixing as identity mixing is a special case
         frames[instance->m_FrameCount] = frames[instance->m_FrameCount-1];
 
-        Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
-        Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
-        {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
-            float mix = frac * range_recip; // determines the bias between two consecutive samples in the sound instance. It ranges from 0-1. A mix of 0, makes only the first sample count while a mix of 0.5 will count equally both samples.
-            T s1 = frames[index];
-            T s2 = frames[index + 1];
-            s1 = (s1 - offset) * scale;
-            s2 = (s2 - offset) * scale;
-
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
+        StereoRamp ramp(GetRamp(mix_context, &instance->m_Gain, mix_buffer_count), GetRamp(mix_context, &instance->m_Pan, mix_buffer_count));
 
-            float s = (1.0f - mix) * s1 + mix * s2; // resulting destination sample value is a mix of two source samples since a kind of fractional indexing is used
-            mix_buffer[2 * i] += s * gain * left_scale;
-            mix_buffer[2 * i + 1] += s * gain * right_scale;
-
-            prev_index = index; // keep old index for assertion
-            frac += delta;
+        uint32_t i = 0;
+        for (; i + 1 < mix_buffer_count; i += 2)
+        {
+            float s1[4], s2[4], mix[4];
+            for (uint32_t j = 0; j < 4; j += 2)
+            {
+                s1[j] = s1[j + 1] = ToFloat<T, offset, scale>(frames[index]);
+                s2[j] = s2[j + 1] = ToFloat<T, offset, scale>(frames[index + 1]);
+                mix[j] = mix[j + 1] = frac * range_recip; // determines the bias between two consecutive samples in the sound instance. It ranges from 0-1. A mix of 0, makes only the first sample count while a mix of 0.5 will count equally both samples.
 
-            index += (uint32_t)(frac >> RESAMPLE_FRACTION_BITS);
+                prev_index = index; // keep old index for assertion
+                StepFrame(delta, &frac, &index);
+            }
+            // resulting destination sample value is a mix of two source samples since a kind of fractional indexing is used
+            MixFrames(mix_buffer + 2 * i, Lerp(s1, s2, mix), ramp);
+        }
+        if (i < mix_buffer_count)
+        {
+            float mix = frac * range_recip;
+            float s1 = ToFloat<T, offset, scale>(frames[index]);
+            float s2 = ToFloat<T, offset, scale>(frames[index + 1]);
+            float s = (1.0f - mix) * s1 + mix * s2;
+            MixFrame(mix_buffer + 2 * i, s, s, ramp);
 
-            frac &= ((1U << RESAMPLE_FRACTION_BITS) - 1U); // Keep lower RESAMPLE_FRACTION_BITS bits. Clear higher.
+            prev_index = index;
+            StepFrame(delta, &frac, &index);
         }
         instance->m_FrameFraction = frac;
 
@@ -945,36 +2055,34 @@ namespace dmSound
         frames[2 * instance->m_FrameCount] = frames[2 * instance->m_FrameCount - 2];
         frames[2 * instance->m_FrameCount + 1] = frames[2 * instance->m_FrameCount - 1];
 
-        Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
-        Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
+        StereoRamp ramp(GetRamp(mix_context, &instance->m_Gain, mix_buffer_count), GetRamp(mix_context, &instance->m_Pan, mix_buffer_count));
+
+        uint32_t i = 0;
+        for (; i + 1 < mix_buffer_count; i += 2)
+        {
+            float s1[4], s2[4], mix[4];
+            for (uint32_t j = 0; j < 4; j += 2)
+            {
+                s1[j]     = ToFloat<T, offset, scale>(frames[2 * index]);
+                s1[j + 1] = ToFloat<T, offset, scale>(frames[2 * index + 1]);
+                s2[j]     = ToFloat<T, offset, scale>(frames[2 * index + 2]);
+                s2[j + 1] = ToFloat<T, offset, scale>(frames[2 * index + 3]);
+                mix[j] = mix[j + 1] = frac * range_recip;
+
+                prev_index = index;
+                StepFrame(delta, &frac, &index);
+            }
+            MixFrames(mix_buffer + 2 * i, Lerp(s1, s2, mix), ramp);
+        }
+        if (i < mix_buffer_count)
         {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
             float mix = frac * range_recip;
-            T sl1 = frames[2 * index];
-            T sl2 = frames[2 * index + 2];
-            sl1 = (sl1 - offset) * scale;
-            sl2 = (sl2 - offset) * scale;
-
-            T sr1 = frames[2 * index + 1];
-            T sr2 = frames[2 * index + 3];
-            sr1 = (sr1 - offset) * scale;
-            sr2 = (sr2 - offset) * scale;
-
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
-
-            float sl = (1.0f - mix) * sl1 + mix * sl2;
-            float sr = (1.0f - mix) * sr1 + mix * sr2;
-            mix_buffer[2 * i]       += sl * gain * left_scale;
-            mix_buffer[2 * i + 1]   += sr * gain * right_scale;
+            float sl = (1.0f - mix) * ToFloat<T, offset, scale>(frames[2 * index]) + mix * ToFloat<T, offset, scale>(frames[2 * index + 2]);
+            float sr = (1.0f - mix) * ToFloat<T, offset, scale>(frames[2 * index + 1]) + mix * ToFloat<T, offset, scale>(frames[2 * index + 3]);
+            MixFrame(mix_buffer + 2 * i, sl, sr, ramp);
 
             prev_index = index;
-            frac += delta;
-            index += (uint32_t)(frac >> RESAMPLE_FRACTION_BITS);
-
-            frac &= ((1U << RESAMPLE_FRACTION_BITS) - 1U);
+            StepFrame(delta, &frac, &index);
         }
         instance->m_FrameFraction = frac;
 
@@ -991,20 +2099,20 @@ namespace dmSound
         (void)mix_rate;
         assert(instance->m_FrameCount == mix_buffer_count);
         T* frames = (T*) instance->m_Frames;
-        Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
-        Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
+        StereoRamp ramp(GetRamp(mix_context, &instance->m_Gain, mix_buffer_count), GetRamp(mix_context, &instance->m_Pan, mix_buffer_count));
 
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
+        uint32_t i = 0;
+        for (; i + 1 < mix_buffer_count; i += 2)
         {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
-            float s = frames[i];
-            s = (s - offset) * scale * gain;
-
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
-            mix_buffer[2 * i]       += s * left_scale;
-            mix_buffer[2 * i + 1]   += s * right_scale;
+            float s[4];
+            s[0] = s[1] = ToFloat<T, offset, scale>(frames[i]);
+            s[2] = s[3] = ToFloat<T, offset, scale>(frames[i + 1]);
+            MixFrames(mix_buffer + 2 * i, dmSIMD::Load(s), ramp);
+        }
+        if (i < mix_buffer_count)
+        {
+            float s = ToFloat<T, offset, scale>(frames[i]);
+            MixFrame(mix_buffer + 2 * i, s, s, ramp);
         }
         instance->m_FrameCount -= mix_buffer_count;
     }
@@ -1016,22 +2124,21 @@ namespace dmSound
         (void)mix_rate;
         assert(instance->m_FrameCount == mix_buffer_count);
         T* frames = (T*) instance->m_Frames;
-        Ramp gain_ramp = GetRamp(mix_context, &instance->m_Gain, mix_buffer_count);
-        Ramp pan_ramp = GetRamp(mix_context, &instance->m_Pan, mix_buffer_count);
+        StereoRamp ramp(GetRamp(mix_context, &instance->m_Gain, mix_buffer_count), GetRamp(mix_context, &instance->m_Pan, mix_buffer_count));
 
-        for (uint32_t i = 0; i < mix_buffer_count; i++)
+        uint32_t i = 0;
+        for (; i + 1 < mix_buffer_count; i += 2)
         {
-            float gain = gain_ramp.GetValue(i);
-            float pan = pan_ramp.GetValue(i);
-            float s1 = frames[2 * i];
-            float s2 = frames[2 * i + 1];
-            s1 = (s1 - offset) * scale * gain;
-            s2 = (s2 - offset) * scale * gain;
-
-            float left_scale, right_scale;
-            GetPanScale(pan, &left_scale, &right_scale);
-            mix_buffer[2 * i]       += s1 * left_scale;
-            mix_buffer[2 * i + 1]   += s2 * right_scale;
+            float s[4];
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                s[j] = ToFloat<T, offset, scale>(frames[2 * i + j]);
+            }
+            MixFrames(mix_buffer + 2 * i, dmSIMD::Load(s), ramp);
+        }
+        if (i < mix_buffer_count)
+        {
+            MixFrame(mix_buffer + 2 * i, ToFloat<T, offset, scale>(frames[2 * i]), ToFloat<T, offset, scale>(frames[2 * i + 1]), ramp);
         }
         instance->m_FrameCount -= mix_buffer_count;
     }
@@ -1098,23 +2205,52 @@ namespace dmSound
         mixer(mix_context, instance, rate, mix_rate, mix_buffer, mix_buffer_count);
     }
 
-    static void Mix(const MixContext* mix_context, SoundInstance* instance, const dmSoundCodec::Info* info)
+    // Number of mix buffer frames the buffered frames of the instance cover, at most one mix buffer
+    static uint32_t GetMixCount(SoundSystem* sound, SoundInstance* instance, const dmSoundCodec::Info* info)
     {
-        DM_PROFILE(__FUNCTION__);
-
-        SoundSystem* sound = g_SoundSystem;
         uint64_t delta = (uint32_t) ((((uint64_t) info->m_Rate) << RESAMPLE_FRACTION_BITS) / sound->m_MixRate);
         uint32_t mix_count = ((uint64_t) (instance->m_FrameCount) << RESAMPLE_FRACTION_BITS) / (delta * instance->m_Speed);
         mix_count = dmMath::Min(mix_count, sound->m_FrameCount);
         assert(mix_count <= sound->m_FrameCount);
+        return mix_count;
+    }
 
-        int* index = sound->m_GroupMap.Get(instance->m_Group);
-        if (index) {
-            SoundGroup* group = &sound->m_Groups[*index];
-            MixResample(mix_context, instance, info, sound->m_MixRate, group->m_MixBuffer, mix_count);
-        } else {
-            dmLogError("Sound group not found");
+    static void Mix(const MixContext* mix_context, SoundInstance* instance, const dmSoundCodec::Info* info)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        SoundSystem* sound = g_SoundSystem;
+        uint32_t mix_count = GetMixCount(sound, instance, info);
+
+        SoundGroup* group = &sound->m_Groups[instance->m_GroupIndex];
+        MixResample(mix_context, instance, info, sound->m_MixRate, group->m_MixBuffer, mix_count);
+    }
+
+    // Consumes the frames of a virtual instance that Mix() would have, without mixing them
+    static void SkipMix(SoundInstance* instance, const dmSoundCodec::Info* info)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        if (instance->m_Speed == 0.0f)
+        {
+            return;
+        }
+
+        uint32_t mix_count = GetMixCount(sound, instance, info);
+        uint32_t index = mix_count;
+        if (info->m_Rate != sound->m_MixRate || instance->m_Speed != 1.0f)
+        {
+            // Same fixed point stepping as the resamplers
+            uint64_t delta = (((uint64_t) info->m_Rate) << RESAMPLE_FRACTION_BITS) / sound->m_MixRate;
+            delta *= instance->m_Speed;
+            uint64_t frac = instance->m_FrameFraction + delta * mix_count;
+            index = (uint32_t) (frac >> RESAMPLE_FRACTION_BITS);
+            instance->m_FrameFraction = frac & ((1U << RESAMPLE_FRACTION_BITS) - 1U);
         }
+
+        assert(instance->m_FrameCount >= index);
+        const uint32_t stride = info->m_Channels * (info->m_BitsPerSample / 8);
+        memmove(instance->m_Frames, (char*) instance->m_Frames + index * stride, (instance->m_FrameCount - index) * stride);
+        instance->m_FrameCount -= index;
     }
 
     static bool IsMuted(SoundInstance* instance) {
@@ -1128,28 +2264,164 @@ namespace dmSound
             return true;
         }
 
-        int* group_index = sound->m_GroupMap.Get(instance->m_Group);
-        if (group_index != NULL) {
-            SoundGroup* group = &sound->m_Groups[*group_index];
-            if (group->m_Gain.IsZero()) {
-                return true;
+        SoundGroup* group = &sound->m_Groups[instance->m_GroupIndex];
+        if (group->m_Gain.IsZero()) {
+            return true;
+        }
+
+        SoundGroup* master = &sound->m_Groups[MASTER_GROUP_INDEX];
+        if (master->m_Gain.IsZero()) {
+            return true;
+        }
+
+        return false;
+    }
+
+    // Decodes frames after the buffered ones. Virtual instances skip them in the decoder instead
+    static dmSoundCodec::Result DecodeOrSkip(SoundSystem* sound, SoundInstance* instance, uint32_t stride, uint32_t frame_count, uint32_t* decoded)
+    {
+        char* out = ((char*) instance->m_Frames) + instance->m_FrameCount * stride;
+        uint32_t size = (frame_count - instance->m_FrameCount) * stride;
+        if (!instance->m_Virtual)
+        {
+            return dmSoundCodec::Decode(sound->m_CodecContext, instance->m_Decoder, out, size, decoded);
+        }
+        // Skipped frames are silent, in case the instance becomes real before they're consumed
+        memset(out, 0x00, size);
+        return dmSoundCodec::Skip(sound->m_CodecContext, instance->m_Decoder, size, decoded);
+    }
+
+    // Fills the instance with frame_count frames from the decoder, restarting it if the instance loops
+    static dmSoundCodec::Result DecodeFrames(SoundSystem* sound, SoundInstance* instance, uint32_t stride, uint32_t frame_count)
+    {
+        uint32_t decoded = 0;
+        dmSoundCodec::Result r = DecodeOrSkip(sound, instance, stride, frame_count, &decoded);
+
+        assert(decoded % stride == 0);
+        instance->m_FrameCount += decoded / stride;
+
+        if (instance->m_FrameCount < frame_count) {
+
+            if (instance->m_Looping && instance->m_Loopcounter != 0) {
+                dmSoundCodec::Reset(sound->m_CodecContext, instance->m_Decoder);
+                if ( instance->m_Loopcounter > 0 ) {
+                    instance->m_Loopcounter --;
+                }
+
+                r = DecodeOrSkip(sound, instance, stride, frame_count, &decoded);
+
+                assert(decoded % stride == 0);
+                instance->m_FrameCount += decoded / stride;
+
+            } else {
+
+                if  (instance->m_FrameCount < instance->m_Speed) {
+                    // since this is the last mix and no more frames will be added, trailing frames will linger on forever
+                    // if they are less than m_Speed. We will truncate them to avoid this.
+                    instance->m_FrameCount = 0;
+                }
+                instance->m_EndOfStream = 1;
+            }
+        }
+        return r;
+    }
+
+    // Reads frames decoded ahead by the decode jobs. If they haven't kept up, the rest is decoded on the mixer
+    static dmSoundCodec::Result ReadDecodedFrames(SoundSystem* sound, SoundInstance* instance, uint32_t stride, uint32_t frame_count)
+    {
+        DecodeStream* stream = &instance->m_Stream;
+        char* frames = (char*) instance->m_Frames;
+        uint32_t size = (frame_count - instance->m_FrameCount) * stride;
+        uint32_t read = ReadStream(stream, frames + instance->m_FrameCount * stride, size);
+
+        bool underrun = false;
+        while (read < size)
+        {
+            if (IsDecodePending(stream))
+            {
+                underrun = true;
+                WaitForDecode(sound, instance);
+            }
+
+            dmSoundCodec::Result r = CollectDecodeResult(instance);
+            if (r != dmSoundCodec::RESULT_OK)
+            {
+                return r;
+            }
+
+            uint32_t n = ReadStream(stream, frames + instance->m_FrameCount * stride + read, size - read);
+            if (n == 0)
+            {
+                if (stream->m_EndOfStream)
+                {
+                    break;
+                }
+                underrun = true;
+                stream->m_LoopCount = instance->m_Looping ? instance->m_Loopcounter : 0;
+                DecodeJob(sound, instance);
             }
+            read += n;
+        }
+
+        if (underrun && stream->m_Primed)
+        {
+            dmAtomicIncrement32(&sound->m_DecodeUnderrunCount);
+            dmAtomicIncrement32(&sound->m_DecodeUnderrunTotal);
         }
 
-        int* master_index = sound->m_GroupMap.Get(MASTER_GROUP_HASH);
-        if (master_index != NULL) {
-            SoundGroup* master = &sound->m_Groups[*master_index];
-            if (master->m_Gain.IsZero()) {
-                return true;
+        assert(read % stride == 0);
+        instance->m_FrameCount += read / stride;
+        stream->m_Primed = 1;
+
+        if (read < size)
+        {
+            if (instance->m_FrameCount < instance->m_Speed) {
+                // since this is the last mix and no more frames will be added, trailing frames will linger on forever
+                // if they are less than m_Speed. We will truncate them to avoid this.
+                instance->m_FrameCount = 0;
             }
+            instance->m_EndOfStream = 1;
         }
+        return dmSoundCodec::RESULT_OK;
+    }
 
-        return false;
+    // Virtual instances use up the frames already decoded ahead, and then skip in the decoder. No new decode jobs
+    // are started until the instance is real again
+    static dmSoundCodec::Result SkipDecodedFrames(SoundSystem* sound, SoundInstance* instance, uint32_t stride, uint32_t frame_count)
+    {
+        DecodeStream* stream = &instance->m_Stream;
+        WaitForDecode(sound, instance);
+        dmSoundCodec::Result r = CollectDecodeResult(instance);
+        if (r != dmSoundCodec::RESULT_OK)
+        {
+            return r;
+        }
+
+        uint32_t size = (frame_count - instance->m_FrameCount) * stride;
+        uint32_t read = ReadStream(stream, (char*) instance->m_Frames + instance->m_FrameCount * stride, size);
+        assert(read % stride == 0);
+        instance->m_FrameCount += read / stride;
+        // Decoding on the mixer when the instance becomes real isn't an underrun
+        stream->m_Primed = 0;
+
+        if (read == size)
+        {
+            return dmSoundCodec::RESULT_OK;
+        }
+        if (!stream->m_EndOfStream)
+        {
+            return DecodeFrames(sound, instance, stride, frame_count);
+        }
+
+        if (instance->m_FrameCount < instance->m_Speed) {
+            instance->m_FrameCount = 0;
+        }
+        instance->m_EndOfStream = 1;
+        return dmSoundCodec::RESULT_OK;
     }
 
     static void MixInstance(const MixContext* mix_context, SoundInstance* instance) {
         SoundSystem* sound = g_SoundSystem;
-        uint32_t decoded = 0;
 
         dmSoundCodec::Info info;
         dmSoundCodec::GetInfo(sound->m_CodecContext, instance->m_Decoder, &info);
@@ -1157,89 +2429,48 @@ namespace dmSound
         bool correct_num_channels = info.m_Channels == 1 || info.m_Channels == 2;
         if (!correct_bit_depth || !correct_num_channels) {
             dmLogError("Only mono/stereo with 8/16 bits per sample is supported (%s): %u bpp %u ch", GetSoundName(sound, instance), (uint32_t)info.m_BitsPerSample, (uint32_t)info.m_Channels);
-            instance->m_Playing = 0;
+            EndInstance(instance);
             return;
         }
 
         if (info.m_Rate > sound->m_MixRate) {
             dmLogError("Sounds with rate higher than sample-rate not supported (%d hz > %d hz) (%s)", info.m_Rate, sound->m_MixRate, GetSoundName(sound, instance));
-            instance->m_Playing = 0;
+            EndInstance(instance);
             return;
         }
 
-        bool is_muted = dmSound::IsMuted(instance);
-
         dmSoundCodec::Result r = dmSoundCodec::RESULT_OK;
         uint32_t mixed_instance_FrameCount = ceilf(sound->m_FrameCount * dmMath::Max(1.0f, instance->m_Speed));
 
         if (instance->m_FrameCount < mixed_instance_FrameCount && instance->m_Playing) {
-
+            // if the result contains a fractional part and we don't ceil(), we'll end up with a smaller number. Later, when deciding the mix_count in Mix(), a smaller value (integer) will be produced. This will result in leaving a small gap in the mix buffer resulting in sound crackling when the chunk changes.
             const uint32_t stride = info.m_Channels * (info.m_BitsPerSample / 8);
-            uint32_t n = mixed_instance_FrameCount - instance->m_FrameCount; // if the result contains a fractional part and we don't ceil(), we'll end up with a smaller number. Later, when deciding the mix_count in Mix(), a smaller value (integer) will be produced. This will result in leaving a small gap in the mix buffer resulting in sound crackling when the chunk changes.
-
-            if (!is_muted)
-            {
-                r = dmSoundCodec::Decode(sound->m_CodecContext,
-                                         instance->m_Decoder,
-                                         ((char*) instance->m_Frames) + instance->m_FrameCount * stride,
-                                         n * stride,
-                                         &decoded);
-            }
-            else
-            {
-                r = dmSoundCodec::Skip(sound->m_CodecContext, instance->m_Decoder, n * stride, &decoded);
-                memset(((char*) instance->m_Frames) + instance->m_FrameCount * stride, 0x00, n * stride);
-            }
-
-            assert(decoded % stride == 0);
-            instance->m_FrameCount += decoded / stride;
-
-            if (instance->m_FrameCount < mixed_instance_FrameCount) {
-
-                if (instance->m_Looping && instance->m_Loopcounter != 0) {
-                    dmSoundCodec::Reset(sound->m_CodecContext, instance->m_Decoder);
-                    if ( instance->m_Loopcounter > 0 ) {
-                        instance->m_Loopcounter --;
-                    }
-
-                    uint32_t n = mixed_instance_FrameCount - instance->m_FrameCount;
-                    if (!is_muted)
-                    {
-                        r = dmSoundCodec::Decode(sound->m_CodecContext,
-                                                 instance->m_Decoder,
-                                                 ((char*) instance->m_Frames) + instance->m_FrameCount * stride,
-                                                 n * stride,
-                                                 &decoded);
-                    }
-                    else
-                    {
-                        r = dmSoundCodec::Skip(sound->m_CodecContext, instance->m_Decoder, n * stride, &decoded);
-                        memset(((char*) instance->m_Frames) + instance->m_FrameCount * stride, 0x00, n * stride);
-                    }
-
-                    assert(decoded % stride == 0);
-                    instance->m_FrameCount += decoded / stride;
-
-                } else {
-
-                    if  (instance->m_FrameCount < instance->m_Speed) {
-                        // since this is the last mix and no more frames will be added, trailing frames will linger on forever
-                        // if they are less than m_Speed. We will truncate them to avoid this.
-                        instance->m_FrameCount = 0;
-                    }
-                    instance->m_EndOfStream = 1;
-                }
+            if (!instance->m_Stream.m_Buffer) {
+                r = DecodeFrames(sound, instance, stride, mixed_instance_FrameCount);
+            } else if (instance->m_Virtual) {
+                r = SkipDecodedFrames(sound, instance, stride, mixed_instance_FrameCount);
+            } else {
+                r = ReadDecodedFrames(sound, instance, stride, mixed_instance_FrameCount);
             }
         }
 
         if (r != dmSoundCodec::RESULT_OK) {
             dmLogWarning("Unable to decode file '%s'. Result %d", GetSoundName(sound, instance), r);
-            instance->m_Playing = 0;
+            EndInstance(instance);
             return;
         }
 
-        if (instance->m_FrameCount > 0)
-            Mix(mix_context, instance, &info);
+        if (instance->m_FrameCount > 0) {
+            if (instance->m_Virtual)
+                SkipMix(instance, &info);
+            else
+                Mix(mix_context, instance, &info);
+        }
+
+        if (instance->m_Stream.m_Buffer && !instance->m_Virtual)
+        {
+            ScheduleDecode(sound, instance);
+        }
 
         if (instance->m_FrameCount <= 1 && instance->m_EndOfStream) {
             // NOTE: Due to round-off errors, e.g 32000 -> 44100,
@@ -1249,6 +2480,39 @@ namespace dmSound
         }
     }
 
+    // Sum of squares and largest square of the left and right channels in an interleaved stereo buffer
+    static void GetSquaredLevels(const float* buffer, uint32_t frame_count, float sum_sq[2], float max_sq[2])
+    {
+        dmSIMD::Vec4f sum = dmSIMD::Zero();
+        dmSIMD::Vec4f peak = dmSIMD::Zero();
+        uint32_t i = 0;
+        for (; i + 1 < frame_count; i += 2)
+        {
+            dmSIMD::Vec4f v = dmSIMD::Load(buffer + 2 * i);
+            dmSIMD::Vec4f sq = dmSIMD::Mul(v, v);
+            sum = dmSIMD::Add(sum, sq);
+            peak = dmSIMD::Max(peak, sq);
+        }
+
+        float s[4], p[4];
+        dmSIMD::Store(s, sum);
+        dmSIMD::Store(p, peak);
+        sum_sq[0] = s[0] + s[2];
+        sum_sq[1] = s[1] + s[3];
+        max_sq[0] = dmMath::Max(p[0], p[2]);
+        max_sq[1] = dmMath::Max(p[1], p[3]);
+
+        if (i < frame_count)
+        {
+            float left_sq = buffer[2 * i] * buffer[2 * i];
+            float right_sq = buffer[2 * i + 1] * buffer[2 * i + 1];
+            sum_sq[0] += left_sq;
+            sum_sq[1] += right_sq;
+            max_sq[0] = dmMath::Max(max_sq[0], left_sq);
+            max_sq[1] = dmMath::Max(max_sq[1], right_sq);
+        }
+    }
+
     static void MixInstances(const MixContext* mix_context)
     {
         DM_PROFILE(__FUNCTION__);
@@ -1258,28 +2522,16 @@ namespace dmSound
             SoundGroup* g = &sound->m_Groups[i];
 
             if (g->m_MixBuffer) {
-                uint32_t frame_count = sound->m_FrameCount;
-                float sum_sq_left = 0;
-                float sum_sq_right = 0;
-                float max_sq_left = 0;
-                float max_sq_right = 0;
-                for (uint32_t j = 0; j < frame_count; j++) {
-
-                    float gain = g->m_Gain.m_Current;
-
-                    float left = g->m_MixBuffer[2 * j + 0] * gain;
-                    float right = g->m_MixBuffer[2 * j + 1] * gain;
-                    float left_sq = left * left;
-                    float right_sq = right * right;
-                    sum_sq_left += left_sq;
-                    sum_sq_right += right_sq;
-                    max_sq_left = dmMath::Max(max_sq_left, left_sq);
-                    max_sq_right = dmMath::Max(max_sq_right, right_sq);
-                }
-                g->m_SumSquaredMemory[2 * g->m_NextMemorySlot + 0] = sum_sq_left;
-                g->m_SumSquaredMemory[2 * g->m_NextMemorySlot + 1] = sum_sq_right;
-                g->m_PeakMemorySq[2 * g->m_NextMemorySlot + 0] = max_sq_left;
-                g->m_PeakMemorySq[2 * g->m_NextMemorySlot + 1] = max_sq_right;
+                float sum_sq[2];
+                float max_sq[2];
+                GetSquaredLevels(g->m_MixBuffer, sound->m_FrameCount, sum_sq, max_sq);
+
+                // The group gain is constant over the buffer, so it's applied to the sums
+                float gain_sq = g->m_Gain.m_Current * g->m_Gain.m_Current;
+                g->m_SumSquaredMemory[2 * g->m_NextMemorySlot + 0] = sum_sq[0] * gain_sq;
+                g->m_SumSquaredMemory[2 * g->m_NextMemorySlot + 1] = sum_sq[1] * gain_sq;
+                g->m_PeakMemorySq[2 * g->m_NextMemorySlot + 0] = max_sq[0] * gain_sq;
+                g->m_PeakMemorySq[2 * g->m_NextMemorySlot + 1] = max_sq[1] * gain_sq;
                 g->m_NextMemorySlot = (g->m_NextMemorySlot + 1) % GROUP_MEMORY_BUFFER_COUNT;
 
                 memset(g->m_MixBuffer, 0, sound->m_FrameCount * sizeof(float) * 2);
@@ -1294,8 +2546,8 @@ namespace dmSound
                 MixInstance(mix_context, instance);
             }
 
-            if (instance->m_EndOfStream && instance->m_FrameCount == 0) {
-                instance->m_Playing = 0;
+            if (instance->m_EndOfStream && instance->m_FrameCount == 0 && instance->m_Playing) {
+                EndInstance(instance);
             }
         }
     }
@@ -1307,8 +2559,7 @@ namespace dmSound
         SoundSystem* sound = g_SoundSystem;
         uint32_t n = sound->m_FrameCount;
         int16_t* out = sound->m_OutBuffers[sound->m_NextOutBuffer];
-        int* master_index = sound->m_GroupMap.Get(MASTER_GROUP_HASH);
-        SoundGroup* master = &sound->m_Groups[*master_index];
+        SoundGroup* master = &sound->m_Groups[MASTER_GROUP_INDEX];
         float* mix_buffer = master->m_MixBuffer;
 
         if (master->m_Gain.IsZero())
@@ -1317,6 +2568,12 @@ namespace dmSound
             return;
         }
 
+        // The groups are summed into the master mix buffer, and the master gain, clipping and conversion
+        // to int16 are applied in the same pass
+        const float* group_buffers[MAX_GROUPS];
+        dmSIMD::Vec4f group_gains[MAX_GROUPS];
+        dmSIMD::Vec4f group_gain_steps[MAX_GROUPS];
+        uint32_t group_count = 0;
         for (uint32_t i = 0; i < MAX_GROUPS; i++) {
             SoundGroup* g = &sound->m_Groups[i];
             if (g->m_MixBuffer == 0x0)
@@ -1331,27 +2588,53 @@ namespace dmSound
             {
                 continue;
             }
-            Ramp ramp = GetRamp(mix_context, &g->m_Gain, n);
-            for (uint32_t i = 0; i < n; i++) {
-                float gain = ramp.GetValue(i);
-                gain = dmMath::Clamp(gain, 0.0f, 1.0f);
-
-                float s1 = g->m_MixBuffer[2 * i];
-                float s2 = g->m_MixBuffer[2 * i + 1];
-                mix_buffer[2 * i] += s1 * gain;
-                mix_buffer[2 * i + 1] += s2 * gain;
+            group_buffers[group_count] = g->m_MixBuffer;
+            GetRampValues(GetRamp(mix_context, &g->m_Gain, n), &group_gains[group_count], &group_gain_steps[group_count]);
+            ++group_count;
+        }
+
+        dmSIMD::Vec4f master_gain, master_gain_step;
+        GetRampValues(GetRamp(mix_context, &master->m_Gain, n), &master_gain, &master_gain_step);
+
+        const dmSIMD::Vec4f zero = dmSIMD::Zero();
+        const dmSIMD::Vec4f one = dmSIMD::Set1(1.0f);
+        const dmSIMD::Vec4f sample_min = dmSIMD::Set1(-32768.0f);
+        const dmSIMD::Vec4f sample_max = dmSIMD::Set1(32767.0f);
+
+        uint32_t i = 0;
+        for (; i + 1 < n; i += 2) {
+            dmSIMD::Vec4f s = dmSIMD::Load(mix_buffer + 2 * i);
+            for (uint32_t j = 0; j < group_count; ++j) {
+                dmSIMD::Vec4f gain = dmSIMD::Min(dmSIMD::Max(group_gains[j], zero), one);
+                s = dmSIMD::MulAdd(dmSIMD::Load(group_buffers[j] + 2 * i), gain, s);
+                group_gains[j] = dmSIMD::Add(group_gains[j], group_gain_steps[j]);
             }
-        }
+            // Keep the sum for the master group meters
+            dmSIMD::Store(mix_buffer + 2 * i, s);
+
+            s = dmSIMD::Mul(s, master_gain);
+            s = dmSIMD::Min(dmSIMD::Max(s, sample_min), sample_max);
+            dmSIMD::StoreInt16(out + 2 * i, s);
+            master_gain = dmSIMD::Add(master_gain, master_gain_step);
+        }
+
+        if (i < n) {
+            float s1 = mix_buffer[2 * i];
+            float s2 = mix_buffer[2 * i + 1];
+            for (uint32_t j = 0; j < group_count; ++j) {
+                float gain[4];
+                dmSIMD::Store(gain, group_gains[j]);
+                gain[0] = dmMath::Clamp(gain[0], 0.0f, 1.0f);
+                s1 += group_buffers[j][2 * i] * gain[0];
+                s2 += group_buffers[j][2 * i + 1] * gain[0];
+            }
+            mix_buffer[2 * i] = s1;
+            mix_buffer[2 * i + 1] = s2;
 
-        Ramp ramp = GetRamp(mix_context, &master->m_Gain, n);
-        for (uint32_t i = 0; i < n; i++) {
-            float gain = ramp.GetValue(i);
-            float s1 = mix_buffer[2 * i] * gain;
-            float s2 = mix_buffer[2 * i + 1] * gain;
-            s1 = dmMath::Min(32767.0f, s1);
-            s1 = dmMath::Max(-32768.0f, s1);
-            s2 = dmMath::Min(32767.0f, s2);
-            s2 = dmMath::Max(-32768.0f, s2);
+            float gain[4];
+            dmSIMD::Store(gain, master_gain);
+            s1 = dmMath::Clamp(s1 * gain[0], -32768.0f, 32767.0f);
+            s2 = dmMath::Clamp(s2 * gain[0], -32768.0f, 32767.0f);
             out[2 * i] = (int16_t) s1;
             out[2 * i + 1] = (int16_t) s2;
         }
@@ -1383,9 +2666,99 @@ namespace dmSound
         }
     }
 
+    // Mixing order of the audible instances: highest priority first, then the loudest. Ties keep the real
+    // instances real, so that instances don't swap between real and virtual every update
+    struct VoiceOrder
+    {
+        SoundSystem* m_Sound;
+        VoiceOrder(SoundSystem* sound) : m_Sound(sound) {}
+
+        float GetLevel(const SoundInstance* instance) const
+        {
+            return instance->m_Gain.m_Next * m_Sound->m_Groups[instance->m_GroupIndex].m_Gain.m_Next;
+        }
+
+        bool operator()(uint16_t a, uint16_t b) const
+        {
+            const SoundInstance* ia = &m_Sound->m_Instances[a];
+            const SoundInstance* ib = &m_Sound->m_Instances[b];
+            if (ia->m_Priority != ib->m_Priority)
+                return ia->m_Priority > ib->m_Priority;
+            float la = GetLevel(ia);
+            float lb = GetLevel(ib);
+            if (la != lb)
+                return la > lb;
+            if (ia->m_Virtual != ib->m_Virtual)
+                return !ia->m_Virtual;
+            return a < b;
+        }
+    };
+
+    /*
+     * Decides which of the playing instances are mixed this update. Inaudible instances, and the ones that don't fit
+     * in the voice limit, become virtual: their position advances, but they aren't decoded or mixed.
+     * An instance that loses its voice while audible is faded out over this update first, and an instance that
+     * gets a voice back is faded in, so that neither clicks.
+     * Called once per update, after the gains have been stepped.
+     */
+    static void UpdateVoices(SoundSystem* sound)
+    {
+        DM_PROFILE(__FUNCTION__);
+
+        uint32_t virtual_count = 0;
+        sound->m_Voices.SetSize(0);
+        uint32_t instances = sound->m_Instances.Size();
+        for (uint32_t i = 0; i < instances; ++i) {
+            SoundInstance* instance = &sound->m_Instances[i];
+            if (!instance->m_Playing && instance->m_FrameCount == 0) {
+                continue;
+            }
+            if (IsMuted(instance)) {
+                instance->m_Virtual = 1;
+                instance->m_Mixed = 0;
+                ++virtual_count;
+                continue;
+            }
+            sound->m_Voices.Push((uint16_t) i);
+        }
+
+        uint32_t voice_count = sound->m_Voices.Size();
+        uint32_t real_count = voice_count;
+        if (sound->m_MaxVoices > 0 && voice_count > sound->m_MaxVoices) {
+            std::sort(sound->m_Voices.Begin(), sound->m_Voices.End(), VoiceOrder(sound));
+            real_count = sound->m_MaxVoices;
+        }
+
+        uint32_t mixed_count = 0;
+        for (uint32_t i = 0; i < voice_count; ++i) {
+            SoundInstance* instance = &sound->m_Instances[sound->m_Voices[i]];
+            if (i < real_count) {
+                if (instance->m_Virtual) {
+                    instance->m_Virtual = 0;
+                    instance->m_Gain.m_Prev = 0.0f;
+                }
+                instance->m_Mixed = 1;
+                ++mixed_count;
+            } else if (instance->m_Mixed && instance->m_Gain.m_Prev != 0.0f) {
+                instance->m_Gain.m_Current = 0.0f;
+                instance->m_Mixed = 0;
+                ++mixed_count;
+            } else {
+                instance->m_Virtual = 1;
+                instance->m_Mixed = 0;
+                ++virtual_count;
+            }
+        }
+
+        dmAtomicStore32(&sound->m_VoiceCount, (int32_t) mixed_count);
+        dmAtomicStore32(&sound->m_VirtualVoiceCount, (int32_t) virtual_count);
+    }
+
     static Result UpdateInternal(SoundSystem* sound)
     {
         DM_PROFILE(__FUNCTION__);
+        ProcessCommands(sound);
+
         if (!sound->m_Device)
         {
             return RESULT_OK;
@@ -1454,12 +2827,11 @@ namespace dmSound
             sound->m_IsDeviceStarted = true;
         }
 
-        DM_MUTEX_OPTIONAL_SCOPED_LOCK(g_SoundSystem->m_Mutex);
-
         uint32_t free_slots = sound->m_DeviceType->m_FreeBufferSlots(sound->m_Device);
         if (free_slots > 0) {
             StepGroupValues();
             StepInstanceValues();
+            UpdateVoices(sound);
         }
 
         uint32_t current_buffer = 0;
@@ -1491,6 +2863,8 @@ namespace dmSound
             Result result = RESULT_OK;
             if (!dmAtomicGet32(&sound->m_IsPaused))
                 result = UpdateInternal(sound);
+            else
+                ProcessCommands(sound);
 
             dmAtomicStore32(&sound->m_Status, (int)result);
             dmTime::Sleep(8000);
@@ -1504,8 +2878,20 @@ namespace dmSound
         if (!sound)
             return RESULT_OK;
 
+        if (sound->m_DecodeJobs)
+        {
+            DM_PROPERTY_ADD_U32(rmtp_SoundDecodeJobs, (uint32_t) dmAtomicStore32(&sound->m_DecodeJobCount, 0));
+            DM_PROPERTY_ADD_U32(rmtp_SoundDecodeUnderruns, (uint32_t) dmAtomicStore32(&sound->m_DecodeUnderrunCount, 0));
+            DM_PROPERTY_SET_U32(rmtp_SoundDecodeUnderrunsTotal, (uint32_t) dmAtomicGet32(&sound->m_DecodeUnderrunTotal));
+        }
+        DM_PROPERTY_SET_U32(rmtp_SoundPCMCacheSize, sound->m_PCMCacheSize);
+        DM_PROPERTY_SET_U32(rmtp_SoundVoices, (uint32_t) dmAtomicGet32(&sound->m_VoiceCount));
+        DM_PROPERTY_SET_U32(rmtp_SoundVirtualVoices, (uint32_t) dmAtomicGet32(&sound->m_VirtualVoiceCount));
+
         if (!sound->m_Thread)
             return UpdateInternal(sound);
+
+        FlushCommandBacklog(sound);
         return (Result)dmAtomicGet32(&sound->m_Status);
     }
 
@@ -1550,4 +2936,36 @@ namespace dmSound
     {
         return data->m_RefCount;
     }
+
+    // Unit tests
+    void GetPCMCacheStats(PCMCacheStats* stats)
+    {
+        SoundSystem* sound = g_SoundSystem;
+        stats->m_Hits = sound->m_PCMCacheHits;
+        stats->m_Misses = sound->m_PCMCacheMisses;
+        stats->m_Size = sound->m_PCMCacheSize;
+        stats->m_Capacity = sound->m_PCMCacheCapacity;
+    }
+
+    // Unit tests
+    bool IsPCMCached(HSoundData sound_data)
+    {
+        return sound_data->m_PCMCacheEntry != 0;
+    }
+
+    // Unit tests
+    void WaitForPCMCacheFill(HSoundData sound_data)
+    {
+        PCMCacheFill* fill = sound_data->m_PCMCacheFill;
+        if (fill)
+        {
+            dmJobSystem::WaitForCounter(g_SoundSystem->m_DecodeJobs, &fill->m_Counter);
+        }
+    }
+
+    // Unit tests
+    bool IsVirtual(HSoundInstance instance)
+    {
+        return instance->m_Virtual != 0;
+    }
 }
@@ -83,6 +83,10 @@ namespace dmSound
         uint32_t m_BufferSize;
         uint32_t m_FrameCount;
         uint32_t m_MaxInstances;
+        uint32_t m_DecodeAheadBuffers;  // Mix buffers of compressed sounds decoded ahead on worker threads. 0 decodes on the mixer
+        uint32_t m_DecodeThreadCount;   // Number of decode worker threads, if m_DecodeAheadBuffers > 0 or m_PCMCacheSize > 0
+        uint32_t m_PCMCacheSize;        // Kilobytes of short compressed sounds kept decoded. 0 disables the cache. Needs m_DecodeThreadCount > 0
+        uint32_t m_MaxVoices;           // Playing instances mixed at a time, the rest play as virtual voices. 0 for no limit
         bool     m_UseThread;
 
         InitializeParams()
@@ -128,6 +132,9 @@ namespace dmSound
 
     Result SetLooping(HSoundInstance sound_instance, bool looping, int8_t loopcount);
 
+    // When there are more audible instances than voices, the ones with the highest priority are mixed. 0 by default
+    Result SetPriority(HSoundInstance sound_instance, uint8_t priority);
+
     Result SetParameter(HSoundInstance sound_instance, Parameter parameter, const dmVMath::Vector4& value);
     Result GetParameter(HSoundInstance sound_instance, Parameter parameter, dmVMath::Vector4& value);
 
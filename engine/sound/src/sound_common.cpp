@@ -27,5 +27,9 @@ namespace dmSound
         params->m_BufferSize = 12 * 4096;
         params->m_FrameCount = 768;
         params->m_MaxInstances = 256;
+        params->m_DecodeAheadBuffers = 0;
+        params->m_DecodeThreadCount = 1;
+        params->m_PCMCacheSize = 0;
+        params->m_MaxVoices = 0;
     }
 }
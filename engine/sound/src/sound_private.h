@@ -31,6 +31,19 @@ namespace dmSound
     // Unit tests
     int64_t GetInternalPos(HSoundInstance);
     int32_t GetRefCount(HSoundData);
+
+    struct PCMCacheStats
+    {
+        uint32_t m_Hits;
+        uint32_t m_Misses;
+        uint32_t m_Size;        // Bytes of decoded sounds held
+        uint32_t m_Capacity;
+    };
+    void GetPCMCacheStats(PCMCacheStats* stats);
+    bool IsPCMCached(HSoundData);
+    // Waits for the decode worker to fill the cache, the next instance picks it up
+    void WaitForPCMCacheFill(HSoundData);
+    bool IsVirtual(HSoundInstance);
 }
 
 #endif // #ifndef DM_SOUND_PRIVATE_H
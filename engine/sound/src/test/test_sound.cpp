@@ -295,6 +295,103 @@ class dmSoundMixerTest : public dmSoundTest2
 {
 };
 
+class dmSoundLatencyTest : public dmSoundTest2
+{
+public:
+    static const uint32_t VOICE_COUNT = 64;
+
+    virtual void SetUp()
+    {
+        dmSound::InitializeParams params;
+        params.m_MaxBuffers = MAX_BUFFERS;
+        params.m_MaxSources = VOICE_COUNT + 1;
+        params.m_OutputDevice = m_DeviceName;
+        params.m_FrameCount = GetParam().m_BufferFrameCount;
+        params.m_UseThread = GetParam().m_UseThread;
+
+        dmSound::Result r = dmSound::Initialize(0, &params);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+};
+
+class dmSoundDecodeAheadTest : public dmSoundTest
+{
+public:
+    virtual void SetUp()
+    {
+        Initialize(4);
+    }
+
+    void Initialize(uint32_t decode_ahead_buffers)
+    {
+        dmSound::InitializeParams params;
+        params.m_MaxBuffers = MAX_BUFFERS;
+        params.m_MaxSources = MAX_SOURCES;
+        params.m_OutputDevice = m_DeviceName;
+        params.m_FrameCount = GetParam().m_BufferFrameCount;
+        params.m_UseThread = false;
+        params.m_DecodeAheadBuffers = decode_ahead_buffers;
+        params.m_DecodeThreadCount = 1;
+
+        dmSound::Result r = dmSound::Initialize(0, &params);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+};
+
+class dmSoundPCMCacheTest : public dmSoundTest
+{
+public:
+    virtual void SetUp()
+    {
+        Initialize(1024);
+    }
+
+    void Initialize(uint32_t pcm_cache_size)
+    {
+        dmSound::InitializeParams params;
+        params.m_MaxBuffers = MAX_BUFFERS;
+        params.m_MaxSources = MAX_SOURCES;
+        params.m_OutputDevice = m_DeviceName;
+        params.m_FrameCount = GetParam().m_BufferFrameCount;
+        params.m_UseThread = false;
+        params.m_PCMCacheSize = pcm_cache_size;
+        params.m_DecodeThreadCount = 1;
+
+        dmSound::Result r = dmSound::Initialize(0, &params);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    void Reinitialize(uint32_t pcm_cache_size)
+    {
+        dmSound::Result r = dmSound::Finalize();
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        Initialize(pcm_cache_size);
+    }
+};
+
+class dmSoundVoiceTest : public dmSoundTest
+{
+public:
+    virtual void SetUp()
+    {
+        Initialize(1);
+    }
+
+    void Initialize(uint32_t max_voices)
+    {
+        dmSound::InitializeParams params;
+        params.m_MaxBuffers = MAX_BUFFERS;
+        params.m_MaxSources = MAX_SOURCES;
+        params.m_OutputDevice = m_DeviceName;
+        params.m_FrameCount = GetParam().m_BufferFrameCount;
+        params.m_UseThread = false;
+        params.m_MaxVoices = max_voices;
+
+        dmSound::Result r = dmSound::Initialize(0, &params);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+};
+
 // Some arbitrary process "time" for loopback-device buffers
 #define LOOPBACK_DEVICE_PROCESS_TIME (4)
 
@@ -544,6 +641,64 @@ TEST_P(dmSoundVerifyTest, Mix)
     r = dmSound::DeleteSoundData(sd);
     ASSERT_EQ(dmSound::RESULT_OK, r);
 }
+
+// The pan scales are interpolated linearly within short segments of a pan ramp, instead of following the constant power pan law.
+// Sweeping the full pan range every mix buffer is the worst case, and the power should still stay within 0.1 dB of the pan law.
+TEST_P(dmSoundVerifyTest, PanRamp)
+{
+    TestParams params = GetParam();
+    dmSound::Result r;
+    dmSound::HSoundData sd = 0;
+    dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+
+    dmSound::HSoundInstance instance = 0;
+    r = dmSound::NewSoundInstance(sd, &instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    r = dmSound::Play(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    float pan = -1.0f;
+    do {
+        r = dmSound::SetParameter(instance, dmSound::PARAMETER_PAN, dmVMath::Vector4(pan,0,0,0));
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        pan = -pan;
+        r = dmSound::Update();
+    } while (dmSound::IsPlaying(instance));
+    r = dmSound::DeleteSoundInstance(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    const float rate = params.m_ToneRate;
+    const float mix_rate = params.m_MixRate;
+    const int n = (params.m_FrameCount * 44100) / (int) mix_rate;
+
+    // With the pan law, left^2 + right^2 is the power of the mono signal for any pan
+    double min_ratio = 1.0;
+    double max_ratio = 1.0;
+    for (int32_t i = params.m_BufferFrameCount * 2; i < n - 1; i++) {
+        int index = i * mix_rate / 44100.0;
+        double a1 = 0.8 * 32768.0 * sin((index * 2.0 * M_PI * rate) / mix_rate);
+        double a2 = 0.8 * 32768.0 * sin(((index + 1) * 2.0 * M_PI * rate) / mix_rate);
+        double frac = fmod(i * mix_rate / 44100.0, 1.0);
+        double a = a1 * (1.0 - frac) + a2 * frac;
+        // Skip the frames close to zero crossings, where the rounding dominates
+        if (fabs(a) < 0.4 * 32768.0)
+            continue;
+
+        double left = g_LoopbackDevice->m_AllOutput[2 * i];
+        double right = g_LoopbackDevice->m_AllOutput[2 * i + 1];
+        double ratio = sqrt(left * left + right * right) / fabs(a);
+        min_ratio = dmMath::Min(min_ratio, ratio);
+        max_ratio = dmMath::Max(max_ratio, ratio);
+    }
+
+    // +-0.1 dB
+    ASSERT_GT(min_ratio, pow(10.0, -0.1 / 20.0));
+    ASSERT_LT(max_ratio, pow(10.0, 0.1 / 20.0));
+
+    r = dmSound::DeleteSoundData(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+}
 #endif
 
 TEST_P(dmSoundVerifyTest, EarlyBailOnNoSoundInstances)
@@ -1117,6 +1272,505 @@ const TestParams params_verify_ogg_test[] = {TestParams("loopback",
 INSTANTIATE_TEST_CASE_P(dmSoundVerifyOggTest, dmSoundVerifyOggTest, jc_test_values_in(params_verify_ogg_test));
 #endif
 
+#if !defined(GITHUB_CI) || (defined(GITHUB_CI) && !(defined(WIN32) || defined(__MACH__)))
+static void PlayLoopsToEnd(const TestParams& params, dmArray<int16_t>& output)
+{
+    dmSound::HSoundData sd = 0;
+    dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    dmSound::HSoundInstance instance = 0;
+    r = dmSound::NewSoundInstance(sd, &instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    r = dmSound::SetLooping(instance, 1, params.m_Loopcount);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    r = dmSound::SetParameter(instance, dmSound::PARAMETER_SPEED, dmVMath::Vector4(params.m_Speed,0,0,0));
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    r = dmSound::Play(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    do {
+        r = dmSound::Update();
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    } while (dmSound::IsPlaying(instance));
+
+    r = dmSound::DeleteSoundInstance(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    r = dmSound::DeleteSoundData(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    output.SetCapacity(g_LoopbackDevice->m_AllOutput.Size());
+    output.PushArray(g_LoopbackDevice->m_AllOutput.Begin(), g_LoopbackDevice->m_AllOutput.Size());
+}
+
+// Decoding ahead on the decode workers must produce the same output as decoding on the mixer
+TEST_P(dmSoundDecodeAheadTest, SameAsMixerDecode)
+{
+    TestParams params = GetParam();
+
+    dmArray<int16_t> decoded_ahead;
+    PlayLoopsToEnd(params, decoded_ahead);
+
+    dmSound::Result r = dmSound::Finalize();
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    Initialize(0);
+
+    dmArray<int16_t> decoded_on_mixer;
+    PlayLoopsToEnd(params, decoded_on_mixer);
+
+    ASSERT_EQ(decoded_on_mixer.Size(), decoded_ahead.Size());
+    ASSERT_EQ(0, memcmp(decoded_on_mixer.Begin(), decoded_ahead.Begin(), decoded_ahead.Size() * sizeof(int16_t)));
+}
+
+const TestParams params_decode_ahead_test[] = {
+    TestParams("loopback",
+            TONE_MONO_22050_OGG,
+            TONE_MONO_22050_OGG_SIZE,
+            dmSound::SOUND_DATA_TYPE_OGG_VORBIS,
+            2000,
+            44100,
+            11025,
+            2048,
+            0.0f,
+            1.0f,
+            2),
+    TestParams("loopback",
+            TONE_MONO_22050_OGG,
+            TONE_MONO_22050_OGG_SIZE,
+            dmSound::SOUND_DATA_TYPE_OGG_VORBIS,
+            2000,
+            44100,
+            11025,
+            2048,
+            0.0f,
+            4.5f,
+            3),
+};
+INSTANTIATE_TEST_CASE_P(dmSoundDecodeAheadTest, dmSoundDecodeAheadTest, jc_test_values_in(params_decode_ahead_test));
+#endif
+
+#if !defined(GITHUB_CI) || (defined(GITHUB_CI) && !(defined(WIN32) || defined(__MACH__)))
+// Creates and deletes an instance of the sound, which puts it in the PCM cache if it's done decoding
+static void UseSound(dmSound::HSoundData sd)
+{
+    dmSound::HSoundInstance instance = 0;
+    dmSound::Result r = dmSound::NewSoundInstance(sd, &instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    r = dmSound::DeleteSoundInstance(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+}
+
+static uint32_t GetPCMCacheSize()
+{
+    dmSound::PCMCacheStats stats;
+    dmSound::GetPCMCacheStats(&stats);
+    return stats.m_Size;
+}
+
+// The first instance starts decoding the sound on the decode worker, and the second picks it up
+static void CacheSound(dmSound::HSoundData sd)
+{
+    UseSound(sd);
+    dmSound::WaitForPCMCacheFill(sd);
+    UseSound(sd);
+
+    dmSound::PCMCacheStats stats;
+    dmSound::GetPCMCacheStats(&stats);
+    ASSERT_LE(stats.m_Size, stats.m_Capacity);
+}
+
+// Bytes the sound takes in the PCM cache
+static void GetPCMCacheEntrySize(const void* sound, uint32_t sound_size, uint32_t* entry_size)
+{
+    uint32_t size_before = GetPCMCacheSize();
+    dmSound::HSoundData sd = 0;
+    dmSound::Result r = dmSound::NewSoundData(sound, sound_size, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    CacheSound(sd);
+    ASSERT_TRUE(dmSound::IsPCMCached(sd));
+    *entry_size = GetPCMCacheSize() - size_before;
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+}
+
+// Kilobytes of cache that hold four entries of entry_size bytes, and no more.
+// Each entry may take up a quarter of the cache
+static uint32_t GetPCMCacheSizeForFour(uint32_t entry_size)
+{
+    return entry_size / 256 + 1;
+}
+
+TEST_P(dmSoundPCMCacheTest, EvictsLeastRecentlyUsed)
+{
+    TestParams params = GetParam();
+    uint32_t entry_size = 0;
+    GetPCMCacheEntrySize(params.m_Sound, params.m_SoundSize, &entry_size);
+    ASSERT_LT(1024U, entry_size);
+    Reinitialize(GetPCMCacheSizeForFour(entry_size));
+
+    dmSound::HSoundData sd[5];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(sd); ++i)
+    {
+        dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd[i], i);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        CacheSound(sd[i]);
+        ASSERT_TRUE(dmSound::IsPCMCached(sd[i]));
+    }
+    ASSERT_EQ(4 * entry_size, GetPCMCacheSize());
+
+    // The second sound is now the least recently used
+    UseSound(sd[0]);
+
+    CacheSound(sd[4]);
+    ASSERT_TRUE(dmSound::IsPCMCached(sd[0]));
+    ASSERT_FALSE(dmSound::IsPCMCached(sd[1]));
+    ASSERT_TRUE(dmSound::IsPCMCached(sd[2]));
+    ASSERT_TRUE(dmSound::IsPCMCached(sd[3]));
+    ASSERT_TRUE(dmSound::IsPCMCached(sd[4]));
+    ASSERT_EQ(4 * entry_size, GetPCMCacheSize());
+
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(sd); ++i)
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd[i]));
+    }
+    ASSERT_EQ(0U, GetPCMCacheSize());
+}
+
+TEST_P(dmSoundPCMCacheTest, OnlyQuarterSizeSounds)
+{
+    TestParams params = GetParam();
+    uint32_t entry_size = 0;
+    GetPCMCacheEntrySize(params.m_Sound, params.m_SoundSize, &entry_size);
+    // A quarter of the cache is a bit smaller than the sound
+    Reinitialize(entry_size / 256);
+
+    dmSound::HSoundData sd = 0;
+    dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    CacheSound(sd);
+    ASSERT_FALSE(dmSound::IsPCMCached(sd));
+    CacheSound(sd);
+    ASSERT_FALSE(dmSound::IsPCMCached(sd));
+    ASSERT_EQ(0U, GetPCMCacheSize());
+
+    dmSound::PCMCacheStats stats;
+    dmSound::GetPCMCacheStats(&stats);
+    ASSERT_EQ(0U, stats.m_Hits);
+    ASSERT_EQ(4U, stats.m_Misses);
+
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+}
+
+TEST_P(dmSoundPCMCacheTest, PlayingNotEvicted)
+{
+    TestParams params = GetParam();
+    uint32_t entry_size = 0;
+    GetPCMCacheEntrySize(params.m_Sound, params.m_SoundSize, &entry_size);
+    Reinitialize(GetPCMCacheSizeForFour(entry_size));
+
+    dmSound::HSoundData sd[5];
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(sd); ++i)
+    {
+        dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd[i], i);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        CacheSound(sd[i]);
+    }
+
+    // Start decoding the fifth sound while the others could be evicted
+    UseSound(sd[4]);
+
+    dmSound::HSoundInstance instances[4];
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sd[i], &instances[i]));
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instances[i]));
+    }
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+
+    // The decoded fifth sound is dropped, and no new decoding is started
+    CacheSound(sd[4]);
+    CacheSound(sd[4]);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(dmSound::IsPCMCached(sd[i]));
+    }
+    ASSERT_FALSE(dmSound::IsPCMCached(sd[4]));
+    ASSERT_EQ(4 * entry_size, GetPCMCacheSize());
+
+    // Once an instance is gone, its sound may be evicted
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instances[0]));
+    CacheSound(sd[4]);
+    ASSERT_FALSE(dmSound::IsPCMCached(sd[0]));
+    ASSERT_TRUE(dmSound::IsPCMCached(sd[4]));
+
+    for (uint32_t i = 1; i < 4; ++i)
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instances[i]));
+    }
+    for (uint32_t i = 0; i < DM_ARRAY_SIZE(sd); ++i)
+    {
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd[i]));
+    }
+}
+
+TEST_P(dmSoundPCMCacheTest, InvalidatedWhileDecoding)
+{
+    TestParams params = GetParam();
+    uint32_t entry_size = 0;
+    GetPCMCacheEntrySize(params.m_Sound, params.m_SoundSize, &entry_size);
+    uint32_t other_entry_size = 0;
+    GetPCMCacheEntrySize(MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, &other_entry_size);
+    ASSERT_NE(entry_size, other_entry_size);
+
+    dmSound::HSoundData sd = 0;
+    dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    // Replace the data while the previous data is decoded
+    UseSound(sd);
+    r = dmSound::SetSoundData(sd, MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    UseSound(sd);
+    ASSERT_FALSE(dmSound::IsPCMCached(sd));
+    ASSERT_EQ(0U, GetPCMCacheSize());
+
+    // The new data is cached
+    CacheSound(sd);
+    ASSERT_TRUE(dmSound::IsPCMCached(sd));
+    ASSERT_EQ(other_entry_size, GetPCMCacheSize());
+
+    // Replacing the data removes it from the cache
+    r = dmSound::SetSoundData(sd, params.m_Sound, params.m_SoundSize);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    ASSERT_FALSE(dmSound::IsPCMCached(sd));
+    ASSERT_EQ(0U, GetPCMCacheSize());
+
+    // Delete the data while it's decoded
+    UseSound(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+    ASSERT_EQ(0U, GetPCMCacheSize());
+}
+
+static void PlayToEnd(dmSound::HSoundData sd, dmArray<int16_t>& output)
+{
+    dmSound::HSoundInstance instance = 0;
+    dmSound::Result r = dmSound::NewSoundInstance(sd, &instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    r = dmSound::Play(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    do {
+        r = dmSound::Update();
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    } while (dmSound::IsPlaying(instance));
+
+    r = dmSound::DeleteSoundInstance(instance);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    output.SetCapacity(g_LoopbackDevice->m_AllOutput.Size());
+    output.PushArray(g_LoopbackDevice->m_AllOutput.Begin(), g_LoopbackDevice->m_AllOutput.Size());
+}
+
+// Playing the cached PCM must produce the same output as decoding the sound
+TEST_P(dmSoundPCMCacheTest, SameAsDecoding)
+{
+    TestParams params = GetParam();
+
+    dmSound::HSoundData sd = 0;
+    dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    CacheSound(sd);
+    ASSERT_TRUE(dmSound::IsPCMCached(sd));
+
+    dmSound::PCMCacheStats stats;
+    dmSound::GetPCMCacheStats(&stats);
+    uint32_t hits = stats.m_Hits;
+
+    dmArray<int16_t> cached;
+    PlayToEnd(sd, cached);
+    dmSound::GetPCMCacheStats(&stats);
+    ASSERT_EQ(hits + 1, stats.m_Hits);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+
+    Reinitialize(0);
+
+    r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    dmArray<int16_t> decoded;
+    PlayToEnd(sd, decoded);
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sd));
+
+    ASSERT_LT(0U, decoded.Size());
+    ASSERT_EQ(decoded.Size(), cached.Size());
+    ASSERT_EQ(0, memcmp(decoded.Begin(), cached.Begin(), cached.Size() * sizeof(int16_t)));
+}
+
+const TestParams params_pcm_cache_test[] = {
+    TestParams("loopback",
+            TONE_MONO_22050_OGG,
+            TONE_MONO_22050_OGG_SIZE,
+            dmSound::SOUND_DATA_TYPE_OGG_VORBIS,
+            2000,
+            44100,
+            11025,
+            2048),
+};
+INSTANTIATE_TEST_CASE_P(dmSoundPCMCacheTest, dmSoundPCMCacheTest, jc_test_values_in(params_pcm_cache_test));
+#endif
+
+#if !defined(GITHUB_CI) || (defined(GITHUB_CI) && !(defined(WIN32) || defined(__MACH__)))
+// A virtual voice must stay at the same position as a real voice of the same sound, also when they swap voices
+TEST_P(dmSoundVoiceTest, VirtualInSync)
+{
+    TestParams params = GetParam();
+    dmSound::HSoundData sd = 0;
+    dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    dmSound::HSoundInstance instances[2];
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        r = dmSound::NewSoundInstance(sd, &instances[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::SetParameter(instances[i], dmSound::PARAMETER_SPEED, dmVMath::Vector4(params.m_Speed,0,0,0));
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::SetPriority(instances[i], (uint8_t) i);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::Play(instances[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    // The instances swap voices after a number of mix buffers, and the second one is faded out before it becomes virtual
+    const uint32_t swap_writes = 16;
+    const uint32_t fade_writes = 8;
+    uint32_t swapped_writes = 0;
+    do {
+        r = dmSound::Update();
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        ASSERT_LT(g_LoopbackDevice->m_NumWrites, 500); // probably will never end
+
+        ASSERT_EQ(dmSound::GetInternalPos(instances[0]), dmSound::GetInternalPos(instances[1]));
+
+        uint32_t writes = g_LoopbackDevice->m_NumWrites;
+        if (swapped_writes == 0 && writes > 0)
+        {
+            ASSERT_TRUE(dmSound::IsVirtual(instances[0]));
+            ASSERT_FALSE(dmSound::IsVirtual(instances[1]));
+        }
+        else if (swapped_writes > 0 && writes > swapped_writes + fade_writes)
+        {
+            ASSERT_FALSE(dmSound::IsVirtual(instances[0]));
+            ASSERT_TRUE(dmSound::IsVirtual(instances[1]));
+        }
+
+        if (swapped_writes == 0 && writes >= swap_writes)
+        {
+            r = dmSound::SetPriority(instances[0], 2);
+            ASSERT_EQ(dmSound::RESULT_OK, r);
+            swapped_writes = writes;
+        }
+    } while (dmSound::IsPlaying(instances[0]));
+
+    ASSERT_GT(g_LoopbackDevice->m_NumWrites, swapped_writes + fade_writes);
+    ASSERT_FALSE(dmSound::IsPlaying(instances[1]));
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        r = dmSound::DeleteSoundInstance(instances[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+    r = dmSound::DeleteSoundData(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+}
+
+static void PlayToEnd(const TestParams& params, float gain2, dmArray<int16_t>& output)
+{
+    dmSound::HSoundData sd = 0;
+    dmSound::Result r = dmSound::NewSoundData(params.m_Sound, params.m_SoundSize, params.m_Type, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    dmSound::HSoundInstance instances[2];
+    const float gains[2] = { 1.0f, gain2 };
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        r = dmSound::NewSoundInstance(sd, &instances[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::SetParameter(instances[i], dmSound::PARAMETER_GAIN, dmVMath::Vector4(gains[i],0,0,0));
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::SetParameter(instances[i], dmSound::PARAMETER_SPEED, dmVMath::Vector4(params.m_Speed,0,0,0));
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::Play(instances[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    do {
+        r = dmSound::Update();
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    } while (dmSound::IsPlaying(instances[0]) || dmSound::IsPlaying(instances[1]));
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        r = dmSound::DeleteSoundInstance(instances[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+    r = dmSound::DeleteSoundData(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    output.SetCapacity(g_LoopbackDevice->m_AllOutput.Size());
+    output.PushArray(g_LoopbackDevice->m_AllOutput.Begin(), g_LoopbackDevice->m_AllOutput.Size());
+}
+
+// With one voice, the quieter of two instances is never mixed, so the output is the same as when it's muted
+TEST_P(dmSoundVoiceTest, QuietestIsVirtual)
+{
+    TestParams params = GetParam();
+
+    dmArray<int16_t> limited;
+    PlayToEnd(params, 0.5f, limited);
+
+    dmSound::Result r = dmSound::Finalize();
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+    Initialize(0);
+
+    dmArray<int16_t> muted;
+    PlayToEnd(params, 0.0f, muted);
+
+    ASSERT_EQ(muted.Size(), limited.Size());
+    ASSERT_EQ(0, memcmp(muted.Begin(), limited.Begin(), limited.Size() * sizeof(int16_t)));
+}
+
+const TestParams params_voice_test[] = {
+    TestParams("loopback",
+            MONO_TONE_440_44100_88200_WAV,
+            MONO_TONE_440_44100_88200_WAV_SIZE,
+            dmSound::SOUND_DATA_TYPE_WAV,
+            440,
+            44100,
+            88200,
+            2048),
+    TestParams("loopback",
+            TONE_MONO_22050_OGG,
+            TONE_MONO_22050_OGG_SIZE,
+            dmSound::SOUND_DATA_TYPE_OGG_VORBIS,
+            2000,
+            44100,
+            11025,
+            2048,
+            0.0f,
+            1.5f),
+};
+INSTANTIATE_TEST_CASE_P(dmSoundVoiceTest, dmSoundVoiceTest, jc_test_values_in(params_voice_test));
+#endif
+
 #if !defined(GITHUB_CI) || (defined(GITHUB_CI) && !(defined(WIN32) || defined(__MACH__)))
 TEST_P(dmSoundTestPlayTest, Play)
 {
@@ -1610,6 +2264,100 @@ const TestParams2 params_mixer_test[] = {
 INSTANTIATE_TEST_CASE_P(dmSoundMixerTest, dmSoundMixerTest, jc_test_values_in(params_mixer_test));
 #endif
 
+#if !defined(GITHUB_CI) || (defined(GITHUB_CI) && !(defined(WIN32) || defined(__MACH__)))
+// Game thread calls are queued to the mixer and should not wait for a mix pass to finish
+TEST_P(dmSoundLatencyTest, PlayLatency)
+{
+    TestParams2 params = GetParam();
+    dmSound::Result r;
+    dmSound::HSoundData sd = 0;
+    r = dmSound::NewSoundData(params.m_Sound1, params.m_SoundSize1, params.m_Type1, &sd, 1234);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+
+    const uint32_t voice_count = VOICE_COUNT;
+    dmSound::HSoundInstance voices[voice_count];
+    for (uint32_t i = 0; i < voice_count; ++i)
+    {
+        r = dmSound::NewSoundInstance(sd, &voices[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::SetLooping(voices[i], true, -1);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::Play(voices[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    dmTime::Sleep(50000);
+
+    const uint32_t iterations = 100;
+    uint64_t max_time = 0;
+    uint64_t total_time = 0;
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        dmSound::HSoundInstance instance = 0;
+        r = dmSound::NewSoundInstance(sd, &instance);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+
+        uint64_t start = dmTime::GetTime();
+        r = dmSound::Play(instance);
+        uint64_t time = dmTime::GetTime() - start;
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        max_time = dmMath::Max(max_time, time);
+        total_time += time;
+
+        dmTime::Sleep(1000);
+
+        r = dmSound::Stop(instance);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::DeleteSoundInstance(instance);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    printf("Play latency with %u voices: max %.3f ms, avg %.3f ms\n", voice_count, max_time / 1000.0f, total_time / (iterations * 1000.0f));
+
+    // Waiting for a mix pass would take about as long as the mixed buffer plays (the loopback device mixes at 44.1kHz)
+    uint64_t buffer_time = (uint64_t) params.m_BufferFrameCount * 1000000 / 44100;
+    ASSERT_LT(max_time, buffer_time);
+    ASSERT_LT(total_time / iterations, 1000u);
+
+    for (uint32_t i = 0; i < voice_count; ++i)
+    {
+        ASSERT_TRUE(dmSound::IsPlaying(voices[i]));
+        r = dmSound::Stop(voices[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+        r = dmSound::DeleteSoundInstance(voices[i]);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    r = dmSound::DeleteSoundData(sd);
+    ASSERT_EQ(dmSound::RESULT_OK, r);
+}
+
+const TestParams2 params_latency_test[] = {
+    TestParams2("loopback",
+                MONO_TONE_440_22050_44100_WAV,
+                MONO_TONE_440_22050_44100_WAV_SIZE,
+                dmSound::SOUND_DATA_TYPE_WAV,
+                440,
+                22050,
+                44100,
+                1.0f,
+                false,
+
+                MONO_TONE_440_22050_44100_WAV,
+                MONO_TONE_440_22050_44100_WAV_SIZE,
+                dmSound::SOUND_DATA_TYPE_WAV,
+                440,
+                22050,
+                44100,
+                1.0f,
+                false,
+
+                2048,
+                true),
+};
+INSTANTIATE_TEST_CASE_P(dmSoundLatencyTest, dmSoundLatencyTest, jc_test_values_in(params_latency_test));
+#endif
+
 DM_DECLARE_SOUND_DEVICE(LoopBackDevice, "loopback", DeviceLoopbackOpen, DeviceLoopbackClose, DeviceLoopbackQueue, DeviceLoopbackFreeBufferSlots, DeviceLoopbackDeviceInfo, DeviceLoopbackRestart, DeviceLoopbackStop);
 
 int main(int argc, char **argv)
@@ -24,6 +24,12 @@
 #include "../sound.h"
 #include "../sound_codec.h"
 #include "../sound_decoder.h"
+#include "../sound_private.h"
+
+#include "test/mono_tone_440_22050_44100.wav.embed.h"
+#include "test/mono_tone_440_44100_88200.wav.embed.h"
+#include "test/stereo_tone_440_32000_64000.wav.embed.h"
+#include "test/stereo_tone_440_44100_88200.wav.embed.h"
 
 #define DEF_EMBED(x) \
     extern unsigned char x[]; \
@@ -36,6 +42,8 @@ DEF_EMBED(EXPLOSION_LOW_MONO_OGG)
 DEF_EMBED(MUSIC_OGG)
 DEF_EMBED(CYMBAL_OGG)
 DEF_EMBED(MUSIC_LOW_OGG)
+DEF_EMBED(MONO_RESAMPLE_FRAMECOUNT_16000_OGG)
+DEF_EMBED(LAYER_GUITAR_A_OGG)
 
 #undef DEF_EMBED
 
@@ -135,6 +143,179 @@ public:
     }
 };
 
+// Discards the output, and always has a free buffer so that each dmSound::Update() mixes one buffer
+static dmSound::Result DevicePerfOpen(const dmSound::OpenDeviceParams* params, dmSound::HDevice* device)
+{
+    *device = (dmSound::HDevice) 1;
+    return dmSound::RESULT_OK;
+}
+
+static void DevicePerfClose(dmSound::HDevice device)
+{
+}
+
+static dmSound::Result DevicePerfQueue(dmSound::HDevice device, const int16_t* samples, uint32_t sample_count)
+{
+    return dmSound::RESULT_OK;
+}
+
+static uint32_t DevicePerfFreeBufferSlots(dmSound::HDevice device)
+{
+    return 1;
+}
+
+static void DevicePerfDeviceInfo(dmSound::HDevice device, dmSound::DeviceInfo* info)
+{
+    info->m_MixRate = 44100;
+}
+
+static void DevicePerfStart(dmSound::HDevice device)
+{
+}
+
+static void DevicePerfStop(dmSound::HDevice device)
+{
+}
+
+class dmSoundMixerPerfTest : public jc_test_base_class
+{
+public:
+    virtual void SetUp()
+    {
+        Initialize(0, 0);
+    }
+
+    void Initialize(uint32_t pcm_cache_size, uint32_t max_voices)
+    {
+        dmSound::InitializeParams params;
+        dmSound::SetDefaultInitializeParams(&params);
+        params.m_OutputDevice = "perf";
+        params.m_MaxSources = 128;
+        params.m_UseThread = false;
+        params.m_PCMCacheSize = pcm_cache_size;
+        params.m_MaxVoices = max_voices;
+
+        dmSound::Result r = dmSound::Initialize(0, &params);
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    virtual void TearDown()
+    {
+        dmSound::Result r = dmSound::Finalize();
+        ASSERT_EQ(dmSound::RESULT_OK, r);
+    }
+
+    // Plays voice_count looping voices, panned and with a gain, and reports how many voices are mixed per ms
+    void MixAndTime(const void* sound, uint32_t sound_size, uint32_t voice_count, const char* test_name)
+    {
+        const uint32_t update_count = 200;
+
+        dmSound::HSoundData sound_data = 0;
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(sound, sound_size, dmSound::SOUND_DATA_TYPE_WAV, &sound_data, 1234));
+
+        dmSound::HSoundInstance instances[128];
+        ASSERT_LE(voice_count, sizeof(instances) / sizeof(instances[0]));
+        for (uint32_t i = 0; i < voice_count; ++i)
+        {
+            ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sound_data, &instances[i]));
+            dmSound::SetLooping(instances[i], true, -1);
+            dmSound::SetParameter(instances[i], dmSound::PARAMETER_GAIN, dmVMath::Vector4(0.5f, 0, 0, 0));
+            dmSound::SetParameter(instances[i], dmSound::PARAMETER_PAN, dmVMath::Vector4((i % 3) * 0.5f - 0.5f, 0, 0, 0));
+            ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instances[i]));
+        }
+
+        // Get past the initial ramps
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            dmSound::Update();
+        }
+
+        uint64_t max_update_time = 0;
+        const uint64_t time_begin = dmTime::GetTime();
+        for (uint32_t i = 0; i < update_count; ++i)
+        {
+            const uint64_t update_begin = dmTime::GetTime();
+            ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+            const uint64_t update_time = dmTime::GetTime() - update_begin;
+            if (update_time > max_update_time)
+                max_update_time = update_time;
+        }
+        const float total_ms = (dmTime::GetTime() - time_begin) * 0.001f;
+
+        printf("[Mixer - %s] Voices: %u, buffers: %u", test_name, voice_count, update_count);
+        printf(" | Total: %.3f ms, max: %.3f ms, avg: %.3f ms", total_ms, max_update_time * 0.001f, total_ms / update_count);
+        printf(" | Voices mixed per ms: %.1f\n", (voice_count * update_count) / total_ms);
+
+        for (uint32_t i = 0; i < voice_count; ++i)
+        {
+            ASSERT_TRUE(dmSound::IsPlaying(instances[i]));
+            dmSound::Stop(instances[i]);
+            ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instances[i]));
+        }
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sound_data));
+    }
+
+    // Plays waves of one-shot voices of a compressed sound to the end, and reports the time per voice, including creating the instances
+    void PlayOneShotsAndTime(const void* sound, uint32_t sound_size, uint32_t pcm_cache_size, const char* test_name)
+    {
+        const uint32_t wave_count = 4;
+        const uint32_t voice_count = 16;
+
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+        Initialize(pcm_cache_size, 0);
+
+        dmSound::HSoundData sound_data = 0;
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundData(sound, sound_size, dmSound::SOUND_DATA_TYPE_OGG_VORBIS, &sound_data, 1234));
+
+        uint32_t update_count = 0;
+        const uint64_t time_begin = dmTime::GetTime();
+        for (uint32_t wave = 0; wave < wave_count; ++wave)
+        {
+            dmSound::HSoundInstance instances[voice_count];
+            for (uint32_t i = 0; i < voice_count; ++i)
+            {
+                ASSERT_EQ(dmSound::RESULT_OK, dmSound::NewSoundInstance(sound_data, &instances[i]));
+                dmSound::SetParameter(instances[i], dmSound::PARAMETER_GAIN, dmVMath::Vector4(0.5f, 0, 0, 0));
+                ASSERT_EQ(dmSound::RESULT_OK, dmSound::Play(instances[i]));
+            }
+
+            bool playing = true;
+            while (playing)
+            {
+                ASSERT_EQ(dmSound::RESULT_OK, dmSound::Update());
+                ++update_count;
+                playing = false;
+                for (uint32_t i = 0; i < voice_count; ++i)
+                {
+                    playing |= dmSound::IsPlaying(instances[i]);
+                }
+            }
+
+            for (uint32_t i = 0; i < voice_count; ++i)
+            {
+                ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundInstance(instances[i]));
+            }
+        }
+        const float total_ms = (dmTime::GetTime() - time_begin) * 0.001f;
+
+        dmSound::PCMCacheStats stats;
+        dmSound::GetPCMCacheStats(&stats);
+        printf("[Mixer - %s] Voices: %u, buffers: %u", test_name, wave_count * voice_count, update_count);
+        printf(" | Total: %.3f ms, per voice: %.3f ms", total_ms, total_ms / (wave_count * voice_count));
+        printf(" | PCM cache hits: %u, misses: %u, bytes: %u\n", stats.m_Hits, stats.m_Misses, stats.m_Size);
+
+        if (pcm_cache_size > 0)
+        {
+            // The instances created before the decode worker has filled the cache decode the sound themselves
+            ASSERT_LE(1U, stats.m_Misses);
+            ASSERT_LT(0U, stats.m_Hits);
+            ASSERT_EQ(wave_count * voice_count, stats.m_Hits + stats.m_Misses);
+        }
+
+        ASSERT_EQ(dmSound::RESULT_OK, dmSound::DeleteSoundData(sound_data));
+    }
+};
+
 #if !defined(GITHUB_CI) || (defined(GITHUB_CI) && !defined(__MACH__))
 TEST_F(dmSoundTest, MeasureStdb)
 {
@@ -155,8 +336,49 @@ TEST_F(dmSoundTest, MeasureTremoloSkip)
 {
     RunSuite("VorbisDecoderTremolo", true);
 }
+
+TEST_F(dmSoundMixerPerfTest, MixIdentityMono)
+{
+    MixAndTime(MONO_TONE_440_44100_88200_WAV, MONO_TONE_440_44100_88200_WAV_SIZE, 64, "Identity Mono 44100");
+}
+
+TEST_F(dmSoundMixerPerfTest, MixIdentityStereo)
+{
+    MixAndTime(STEREO_TONE_440_44100_88200_WAV, STEREO_TONE_440_44100_88200_WAV_SIZE, 64, "Identity Stereo 44100");
+}
+
+TEST_F(dmSoundMixerPerfTest, MixResampleMono)
+{
+    MixAndTime(MONO_TONE_440_22050_44100_WAV, MONO_TONE_440_22050_44100_WAV_SIZE, 64, "Resample Mono 22050");
+}
+
+TEST_F(dmSoundMixerPerfTest, MixResampleStereo)
+{
+    MixAndTime(STEREO_TONE_440_32000_64000_WAV, STEREO_TONE_440_32000_64000_WAV_SIZE, 64, "Resample Stereo 32000");
+}
+
+TEST_F(dmSoundMixerPerfTest, MixVoiceLimit)
+{
+    ASSERT_EQ(dmSound::RESULT_OK, dmSound::Finalize());
+    Initialize(0, 16);
+    MixAndTime(MONO_TONE_440_22050_44100_WAV, MONO_TONE_440_22050_44100_WAV_SIZE, 64, "Resample Mono 22050, 16 voices");
+}
+
+TEST_F(dmSoundMixerPerfTest, OneShotsMono)
+{
+    PlayOneShotsAndTime(MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, 0, "One-shots Mono 16000, no PCM cache");
+    PlayOneShotsAndTime(MONO_RESAMPLE_FRAMECOUNT_16000_OGG, MONO_RESAMPLE_FRAMECOUNT_16000_OGG_SIZE, 4096, "One-shots Mono 16000, PCM cache");
+}
+
+TEST_F(dmSoundMixerPerfTest, OneShotsStereo)
+{
+    PlayOneShotsAndTime(LAYER_GUITAR_A_OGG, LAYER_GUITAR_A_OGG_SIZE, 0, "One-shots Stereo 44100, no PCM cache");
+    PlayOneShotsAndTime(LAYER_GUITAR_A_OGG, LAYER_GUITAR_A_OGG_SIZE, 4096, "One-shots Stereo 44100, PCM cache");
+}
 #endif
 
+DM_DECLARE_SOUND_DEVICE(PerfSoundDevice, "perf", DevicePerfOpen, DevicePerfClose, DevicePerfQueue, DevicePerfFreeBufferSlots, DevicePerfDeviceInfo, DevicePerfStart, DevicePerfStop);
+
 int main(int argc, char **argv)
 {
     jc_test_init(&argc, argv);